@@ -4,37 +4,170 @@
 #include "stdafx.h"
 #include "timer.h"
 #include <conio.h>
+#include <math.h>
 #include <vector>
+#include <algorithm>
+
+#include "..\..\Source_100624\Extras\Simd\Blas1.h"
+
+using namespace Extras;
 
-int _tmain(int argc, _TCHAR* argv[])
-{
 #define MAX_SIZE2	10000000
+#define REPEAT	5
+
+// Reductions store their result here so the compiler can't drop them.
+volatile float g_sink;
+
+// Scalar versions of each kernel, kept out of the auto-vectorizer as the baseline.
+
+void ScalarAdd(const float* x, const float* y, float* z, int n)
+{
+#pragma loop(no_vector)
+	for (int i = 0; i < n; i++)
+		z[i] = x[i] + y[i];
+}
+
+void ScalarScale(float alpha, float* x, int n)
+{
+#pragma loop(no_vector)
+	for (int i = 0; i < n; i++)
+		x[i] *= alpha;
+}
+
+void ScalarAxpy(float alpha, const float* x, float* y, int n)
+{
+#pragma loop(no_vector)
+	for (int i = 0; i < n; i++)
+		y[i] += alpha * x[i];
+}
+
+float ScalarDot(const float* x, const float* y, int n)
+{
+	float sum = 0.0f;
+#pragma loop(no_vector)
+	for (int i = 0; i < n; i++)
+		sum += x[i] * y[i];
+	return sum;
+}
+
+float ScalarNrm2(const float* x, int n)
+{
+	float sum = 0.0f;
+#pragma loop(no_vector)
+	for (int i = 0; i < n; i++)
+		sum += x[i] * x[i];
+	return sqrtf(sum);
+}
 
-	std::vector<int> view_a(MAX_SIZE2);
-	std::vector<int> view_b(MAX_SIZE2);
-	std::vector<int> view_c(MAX_SIZE2);
+void ScalarTriad(const float* b, const float* c, float scalar, float* a, int n)
+{
+#pragma loop(no_vector)
+	for (int i = 0; i < n; i++)
+		a[i] = b[i] + scalar * c[i];
+}
 
-	Timer total;
+void ScalarFmaAccumulate(const float* x, const float* y, float* z, int n)
+{
+#pragma loop(no_vector)
+	for (int i = 0; i < n; i++)
+		z[i] += x[i] * y[i];
+}
 
-	total.Start();
+float ScalarAbsMax(const float* x, int n)
+{
+	float result = 0.0f;
 #pragma loop(no_vector)
-	for (unsigned int i = 0; i < MAX_SIZE2; i++)
+	for (int i = 0; i < n; i++)
+		result = (fabsf(x[i]) > result) ? fabsf(x[i]) : result;
+	return result;
+}
+
+// Best time in ms over REPEAT runs.
+
+template <typename Body>
+double BestOf(const Body& body)
+{
+	Timer timer;
+	double best = 0.0;
+	for (int r = 0; r < REPEAT; r++)
 	{
-		view_c[i] = view_a[i] + view_b[i];
+		timer.Start();
+		body();
+		timer.Stop();
+		best = (r == 0) ? timer.Elapsed() : (std::min)(best, timer.Elapsed());
 	}
-	total.Stop();
-	printf("%-10s \t%f\n", "no_vector", total.Elapsed());
+	return best;
+}
+
+void Report(const char* kernel, const char* version, double bytes, double ms, double baseline)
+{
+	printf("%-10s \t%-10s \t%10f ms \t%8.2f GB/s \t%6.2fx\n", kernel, version, ms, bytes / (ms * 1.0e6), baseline / ms);
+}
 
+// Times the scalar loop, the SIMD kernel single threaded at each level the CPU supports and
+// the widest kernel running on all cores. bytesPerElement is the memory traffic per element.
+
+template <typename Scalar, typename Simd>
+void Benchmark(const char* kernel, int bytesPerElement, const Scalar& scalar, const Simd& simd)
+{
+	const SimdLevel levels[] = { SimdLevel::Sse2, SimdLevel::Avx2, SimdLevel::Avx512 };
+	const char* names[] = { "sse2", "avx2", "avx512" };
+	const double bytes = double(bytesPerElement) * MAX_SIZE2;
 
-	total.Start();
-	for (unsigned int i = 0; i < MAX_SIZE2; i++)
+	const double baseline = BestOf(scalar);
+	Report(kernel, "no_vector", bytes, baseline, baseline);
+	for (int l = 0; l < 3; l++)
 	{
-		view_c[i] = view_a[i] + view_b[i];
+		if (levels[l] > GetSimdLevel())
+			break;
+		Report(kernel, names[l], bytes, BestOf([&] { simd(levels[l], false); }), baseline);
 	}
-	total.Stop();
-	printf("%-10s \t%f\n", "vector", total.Elapsed());
+	Report(kernel, "parallel", bytes, BestOf([&] { simd(GetSimdLevel(), true); }), baseline);
+	printf("\n");
+}
+
+int _tmain(int argc, _TCHAR* argv[])
+{
+	std::vector<float> view_a(MAX_SIZE2);
+	std::vector<float> view_b(MAX_SIZE2);
+	std::vector<float> view_c(MAX_SIZE2);
+	for (int i = 0; i < MAX_SIZE2; i++)
+	{
+		view_a[i] = float(i % 1000) / 1000.0f;
+		view_b[i] = float(i % 777) / 777.0f - 0.5f;
+	}
+	float* a = view_a.data();
+	float* b = view_b.data();
+	float* c = view_c.data();
+	const int n = MAX_SIZE2;
+
+	printf("SIMD level %d, %d elements\n\n", int(GetSimdLevel()), n);
+
+	Benchmark("add", 12,
+		[=] { ScalarAdd(a, b, c, n); },
+		[=](SimdLevel level, bool parallel) { Blas1::Add(a, b, c, n, level, parallel); });
+	Benchmark("scale", 8,
+		[=] { ScalarScale(0.999f, c, n); },
+		[=](SimdLevel level, bool parallel) { Blas1::Scale(0.999f, c, n, level, parallel); });
+	Benchmark("axpy", 12,
+		[=] { ScalarAxpy(0.5f, a, c, n); },
+		[=](SimdLevel level, bool parallel) { Blas1::Axpy(0.5f, a, c, n, level, parallel); });
+	Benchmark("dot", 8,
+		[=] { g_sink = ScalarDot(a, b, n); },
+		[=](SimdLevel level, bool parallel) { g_sink = Blas1::Dot(a, b, n, level, parallel); });
+	Benchmark("nrm2", 4,
+		[=] { g_sink = ScalarNrm2(a, n); },
+		[=](SimdLevel level, bool parallel) { g_sink = Blas1::Nrm2(a, n, level, parallel); });
+	Benchmark("triad", 12,
+		[=] { ScalarTriad(a, b, 3.0f, c, n); },
+		[=](SimdLevel level, bool parallel) { Blas1::Triad(a, b, 3.0f, c, n, level, parallel); });
+	Benchmark("fma_acc", 16,
+		[=] { ScalarFmaAccumulate(a, b, c, n); },
+		[=](SimdLevel level, bool parallel) { Blas1::FmaAccumulate(a, b, c, n, level, parallel); });
+	Benchmark("abs_max", 4,
+		[=] { g_sink = ScalarAbsMax(b, n); },
+		[=](SimdLevel level, bool parallel) { g_sink = Blas1::AbsMax(b, n, level, parallel); });
 
 	_getch();
 	return 0;
 }
-
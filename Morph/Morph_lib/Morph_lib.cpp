@@ -9,6 +9,8 @@
 #include "stdafx.h"
 #include <assert.h>
 #include <iostream>
+#include "..\..\Source_100624\Extras\Imaging\CpuTexture.h"
+#include "..\..\Source_100624\Extras\Simd\BytePermute.h"
 using namespace concurrency;
 using namespace concurrency::graphics;
 using namespace concurrency::fast_math;
@@ -278,28 +280,29 @@ public:
 		: compute_morph(line_pairs_ptr, line_pairs_num, const_a, const_b, const_p)
 		, use_ppl(use_ppl)
 		, size(height, width)
-		, start(new unsigned char[size.size() * 4])
-		, end(new unsigned char[size.size() * 4])
+		, start(width, height, reinterpret_cast<const Extras::Unorm8x4*>(start_image_ptr))
+		, end(width, height, reinterpret_cast<const Extras::Unorm8x4*>(end_image_ptr))
 		, start_intermediate(new unsigned char[size.size() * 4])
 		, end_intermediate(new unsigned char[size.size() * 4])
 	{
-		memcpy(start.get(), start_image_ptr, size.size() * 4);
-		memcpy(end.get(), end_image_ptr, size.size() * 4);
 	}
 
 	void compute(char* output_ptr, float percentage) override;
 
 private:
+	// Pre-image lookups scatter across the source image, so the sources are kept in tiled
+	// order where 2D neighbors share cache lines.
+	typedef Extras::CpuTexture<Extras::Unorm8x4, Extras::TiledLayout<>> source_texture;
+
 	int linearize(const index<2>& idx) const;
-	unsigned char saturate(float v) const;
-	void compute_preimage(const unsigned char* source, unsigned char* dest, const std::vector<line_pair>& line_pairs);
+	void compute_preimage(const source_texture& source, unsigned char* dest, const std::vector<line_pair>& line_pairs);
 	void blend_images(unsigned char* output_ptr, float blend_factor);
 	void operator=(compute_morph_cpp&);
 
 	bool use_ppl;
 	extent<2> size;
-	std::unique_ptr<unsigned char[]> start;
-	std::unique_ptr<unsigned char[]> end;
+	const source_texture start;
+	const source_texture end;
 	std::unique_ptr<unsigned char[]> start_intermediate;
 	std::unique_ptr<unsigned char[]> end_intermediate;
 };
@@ -307,8 +310,8 @@ private:
 void compute_morph_cpp::compute(char* output_ptr, float percentage)
 {
 	interpolate_lines(percentage);
-	compute_preimage(start.get(), start_intermediate.get(), forwards_line_pairs);
-	compute_preimage(end.get(), end_intermediate.get(), backwards_line_pairs);
+	compute_preimage(start, start_intermediate.get(), forwards_line_pairs);
+	compute_preimage(end, end_intermediate.get(), backwards_line_pairs);
 	blend_images(reinterpret_cast<unsigned char*>(output_ptr), 1 - percentage);
 }
 
@@ -317,17 +320,7 @@ int compute_morph_cpp::linearize(const index<2>& idx) const
 	return (idx[0] * size[1] + idx[1]) * 4;
 }
 
-unsigned char compute_morph_cpp::saturate(float v) const
-{
-	if(v > UCHAR_MAX)
-		return UCHAR_MAX;
-	else if(v < 0)
-		return 0;
-	else
-		return static_cast<unsigned char>(v);
-}
-
-void compute_morph_cpp::compute_preimage(const unsigned char* source, unsigned char* dest, const std::vector<line_pair>& line_pairs)
+void compute_morph_cpp::compute_preimage(const source_texture& source, unsigned char* dest, const std::vector<line_pair>& line_pairs)
 {
 	if(!use_ppl)
 	{
@@ -339,17 +332,13 @@ void compute_morph_cpp::compute_preimage(const unsigned char* source, unsigned c
 				float_2 pf = get_preimage_location(idx, line_pairs.data(), line_pairs.size(), const_a, const_b, const_p);
 				index<2> p = clamp_point(pf, size);
 				int offset_idx = linearize(idx);
-				int offset_p = linearize(p);
-				dest[offset_idx + 0] = source[offset_p + 0];
-				dest[offset_idx + 1] = source[offset_p + 1];
-				dest[offset_idx + 2] = source[offset_p + 2];
-				dest[offset_idx + 3] = source[offset_p + 3];
+				*reinterpret_cast<Extras::Unorm8x4*>(dest + offset_idx) = source.Load(p[1], p[0]);
 			}
 		}
 	}
 	else
 	{
-		parallel_for(0, size[0], 1, [=](int y)
+		parallel_for(0, size[0], 1, [=, &source](int y)
 		{
 			for(int x = 0; x < size[1]; x++)
 			{
@@ -357,11 +346,7 @@ void compute_morph_cpp::compute_preimage(const unsigned char* source, unsigned c
 				float_2 pf = get_preimage_location(idx, line_pairs.data(), line_pairs.size(), const_a, const_b, const_p);
 				index<2> p = clamp_point(pf, size);
 				int offset_idx = linearize(idx);
-				int offset_p = linearize(p);
-				dest[offset_idx + 0] = source[offset_p + 0];
-				dest[offset_idx + 1] = source[offset_p + 1];
-				dest[offset_idx + 2] = source[offset_p + 2];
-				dest[offset_idx + 3] = source[offset_p + 3];
+				*reinterpret_cast<Extras::Unorm8x4*>(dest + offset_idx) = source.Load(p[1], p[0]);
 			}
 		});
 	}
@@ -369,32 +354,22 @@ void compute_morph_cpp::compute_preimage(const unsigned char* source, unsigned c
 
 void compute_morph_cpp::blend_images(unsigned char* output_ptr, float blend_factor)
 {
+	// Rows are blended with SIMD byte arithmetic, see Extras\Simd\BytePermute.h.
+	const size_t row_bytes = size[1] * 4U;
 	if(!use_ppl)
 	{
 		for(int y = 0; y < size[0]; y++)
 		{
-			for(int x = 0; x < size[1]; x++)
-			{
-				int offset = linearize(index<2>(y, x));
-				output_ptr[offset + 0] = saturate(static_cast<float>(start_intermediate[offset + 0]) * blend_factor + static_cast<float>(end_intermediate[offset + 0]) * (1 - blend_factor));
-				output_ptr[offset + 1] = saturate(static_cast<float>(start_intermediate[offset + 1]) * blend_factor + static_cast<float>(end_intermediate[offset + 1]) * (1 - blend_factor));
-				output_ptr[offset + 2] = saturate(static_cast<float>(start_intermediate[offset + 2]) * blend_factor + static_cast<float>(end_intermediate[offset + 2]) * (1 - blend_factor));
-				output_ptr[offset + 3] = saturate(static_cast<float>(start_intermediate[offset + 3]) * blend_factor + static_cast<float>(end_intermediate[offset + 3]) * (1 - blend_factor));
-			}
+			const size_t offset = y * row_bytes;
+			Extras::LerpBytes(start_intermediate.get() + offset, end_intermediate.get() + offset, output_ptr + offset, row_bytes, blend_factor);
 		}
 	}
 	else
 	{
 		parallel_for(0, size[0], 1, [=](int y)
 		{
-			for(int x = 0; x < size[1]; x++)
-			{
-				int offset = linearize(index<2>(y, x));
-				output_ptr[offset + 0] = saturate(static_cast<float>(start_intermediate[offset + 0]) * blend_factor + static_cast<float>(end_intermediate[offset + 0]) * (1 - blend_factor));
-				output_ptr[offset + 1] = saturate(static_cast<float>(start_intermediate[offset + 1]) * blend_factor + static_cast<float>(end_intermediate[offset + 1]) * (1 - blend_factor));
-				output_ptr[offset + 2] = saturate(static_cast<float>(start_intermediate[offset + 2]) * blend_factor + static_cast<float>(end_intermediate[offset + 2]) * (1 - blend_factor));
-				output_ptr[offset + 3] = saturate(static_cast<float>(start_intermediate[offset + 3]) * blend_factor + static_cast<float>(end_intermediate[offset + 3]) * (1 - blend_factor));
-			}
+			const size_t offset = y * row_bytes;
+			Extras::LerpBytes(start_intermediate.get() + offset, end_intermediate.get() + offset, output_ptr + offset, row_bytes, blend_factor);
 		});
 	}
 }
@@ -0,0 +1,404 @@
+//===============================================================================
+//
+// Microsoft Press
+// C++ AMP: Accelerated Massive Parallelism with Microsoft Visual C++
+//
+//===============================================================================
+// Copyright (c) 2012 Ade Miller & Kate Gregory.  All rights reserved.
+// This code released under the terms of the
+// Microsoft Public License (Ms-PL), http://ampbook.codeplex.com/license.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//===============================================================================
+
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+#include <assert.h>
+#include <emmintrin.h>
+#include <amp_short_vectors.h>
+
+#include "PixelFormat.h"
+
+using namespace concurrency::graphics;
+
+//--------------------------------------------------------------------------------------
+//  A CPU texture that stores its texels in a cache friendly, swizzled order.
+//--------------------------------------------------------------------------------------
+//
+//  A row-major image is a poor fit for 2D neighborhood gathers and warps on the CPU. Moving
+//  one pixel down touches a new cache line and a pre-image lookup that wanders diagonally
+//  touches a new line on almost every read. CpuTexture stores texels in either fixed size
+//  square tiles (TiledLayout) or Morton (Z-order) (MortonLayout) so that texels which are
+//  close in 2D are also close in memory.
+//
+//  Texel coordinates follow the C++ AMP texture convention, x is the column and y is the
+//  row. Sampling coordinates are in texel space and texel centers are at (x + 0.5, y + 0.5)
+//  as they are for D3D textures.
+
+namespace Extras
+{
+    enum class AddressMode
+    {
+        Clamp,
+        Wrap
+    };
+
+    //  Conversion from the stored texel type to the type used for filtering.
+
+    template <typename T>
+    struct TexelTraits
+    {
+        typedef T FloatType;
+
+        static inline FloatType ToFloat(const T& texel) { return texel; }
+    };
+
+    template <>
+    struct TexelTraits<Unorm8x4>
+    {
+        typedef float_4 FloatType;
+
+        static inline FloatType ToFloat(const Unorm8x4& texel) { return UnpackUnorm(texel); }
+    };
+
+    namespace details
+    {
+        //  Spread the low 16 bits of v so that there is a zero bit between each of them.
+
+        inline unsigned Part1By1(unsigned v)
+        {
+            v &= 0x0000FFFF;
+            v = (v | (v << 8)) & 0x00FF00FF;
+            v = (v | (v << 4)) & 0x0F0F0F0F;
+            v = (v | (v << 2)) & 0x33333333;
+            v = (v | (v << 1)) & 0x55555555;
+            return v;
+        }
+
+        inline int NextPowerOfTwo(int v)
+        {
+            int p = 1;
+            while (p < v)
+                p <<= 1;
+            return p;
+        }
+
+        //  Copy bytes between two buffers using 16 byte SSE2 moves. The byte count must be
+        //  a multiple of 16.
+
+        inline void Copy16(void* const pDest, const void* const pSrc, size_t bytes)
+        {
+            assert((bytes % 16) == 0);
+            const __m128i* pS = static_cast<const __m128i*>(pSrc);
+            __m128i* pD = static_cast<__m128i*>(pDest);
+            for (size_t i = 0; i < bytes / 16; ++i)
+                _mm_storeu_si128(pD + i, _mm_loadu_si128(pS + i));
+        }
+
+        inline int Address(int coord, int size, AddressMode mode)
+        {
+            if (mode == AddressMode::Wrap)
+            {
+                coord %= size;
+                return (coord < 0) ? coord + size : coord;
+            }
+            return (std::min)((std::max)(coord, 0), size - 1);
+        }
+    }
+
+    //--------------------------------------------------------------------------------------
+    //  Tiled layout.
+    //--------------------------------------------------------------------------------------
+    //
+    //  The image is divided into square tiles of (1 << TileShift) texels on a side. Tiles are
+    //  stored in row-major order and texels within each tile are also row-major. The default
+    //  4 x 4 tile of 32 bit texels fills exactly one 64 byte cache line.
+
+    template <int TileShift = 2>
+    class TiledLayout
+    {
+    public:
+        static const int TileSize = 1 << TileShift;
+
+        TiledLayout(int width, int height) :
+            m_width(width),
+            m_height(height),
+            m_tilesPerRow((width + TileSize - 1) >> TileShift),
+            m_tileRows((height + TileSize - 1) >> TileShift)
+        {
+        }
+
+        inline size_t Size() const
+        {
+            return (size_t(m_tilesPerRow) * m_tileRows) << (2 * TileShift);
+        }
+
+        inline size_t Offset(int x, int y) const
+        {
+            const size_t tile = size_t(y >> TileShift) * m_tilesPerRow + (x >> TileShift);
+            return (tile << (2 * TileShift)) + ((y & (TileSize - 1)) << TileShift) + (x & (TileSize - 1));
+        }
+
+        //  Whole tile rows are contiguous in both layouts so they are moved with vector copies.
+        //  Partial tiles on the right and bottom edges fall back to per texel copies.
+
+        template <typename T>
+        void FromLinear(const T* const pSrc, size_t srcPitch, T* const pDest) const
+        {
+            Convert(const_cast<T*>(pSrc), srcPitch, pDest, true);
+        }
+
+        template <typename T>
+        void ToLinear(const T* const pSrc, T* const pDest, size_t destPitch) const
+        {
+            Convert(pDest, destPitch, const_cast<T*>(pSrc), false);
+        }
+
+    private:
+        int m_width;
+        int m_height;
+        int m_tilesPerRow;
+        int m_tileRows;
+
+        template <typename T>
+        void Convert(T* const pLinear, size_t pitch, T* const pTiled, bool toTiled) const
+        {
+            const size_t rowBytes = TileSize * sizeof(T);
+            const int fullTilesPerRow = m_width >> TileShift;
+
+            for (int y = 0; y < m_height; ++y)
+            {
+                T* pRow = pLinear + y * pitch;
+                for (int tx = 0; tx < fullTilesPerRow; ++tx)
+                {
+                    T* pTiledRow = pTiled + Offset(tx << TileShift, y);
+                    T* pLinearRow = pRow + (tx << TileShift);
+                    T* pDest = toTiled ? pTiledRow : pLinearRow;
+                    const T* pSrc = toTiled ? pLinearRow : pTiledRow;
+                    if ((rowBytes % 16) == 0)
+                        details::Copy16(pDest, pSrc, rowBytes);
+                    else
+                        memcpy(pDest, pSrc, rowBytes);
+                }
+                for (int x = fullTilesPerRow << TileShift; x < m_width; ++x)
+                {
+                    if (toTiled)
+                        pTiled[Offset(x, y)] = pRow[x];
+                    else
+                        pRow[x] = pTiled[Offset(x, y)];
+                }
+            }
+        }
+    };
+
+    //--------------------------------------------------------------------------------------
+    //  Morton (Z-order) layout.
+    //--------------------------------------------------------------------------------------
+    //
+    //  The bits of x and y are interleaved to give the texel offset. Storage is padded to a
+    //  power of two square so very wide or tall images waste memory, use TiledLayout for
+    //  those. Width and height are limited to 65536 texels.
+
+    class MortonLayout
+    {
+    public:
+        MortonLayout(int width, int height) :
+            m_width(width),
+            m_height(height),
+            m_side(details::NextPowerOfTwo((std::max)(width, height)))
+        {
+            assert(m_side <= 65536);
+        }
+
+        inline size_t Size() const
+        {
+            return size_t(m_side) * m_side;
+        }
+
+        inline size_t Offset(int x, int y) const
+        {
+            return details::Part1By1(x) | (details::Part1By1(y) << 1);
+        }
+
+        template <typename T>
+        void FromLinear(const T* const pSrc, size_t srcPitch, T* const pDest) const
+        {
+            Convert(const_cast<T*>(pSrc), srcPitch, pDest, true);
+        }
+
+        template <typename T>
+        void ToLinear(const T* const pSrc, T* const pDest, size_t destPitch) const
+        {
+            Convert(pDest, destPitch, const_cast<T*>(pSrc), false);
+        }
+
+    private:
+        int m_width;
+        int m_height;
+        int m_side;
+
+        //  For 32 bit texels a 4 x 2 block whose x is a multiple of 4 and y is a multiple of 2
+        //  occupies eight consecutive Morton offsets:
+        //
+        //      (0,0) (1,0) (0,1) (1,1) (2,0) (3,0) (2,1) (3,1)
+        //
+        //  So two row loads are shuffled with unpacklo/hi_epi64 into two contiguous stores.
+
+        template <typename T>
+        void Convert(T* const pLinear, size_t pitch, T* const pMorton, bool toMorton) const
+        {
+            int yBlockEnd = 0;
+            int xBlockEnd = 0;
+            if (sizeof(T) == 4)
+            {
+                yBlockEnd = m_height & ~1;
+                xBlockEnd = m_width & ~3;
+                for (int y = 0; y < yBlockEnd; y += 2)
+                {
+                    __m128i* pRow0 = reinterpret_cast<__m128i*>(pLinear + y * pitch);
+                    __m128i* pRow1 = reinterpret_cast<__m128i*>(pLinear + (y + 1) * pitch);
+                    for (int x = 0; x < xBlockEnd; x += 4)
+                    {
+                        __m128i* pBlock = reinterpret_cast<__m128i*>(pMorton + Offset(x, y));
+                        if (toMorton)
+                        {
+                            const __m128i r0 = _mm_loadu_si128(pRow0 + x / 4);
+                            const __m128i r1 = _mm_loadu_si128(pRow1 + x / 4);
+                            _mm_storeu_si128(pBlock, _mm_unpacklo_epi64(r0, r1));
+                            _mm_storeu_si128(pBlock + 1, _mm_unpackhi_epi64(r0, r1));
+                        }
+                        else
+                        {
+                            const __m128i b0 = _mm_loadu_si128(pBlock);
+                            const __m128i b1 = _mm_loadu_si128(pBlock + 1);
+                            _mm_storeu_si128(pRow0 + x / 4, _mm_unpacklo_epi64(b0, b1));
+                            _mm_storeu_si128(pRow1 + x / 4, _mm_unpackhi_epi64(b0, b1));
+                        }
+                    }
+                }
+            }
+
+            //  Remaining columns of the blocked rows and any remaining rows.
+
+            for (int y = 0; y < m_height; ++y)
+            {
+                T* pRow = pLinear + y * pitch;
+                for (int x = (y < yBlockEnd) ? xBlockEnd : 0; x < m_width; ++x)
+                {
+                    if (toMorton)
+                        pMorton[Offset(x, y)] = pRow[x];
+                    else
+                        pRow[x] = pMorton[Offset(x, y)];
+                }
+            }
+        }
+    };
+
+    //--------------------------------------------------------------------------------------
+    //  CPU texture.
+    //--------------------------------------------------------------------------------------
+
+    template <typename T, typename Layout = TiledLayout<>>
+    class CpuTexture
+    {
+    public:
+        typedef typename TexelTraits<T>::FloatType FloatType;
+
+        CpuTexture(int width, int height) :
+            m_width(width),
+            m_height(height),
+            m_layout(width, height),
+            m_texels(m_layout.Size())
+        {
+            assert(width > 0 && height > 0);
+        }
+
+        //  Create a texture from row-major data. The pitch is the distance between rows in
+        //  texels and defaults to the width.
+
+        CpuTexture(int width, int height, const T* const pSrc, size_t srcPitch = 0) :
+            m_width(width),
+            m_height(height),
+            m_layout(width, height),
+            m_texels(m_layout.Size())
+        {
+            assert(width > 0 && height > 0);
+            CopyFrom(pSrc, srcPitch);
+        }
+
+        inline int Width() const { return m_width; }
+        inline int Height() const { return m_height; }
+
+        void CopyFrom(const T* const pSrc, size_t srcPitch = 0)
+        {
+            m_layout.FromLinear(pSrc, (srcPitch == 0) ? m_width : srcPitch, m_texels.data());
+        }
+
+        void CopyTo(T* const pDest, size_t destPitch = 0) const
+        {
+            m_layout.ToLinear(m_texels.data(), pDest, (destPitch == 0) ? m_width : destPitch);
+        }
+
+        //  Unchecked read and write of a single texel, x and y must be within the texture.
+
+        inline const T& Load(int x, int y) const
+        {
+            assert(x >= 0 && x < m_width && y >= 0 && y < m_height);
+            return m_texels[m_layout.Offset(x, y)];
+        }
+
+        inline void Store(int x, int y, const T& texel)
+        {
+            assert(x >= 0 && x < m_width && y >= 0 && y < m_height);
+            m_texels[m_layout.Offset(x, y)] = texel;
+        }
+
+        //  Read a texel, applying the address mode to out of range coordinates.
+
+        inline const T& Load(int x, int y, AddressMode mode) const
+        {
+            return m_texels[m_layout.Offset(details::Address(x, m_width, mode), details::Address(y, m_height, mode))];
+        }
+
+        //  Point sampling returns the texel whose area contains (x, y).
+
+        inline T SamplePoint(float x, float y, AddressMode mode = AddressMode::Clamp) const
+        {
+            return Load(static_cast<int>(floorf(x)), static_cast<int>(floorf(y)), mode);
+        }
+
+        //  Bilinear sampling of the four texels whose centers surround (x, y).
+
+        inline FloatType SampleBilinear(float x, float y, AddressMode mode = AddressMode::Clamp) const
+        {
+            x -= 0.5f;
+            y -= 0.5f;
+            const float fx = floorf(x);
+            const float fy = floorf(y);
+            const int x0 = static_cast<int>(fx);
+            const int y0 = static_cast<int>(fy);
+            const float ax = x - fx;
+            const float ay = y - fy;
+
+            const FloatType t00 = TexelTraits<T>::ToFloat(Load(x0, y0, mode));
+            const FloatType t10 = TexelTraits<T>::ToFloat(Load(x0 + 1, y0, mode));
+            const FloatType t01 = TexelTraits<T>::ToFloat(Load(x0, y0 + 1, mode));
+            const FloatType t11 = TexelTraits<T>::ToFloat(Load(x0 + 1, y0 + 1, mode));
+
+            return (t00 * (1.0f - ax) + t10 * ax) * (1.0f - ay) + (t01 * (1.0f - ax) + t11 * ax) * ay;
+        }
+
+    private:
+        int m_width;
+        int m_height;
+        Layout m_layout;
+        std::vector<T> m_texels;
+    };
+}
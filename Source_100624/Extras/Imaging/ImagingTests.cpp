@@ -0,0 +1,314 @@
+//===============================================================================
+//
+// Microsoft Press
+// C++ AMP: Accelerated Massive Parallelism with Microsoft Visual C++
+//
+//===============================================================================
+// Copyright (c) 2012 Ade Miller & Kate Gregory.  All rights reserved.
+// This code released under the terms of the
+// Microsoft Public License (Ms-PL), http://ampbook.codeplex.com/license.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//===============================================================================
+
+#include "stdafx.h"
+
+#include "CpuTexture.h"
+#include "PixelFormat.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Extras;
+
+namespace ImagingTests
+{
+    std::vector<unsigned> MakeImage(int width, int height)
+    {
+        std::vector<unsigned> image(width * height);
+        std::iota(begin(image), end(image), 0);
+        return image;
+    }
+
+    Unorm8x4 MakeUnorm(size_t x, size_t y, size_t z, size_t w)
+    {
+        Unorm8x4 p = { static_cast<unsigned char>(x), static_cast<unsigned char>(y), static_cast<unsigned char>(z), static_cast<unsigned char>(w) };
+        return p;
+    }
+
+    Norm8x4 MakeNorm(int x, int y, int z, int w)
+    {
+        Norm8x4 p = { static_cast<signed char>(x), static_cast<signed char>(y), static_cast<signed char>(z), static_cast<signed char>(w) };
+        return p;
+    }
+
+    template <typename Layout>
+    void CheckRoundTrip(int width, int height)
+    {
+        std::vector<unsigned> input = MakeImage(width, height);
+        std::vector<unsigned> result(input.size());
+
+        CpuTexture<unsigned, Layout> tex(width, height, input.data());
+        tex.CopyTo(result.data());
+
+        Assert::IsTrue(input == result);
+        for (int y = 0; y < height; ++y)
+            for (int x = 0; x < width; ++x)
+                Assert::AreEqual(input[y * width + x], tex.Load(x, y));
+    }
+
+    TEST_CLASS(CpuTextureTests)
+    {
+    public:
+        TEST_METHOD(CpuTextureTests_TiledRoundTrip)
+        {
+            CheckRoundTrip<TiledLayout<>>(16, 8);
+        }
+
+        TEST_METHOD(CpuTextureTests_TiledRoundTripPartialTiles)
+        {
+            CheckRoundTrip<TiledLayout<>>(13, 7);
+            CheckRoundTrip<TiledLayout<3>>(21, 5);
+        }
+
+        TEST_METHOD(CpuTextureTests_MortonRoundTrip)
+        {
+            CheckRoundTrip<MortonLayout>(16, 16);
+        }
+
+        TEST_METHOD(CpuTextureTests_MortonRoundTripOddSizes)
+        {
+            CheckRoundTrip<MortonLayout>(11, 5);
+            CheckRoundTrip<MortonLayout>(1, 9);
+        }
+
+        TEST_METHOD(CpuTextureTests_CopyWithPitch)
+        {
+            const int width = 6;
+            const int height = 4;
+            const int pitch = 8;
+            std::vector<unsigned> input(pitch * height, 0xDEAD);
+            for (int y = 0; y < height; ++y)
+                for (int x = 0; x < width; ++x)
+                    input[y * pitch + x] = y * width + x;
+
+            CpuTexture<unsigned, MortonLayout> tex(width, height, input.data(), pitch);
+            std::vector<unsigned> result(width * height);
+            tex.CopyTo(result.data());
+
+            Assert::IsTrue(MakeImage(width, height) == result);
+        }
+
+        TEST_METHOD(CpuTextureTests_AddressModes)
+        {
+            std::vector<unsigned> input = MakeImage(4, 4);
+            CpuTexture<unsigned> tex(4, 4, input.data());
+
+            Assert::AreEqual(0u, tex.Load(-3, -1, AddressMode::Clamp));
+            Assert::AreEqual(15u, tex.Load(9, 7, AddressMode::Clamp));
+            Assert::AreEqual(3u, tex.Load(-1, 0, AddressMode::Wrap));
+            Assert::AreEqual(5u, tex.Load(5, 5, AddressMode::Wrap));
+        }
+
+        TEST_METHOD(CpuTextureTests_SamplePoint)
+        {
+            std::vector<unsigned> input = MakeImage(4, 4);
+            CpuTexture<unsigned> tex(4, 4, input.data());
+
+            Assert::AreEqual(6u, tex.SamplePoint(2.9f, 1.1f));
+            Assert::AreEqual(12u, tex.SamplePoint(-0.5f, 8.0f));
+        }
+
+        TEST_METHOD(CpuTextureTests_SampleBilinear)
+        {
+            std::vector<float> input(4 * 4);
+            std::iota(begin(input), end(input), 0.0f);
+            CpuTexture<float> tex(4, 4, input.data());
+
+            // Texel centers return the texel, half way between four centers returns their average.
+            Assert::AreEqual(5.0f, tex.SampleBilinear(1.5f, 1.5f), 1e-6f);
+            Assert::AreEqual(7.5f, tex.SampleBilinear(2.0f, 2.0f), 1e-6f);
+            Assert::AreEqual(0.0f, tex.SampleBilinear(0.0f, 0.0f, AddressMode::Clamp), 1e-6f);
+            Assert::AreEqual(7.5f, tex.SampleBilinear(0.0f, 0.0f, AddressMode::Wrap), 1e-6f);
+        }
+
+        TEST_METHOD(CpuTextureTests_SampleBilinearUnorm)
+        {
+            Unorm8x4 input[2] = { { 0, 0, 0, 255 }, { 255, 51, 0, 255 } };
+            CpuTexture<Unorm8x4> tex(2, 1, input);
+
+            float_4 texel = tex.SampleBilinear(1.0f, 0.5f);
+            Assert::AreEqual(0.5f, texel.x, 1e-6f);
+            Assert::AreEqual(0.1f, texel.y, 1e-6f);
+            Assert::AreEqual(0.0f, texel.z, 1e-6f);
+            Assert::AreEqual(1.0f, texel.w, 1e-6f);
+        }
+    };
+
+    TEST_CLASS(PixelFormatTests)
+    {
+    public:
+        TEST_METHOD(PixelFormatTests_UnpackPackRoundTrip)
+        {
+            // 67 pixels exercises both the SSE loop and the scalar tail.
+            std::vector<Unorm8x4> input(67);
+            for (size_t i = 0; i < input.size(); ++i)
+            {
+                input[i] = MakeUnorm(i * 4, 255 - i, i * 7, i);
+            }
+            std::vector<float_4> floats(input.size());
+            std::vector<Unorm8x4> result(input.size());
+
+            UnpackRow(input.data(), floats.data(), input.size());
+            PackRow(floats.data(), result.data(), floats.size());
+
+            for (size_t i = 0; i < input.size(); ++i)
+            {
+                Assert::AreEqual(input[i].z / 255.0f, floats[i].z, 1e-6f);
+                Assert::AreEqual(0, memcmp(&input[i], &result[i], sizeof(Unorm8x4)));
+            }
+        }
+
+        TEST_METHOD(PixelFormatTests_PackSaturates)
+        {
+            const float nan = std::numeric_limits<float>::quiet_NaN();
+            std::vector<float_4> input(5, float_4(-3.0f, 2.0f, 0.5f, nan));
+            std::vector<Unorm8x4> result(input.size());
+            PackRow(input.data(), result.data(), input.size());
+
+            for (size_t i = 0; i < result.size(); ++i)
+            {
+                Assert::AreEqual(0, int(result[i].x));
+                Assert::AreEqual(255, int(result[i].y));
+                Assert::AreEqual(128, int(result[i].z));
+                Assert::AreEqual(0, int(result[i].w));
+            }
+
+            //  Infinities and values too large for an int must saturate, not wrap.
+            const float inf = std::numeric_limits<float>::infinity();
+            std::vector<float_4> large(5, float_4(inf, -inf, 1e10f, -1e10f));
+            PackRow(large.data(), result.data(), large.size());
+            std::vector<Norm8x4> norm(large.size());
+            PackRow(large.data(), norm.data(), large.size());
+            for (size_t i = 0; i < large.size(); ++i)
+            {
+                Assert::AreEqual(255, int(result[i].x));
+                Assert::AreEqual(0, int(result[i].y));
+                Assert::AreEqual(255, int(result[i].z));
+                Assert::AreEqual(0, int(result[i].w));
+                Assert::AreEqual(127, int(norm[i].x));
+                Assert::AreEqual(-127, int(norm[i].y));
+                Assert::AreEqual(127, int(norm[i].z));
+                Assert::AreEqual(-127, int(norm[i].w));
+            }
+        }
+
+        TEST_METHOD(PixelFormatTests_PackExactHalvesMatchInRowTail)
+        {
+            //  Each channel scales to exactly k + 0.5. The first four pixels are packed with SSE2,
+            //  the fifth by the scalar tail, both must round half to even.
+            const float_4 unorm(2.5f / 255.0f, 1.5f / 255.0f, 0.5f / 255.0f, 3.5f / 255.0f);
+            Assert::IsTrue(unorm.x * 255.0f == 2.5f && unorm.y * 255.0f == 1.5f && unorm.z * 255.0f == 0.5f && unorm.w * 255.0f == 3.5f);
+            std::vector<float_4> input(5, unorm);
+            std::vector<Unorm8x4> result(input.size());
+            PackRow(input.data(), result.data(), input.size());
+            for (size_t i = 0; i < result.size(); ++i)
+            {
+                Assert::AreEqual(2, int(result[i].x));
+                Assert::AreEqual(2, int(result[i].y));
+                Assert::AreEqual(0, int(result[i].z));
+                Assert::AreEqual(4, int(result[i].w));
+            }
+
+            const float_4 norm(2.5f / 127.0f, -2.5f / 127.0f, 0.5f / 127.0f, -1.5f / 127.0f);
+            Assert::IsTrue(norm.x * 127.0f == 2.5f && norm.y * 127.0f == -2.5f && norm.z * 127.0f == 0.5f && norm.w * 127.0f == -1.5f);
+            input.assign(5, norm);
+            std::vector<Norm8x4> normResult(input.size());
+            PackRow(input.data(), normResult.data(), input.size());
+            for (size_t i = 0; i < normResult.size(); ++i)
+            {
+                Assert::AreEqual(2, int(normResult[i].x));
+                Assert::AreEqual(-2, int(normResult[i].y));
+                Assert::AreEqual(0, int(normResult[i].z));
+                Assert::AreEqual(-2, int(normResult[i].w));
+            }
+        }
+
+        TEST_METHOD(PixelFormatTests_NormRoundTrip)
+        {
+            std::vector<Norm8x4> input(9);
+            for (size_t i = 0; i < input.size(); ++i)
+            {
+                input[i] = MakeNorm(-128 + int(i), 127 - int(i), int(i), -int(i));
+            }
+            std::vector<float_4> floats(input.size());
+            std::vector<Norm8x4> result(input.size());
+
+            UnpackRow(input.data(), floats.data(), input.size());
+            Assert::AreEqual(-1.0f, floats[0].x, 1e-6f);
+            Assert::AreEqual(-1.0f, floats[1].x, 1e-6f);
+            Assert::AreEqual(1.0f, floats[0].y, 1e-6f);
+
+            floats[8] = float_4(-2.0f, 2.0f, 0.0f, -0.5f);
+            PackRow(floats.data(), result.data(), floats.size());
+            Assert::AreEqual(-127, int(result[0].x));
+            for (size_t i = 1; i < 8; ++i)
+                Assert::AreEqual(0, memcmp(&input[i], &result[i], sizeof(Norm8x4)));
+            Assert::AreEqual(-127, int(result[8].x));
+            Assert::AreEqual(127, int(result[8].y));
+            Assert::AreEqual(-64, int(result[8].w));
+        }
+
+        TEST_METHOD(PixelFormatTests_PlanarImageRoundTrip)
+        {
+            const int width = 13;
+            const int height = 3;
+            const int pitch = 16;
+            std::vector<Unorm8x4> input(width * height);
+            for (size_t i = 0; i < input.size(); ++i)
+            {
+                input[i] = MakeUnorm(i, i + 1, i + 2, 200);
+            }
+            std::vector<float> planes(4 * pitch * height);
+            float* pX = planes.data();
+            float* pY = pX + pitch * height;
+            float* pZ = pY + pitch * height;
+            float* pW = pZ + pitch * height;
+
+            UnpackImagePlanar(input.data(), width, pX, pY, pZ, pW, pitch, width, height);
+            Assert::AreEqual(14 / 255.0f, pX[pitch + 1], 1e-6f);
+            Assert::AreEqual(16 / 255.0f, pZ[pitch + 1], 1e-6f);
+            Assert::AreEqual(200 / 255.0f, pW[2 * pitch + 12], 1e-6f);
+
+            std::vector<Unorm8x4> result(input.size());
+            PackImagePlanar(pX, pY, pZ, pW, pitch, result.data(), width, width, height);
+            Assert::AreEqual(0, memcmp(input.data(), result.data(), input.size() * sizeof(Unorm8x4)));
+
+            PackImagePlanar(pX, pY, pZ, nullptr, pitch, result.data(), width, width, height);
+            Assert::AreEqual(255, int(result[5].w));
+        }
+
+        TEST_METHOD(PixelFormatTests_Srgb)
+        {
+            std::vector<Unorm8x4> input(256);
+            for (int i = 0; i < 256; ++i)
+            {
+                input[i] = MakeUnorm(i, i, i, i);
+            }
+            std::vector<float_4> floats(input.size());
+            std::vector<Unorm8x4> result(input.size());
+
+            UnpackImage(input.data(), 16, floats.data(), 16, 16, 16, ColorSpace::Srgb);
+            Assert::AreEqual(0.2159f, floats[128].x, 1e-4f);
+            Assert::AreEqual(128 / 255.0f, floats[128].w, 1e-6f);
+
+            PackImage(floats.data(), 16, result.data(), 16, 16, 16, ColorSpace::Srgb);
+            for (int i = 0; i < 256; ++i)
+            {
+                Assert::IsTrue(abs(int(result[i].x) - i) <= 1);
+                Assert::AreEqual(i, int(result[i].w));
+            }
+        }
+    };
+}
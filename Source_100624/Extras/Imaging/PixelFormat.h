@@ -0,0 +1,457 @@
+//===============================================================================
+//
+// Microsoft Press
+// C++ AMP: Accelerated Massive Parallelism with Microsoft Visual C++
+//
+//===============================================================================
+// Copyright (c) 2012 Ade Miller & Kate Gregory.  All rights reserved.
+// This code released under the terms of the
+// Microsoft Public License (Ms-PL), http://ampbook.codeplex.com/license.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//===============================================================================
+
+#pragma once
+
+#include <algorithm>
+#include <math.h>
+#include <assert.h>
+#include <emmintrin.h>
+#include <xmmintrin.h>
+#include <ppl.h>
+#include <amp_short_vectors.h>
+
+using namespace concurrency::graphics;
+
+//--------------------------------------------------------------------------------------
+//  Bulk pixel format conversion.
+//--------------------------------------------------------------------------------------
+//
+//  Converts whole rows or images between packed 8 bit per channel pixels and float pixels,
+//  either interleaved (float_4) or planar (one float array per channel). Rows are converted
+//  four pixels at a time with SSE2, the pack instructions provide saturation for free.
+//
+//  Channels are numbered in memory order so for a GDI+ 32bpp bitmap x, y, z, w are B, G, R
+//  and A. When ColorSpace::Srgb is used the x, y and z channels are converted between sRGB
+//  and linear, w is always treated as linear alpha.
+//
+//  The row functions don't allocate or start threads so other kernels can call them on a
+//  strip of their own data as a fused conversion stage. The image functions split rows
+//  across cores when the image is large enough to make this worthwhile.
+
+namespace Extras
+{
+    //  Four 8 bit unsigned normalized channels, [0, 255] maps to [0.0, 1.0]. Stored in memory
+    //  order, for a GDI+ 32bpp bitmap x, y, z, w are B, G, R, A.
+
+    struct Unorm8x4
+    {
+        unsigned char x, y, z, w;
+    };
+
+    //  Four 8 bit signed normalized channels, [-127, 127] maps to [-1.0, 1.0]. As with D3D
+    //  SNORM formats -128 also maps to -1.0.
+
+    struct Norm8x4
+    {
+        signed char x, y, z, w;
+    };
+
+    enum class ColorSpace
+    {
+        Linear,
+        Srgb
+    };
+
+    //  Images with fewer pixels than this are converted on the calling thread.
+
+    const size_t kParallelConversionThreshold = 256 * 1024;
+
+    namespace details
+    {
+        //  One instance of a lookup table class, built during static initialization before the
+        //  program starts any threads. A function local static isn't thread safe with v110.
+
+        template <typename Tables>
+        struct StaticTables
+        {
+            static const Tables value;
+        };
+
+        template <typename Tables>
+        const Tables StaticTables<Tables>::value;
+
+        //  Lookup tables for sRGB conversion. Decoding is exact, 256 entries. Encoding
+        //  quantizes the linear value to 12 bits which is within one code of the exact result.
+
+        class SrgbTables
+        {
+        public:
+            static const int kEncodeBits = 12;
+            static const int kEncodeSize = 1 << kEncodeBits;
+
+            float ToLinear[256];
+            unsigned char FromLinear[kEncodeSize + 1];
+
+            SrgbTables()
+            {
+                for (int i = 0; i < 256; ++i)
+                {
+                    const float c = i / 255.0f;
+                    ToLinear[i] = (c <= 0.04045f) ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+                }
+                for (int i = 0; i <= kEncodeSize; ++i)
+                {
+                    const float l = float(i) / kEncodeSize;
+                    const float c = (l <= 0.0031308f) ? l * 12.92f : 1.055f * powf(l, 1.0f / 2.4f) - 0.055f;
+                    FromLinear[i] = static_cast<unsigned char>(c * 255.0f + 0.5f);
+                }
+            }
+
+            static const SrgbTables& Get()
+            {
+                return StaticTables<SrgbTables>::value;
+            }
+        };
+
+        inline unsigned char EncodeSrgb(float v, const SrgbTables& tables)
+        {
+            v = (v > 0.0f) ? ((v < 1.0f) ? v : 1.0f) : 0.0f;        // Also maps NaN to zero.
+            return tables.FromLinear[static_cast<int>(v * SrgbTables::kEncodeSize + 0.5f)];
+        }
+
+        //  Widen four packed pixels to four float_4 values, one per register.
+
+        inline void UnpackUnorm4(__m128i packed, __m128 (&out)[4])
+        {
+            const __m128i zero = _mm_setzero_si128();
+            const __m128 scale = _mm_set1_ps(1.0f / 255.0f);
+            const __m128i lo = _mm_unpacklo_epi8(packed, zero);
+            const __m128i hi = _mm_unpackhi_epi8(packed, zero);
+            out[0] = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)), scale);
+            out[1] = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)), scale);
+            out[2] = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)), scale);
+            out[3] = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)), scale);
+        }
+
+        inline void UnpackNorm4(__m128i packed, __m128 (&out)[4])
+        {
+            const __m128 scale = _mm_set1_ps(1.0f / 127.0f);
+            const __m128 minusOne = _mm_set1_ps(-1.0f);
+            //  Place each byte in the top of a wider lane and then shift right arithmetically to sign extend.
+            const __m128i lo = _mm_srai_epi16(_mm_unpacklo_epi8(packed, packed), 8);
+            const __m128i hi = _mm_srai_epi16(_mm_unpackhi_epi8(packed, packed), 8);
+            out[0] = _mm_max_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(lo, lo), 16)), scale), minusOne);
+            out[1] = _mm_max_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(lo, lo), 16)), scale), minusOne);
+            out[2] = _mm_max_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(hi, hi), 16)), scale), minusOne);
+            out[3] = _mm_max_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(hi, hi), 16)), scale), minusOne);
+        }
+
+        //  Narrow four float_4 values to four packed pixels. The conversion rounds to nearest even,
+        //  SaturateUnorm8 and SaturateNorm8 round the same way so row tails match the vector body.
+
+        inline __m128i PackUnorm4(const __m128 (&in)[4])
+        {
+            //  Clamp before converting, _mm_cvtps_epi32 returns 0x80000000 for infinities and
+            //  anything too large for an int. _mm_max_ps returns its second operand for NaN.
+            const __m128 scale = _mm_set1_ps(255.0f);
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 maxValue = _mm_set1_ps(255.0f);
+            const __m128i a = _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(in[0], scale), zero), maxValue));
+            const __m128i b = _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(in[1], scale), zero), maxValue));
+            const __m128i c = _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(in[2], scale), zero), maxValue));
+            const __m128i d = _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(in[3], scale), zero), maxValue));
+            return _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+        }
+
+        inline __m128i PackNorm4(const __m128 (&in)[4])
+        {
+            //  Clamp to [-127, 127] before converting, as for PackUnorm4. NaN becomes -127, -1.0.
+            const __m128 scale = _mm_set1_ps(127.0f);
+            const __m128 minValue = _mm_set1_ps(-127.0f);
+            const __m128 maxValue = _mm_set1_ps(127.0f);
+            const __m128i a = _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(in[0], scale), minValue), maxValue));
+            const __m128i b = _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(in[1], scale), minValue), maxValue));
+            const __m128i c = _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(in[2], scale), minValue), maxValue));
+            const __m128i d = _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(in[3], scale), minValue), maxValue));
+            return _mm_packs_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+        }
+
+        //  Apply the sRGB transfer function to the first three channels of interleaved pixels.
+
+        inline void SrgbToLinear(float_4* const pPixels, const Unorm8x4* const pSrc, size_t count)
+        {
+            const SrgbTables& tables = SrgbTables::Get();
+            for (size_t i = 0; i < count; ++i)
+            {
+                pPixels[i].x = tables.ToLinear[pSrc[i].x];
+                pPixels[i].y = tables.ToLinear[pSrc[i].y];
+                pPixels[i].z = tables.ToLinear[pSrc[i].z];
+            }
+        }
+
+        //  Run a row conversion over every row of an image, in parallel for large images.
+
+        template <typename Func>
+        void ForEachRow(int width, int height, const Func& convertRow)
+        {
+            if (size_t(width) * height < kParallelConversionThreshold)
+            {
+                for (int y = 0; y < height; ++y)
+                    convertRow(y);
+            }
+            else
+            {
+                concurrency::parallel_for(0, height, convertRow);
+            }
+        }
+    }
+
+    //--------------------------------------------------------------------------------------
+    //  Per pixel conversions, for use inside other kernels.
+    //--------------------------------------------------------------------------------------
+
+    inline float_4 UnpackUnorm(const Unorm8x4& p)
+    {
+        const float scale = 1.0f / 255.0f;
+        return float_4(p.x * scale, p.y * scale, p.z * scale, p.w * scale);
+    }
+
+    inline float_4 UnpackNorm(const Norm8x4& p)
+    {
+        const float scale = 1.0f / 127.0f;
+        return float_4((std::max)(p.x * scale, -1.0f), (std::max)(p.y * scale, -1.0f), (std::max)(p.z * scale, -1.0f), (std::max)(p.w * scale, -1.0f));
+    }
+
+    //  Saturate and round to nearest even with _mm_cvtss_si32, the same as the SSE2 row
+    //  conversions, so a value packs to the same byte wherever it falls in a row.
+
+    inline unsigned char SaturateUnorm8(float v)
+    {
+        v = (v > 0.0f) ? ((v < 1.0f) ? v : 1.0f) : 0.0f;
+        return static_cast<unsigned char>(_mm_cvtss_si32(_mm_set_ss(v * 255.0f)));
+    }
+
+    inline signed char SaturateNorm8(float v)
+    {
+        v = (v > -1.0f) ? ((v < 1.0f) ? v : 1.0f) : -1.0f;
+        return static_cast<signed char>(_mm_cvtss_si32(_mm_set_ss(v * 127.0f)));
+    }
+
+    inline Unorm8x4 PackUnorm(const float_4& p)
+    {
+        Unorm8x4 result = { SaturateUnorm8(p.x), SaturateUnorm8(p.y), SaturateUnorm8(p.z), SaturateUnorm8(p.w) };
+        return result;
+    }
+
+    inline Norm8x4 PackNorm(const float_4& p)
+    {
+        Norm8x4 result = { SaturateNorm8(p.x), SaturateNorm8(p.y), SaturateNorm8(p.z), SaturateNorm8(p.w) };
+        return result;
+    }
+
+    //--------------------------------------------------------------------------------------
+    //  Row conversions.
+    //--------------------------------------------------------------------------------------
+
+    //  Packed unorm8 to interleaved float.
+
+    inline void UnpackRow(const Unorm8x4* const pSrc, float_4* const pDest, size_t count, ColorSpace space = ColorSpace::Linear)
+    {
+        static_assert(sizeof(float_4) == 4 * sizeof(float), "float_4 must be unpadded.");
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128 pixels[4];
+            details::UnpackUnorm4(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + i)), pixels);
+            float* pOut = reinterpret_cast<float*>(pDest + i);
+            _mm_storeu_ps(pOut, pixels[0]);
+            _mm_storeu_ps(pOut + 4, pixels[1]);
+            _mm_storeu_ps(pOut + 8, pixels[2]);
+            _mm_storeu_ps(pOut + 12, pixels[3]);
+        }
+        for (; i < count; ++i)
+            pDest[i] = UnpackUnorm(pSrc[i]);
+
+        if (space == ColorSpace::Srgb)
+            details::SrgbToLinear(pDest, pSrc, count);
+    }
+
+    //  Interleaved float to packed unorm8, saturating to [0.0, 1.0].
+
+    inline void PackRow(const float_4* const pSrc, Unorm8x4* const pDest, size_t count, ColorSpace space = ColorSpace::Linear)
+    {
+        if (space == ColorSpace::Srgb)
+        {
+            const details::SrgbTables& tables = details::SrgbTables::Get();
+            for (size_t i = 0; i < count; ++i)
+            {
+                Unorm8x4 p = { details::EncodeSrgb(pSrc[i].x, tables), details::EncodeSrgb(pSrc[i].y, tables),
+                    details::EncodeSrgb(pSrc[i].z, tables), SaturateUnorm8(pSrc[i].w) };
+                pDest[i] = p;
+            }
+            return;
+        }
+
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            const float* pIn = reinterpret_cast<const float*>(pSrc + i);
+            const __m128 pixels[4] = { _mm_loadu_ps(pIn), _mm_loadu_ps(pIn + 4), _mm_loadu_ps(pIn + 8), _mm_loadu_ps(pIn + 12) };
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(pDest + i), details::PackUnorm4(pixels));
+        }
+        for (; i < count; ++i)
+            pDest[i] = PackUnorm(pSrc[i]);
+    }
+
+    //  Packed norm8 to interleaved float and back, saturating to [-1.0, 1.0].
+
+    inline void UnpackRow(const Norm8x4* const pSrc, float_4* const pDest, size_t count)
+    {
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128 pixels[4];
+            details::UnpackNorm4(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + i)), pixels);
+            float* pOut = reinterpret_cast<float*>(pDest + i);
+            _mm_storeu_ps(pOut, pixels[0]);
+            _mm_storeu_ps(pOut + 4, pixels[1]);
+            _mm_storeu_ps(pOut + 8, pixels[2]);
+            _mm_storeu_ps(pOut + 12, pixels[3]);
+        }
+        for (; i < count; ++i)
+            pDest[i] = UnpackNorm(pSrc[i]);
+    }
+
+    inline void PackRow(const float_4* const pSrc, Norm8x4* const pDest, size_t count)
+    {
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            const float* pIn = reinterpret_cast<const float*>(pSrc + i);
+            const __m128 pixels[4] = { _mm_loadu_ps(pIn), _mm_loadu_ps(pIn + 4), _mm_loadu_ps(pIn + 8), _mm_loadu_ps(pIn + 12) };
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(pDest + i), details::PackNorm4(pixels));
+        }
+        for (; i < count; ++i)
+            pDest[i] = PackNorm(pSrc[i]);
+    }
+
+    //  Packed unorm8 to planar float, one output row per channel. Four pixels are unpacked and
+    //  then transposed so that each register holds one channel.
+
+    inline void UnpackRowPlanar(const Unorm8x4* const pSrc, float* const pX, float* const pY, float* const pZ, float* const pW,
+        size_t count, ColorSpace space = ColorSpace::Linear)
+    {
+        size_t i = 0;
+        if (space == ColorSpace::Linear)
+        {
+            for (; i + 4 <= count; i += 4)
+            {
+                __m128 p[4];
+                details::UnpackUnorm4(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + i)), p);
+                _MM_TRANSPOSE4_PS(p[0], p[1], p[2], p[3]);
+                _mm_storeu_ps(pX + i, p[0]);
+                _mm_storeu_ps(pY + i, p[1]);
+                _mm_storeu_ps(pZ + i, p[2]);
+                _mm_storeu_ps(pW + i, p[3]);
+            }
+        }
+        for (; i < count; ++i)
+        {
+            float_4 p = UnpackUnorm(pSrc[i]);
+            if (space == ColorSpace::Srgb)
+            {
+                const details::SrgbTables& tables = details::SrgbTables::Get();
+                p = float_4(tables.ToLinear[pSrc[i].x], tables.ToLinear[pSrc[i].y], tables.ToLinear[pSrc[i].z], p.w);
+            }
+            pX[i] = p.x;
+            pY[i] = p.y;
+            pZ[i] = p.z;
+            pW[i] = p.w;
+        }
+    }
+
+    //  Planar float to packed unorm8. If pW is null alpha is set to 1.0.
+
+    inline void PackRowPlanar(const float* const pX, const float* const pY, const float* const pZ, const float* const pW,
+        Unorm8x4* const pDest, size_t count, ColorSpace space = ColorSpace::Linear)
+    {
+        size_t i = 0;
+        if (space == ColorSpace::Linear)
+        {
+            const __m128 one = _mm_set1_ps(1.0f);
+            for (; i + 4 <= count; i += 4)
+            {
+                __m128 p[4] = { _mm_loadu_ps(pX + i), _mm_loadu_ps(pY + i), _mm_loadu_ps(pZ + i), (pW != nullptr) ? _mm_loadu_ps(pW + i) : one };
+                _MM_TRANSPOSE4_PS(p[0], p[1], p[2], p[3]);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(pDest + i), details::PackUnorm4(p));
+            }
+        }
+        for (; i < count; ++i)
+        {
+            const float w = (pW != nullptr) ? pW[i] : 1.0f;
+            if (space == ColorSpace::Srgb)
+            {
+                const details::SrgbTables& tables = details::SrgbTables::Get();
+                Unorm8x4 p = { details::EncodeSrgb(pX[i], tables), details::EncodeSrgb(pY[i], tables), details::EncodeSrgb(pZ[i], tables), SaturateUnorm8(w) };
+                pDest[i] = p;
+            }
+            else
+            {
+                pDest[i] = PackUnorm(float_4(pX[i], pY[i], pZ[i], w));
+            }
+        }
+    }
+
+    //--------------------------------------------------------------------------------------
+    //  Image conversions.
+    //--------------------------------------------------------------------------------------
+    //
+    //  Pitches are the distance between rows in elements of the pointed to type. For planar
+    //  images all four planes share the same pitch.
+
+    inline void UnpackImage(const Unorm8x4* const pSrc, size_t srcPitch, float_4* const pDest, size_t destPitch,
+        int width, int height, ColorSpace space = ColorSpace::Linear)
+    {
+        details::SrgbTables::Get();                         // Build the tables before starting any threads.
+        details::ForEachRow(width, height, [=](int y)
+        {
+            UnpackRow(pSrc + y * srcPitch, pDest + y * destPitch, width, space);
+        });
+    }
+
+    inline void PackImage(const float_4* const pSrc, size_t srcPitch, Unorm8x4* const pDest, size_t destPitch,
+        int width, int height, ColorSpace space = ColorSpace::Linear)
+    {
+        details::SrgbTables::Get();
+        details::ForEachRow(width, height, [=](int y)
+        {
+            PackRow(pSrc + y * srcPitch, pDest + y * destPitch, width, space);
+        });
+    }
+
+    inline void UnpackImagePlanar(const Unorm8x4* const pSrc, size_t srcPitch, float* const pX, float* const pY, float* const pZ, float* const pW,
+        size_t planePitch, int width, int height, ColorSpace space = ColorSpace::Linear)
+    {
+        details::SrgbTables::Get();
+        details::ForEachRow(width, height, [=](int y)
+        {
+            const size_t offset = y * planePitch;
+            UnpackRowPlanar(pSrc + y * srcPitch, pX + offset, pY + offset, pZ + offset, pW + offset, width, space);
+        });
+    }
+
+    inline void PackImagePlanar(const float* const pX, const float* const pY, const float* const pZ, const float* const pW,
+        size_t planePitch, Unorm8x4* const pDest, size_t destPitch, int width, int height, ColorSpace space = ColorSpace::Linear)
+    {
+        details::SrgbTables::Get();
+        details::ForEachRow(width, height, [=](int y)
+        {
+            const size_t offset = y * planePitch;
+            PackRowPlanar(pX + offset, pY + offset, pZ + offset, (pW != nullptr) ? pW + offset : nullptr, pDest + y * destPitch, width, space);
+        });
+    }
+}
@@ -0,0 +1,361 @@
+//===============================================================================
+//
+// Microsoft Press
+// C++ AMP: Accelerated Massive Parallelism with Microsoft Visual C++
+//
+//===============================================================================
+// Copyright (c) 2012 Ade Miller & Kate Gregory.  All rights reserved.
+// This code released under the terms of the
+// Microsoft Public License (Ms-PL), http://ampbook.codeplex.com/license.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//===============================================================================
+
+#pragma once
+
+#include <amp.h>
+#include <ppl.h>
+#include <vector>
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+#include <limits>
+#include <assert.h>
+
+using namespace concurrency;
+
+//--------------------------------------------------------------------------------------
+//  Reproducible floating point sums.
+//--------------------------------------------------------------------------------------
+//
+//  Floating point addition isn't associative so a parallel sum normally depends on how the
+//  work was split between threads or tiles. Two approaches are provided here, both give the
+//  same bits regardless of the number of cores or how PPL schedules the work.
+//
+//  ExactSum accumulates every value into a wide fixed point integer, a superaccumulator,
+//  so no rounding happens until the end. The result is the correctly rounded exact sum and
+//  doesn't depend on the order of the input at all. CPU only, C++ AMP has no 64 bit integers.
+//
+//  FixedTreeSum uses a reduction tree whose shape depends only on the number of elements.
+//  The input is split into blocks of kFixedTreeBlockSize elements, each block is reduced
+//  pairwise by halving, x[i] += x[i + s] for s = 512 ... 1, and the block sums are reduced
+//  in the same way until one value remains. The CPU and C++ AMP versions evaluate the same
+//  tree so they agree with each other as well, except where the GPU flushes denormals.
+
+namespace Extras
+{
+    //--------------------------------------------------------------------------------------
+    //  Superaccumulator.
+    //--------------------------------------------------------------------------------------
+    //
+    //  Every finite float is M * 2^(p - 149) for an integer M < 2^24 and 0 <= p <= 253. The
+    //  accumulator holds the sum as a fixed point number with 32 bits per limb, stored in 64 bit
+    //  signed integers so that carries only need propagating every 2^30 additions.
+
+    class ExactFloatAccumulator
+    {
+    public:
+        ExactFloatAccumulator() : m_pending(0), m_nan(false), m_positiveInfinity(false), m_negativeInfinity(false)
+        {
+            memset(m_limbs, 0, sizeof(m_limbs));
+        }
+
+        void Add(float value)
+        {
+            unsigned bits;
+            memcpy(&bits, &value, sizeof(bits));
+            const unsigned exponent = (bits >> 23) & 0xFF;
+            unsigned long long mantissa = bits & 0x7FFFFF;
+            const bool negative = (bits >> 31) != 0;
+
+            if (exponent == 0xFF)
+            {
+                if (mantissa != 0)
+                    m_nan = true;
+                else if (negative)
+                    m_negativeInfinity = true;
+                else
+                    m_positiveInfinity = true;
+                return;
+            }
+
+            int position = 0;                               // Denormals have no implicit bit.
+            if (exponent != 0)
+            {
+                mantissa |= 0x800000;
+                position = int(exponent) - 1;
+            }
+
+            const unsigned long long shifted = mantissa << (position % kLimbBits);
+            const long long low = static_cast<long long>(shifted & 0xFFFFFFFF);
+            const long long high = static_cast<long long>(shifted >> kLimbBits);
+            const int limb = position / kLimbBits;
+            if (negative)
+            {
+                m_limbs[limb] -= low;
+                m_limbs[limb + 1] -= high;
+            }
+            else
+            {
+                m_limbs[limb] += low;
+                m_limbs[limb + 1] += high;
+            }
+
+            if (++m_pending == kNormalizeInterval)
+                Normalize();
+        }
+
+        void Merge(const ExactFloatAccumulator& other)
+        {
+            ExactFloatAccumulator rhs(other);
+            rhs.Normalize();
+            Normalize();
+            for (int i = 0; i < kLimbCount; ++i)
+                m_limbs[i] += rhs.m_limbs[i];
+            Normalize();
+            m_nan |= rhs.m_nan;
+            m_positiveInfinity |= rhs.m_positiveInfinity;
+            m_negativeInfinity |= rhs.m_negativeInfinity;
+        }
+
+        //  The exact sum rounded to nearest, ties to even. An exact zero is returned as +0.0.
+
+        float ToFloat() const
+        {
+            if (m_nan || (m_positiveInfinity && m_negativeInfinity))
+                return std::numeric_limits<float>::quiet_NaN();
+            if (m_positiveInfinity)
+                return std::numeric_limits<float>::infinity();
+            if (m_negativeInfinity)
+                return -std::numeric_limits<float>::infinity();
+
+            ExactFloatAccumulator magnitude(*this);
+            magnitude.Normalize();
+            const bool negative = magnitude.m_limbs[kLimbCount - 1] < 0;
+            if (negative)
+            {
+                for (int i = 0; i < kLimbCount; ++i)
+                    magnitude.m_limbs[i] = -magnitude.m_limbs[i];
+                magnitude.Normalize();
+            }
+
+            int top = kLimbCount - 1;
+            while (top >= 0 && magnitude.m_limbs[top] == 0)
+                --top;
+            if (top < 0)
+                return 0.0f;
+
+            //  Take the top two limbs as a 64 bit window, anything below it only affects rounding.
+            unsigned long long window = static_cast<unsigned long long>(magnitude.m_limbs[top]);
+            int windowLowBit = top * kLimbBits;
+            bool sticky = false;
+            if (top > 0)
+            {
+                window = (window << kLimbBits) | static_cast<unsigned long long>(magnitude.m_limbs[top - 1]);
+                windowLowBit -= kLimbBits;
+                for (int i = 0; i < top - 1; ++i)
+                    sticky |= (magnitude.m_limbs[i] != 0);
+            }
+
+            int msb = 63;
+            while (((window >> msb) & 1) == 0)
+                --msb;
+
+            float result;
+            if (msb < 24)
+            {
+                //  Fits in the 24 bit significand, which only happens when top == 0, so it's exact.
+                result = ldexpf(float(window), windowLowBit - 149);
+            }
+            else
+            {
+                const int shift = msb - 23;
+                unsigned long long significand = window >> shift;
+                const unsigned long long remainder = window & ((1ull << shift) - 1);
+                const unsigned long long half = 1ull << (shift - 1);
+                if (remainder > half || (remainder == half && (sticky || (significand & 1) != 0)))
+                    ++significand;
+                result = ldexpf(float(significand), windowLowBit + shift - 149);
+            }
+            return negative ? -result : result;
+        }
+
+    private:
+        static const int kLimbBits = 32;
+        static const int kLimbCount = 12;                   // 384 bits, enough for 2^63 additions of FLT_MAX.
+        static const int kNormalizeInterval = 1 << 30;
+
+        //  Propagate carries so limbs 0 ... kLimbCount - 2 are in [0, 2^32), the top limb carries the sign.
+        void Normalize()
+        {
+            for (int i = 0; i < kLimbCount - 1; ++i)
+            {
+                const long long carry = (m_limbs[i] >= 0) ? (m_limbs[i] >> kLimbBits) : -((-m_limbs[i] + 0xFFFFFFFFll) >> kLimbBits);
+                m_limbs[i] -= carry * (1ll << kLimbBits);
+                m_limbs[i + 1] += carry;
+            }
+            m_pending = 0;
+        }
+
+        long long m_limbs[kLimbCount];
+        int m_pending;
+        bool m_nan;
+        bool m_positiveInfinity;
+        bool m_negativeInfinity;
+    };
+
+    //  Correctly rounded sum of count floats, computed in parallel.
+
+    inline float ExactSum(const float* const pData, size_t count)
+    {
+        const size_t chunkSize = 64 * 1024;
+        const size_t chunkCount = (count + chunkSize - 1) / chunkSize;
+        std::vector<ExactFloatAccumulator> partial(chunkCount);
+
+        concurrency::parallel_for(size_t(0), chunkCount, [=, &partial](size_t c)
+        {
+            const size_t end = (std::min)(count, (c + 1) * chunkSize);
+            ExactFloatAccumulator& acc = partial[c];
+            for (size_t i = c * chunkSize; i < end; ++i)
+                acc.Add(pData[i]);
+        });
+
+        ExactFloatAccumulator total;
+        for (size_t c = 0; c < chunkCount; ++c)
+            total.Merge(partial[c]);
+        return total.ToFloat();
+    }
+
+    //--------------------------------------------------------------------------------------
+    //  Fixed shape tree.
+    //--------------------------------------------------------------------------------------
+
+    const int kFixedTreeBlockSize = 1024;
+
+    namespace details
+    {
+        //  Reduce one block of a level on the CPU, the same steps as the C++ AMP kernel below.
+
+        inline float FixedTreeBlockCpu(const float* const pData, size_t count, size_t block)
+        {
+            const int halfBlock = kFixedTreeBlockSize / 2;
+            const size_t first = block * kFixedTreeBlockSize;
+            float x[halfBlock];
+            if (first + kFixedTreeBlockSize <= count)
+            {
+                for (int i = 0; i < halfBlock; ++i)
+                    x[i] = pData[first + i] + pData[first + i + halfBlock];
+            }
+            else
+            {
+                //  The last block is padded with zeros, exactly as the C++ AMP kernel does.
+                for (int i = 0; i < halfBlock; ++i)
+                {
+                    const float a = (first + i < count) ? pData[first + i] : 0.0f;
+                    const float b = (first + i + halfBlock < count) ? pData[first + i + halfBlock] : 0.0f;
+                    x[i] = a + b;
+                }
+            }
+            for (int s = halfBlock / 2; s > 0; s /= 2)
+            {
+                for (int i = 0; i < s; ++i)
+                    x[i] += x[i + s];
+            }
+            return x[0];
+        }
+
+        //  A single dispatch can have at most 65535 tiles, so longer levels are reduced in
+        //  sections of that many blocks.
+
+        const int kFixedTreeMaxTiles = 65535;
+
+        inline void FixedTreeLevelAmp(const accelerator_view& view, const array_view<const float, 1>& input, const array_view<float, 1>& output)
+        {
+            const int halfBlock = kFixedTreeBlockSize / 2;
+            const int count = input.extent[0];
+            const int blockCount = output.extent[0];
+
+            for (int firstBlock = 0; firstBlock < blockCount; firstBlock += kFixedTreeMaxTiles)
+            {
+                const int sectionBlocks = (std::min)(kFixedTreeMaxTiles, blockCount - firstBlock);
+                parallel_for_each(view, extent<1>(sectionBlocks * halfBlock).tile<halfBlock>(), [=](tiled_index<halfBlock> tidx) restrict(amp)
+                {
+                    const int tid = tidx.local[0];
+                    const int block = firstBlock + tidx.tile[0];
+                    const int i = block * kFixedTreeBlockSize + tid;
+                    tile_static float x[halfBlock];
+
+                    const float a = (i < count) ? input[i] : 0.0f;
+                    const float b = (i + halfBlock < count) ? input[i + halfBlock] : 0.0f;
+                    x[tid] = a + b;
+                    tidx.barrier.wait_with_tile_static_memory_fence();
+
+                    for (int s = halfBlock / 2; s > 0; s /= 2)
+                    {
+                        if (tid < s)
+                            x[tid] += x[tid + s];
+                        tidx.barrier.wait_with_tile_static_memory_fence();
+                    }
+
+                    if (tid == 0)
+                        output[block] = x[0];
+                });
+            }
+        }
+    }
+
+    inline float FixedTreeSumCpu(const float* const pData, size_t count)
+    {
+        if (count == 0)
+            return 0.0f;
+
+        const float* pLevel = pData;
+        size_t levelSize = count;
+        std::vector<float> level;
+        std::vector<float> next;
+        while (levelSize > 1)
+        {
+            next.resize((levelSize + kFixedTreeBlockSize - 1) / kFixedTreeBlockSize);
+            float* const pNext = next.data();
+            concurrency::parallel_for(size_t(0), next.size(), [=](size_t b)
+            {
+                pNext[b] = details::FixedTreeBlockCpu(pLevel, levelSize, b);
+            });
+            level.swap(next);
+            pLevel = level.data();
+            levelSize = level.size();
+        }
+        return pLevel[0];
+    }
+
+    inline float FixedTreeSum(const accelerator_view& view, const array_view<const float, 1>& input)
+    {
+        int count = input.extent[0];
+        if (count == 0)
+            return 0.0f;
+        if (count == 1)
+        {
+            std::vector<float> single(1);
+            copy(input, single.begin());
+            return single[0];
+        }
+
+        array_view<const float, 1> level = input;
+        std::vector<array<float, 1>> levels;
+        levels.reserve(4);
+        while (count > 1)
+        {
+            count = (count + kFixedTreeBlockSize - 1) / kFixedTreeBlockSize;
+            levels.push_back(array<float, 1>(count, view));
+            details::FixedTreeLevelAmp(view, level, array_view<float, 1>(levels.back()));
+            level = array_view<const float, 1>(levels.back());
+        }
+
+        std::vector<float> result(1);
+        copy(levels.back(), result.begin());
+        return result[0];
+    }
+}
@@ -0,0 +1,440 @@
+//===============================================================================
+//
+// Microsoft Press
+// C++ AMP: Accelerated Massive Parallelism with Microsoft Visual C++
+//
+//===============================================================================
+// Copyright (c) 2012 Ade Miller & Kate Gregory.  All rights reserved.
+// This code released under the terms of the
+// Microsoft Public License (Ms-PL), http://ampbook.codeplex.com/license.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//===============================================================================
+
+#pragma once
+
+#include <amp.h>
+#include <vector>
+#include <iterator>
+#include <utility>
+#include <limits.h>
+#include <float.h>
+#include <assert.h>
+
+using namespace concurrency;
+
+//--------------------------------------------------------------------------------------
+//  Generic reduction.
+//--------------------------------------------------------------------------------------
+//
+//  The cascading reduction from the Reduction case study, templated on the element type
+//  and the operator. Each thread first accumulates a strided subset of the input, so any
+//  length works without padding, then each tile combines its threads' values in tile_static
+//  memory. The per tile results are combined on the CPU in tile order.
+//
+//  An operator is any type providing:
+//
+//      T Identity() const restrict(amp, cpu);
+//      T operator()(const T& a, const T& b) const restrict(amp, cpu);
+//
+//  TransformReduce applies a function to each element as it is loaded and reduces the results,
+//  so the transformed values are never written to memory.
+//
+//  The operator must be associative and commutative, each thread combines a strided subset
+//  of the elements so they are not combined in input order. Element types are limited to
+//  those C++ AMP allows in an array: int, unsigned, float, double and structs of these.
+
+namespace Extras
+{
+    const int kReduceTileSize = 256;
+    const int kReduceTileCount = 128;
+
+    namespace details
+    {
+        //  std::numeric_limits is not available in restrict(amp) code.
+
+        template <typename T>
+        struct Limits;
+
+        template <>
+        struct Limits<int>
+        {
+            static int Lowest() restrict(amp, cpu) { return INT_MIN; }
+            static int Highest() restrict(amp, cpu) { return INT_MAX; }
+        };
+
+        template <>
+        struct Limits<unsigned>
+        {
+            static unsigned Lowest() restrict(amp, cpu) { return 0; }
+            static unsigned Highest() restrict(amp, cpu) { return UINT_MAX; }
+        };
+
+        template <>
+        struct Limits<float>
+        {
+            static float Lowest() restrict(amp, cpu) { return -FLT_MAX; }
+            static float Highest() restrict(amp, cpu) { return FLT_MAX; }
+        };
+
+        template <>
+        struct Limits<double>
+        {
+            static double Lowest() restrict(amp, cpu) { return -DBL_MAX; }
+            static double Highest() restrict(amp, cpu) { return DBL_MAX; }
+        };
+    }
+
+    //--------------------------------------------------------------------------------------
+    //  Operators.
+    //--------------------------------------------------------------------------------------
+
+    template <typename T>
+    struct SumOp
+    {
+        T Identity() const restrict(amp, cpu) { return T(0); }
+        T operator()(const T& a, const T& b) const restrict(amp, cpu) { return a + b; }
+    };
+
+    template <typename T>
+    struct MinOp
+    {
+        T Identity() const restrict(amp, cpu) { return details::Limits<T>::Highest(); }
+        T operator()(const T& a, const T& b) const restrict(amp, cpu) { return (b < a) ? b : a; }
+    };
+
+    template <typename T>
+    struct MaxOp
+    {
+        T Identity() const restrict(amp, cpu) { return details::Limits<T>::Lowest(); }
+        T operator()(const T& a, const T& b) const restrict(amp, cpu) { return (a < b) ? b : a; }
+    };
+
+    //  C++ AMP has no bool arrays so truth values are ints, zero or one.
+
+    struct LogicalAndOp
+    {
+        int Identity() const restrict(amp, cpu) { return 1; }
+        int operator()(const int& a, const int& b) const restrict(amp, cpu) { return a & b; }
+    };
+
+    struct LogicalOrOp
+    {
+        int Identity() const restrict(amp, cpu) { return 0; }
+        int operator()(const int& a, const int& b) const restrict(amp, cpu) { return a | b; }
+    };
+
+    //  A value and its position in the input. When several elements share the smallest or largest
+    //  value the one with the lowest index is chosen, so the result doesn't depend on scheduling.
+
+    template <typename T>
+    struct IndexedValue
+    {
+        T value;
+        int position;
+    };
+
+    template <typename T>
+    struct ArgMinOp
+    {
+        IndexedValue<T> Identity() const restrict(amp, cpu)
+        {
+            IndexedValue<T> r;
+            r.value = details::Limits<T>::Highest();
+            r.position = INT_MAX;
+            return r;
+        }
+
+        IndexedValue<T> operator()(const IndexedValue<T>& a, const IndexedValue<T>& b) const restrict(amp, cpu)
+        {
+            return ((b.value < a.value) || (b.value == a.value && b.position < a.position)) ? b : a;
+        }
+    };
+
+    template <typename T>
+    struct ArgMaxOp
+    {
+        IndexedValue<T> Identity() const restrict(amp, cpu)
+        {
+            IndexedValue<T> r;
+            r.value = details::Limits<T>::Lowest();
+            r.position = INT_MAX;
+            return r;
+        }
+
+        IndexedValue<T> operator()(const IndexedValue<T>& a, const IndexedValue<T>& b) const restrict(amp, cpu)
+        {
+            return ((a.value < b.value) || (b.value == a.value && b.position < a.position)) ? b : a;
+        }
+    };
+
+    //  Several reductions computed in a single pass. Sums are accumulated as AccT which can be
+    //  wider than the element type to avoid overflow.
+
+    template <typename T, typename AccT>
+    struct Statistics
+    {
+        AccT sum;
+        AccT sumOfSquares;
+        int count;
+        T minimum;
+        T maximum;
+    };
+
+    template <typename T, typename AccT>
+    struct StatisticsOp
+    {
+        Statistics<T, AccT> Identity() const restrict(amp, cpu)
+        {
+            Statistics<T, AccT> r;
+            r.sum = AccT(0);
+            r.sumOfSquares = AccT(0);
+            r.count = 0;
+            r.minimum = details::Limits<T>::Highest();
+            r.maximum = details::Limits<T>::Lowest();
+            return r;
+        }
+
+        Statistics<T, AccT> operator()(const Statistics<T, AccT>& a, const Statistics<T, AccT>& b) const restrict(amp, cpu)
+        {
+            Statistics<T, AccT> r;
+            r.sum = a.sum + b.sum;
+            r.sumOfSquares = a.sumOfSquares + b.sumOfSquares;
+            r.count = a.count + b.count;
+            r.minimum = (b.minimum < a.minimum) ? b.minimum : a.minimum;
+            r.maximum = (a.maximum < b.maximum) ? b.maximum : a.maximum;
+            return r;
+        }
+    };
+
+    namespace details
+    {
+        //  Loaders convert an input element into the operator's value type as it is read.
+
+        template <typename T>
+        struct LoadElement
+        {
+            T operator()(const array_view<const T, 1>& input, int i) const restrict(amp) { return input[i]; }
+        };
+
+        template <typename T>
+        struct LoadIndexed
+        {
+            IndexedValue<T> operator()(const array_view<const T, 1>& input, int i) const restrict(amp)
+            {
+                IndexedValue<T> r;
+                r.value = input[i];
+                r.position = i;
+                return r;
+            }
+        };
+
+        template <typename T>
+        struct LoadTruth
+        {
+            int operator()(const array_view<const T, 1>& input, int i) const restrict(amp) { return (input[i] != T(0)) ? 1 : 0; }
+        };
+
+        template <typename T, typename AccT>
+        struct LoadStatistics
+        {
+            Statistics<T, AccT> operator()(const array_view<const T, 1>& input, int i) const restrict(amp)
+            {
+                const T v = input[i];
+                Statistics<T, AccT> r;
+                r.sum = AccT(v);
+                r.sumOfSquares = AccT(v) * AccT(v);
+                r.count = 1;
+                r.minimum = v;
+                r.maximum = v;
+                return r;
+            }
+        };
+
+        template <int TileSize, int TileCount, typename U, typename T, typename Op, typename Load>
+        U ReduceCascading(const accelerator_view& view, const array_view<const T, 1>& input, const Op& op, const Load& load)
+        {
+            static_assert((TileSize >= 2) && ((TileSize & (TileSize - 1)) == 0), "TileSize must be a power of two.");
+            static_assert(TileCount > 0, "TileCount must be positive.");
+
+            const int elementCount = input.extent[0];
+            const int stride = TileSize * TileCount;
+            array<U, 1> partial(TileCount, view);
+
+            parallel_for_each(view, extent<1>(stride).tile<TileSize>(), [=, &partial](tiled_index<TileSize> tidx) restrict(amp)
+            {
+                const int tid = tidx.local[0];
+                tile_static U tileData[TileSize];
+
+                //  Accumulate many elements per thread. Adjacent threads read adjacent elements.
+                U acc = op.Identity();
+                for (int i = tidx.global[0]; i < elementCount; i += stride)
+                    acc = op(acc, load(input, i));
+                tileData[tid] = acc;
+                tidx.barrier.wait();
+
+                //  TileSize is a template parameter so the compiler fully unrolls this loop. Unlike the
+                //  warp unrolled case study reducers every step keeps its barrier, so the result does
+                //  not depend on the hardware's warp or wavefront size.
+                for (int s = TileSize / 2; s > 0; s /= 2)
+                {
+                    if (tid < s)
+                        tileData[tid] = op(tileData[tid], tileData[tid + s]);
+                    tidx.barrier.wait_with_tile_static_memory_fence();
+                }
+
+                if (tid == 0)
+                    partial[tidx.tile[0]] = tileData[0];
+            });
+
+            std::vector<U> partialResult(TileCount);
+            copy(partial, partialResult.begin());
+            U result = op.Identity();
+            for (int i = 0; i < TileCount; ++i)
+                result = op(result, partialResult[i]);
+            return result;
+        }
+    }
+
+    //--------------------------------------------------------------------------------------
+    //  Reductions.
+    //--------------------------------------------------------------------------------------
+
+    template <int TileSize, int TileCount, typename T, typename Op>
+    inline T Reduce(const accelerator_view& view, const array_view<const T, 1>& input, const Op& op)
+    {
+        return details::ReduceCascading<TileSize, TileCount, T>(view, input, op, details::LoadElement<T>());
+    }
+
+    template <typename T, typename Op>
+    inline T Reduce(const accelerator_view& view, const array_view<const T, 1>& input, const Op& op)
+    {
+        return Reduce<kReduceTileSize, kReduceTileCount>(view, input, op);
+    }
+
+    template <typename InIt, typename Op>
+    inline typename std::iterator_traits<InIt>::value_type Reduce(InIt first, InIt last, const Op& op)
+    {
+        typedef typename std::iterator_traits<InIt>::value_type T;
+
+        const int size = int(std::distance(first, last));
+        if (size == 0)
+            return op.Identity();
+        accelerator_view view = accelerator().default_view;
+        concurrency::array<T, 1> input(size, first, last, view);
+        return Reduce(view, array_view<const T, 1>(input), op);
+    }
+
+    //  The smallest or largest element and its position. The position is -1 if the input is empty.
+
+    template <typename T>
+    inline IndexedValue<T> ArgMin(const accelerator_view& view, const array_view<const T, 1>& input)
+    {
+        IndexedValue<T> r = details::ReduceCascading<kReduceTileSize, kReduceTileCount, IndexedValue<T>>(view, input, ArgMinOp<T>(), details::LoadIndexed<T>());
+        if (r.position == INT_MAX)
+            r.position = -1;
+        return r;
+    }
+
+    template <typename T>
+    inline IndexedValue<T> ArgMax(const accelerator_view& view, const array_view<const T, 1>& input)
+    {
+        IndexedValue<T> r = details::ReduceCascading<kReduceTileSize, kReduceTileCount, IndexedValue<T>>(view, input, ArgMaxOp<T>(), details::LoadIndexed<T>());
+        if (r.position == INT_MAX)
+            r.position = -1;
+        return r;
+    }
+
+    //  True if all, or any, elements are non-zero.
+
+    template <typename T>
+    inline bool AllOf(const accelerator_view& view, const array_view<const T, 1>& input)
+    {
+        return details::ReduceCascading<kReduceTileSize, kReduceTileCount, int>(view, input, LogicalAndOp(), details::LoadTruth<T>()) != 0;
+    }
+
+    template <typename T>
+    inline bool AnyOf(const accelerator_view& view, const array_view<const T, 1>& input)
+    {
+        return details::ReduceCascading<kReduceTileSize, kReduceTileCount, int>(view, input, LogicalOrOp(), details::LoadTruth<T>()) != 0;
+    }
+
+    //  Sum, sum of squares, count, minimum and maximum in a single pass over the input.
+
+    template <typename AccT, typename T>
+    inline Statistics<T, AccT> ComputeStatistics(const accelerator_view& view, const array_view<const T, 1>& input)
+    {
+        return details::ReduceCascading<kReduceTileSize, kReduceTileCount, Statistics<T, AccT>>(view, input, StatisticsOp<T, AccT>(), details::LoadStatistics<T, AccT>());
+    }
+
+    //--------------------------------------------------------------------------------------
+    //  Transform reductions.
+    //--------------------------------------------------------------------------------------
+    //
+    //  The transform is any restrict(amp) function object, unary or binary. Its result type must
+    //  be the operator's value type, for example the squared norm of a vector is
+    //
+    //      TransformReduce(view, av, [](float x) restrict(amp) { return x * x; }, SumOp<float>());
+
+    namespace details
+    {
+        template <typename Op>
+        struct OpValue
+        {
+            typedef decltype(std::declval<const Op&>().Identity()) Type;
+        };
+
+        template <typename U, typename T, typename Transform>
+        struct LoadTransformed
+        {
+            Transform transform;
+
+            U operator()(const array_view<const T, 1>& input, int i) const restrict(amp) { return transform(input[i]); }
+        };
+
+        template <typename U, typename T1, typename T2, typename Transform>
+        struct LoadBinaryTransformed
+        {
+            array_view<const T2, 1> second;
+            Transform transform;
+
+            U operator()(const array_view<const T1, 1>& first, int i) const restrict(amp) { return transform(first[i], second[i]); }
+        };
+
+        template <typename T>
+        struct Multiply
+        {
+            T operator()(const T& a, const T& b) const restrict(amp, cpu) { return a * b; }
+        };
+    }
+
+    template <typename T, typename Transform, typename Op>
+    inline typename details::OpValue<Op>::Type TransformReduce(const accelerator_view& view, const array_view<const T, 1>& input,
+        const Transform& transform, const Op& op)
+    {
+        typedef typename details::OpValue<Op>::Type U;
+        const details::LoadTransformed<U, T, Transform> load = { transform };
+        return details::ReduceCascading<kReduceTileSize, kReduceTileCount, U>(view, input, op, load);
+    }
+
+    //  Reduces transform(first[i], second[i]), the inputs must be the same length.
+
+    template <typename T1, typename T2, typename Transform, typename Op>
+    inline typename details::OpValue<Op>::Type TransformReduce(const accelerator_view& view, const array_view<const T1, 1>& first,
+        const array_view<const T2, 1>& second, const Transform& transform, const Op& op)
+    {
+        typedef typename details::OpValue<Op>::Type U;
+        assert(first.extent == second.extent);
+        const details::LoadBinaryTransformed<U, T1, T2, Transform> load = { second, transform };
+        return details::ReduceCascading<kReduceTileSize, kReduceTileCount, U>(view, first, op, load);
+    }
+
+    template <typename T>
+    inline T Dot(const accelerator_view& view, const array_view<const T, 1>& first, const array_view<const T, 1>& second)
+    {
+        return TransformReduce(view, first, second, details::Multiply<T>(), SumOp<T>());
+    }
+}
@@ -0,0 +1,269 @@
+//===============================================================================
+//
+// Microsoft Press
+// C++ AMP: Accelerated Massive Parallelism with Microsoft Visual C++
+//
+//===============================================================================
+// Copyright (c) 2012 Ade Miller & Kate Gregory.  All rights reserved.
+// This code released under the terms of the
+// Microsoft Public License (Ms-PL), http://ampbook.codeplex.com/license.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//===============================================================================
+
+#pragma once
+
+#include <ppl.h>
+#include <vector>
+#include <algorithm>
+#include <emmintrin.h>
+#include <xmmintrin.h>
+
+//--------------------------------------------------------------------------------------
+//  CPU sum tuned for memory bandwidth.
+//--------------------------------------------------------------------------------------
+//
+//  std::accumulate and parallel_reduce run one dependent chain of adds per thread so each
+//  add waits for the previous one. SumSimd keeps four SSE2 accumulators, 16 values in
+//  flight, and consumes one 64 byte cache line per iteration starting from a cache line
+//  boundary, prefetching a fixed distance ahead.
+//
+//  SumParallel gives each virtual processor one contiguous, cache line aligned range.
+//  The per worker results are written to separate cache lines to avoid false sharing and
+//  then combined pairwise. PPL doesn't pin workers to cores or sockets, so the hierarchy
+//  is a fixed tree over workers rather than an explicit per socket stage.
+//
+//  Integer sums wrap on overflow exactly as the scalar loop does. Float sums are
+//  reassociated so they can differ from a sequential sum in the last bits, see
+//  DeterministicReduce.h if that matters.
+
+namespace Extras
+{
+    namespace details
+    {
+        const size_t kCacheLineSize = 64;
+        const size_t kPrefetchDistance = 16 * kCacheLineSize;
+        const size_t kMinElementsPerWorker = 64 * 1024;
+
+        template <typename T>
+        struct SimdSumOps;
+
+        template <>
+        struct SimdSumOps<int>
+        {
+            typedef __m128i Register;
+
+            static Register Zero() { return _mm_setzero_si128(); }
+            static Register Load(const int* p) { return _mm_load_si128(reinterpret_cast<const __m128i*>(p)); }
+            static Register Add(Register a, Register b) { return _mm_add_epi32(a, b); }
+            static int AddScalar(int a, int b) { return int(unsigned(a) + unsigned(b)); }
+            static int HorizontalSum(Register v)
+            {
+                v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+                v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+                return _mm_cvtsi128_si32(v);
+            }
+        };
+
+        template <>
+        struct SimdSumOps<float>
+        {
+            typedef __m128 Register;
+
+            static Register Zero() { return _mm_setzero_ps(); }
+            static Register Load(const float* p) { return _mm_load_ps(p); }
+            static Register Add(Register a, Register b) { return _mm_add_ps(a, b); }
+            static float AddScalar(float a, float b) { return a + b; }
+            static float HorizontalSum(Register v)
+            {
+                v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+                v = _mm_add_ss(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1)));
+                return _mm_cvtss_f32(v);
+            }
+        };
+
+        //  Align each worker's result to a cache line, a T larger than a line takes whole lines.
+        //  __declspec(align) needs a literal so keep this in step with kCacheLineSize.
+
+        template <typename T>
+        struct __declspec(align(64)) PaddedPartial
+        {
+            T value;
+        };
+    }
+
+    //  Single threaded sum with multiple SIMD accumulators.
+
+    template <typename T>
+    inline T SumSimd(const T* const pData, size_t count)
+    {
+        typedef details::SimdSumOps<T> Ops;
+        const size_t perLine = details::kCacheLineSize / sizeof(T);
+
+        //  Scalar head up to the first cache line boundary.
+        size_t i = 0;
+        T head = T(0);
+        while (i < count && (reinterpret_cast<size_t>(pData + i) % details::kCacheLineSize) != 0)
+            head = Ops::AddScalar(head, pData[i++]);
+
+        typename Ops::Register acc0 = Ops::Zero();
+        typename Ops::Register acc1 = Ops::Zero();
+        typename Ops::Register acc2 = Ops::Zero();
+        typename Ops::Register acc3 = Ops::Zero();
+        for (; i + perLine <= count; i += perLine)
+        {
+            //  Prefetches never fault so reading past the end of the data is harmless.
+            _mm_prefetch(reinterpret_cast<const char*>(pData + i) + details::kPrefetchDistance, _MM_HINT_T0);
+            acc0 = Ops::Add(acc0, Ops::Load(pData + i));
+            acc1 = Ops::Add(acc1, Ops::Load(pData + i + perLine / 4));
+            acc2 = Ops::Add(acc2, Ops::Load(pData + i + perLine / 2));
+            acc3 = Ops::Add(acc3, Ops::Load(pData + i + 3 * perLine / 4));
+        }
+        T result = Ops::HorizontalSum(Ops::Add(Ops::Add(acc0, acc1), Ops::Add(acc2, acc3)));
+
+        for (; i < count; ++i)
+            result = Ops::AddScalar(result, pData[i]);
+        return Ops::AddScalar(result, head);
+    }
+
+    namespace details
+    {
+        //  Splits [0, count) into one range per virtual processor, with split points on cache line
+        //  boundaries of pData. Each range is reduced by reduceRange(first, last) and the results are
+        //  combined pairwise, in order, with combine.
+
+        template <typename U, typename T, typename ReduceRange, typename Combine>
+        inline U ReduceWorkerRanges(const T* const pData, size_t count, const ReduceRange& reduceRange, const Combine& combine)
+        {
+            const size_t perLine = kCacheLineSize / sizeof(T);
+            const size_t maxWorkers = (std::max)(size_t(1), count / kMinElementsPerWorker);
+            const size_t workers = (std::min)(size_t(concurrency::CurrentScheduler::GetNumberOfVirtualProcessors()), maxWorkers);
+            if (workers <= 1)
+                return reduceRange(size_t(0), count);
+
+            const size_t misalignment = (reinterpret_cast<size_t>(pData) % kCacheLineSize) / sizeof(T);
+            std::vector<size_t> bounds(workers + 1);
+            for (size_t w = 1; w < workers; ++w)
+                bounds[w] = (std::min)(count, ((count / workers * w + misalignment) / perLine) * perLine - misalignment);
+            bounds[workers] = count;
+
+            std::vector<PaddedPartial<U>> partial(workers);
+            concurrency::parallel_for(size_t(0), workers, [&](size_t w)
+            {
+                partial[w].value = reduceRange(bounds[w], bounds[w + 1]);
+            });
+
+            for (size_t stride = 1; stride < workers; stride *= 2)
+            {
+                for (size_t w = 0; w + stride < workers; w += 2 * stride)
+                    partial[w].value = combine(partial[w].value, partial[w + stride].value);
+            }
+            return partial[0].value;
+        }
+    }
+
+    //  Multi threaded sum, one aligned range per virtual processor.
+
+    template <typename T>
+    inline T SumParallel(const T* const pData, size_t count)
+    {
+        return details::ReduceWorkerRanges<T>(pData, count,
+            [=](size_t first, size_t last) { return SumSimd(pData + first, last - first); },
+            [](T a, T b) { return details::SimdSumOps<T>::AddScalar(a, b); });
+    }
+
+    //--------------------------------------------------------------------------------------
+    //  Transform reductions.
+    //--------------------------------------------------------------------------------------
+    //
+    //  Reduce transform(x), or transform(x, y) for two inputs, without storing the transformed
+    //  values, using the operators from Reduce.h. Each thread keeps four accumulators so, as with
+    //  Reduce, the operator must be commutative as well as associative. These are scalar loops; an
+    //  arbitrary transform can't be handed to SSE so any vectorization is left to the compiler.
+    //  DotSimd and DotParallel are hand written SSE2 for the most common case, a multiply followed
+    //  by a separate add since SSE2 has no fused multiply-add.
+
+    template <typename T, typename Transform, typename Op>
+    inline auto TransformReduce(const T* const pData, size_t count, const Transform& transform, const Op& op) -> decltype(op.Identity())
+    {
+        typedef decltype(op.Identity()) U;
+        return details::ReduceWorkerRanges<U>(pData, count, [&](size_t first, size_t last) -> U
+        {
+            U acc0 = op.Identity();
+            U acc1 = op.Identity();
+            U acc2 = op.Identity();
+            U acc3 = op.Identity();
+            size_t i = first;
+            for (; i + 4 <= last; i += 4)
+            {
+                acc0 = op(acc0, transform(pData[i]));
+                acc1 = op(acc1, transform(pData[i + 1]));
+                acc2 = op(acc2, transform(pData[i + 2]));
+                acc3 = op(acc3, transform(pData[i + 3]));
+            }
+            for (; i < last; ++i)
+                acc0 = op(acc0, transform(pData[i]));
+            return op(op(acc0, acc1), op(acc2, acc3));
+        }, op);
+    }
+
+    template <typename T1, typename T2, typename Transform, typename Op>
+    inline auto TransformReduce(const T1* const pFirst, const T2* const pSecond, size_t count, const Transform& transform, const Op& op)
+        -> decltype(op.Identity())
+    {
+        typedef decltype(op.Identity()) U;
+        return details::ReduceWorkerRanges<U>(pFirst, count, [&](size_t first, size_t last) -> U
+        {
+            U acc0 = op.Identity();
+            U acc1 = op.Identity();
+            U acc2 = op.Identity();
+            U acc3 = op.Identity();
+            size_t i = first;
+            for (; i + 4 <= last; i += 4)
+            {
+                acc0 = op(acc0, transform(pFirst[i], pSecond[i]));
+                acc1 = op(acc1, transform(pFirst[i + 1], pSecond[i + 1]));
+                acc2 = op(acc2, transform(pFirst[i + 2], pSecond[i + 2]));
+                acc3 = op(acc3, transform(pFirst[i + 3], pSecond[i + 3]));
+            }
+            for (; i < last; ++i)
+                acc0 = op(acc0, transform(pFirst[i], pSecond[i]));
+            return op(op(acc0, acc1), op(acc2, acc3));
+        }, op);
+    }
+
+    inline float DotSimd(const float* const pFirst, const float* const pSecond, size_t count)
+    {
+        typedef details::SimdSumOps<float> Ops;
+
+        //  The two inputs needn't share an alignment so both use unaligned loads.
+        __m128 acc0 = _mm_setzero_ps();
+        __m128 acc1 = _mm_setzero_ps();
+        __m128 acc2 = _mm_setzero_ps();
+        __m128 acc3 = _mm_setzero_ps();
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16)
+        {
+            _mm_prefetch(reinterpret_cast<const char*>(pFirst + i) + details::kPrefetchDistance, _MM_HINT_T0);
+            _mm_prefetch(reinterpret_cast<const char*>(pSecond + i) + details::kPrefetchDistance, _MM_HINT_T0);
+            acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(pFirst + i), _mm_loadu_ps(pSecond + i)));
+            acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(pFirst + i + 4), _mm_loadu_ps(pSecond + i + 4)));
+            acc2 = _mm_add_ps(acc2, _mm_mul_ps(_mm_loadu_ps(pFirst + i + 8), _mm_loadu_ps(pSecond + i + 8)));
+            acc3 = _mm_add_ps(acc3, _mm_mul_ps(_mm_loadu_ps(pFirst + i + 12), _mm_loadu_ps(pSecond + i + 12)));
+        }
+        float result = Ops::HorizontalSum(_mm_add_ps(_mm_add_ps(acc0, acc1), _mm_add_ps(acc2, acc3)));
+        for (; i < count; ++i)
+            result += pFirst[i] * pSecond[i];
+        return result;
+    }
+
+    inline float DotParallel(const float* const pFirst, const float* const pSecond, size_t count)
+    {
+        return details::ReduceWorkerRanges<float>(pFirst, count,
+            [=](size_t first, size_t last) { return DotSimd(pFirst + first, pSecond + first, last - first); },
+            [](float a, float b) { return a + b; });
+    }
+}
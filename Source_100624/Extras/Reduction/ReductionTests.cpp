@@ -0,0 +1,539 @@
+//===============================================================================
+//
+// Microsoft Press
+// C++ AMP: Accelerated Massive Parallelism with Microsoft Visual C++
+//
+//===============================================================================
+// Copyright (c) 2012 Ade Miller & Kate Gregory.  All rights reserved.
+// This code released under the terms of the
+// Microsoft Public License (Ms-PL), http://ampbook.codeplex.com/license.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//===============================================================================
+
+#include "stdafx.h"
+
+#include "Reduce.h"
+#include "DeterministicReduce.h"
+#include "ReduceCpu.h"
+#include "SegmentedReduce.h"
+#include "StreamReduce.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Extras;
+
+namespace ReductionTests
+{
+    //  A user defined operator, the element with the largest magnitude.
+
+    struct MaxAbsOp
+    {
+        float Identity() const restrict(amp, cpu) { return 0.0f; }
+        float operator()(const float& a, const float& b) const restrict(amp, cpu) { return (fabs(b) > fabs(a)) ? b : a; }
+    };
+
+    std::vector<int> MakeInput(int size)
+    {
+        std::vector<int> input(size);
+        int i = 0;
+        std::generate(begin(input), end(input), [&i]() { return (i++ * 7) % 23 - 5; });
+        return input;
+    }
+
+    TEST_CLASS(ReduceTests)
+    {
+    public:
+        TEST_METHOD(ReduceTests_SumAnyLength)
+        {
+            accelerator_view view = accelerator().default_view;
+            const int sizes[] = { 0, 1, 63, 64, 1000, 4099 };
+            for (int size : sizes)
+            {
+                std::vector<int> input = MakeInput(size);
+                const int expected = std::accumulate(begin(input), end(input), 0);
+                array_view<const int, 1> av(size, input);
+
+                Assert::AreEqual(expected, Reduce<64, 4>(view, av, SumOp<int>()));
+                Assert::AreEqual(expected, Reduce(begin(input), end(input), SumOp<int>()));
+            }
+        }
+
+        TEST_METHOD(ReduceTests_MinMax)
+        {
+            accelerator_view view = accelerator().default_view;
+            std::vector<float> input(777);
+            for (size_t i = 0; i < input.size(); ++i)
+                input[i] = sinf(float(i));
+            array_view<const float, 1> av(int(input.size()), input);
+
+            Assert::AreEqual(*std::min_element(begin(input), end(input)), Reduce(view, av, MinOp<float>()));
+            Assert::AreEqual(*std::max_element(begin(input), end(input)), Reduce(view, av, MaxOp<float>()));
+        }
+
+        TEST_METHOD(ReduceTests_ArgMinArgMaxPickFirst)
+        {
+            accelerator_view view = accelerator().default_view;
+            std::vector<int> input(3000, 4);
+            input[2999] = -2;
+            input[1500] = -2;
+            input[17] = 9;
+            input[2500] = 9;
+            array_view<const int, 1> av(int(input.size()), input);
+
+            IndexedValue<int> minimum = ArgMin(view, av);
+            IndexedValue<int> maximum = ArgMax(view, av);
+
+            Assert::AreEqual(-2, minimum.value);
+            Assert::AreEqual(1500, minimum.position);
+            Assert::AreEqual(9, maximum.value);
+            Assert::AreEqual(17, maximum.position);
+
+            std::vector<int> empty(1);
+            Assert::AreEqual(-1, ArgMin(view, array_view<const int, 1>(0, empty)).position);
+        }
+
+        TEST_METHOD(ReduceTests_AllOfAnyOf)
+        {
+            accelerator_view view = accelerator().default_view;
+            std::vector<int> input(1025, 3);
+            array_view<const int, 1> av(int(input.size()), input);
+
+            Assert::IsTrue(AllOf(view, av));
+            Assert::IsTrue(AnyOf(view, av));
+
+            input[1024] = 0;
+            Assert::IsFalse(AllOf(view, av));
+            std::fill(begin(input), end(input), 0);
+            Assert::IsFalse(AnyOf(view, av));
+        }
+
+        TEST_METHOD(ReduceTests_StatisticsSinglePass)
+        {
+            accelerator_view view = accelerator().default_view;
+            std::vector<int> input = MakeInput(5000);
+            array_view<const int, 1> av(int(input.size()), input);
+
+            Statistics<int, float> stats = ComputeStatistics<float>(view, av);
+
+            float sumOfSquares = 0.0f;
+            for (int v : input)
+                sumOfSquares += float(v) * v;
+            Assert::AreEqual(float(std::accumulate(begin(input), end(input), 0)), stats.sum);
+            Assert::AreEqual(sumOfSquares, stats.sumOfSquares, sumOfSquares * 1e-6f);
+            Assert::AreEqual(5000, stats.count);
+            Assert::AreEqual(-5, stats.minimum);
+            Assert::AreEqual(17, stats.maximum);
+        }
+
+        TEST_METHOD(ReduceTests_UserOperator)
+        {
+            accelerator_view view = accelerator().default_view;
+            std::vector<float> input(300, 1.0f);
+            input[123] = -8.5f;
+            input[200] = 8.0f;
+            array_view<const float, 1> av(int(input.size()), input);
+
+            Assert::AreEqual(-8.5f, Reduce<32, 2>(view, av, MaxAbsOp()));
+        }
+
+        TEST_METHOD(ReduceTests_TransformReduce)
+        {
+            accelerator_view view = accelerator().default_view;
+            std::vector<int> input = MakeInput(4099);
+            array_view<const int, 1> av(int(input.size()), input);
+
+            int sumOfSquares = 0;
+            for (int v : input)
+                sumOfSquares += v * v;
+            const int threshold = 10;
+            const int above = int(std::count_if(begin(input), end(input), [=](int v) { return v > threshold; }));
+
+            Assert::AreEqual(sumOfSquares, TransformReduce(view, av, [](int x) restrict(amp, cpu) { return x * x; }, SumOp<int>()));
+            Assert::AreEqual(above, TransformReduce(view, av, [=](int x) restrict(amp, cpu) { return (x > threshold) ? 1 : 0; }, SumOp<int>()));
+        }
+
+        TEST_METHOD(ReduceTests_BinaryTransformReduce)
+        {
+            accelerator_view view = accelerator().default_view;
+            std::vector<int> first = MakeInput(3000);
+            std::vector<int> second(3000);
+            std::iota(begin(second), end(second), -1500);
+            array_view<const int, 1> av1(3000, first);
+            array_view<const int, 1> av2(3000, second);
+
+            const int expected = std::inner_product(begin(first), end(first), begin(second), 0);
+            Assert::AreEqual(expected, Dot(view, av1, av2));
+            int equal = 0;
+            for (size_t i = 0; i < first.size(); ++i)
+                equal += (first[i] == second[i]) ? 1 : 0;
+            Assert::AreEqual(equal, TransformReduce(view, av1, av2, [](int a, int b) restrict(amp, cpu) { return (a == b) ? 1 : 0; }, SumOp<int>()));
+        }
+    };
+
+    //  Reference for the fixed shape tree, written as plainly as possible.
+
+    float FixedTreeReference(std::vector<float> level)
+    {
+        while (level.size() > 1)
+        {
+            std::vector<float> next;
+            for (size_t first = 0; first < level.size(); first += kFixedTreeBlockSize)
+            {
+                std::vector<float> block(kFixedTreeBlockSize, 0.0f);
+                std::copy(begin(level) + first, begin(level) + (std::min)(level.size(), first + kFixedTreeBlockSize), begin(block));
+                for (int s = kFixedTreeBlockSize / 2; s > 0; s /= 2)
+                    for (int i = 0; i < s; ++i)
+                        block[i] += block[i + s];
+                next.push_back(block[0]);
+            }
+            level.swap(next);
+        }
+        return level.empty() ? 0.0f : level[0];
+    }
+
+    std::vector<float> MakeIllConditioned(int size)
+    {
+        std::vector<float> input(size);
+        unsigned seed = 12345;
+        for (float& v : input)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            v = ldexpf(float(int(seed >> 8) - (1 << 23)), int(seed % 40) - 20 - 23);
+        }
+        return input;
+    }
+
+    bool SameBits(float a, float b)
+    {
+        return memcmp(&a, &b, sizeof(float)) == 0;
+    }
+
+    TEST_CLASS(DeterministicReduceTests)
+    {
+    public:
+        TEST_METHOD(DeterministicReduceTests_ExactSumIsCorrectlyRounded)
+        {
+            std::vector<float> input;
+            input.push_back(1e8f);
+            input.push_back(1.0f);
+            input.push_back(-1e8f);
+            input.push_back(ldexpf(1.0f, -149));
+            Assert::AreEqual(1.0f, ExactSum(input.data(), input.size()));
+
+            // 2^24 + 1 + 2^-30 must round up to 2^24 + 2, without the tiny term it is a tie that rounds to even.
+            std::vector<float> tie;
+            tie.push_back(16777216.0f);
+            tie.push_back(1.0f);
+            Assert::AreEqual(16777216.0f, ExactSum(tie.data(), tie.size()));
+            tie.push_back(ldexpf(1.0f, -30));
+            Assert::AreEqual(16777218.0f, ExactSum(tie.data(), tie.size()));
+
+            std::vector<float> negative(1000, -0.1f);
+            Assert::AreEqual(float(-1000.0 * double(0.1f)), ExactSum(negative.data(), negative.size()));
+        }
+
+        TEST_METHOD(DeterministicReduceTests_ExactSumIgnoresOrder)
+        {
+            std::vector<float> input = MakeIllConditioned(200000);
+            const float expected = ExactSum(input.data(), input.size());
+
+            double reference = 0.0;
+            for (float v : input)
+                reference += v;
+            Assert::AreEqual(float(reference), expected, fabsf(expected) * 1e-6f);
+
+            std::reverse(begin(input), end(input));
+            Assert::IsTrue(SameBits(expected, ExactSum(input.data(), input.size())));
+            std::rotate(begin(input), begin(input) + 77777, end(input));
+            Assert::IsTrue(SameBits(expected, ExactSum(input.data(), input.size())));
+        }
+
+        TEST_METHOD(DeterministicReduceTests_ExactSumSpecialValues)
+        {
+            std::vector<float> input(10, 1.0f);
+            input[3] = std::numeric_limits<float>::infinity();
+            Assert::AreEqual(std::numeric_limits<float>::infinity(), ExactSum(input.data(), input.size()));
+            input[4] = -std::numeric_limits<float>::infinity();
+            Assert::IsTrue(ExactSum(input.data(), input.size()) != ExactSum(input.data(), input.size()));
+        }
+
+        TEST_METHOD(DeterministicReduceTests_FixedTreeCpuAndAmpAgree)
+        {
+            accelerator_view view = accelerator().default_view;
+            const int sizes[] = { 1, 1000, 1024, 5000, 1100000 };
+            for (int size : sizes)
+            {
+                std::vector<float> input = MakeIllConditioned(size);
+                const float expected = FixedTreeReference(input);
+
+                Assert::IsTrue(SameBits(expected, FixedTreeSumCpu(input.data(), input.size())));
+                Assert::IsTrue(SameBits(expected, FixedTreeSum(view, array_view<const float, 1>(size, input))));
+            }
+        }
+
+        TEST_METHOD(DeterministicReduceTests_FixedTreeAmpAboveTileLimit)
+        {
+            //  One block more than a single dispatch can have tiles, plus a partial block.
+            accelerator_view view = accelerator().default_view;
+            const int size = (Extras::details::kFixedTreeMaxTiles + 1) * kFixedTreeBlockSize + 17;
+            std::vector<float> input(size);
+            for (int i = 0; i < size; ++i)
+                input[i] = float(i % 7) * 0.25f;
+
+            const float expected = FixedTreeSumCpu(input.data(), input.size());
+            Assert::IsTrue(SameBits(expected, FixedTreeSum(view, array_view<const float, 1>(size, input))));
+        }
+    };
+
+    //  A reduction result larger than a cache line.
+
+    struct Histogram
+    {
+        static const int kBinCount = 32;
+        int bins[kBinCount];
+    };
+
+    struct HistogramOp
+    {
+        Histogram Identity() const
+        {
+            Histogram h;
+            for (int b = 0; b < Histogram::kBinCount; ++b)
+                h.bins[b] = 0;
+            return h;
+        }
+
+        Histogram operator()(const Histogram& x, const Histogram& y) const
+        {
+            Histogram h;
+            for (int b = 0; b < Histogram::kBinCount; ++b)
+                h.bins[b] = x.bins[b] + y.bins[b];
+            return h;
+        }
+    };
+
+    TEST_CLASS(ReduceCpuTests)
+    {
+    public:
+        TEST_METHOD(ReduceCpuTests_SumSimdAnyAlignment)
+        {
+            std::vector<int> input = MakeInput(1000);
+            for (size_t offset = 0; offset < 17; ++offset)
+            {
+                for (size_t size = 0; size < 100; size += 7)
+                {
+                    const int expected = std::accumulate(begin(input) + offset, begin(input) + offset + size, 0);
+                    Assert::AreEqual(expected, SumSimd(input.data() + offset, size));
+                }
+            }
+        }
+
+        TEST_METHOD(ReduceCpuTests_SumParallelMatchesSequential)
+        {
+            std::vector<int> input = MakeInput(3 * 1024 * 1024 + 5);
+            input[12345] = (std::numeric_limits<int>::max)();   // Wraps exactly as an unsigned sum does.
+            const int expected = int(std::accumulate(begin(input) + 3, end(input), 0u));
+            Assert::AreEqual(expected, SumParallel(input.data() + 3, input.size() - 3));
+        }
+
+        TEST_METHOD(ReduceCpuTests_SumFloat)
+        {
+            //  Small integers so every partial sum is exact whatever the order.
+            std::vector<int> values = MakeInput(1000001);
+            std::vector<float> input(begin(values), end(values));
+            const float expected = float(std::accumulate(begin(values), end(values), 0));
+
+            Assert::AreEqual(expected, SumSimd(input.data() + 1, input.size() - 1) + input[0]);
+            Assert::AreEqual(expected, SumParallel(input.data(), input.size()));
+        }
+
+        TEST_METHOD(ReduceCpuTests_TransformReduce)
+        {
+            //  Small values so the float sums of squares are exact whatever the order.
+            std::vector<int> values(1000003);
+            for (size_t i = 0; i < values.size(); ++i)
+                values[i] = int(i % 5) - 2;
+            std::vector<float> input(begin(values), end(values));
+            const float expected = float(std::inner_product(begin(values), end(values), begin(values), 0));
+
+            Assert::AreEqual(expected, TransformReduce(input.data(), input.size(), [](float x) { return x * x; }, SumOp<float>()));
+            Assert::AreEqual(expected, TransformReduce(input.data(), input.data(), input.size(), [](float a, float b) { return a * b; }, SumOp<float>()));
+            Assert::AreEqual(expected, DotSimd(input.data() + 1, input.data() + 1, input.size() - 1) + input[0] * input[0]);
+            Assert::AreEqual(expected, DotParallel(input.data(), input.data(), input.size()));
+            Assert::AreEqual(2, TransformReduce(values.data(), values.size(), [](int x) { return x; }, MaxOp<int>()));
+        }
+
+        TEST_METHOD(ReduceCpuTests_TransformReduceLargerThanCacheLine)
+        {
+            std::vector<int> values(1000003);
+            for (size_t i = 0; i < values.size(); ++i)
+                values[i] = int(i % 5);
+
+            const Histogram result = TransformReduce(values.data(), values.size(), [](int x) -> Histogram
+            {
+                Histogram h = HistogramOp().Identity();
+                h.bins[x] = 1;
+                return h;
+            }, HistogramOp());
+            for (int b = 0; b < 5; ++b)
+                Assert::AreEqual(int(values.size() / 5) + ((b < int(values.size() % 5)) ? 1 : 0), result.bins[b]);
+            for (int b = 5; b < Histogram::kBinCount; ++b)
+                Assert::AreEqual(0, result.bins[b]);
+        }
+    };
+
+    //  Segment lengths from one element up to many tiles, with some empty segments.
+
+    std::vector<int> MakeOffsets(int segmentCount)
+    {
+        std::vector<int> offsets(1, 0);
+        unsigned seed = 42;
+        for (int s = 0; s < segmentCount; ++s)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            const int length = (s == segmentCount / 2) ? 200000 : int(seed >> 16) % ((s % 7 == 0) ? 3000 : 20);
+            offsets.push_back(offsets.back() + length);
+        }
+        return offsets;
+    }
+
+    std::vector<int> ReferenceSegmentedSum(const std::vector<int>& input, const std::vector<int>& offsets)
+    {
+        std::vector<int> expected(offsets.size() - 1);
+        for (size_t s = 0; s < expected.size(); ++s)
+            expected[s] = std::accumulate(begin(input) + offsets[s], begin(input) + offsets[s + 1], 0);
+        return expected;
+    }
+
+    TEST_CLASS(SegmentedReduceTests)
+    {
+    public:
+        TEST_METHOD(SegmentedReduceTests_SumVaryingLengths)
+        {
+            accelerator_view view = accelerator().default_view;
+            const std::vector<int> offsets = MakeOffsets(2000);
+            const std::vector<int> input = MakeInput(offsets.back());
+            const std::vector<int> expected = ReferenceSegmentedSum(input, offsets);
+            const int segmentCount = int(expected.size());
+
+            array_view<const int, 1> inputView(int(input.size()), input);
+            array_view<const int, 1> offsetsView(int(offsets.size()), offsets);
+            std::vector<int> output(segmentCount, -1);
+            array_view<int, 1> outputView(segmentCount, output);
+
+            SegmentedReduce(view, inputView, offsetsView, outputView, SumOp<int>());
+            outputView.synchronize();
+            Assert::IsTrue(expected == output);
+
+            std::fill(begin(output), end(output), -1);
+            outputView.refresh();
+            SegmentedReduce<32, 3>(view, inputView, offsetsView, outputView, SumOp<int>());
+            outputView.synchronize();
+            Assert::IsTrue(expected == output);
+
+            std::fill(begin(output), end(output), -1);
+            SegmentedReduce(input.data(), offsets.data(), segmentCount, output.data(), SumOp<int>());
+            Assert::IsTrue(expected == output);
+        }
+
+        TEST_METHOD(SegmentedReduceTests_ArgMinPerSegment)
+        {
+            accelerator_view view = accelerator().default_view;
+            std::vector<int> offsets;
+            offsets.push_back(0);
+            offsets.push_back(10);
+            offsets.push_back(10);
+            offsets.push_back(5000);
+            std::vector<int> input(5000, 3);
+            input[7] = 1;
+            input[9] = 1;
+            input[4000] = -6;
+
+            std::vector<IndexedValue<int>> output(3);
+            array_view<IndexedValue<int>, 1> outputView(3, output);
+            SegmentedArgMin(view, array_view<const int, 1>(5000, input), array_view<const int, 1>(4, offsets), outputView);
+            outputView.synchronize();
+
+            Assert::AreEqual(1, output[0].value);
+            Assert::AreEqual(7, output[0].position);
+            Assert::AreEqual(-1, output[1].position);
+            Assert::AreEqual(-6, output[2].value);
+            Assert::AreEqual(4000, output[2].position);
+        }
+
+        TEST_METHOD(SegmentedReduceTests_ReduceByKey)
+        {
+            accelerator_view view = accelerator().default_view;
+            const std::vector<int> offsets = MakeOffsets(500);
+            const std::vector<int> input = MakeInput(offsets.back());
+            const int count = int(input.size());
+            std::vector<int> keys(count);
+            const std::vector<int> sums = ReferenceSegmentedSum(input, offsets);
+            std::vector<int> expectedKeys;
+            std::vector<int> expected;
+            for (size_t s = 0; s < sums.size(); ++s)
+            {
+                if (offsets[s] == offsets[s + 1])
+                    continue;
+                std::fill(begin(keys) + offsets[s], begin(keys) + offsets[s + 1], int(s) * 3);
+                expectedKeys.push_back(int(s) * 3);
+                expected.push_back(sums[s]);
+            }
+
+            std::vector<int> uniqueKeys(count);
+            std::vector<int> output(count);
+            array_view<int, 1> uniqueKeysView(count, uniqueKeys);
+            array_view<int, 1> outputView(count, output);
+            const int segmentCount = ReduceByKey(view, array_view<const int, 1>(count, keys), array_view<const int, 1>(count, input), uniqueKeysView, outputView, SumOp<int>());
+            uniqueKeysView.synchronize();
+            outputView.synchronize();
+
+            Assert::AreEqual(int(expected.size()), segmentCount);
+            Assert::IsTrue(std::equal(begin(expectedKeys), end(expectedKeys), begin(uniqueKeys)));
+            Assert::IsTrue(std::equal(begin(expected), end(expected), begin(output)));
+
+            std::fill(begin(output), end(output), 0);
+            Assert::AreEqual(segmentCount, ReduceByKey(keys.data(), input.data(), count, uniqueKeys.data(), output.data(), SumOp<int>()));
+            Assert::IsTrue(std::equal(begin(expected), end(expected), begin(output)));
+        }
+    };
+
+    TEST_CLASS(StreamReduceTests)
+    {
+    public:
+        TEST_METHOD(StreamReduceTests_SumFile)
+        {
+            //  Not a whole number of chunks, with two trailing bytes that aren't a whole element.
+            const std::vector<int> input = MakeInput(10000);
+            {
+                std::ofstream file("StreamReduceTests.bin", std::ios::binary);
+                file.write(reinterpret_cast<const char*>(input.data()), input.size() * sizeof(int));
+                file.write("xy", 2);
+            }
+            const int expected = std::accumulate(begin(input), end(input), 0);
+            auto sumChunk = [](const int* pData, size_t count) { return SumSimd(pData, count); };
+
+            for (int unbuffered = 0; unbuffered < 2; ++unbuffered)
+            {
+                FileChunkReader reader(L"StreamReduceTests.bin", 4096, 2, unbuffered != 0);
+                Assert::IsTrue(reader.Size() == input.size() * sizeof(int) + 2);
+                Assert::AreEqual(expected, StreamReduce<int>(reader, sumChunk, SumOp<int>()));
+            }
+            Assert::AreEqual(expected, StreamReduce<int>(L"StreamReduceTests.bin", sumChunk, SumOp<int>()));
+            std::remove("StreamReduceTests.bin");
+        }
+
+        TEST_METHOD(StreamReduceTests_EmptyFile)
+        {
+            {
+                std::ofstream file("StreamReduceTests.bin", std::ios::binary);
+            }
+            FileChunkReader reader(L"StreamReduceTests.bin", 4096, 1, false);
+            Assert::AreEqual(INT_MAX, StreamReduce<int>(reader, [](const int* pData, size_t count) { return *std::min_element(pData, pData + count); }, MinOp<int>()));
+            std::remove("StreamReduceTests.bin");
+        }
+    };
+}
@@ -0,0 +1,469 @@
+//===============================================================================
+//
+// Microsoft Press
+// C++ AMP: Accelerated Massive Parallelism with Microsoft Visual C++
+//
+//===============================================================================
+// Copyright (c) 2012 Ade Miller & Kate Gregory.  All rights reserved.
+// This code released under the terms of the
+// Microsoft Public License (Ms-PL), http://ampbook.codeplex.com/license.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//===============================================================================
+
+#pragma once
+
+#include <amp.h>
+#include <ppl.h>
+#include <vector>
+#include <algorithm>
+#include <assert.h>
+
+#include "Reduce.h"
+
+using namespace concurrency;
+
+//--------------------------------------------------------------------------------------
+//  Segmented reduction.
+//--------------------------------------------------------------------------------------
+//
+//  Reduces each segment of the input separately, using the operators from Reduce.h. Segments
+//  are given either as offsets, segmentCount + 1 ascending values where segment s is the
+//  elements [offsets[s], offsets[s + 1]) and the last offset is the element count, or as runs
+//  of equal keys, see ReduceByKey. Empty segments are set to the operator's identity.
+//
+//  Work is split by element rather than by segment so very long segments don't hold up a
+//  single thread. Each thread reduces ItemsPerThread consecutive elements, finding its first
+//  segment with a binary search over the offsets. Segments that lie entirely inside a thread's
+//  range are written directly. A segment that continues from earlier threads gets their
+//  partial result from a segmented scan in tile_static memory, and one that continues from
+//  earlier tiles is completed by a small fix up pass once the per tile carries are known.
+//  Elements are combined in input order so, unlike Reduce, the operator only needs to be
+//  associative.
+
+namespace Extras
+{
+    const int kSegmentedTileSize = 256;
+    const int kSegmentedItemsPerThread = 8;
+
+    namespace details
+    {
+        //  The last segment s in [first, last) with offsets[s] <= i. Requires offsets[first] <= i.
+
+        template <typename Offsets>
+        inline int FindSegment(const Offsets& offsets, int first, int last, int i) restrict(amp, cpu)
+        {
+            while (last - first > 1)
+            {
+                const int middle = first + (last - first) / 2;
+                if (offsets[middle] <= i)
+                    first = middle;
+                else
+                    last = middle;
+            }
+            return first;
+        }
+
+        //  Identity for every empty segment, nothing else writes them.
+
+        template <typename U, typename Op>
+        inline void FillEmptySegments(const accelerator_view& view, const array_view<const int, 1>& offsets, const array_view<U, 1>& output, const Op& op)
+        {
+            parallel_for_each(view, output.extent, [=](concurrency::index<1> idx) restrict(amp)
+            {
+                if (offsets[idx[0] + 1] == offsets[idx[0]])
+                    output[idx] = op.Identity();
+            });
+        }
+
+        template <int TileSize, int ItemsPerThread, typename U, typename T, typename Op, typename Load>
+        void SegmentedReduceTiled(const accelerator_view& view, const array_view<const T, 1>& input, const array_view<const int, 1>& offsets,
+            const array_view<U, 1>& output, const Op& op, const Load& load)
+        {
+            static_assert((TileSize >= 2) && ((TileSize & (TileSize - 1)) == 0), "TileSize must be a power of two.");
+            static_assert(ItemsPerThread > 0, "ItemsPerThread must be positive.");
+
+            const int elementCount = input.extent[0];
+            const int segmentCount = output.extent[0];
+            assert(offsets.extent[0] == segmentCount + 1);
+            if (segmentCount == 0)
+                return;
+            FillEmptySegments(view, offsets, output, op);
+            if (elementCount == 0)
+                return;
+
+            const int tileElements = TileSize * ItemsPerThread;
+            const int tileCount = (elementCount + tileElements - 1) / tileElements;
+            array<U, 1> tileValue(tileCount, view);
+            array<int, 1> tileFlag(tileCount, view);
+            array<int, 1> tileFixup(tileCount, view);
+
+            parallel_for_each(view, extent<1>(tileCount * TileSize).tile<TileSize>(),
+                [=, &tileValue, &tileFlag, &tileFixup](tiled_index<TileSize> tidx) restrict(amp)
+            {
+                const int tid = tidx.local[0];
+                const int first = tidx.global[0] * ItemsPerThread;
+                const int last = (first + ItemsPerThread < elementCount) ? first + ItemsPerThread : elementCount;
+                tile_static U scanValue[TileSize];
+                tile_static int scanFlag[TileSize];
+                tile_static int fixup;
+
+                //  head is the partial result for a segment that started before this thread's range and
+                //  ends inside it, tail the partial result since the last segment start in the range.
+                U head = op.Identity();
+                U acc = op.Identity();
+                int headSegment = -1;
+                int flag = 0;
+                if (first < elementCount)
+                {
+                    int s = FindSegment(offsets, 0, segmentCount, first);
+                    int i = first;
+                    int isFirst = 1;
+                    flag = (offsets[s] == first) ? 1 : 0;
+                    while (true)
+                    {
+                        const int segmentEnd = offsets[s + 1];
+                        const int end = (segmentEnd < last) ? segmentEnd : last;
+                        for (; i < end; ++i)
+                            acc = op(acc, load(input, i));
+                        if (end != segmentEnd)
+                            break;
+
+                        if (isFirst && offsets[s] < first)
+                        {
+                            head = acc;
+                            headSegment = s;
+                        }
+                        else
+                        {
+                            output[s] = acc;
+                        }
+                        isFirst = 0;
+                        if (i == last)
+                            break;
+                        s = FindSegment(offsets, s + 1, segmentCount, i);
+                        flag = 1;
+                        acc = op.Identity();
+                    }
+                }
+                scanValue[tid] = acc;
+                scanFlag[tid] = flag;
+                if (tid == 0)
+                    fixup = -1;
+                tidx.barrier.wait_with_tile_static_memory_fence();
+
+                //  Inclusive segmented scan, a set flag stops values from earlier threads being combined.
+                for (int d = 1; d < TileSize; d *= 2)
+                {
+                    U v = scanValue[tid];
+                    int f = scanFlag[tid];
+                    if (tid >= d)
+                    {
+                        if (f == 0)
+                            v = op(scanValue[tid - d], v);
+                        f |= scanFlag[tid - d];
+                    }
+                    tidx.barrier.wait_with_tile_static_memory_fence();
+                    scanValue[tid] = v;
+                    scanFlag[tid] = f;
+                    tidx.barrier.wait_with_tile_static_memory_fence();
+                }
+
+                if (headSegment >= 0)
+                {
+                    const U carry = (tid > 0) ? scanValue[tid - 1] : op.Identity();
+                    output[headSegment] = op(carry, head);
+
+                    //  No segment starts earlier in the tile so this one began in a previous tile.
+                    if (tid == 0 || scanFlag[tid - 1] == 0)
+                        fixup = headSegment;
+                }
+                tidx.barrier.wait_with_tile_static_memory_fence();
+
+                if (tid == TileSize - 1)
+                {
+                    tileValue[tidx.tile[0]] = scanValue[tid];
+                    tileFlag[tidx.tile[0]] = scanFlag[tid];
+                }
+                if (tid == 0)
+                    tileFixup[tidx.tile[0]] = fixup;
+            });
+
+            //  Scan the tile carries on the CPU, there are few of them, then complete the segments
+            //  that crossed a tile boundary.
+            std::vector<U> value(tileCount);
+            std::vector<int> flag(tileCount);
+            std::vector<int> fixup(tileCount);
+            copy(tileValue, value.begin());
+            copy(tileFlag, flag.begin());
+            copy(tileFixup, fixup.begin());
+
+            std::vector<int> fixupSegment;
+            std::vector<U> fixupCarry;
+            U carry = op.Identity();
+            for (int t = 0; t < tileCount; ++t)
+            {
+                if (t > 0 && fixup[t] >= 0)
+                {
+                    fixupSegment.push_back(fixup[t]);
+                    fixupCarry.push_back(carry);
+                }
+                carry = flag[t] ? value[t] : op(carry, value[t]);
+            }
+            if (fixupSegment.empty())
+                return;
+
+            const int fixupCount = int(fixupSegment.size());
+            array<int, 1> segments(fixupCount, fixupSegment.begin(), fixupSegment.end(), view);
+            array<U, 1> carries(fixupCount, fixupCarry.begin(), fixupCarry.end(), view);
+            parallel_for_each(view, extent<1>(fixupCount), [=, &segments, &carries](concurrency::index<1> idx) restrict(amp)
+            {
+                const int s = segments[idx];
+                output[s] = op(carries[idx], output[s]);
+            });
+        }
+
+        //  Inclusive scan of the segment start flags within a tile, returns this thread's flag.
+
+        template <int TileSize, typename K>
+        inline int ScanSegmentStarts(const tiled_index<TileSize>& tidx, const array_view<const K, 1>& keys, int (&starts)[TileSize]) restrict(amp)
+        {
+            const int i = tidx.global[0];
+            const int tid = tidx.local[0];
+            const int isStart = (i < keys.extent[0] && (i == 0 || keys[i] != keys[i - 1])) ? 1 : 0;
+            starts[tid] = isStart;
+            tidx.barrier.wait_with_tile_static_memory_fence();
+            for (int d = 1; d < TileSize; d *= 2)
+            {
+                const int v = (tid >= d) ? starts[tid] + starts[tid - d] : starts[tid];
+                tidx.barrier.wait_with_tile_static_memory_fence();
+                starts[tid] = v;
+                tidx.barrier.wait_with_tile_static_memory_fence();
+            }
+            return isStart;
+        }
+
+        //  Segment offsets from runs of equal keys, two passes each with the scan above. Returns the
+        //  number of segments.
+
+        template <int TileSize, typename K>
+        int SegmentOffsetsFromKeys(const accelerator_view& view, const array_view<const K, 1>& keys, const array_view<int, 1>& offsets,
+            const array_view<K, 1>& uniqueKeys)
+        {
+            const int elementCount = keys.extent[0];
+            const int tileCount = (elementCount + TileSize - 1) / TileSize;
+            array<int, 1> tileCounts(tileCount, view);
+            array<int, 1> tileBase(tileCount, view);
+
+            parallel_for_each(view, extent<1>(tileCount * TileSize).tile<TileSize>(), [=, &tileCounts](tiled_index<TileSize> tidx) restrict(amp)
+            {
+                tile_static int starts[TileSize];
+                ScanSegmentStarts(tidx, keys, starts);
+                if (tidx.local[0] == TileSize - 1)
+                    tileCounts[tidx.tile[0]] = starts[TileSize - 1];
+            });
+
+            std::vector<int> base(tileCount);
+            copy(tileCounts, base.begin());
+            int segmentCount = 0;
+            for (int t = 0; t < tileCount; ++t)
+            {
+                const int c = base[t];
+                base[t] = segmentCount;
+                segmentCount += c;
+            }
+            copy(base.begin(), base.end(), tileBase);
+
+            parallel_for_each(view, extent<1>(tileCount * TileSize).tile<TileSize>(), [=, &tileBase](tiled_index<TileSize> tidx) restrict(amp)
+            {
+                tile_static int starts[TileSize];
+                if (ScanSegmentStarts(tidx, keys, starts))
+                {
+                    const int i = tidx.global[0];
+                    const int s = tileBase[tidx.tile[0]] + starts[tidx.local[0]] - 1;
+                    offsets[s] = i;
+                    uniqueKeys[s] = keys[i];
+                }
+            });
+
+            std::vector<int> end(1, elementCount);
+            copy(end.begin(), end.end(), offsets.section(segmentCount, 1));
+            return segmentCount;
+        }
+
+        //  CPU version of the per thread work in SegmentedReduceTiled, for one chunk of elements.
+
+        template <typename T>
+        struct SegmentChunk
+        {
+            T head;
+            T tail;
+            int headSegment;
+            int flag;
+        };
+
+        template <typename T, typename Op>
+        inline SegmentChunk<T> ReduceSegmentChunk(const T* const pValues, const int* const pOffsets, int segmentCount, int first, int last,
+            T* const pOutput, const Op& op)
+        {
+            SegmentChunk<T> r;
+            r.head = op.Identity();
+            r.headSegment = -1;
+            T acc = op.Identity();
+
+            int s = FindSegment(pOffsets, 0, segmentCount, first);
+            int i = first;
+            bool isFirst = true;
+            r.flag = (pOffsets[s] == first) ? 1 : 0;
+            while (true)
+            {
+                const int segmentEnd = pOffsets[s + 1];
+                const int end = (std::min)(segmentEnd, last);
+                for (; i < end; ++i)
+                    acc = op(acc, pValues[i]);
+                if (end != segmentEnd)
+                    break;
+
+                if (isFirst && pOffsets[s] < first)
+                {
+                    r.head = acc;
+                    r.headSegment = s;
+                }
+                else
+                {
+                    pOutput[s] = acc;
+                }
+                isFirst = false;
+                if (i == last)
+                    break;
+                s = FindSegment(pOffsets, s + 1, segmentCount, i);
+                r.flag = 1;
+                acc = op.Identity();
+            }
+            r.tail = acc;
+            return r;
+        }
+    }
+
+    //--------------------------------------------------------------------------------------
+    //  C++ AMP segmented reductions.
+    //--------------------------------------------------------------------------------------
+
+    template <int TileSize, int ItemsPerThread, typename T, typename Op>
+    inline void SegmentedReduce(const accelerator_view& view, const array_view<const T, 1>& input, const array_view<const int, 1>& offsets,
+        const array_view<T, 1>& output, const Op& op)
+    {
+        details::SegmentedReduceTiled<TileSize, ItemsPerThread, T>(view, input, offsets, output, op, details::LoadElement<T>());
+    }
+
+    template <typename T, typename Op>
+    inline void SegmentedReduce(const accelerator_view& view, const array_view<const T, 1>& input, const array_view<const int, 1>& offsets,
+        const array_view<T, 1>& output, const Op& op)
+    {
+        SegmentedReduce<kSegmentedTileSize, kSegmentedItemsPerThread>(view, input, offsets, output, op);
+    }
+
+    //  The smallest or largest element of each segment and its position in the whole input, -1 for
+    //  an empty segment.
+
+    template <typename T>
+    inline void SegmentedArgMin(const accelerator_view& view, const array_view<const T, 1>& input, const array_view<const int, 1>& offsets,
+        const array_view<IndexedValue<T>, 1>& output)
+    {
+        details::SegmentedReduceTiled<kSegmentedTileSize, kSegmentedItemsPerThread, IndexedValue<T>>(view, input, offsets, output, ArgMinOp<T>(), details::LoadIndexed<T>());
+        parallel_for_each(view, output.extent, [=](concurrency::index<1> idx) restrict(amp)
+        {
+            if (output[idx].position == INT_MAX)
+                output[idx].position = -1;
+        });
+    }
+
+    template <typename T>
+    inline void SegmentedArgMax(const accelerator_view& view, const array_view<const T, 1>& input, const array_view<const int, 1>& offsets,
+        const array_view<IndexedValue<T>, 1>& output)
+    {
+        details::SegmentedReduceTiled<kSegmentedTileSize, kSegmentedItemsPerThread, IndexedValue<T>>(view, input, offsets, output, ArgMaxOp<T>(), details::LoadIndexed<T>());
+        parallel_for_each(view, output.extent, [=](concurrency::index<1> idx) restrict(amp)
+        {
+            if (output[idx].position == INT_MAX)
+                output[idx].position = -1;
+        });
+    }
+
+    //  Reduces each run of equal keys. uniqueKeys and output must hold as many elements as the
+    //  input, the first segmentCount of each are written. Returns segmentCount.
+
+    template <typename K, typename T, typename Op>
+    inline int ReduceByKey(const accelerator_view& view, const array_view<const K, 1>& keys, const array_view<const T, 1>& input,
+        const array_view<K, 1>& uniqueKeys, const array_view<T, 1>& output, const Op& op)
+    {
+        const int elementCount = input.extent[0];
+        assert(keys.extent[0] == elementCount);
+        assert(uniqueKeys.extent[0] >= elementCount && output.extent[0] >= elementCount);
+        if (elementCount == 0)
+            return 0;
+
+        array<int, 1> offsets(elementCount + 1, view);
+        const int segmentCount = details::SegmentOffsetsFromKeys<kSegmentedTileSize>(view, keys, array_view<int, 1>(offsets), uniqueKeys);
+        SegmentedReduce(view, input, array_view<const int, 1>(offsets).section(0, segmentCount + 1), output.section(0, segmentCount), op);
+        return segmentCount;
+    }
+
+    //--------------------------------------------------------------------------------------
+    //  CPU segmented reductions.
+    //--------------------------------------------------------------------------------------
+    //
+    //  The same element based split with fixed size chunks handed to PPL, the carries between
+    //  chunks are combined in order afterwards.
+
+    template <typename T, typename Op>
+    inline void SegmentedReduce(const T* const pValues, const int* const pOffsets, int segmentCount, T* const pOutput, const Op& op)
+    {
+        if (segmentCount == 0)
+            return;
+        for (int s = 0; s < segmentCount; ++s)
+        {
+            if (pOffsets[s + 1] == pOffsets[s])
+                pOutput[s] = op.Identity();
+        }
+
+        const int elementCount = pOffsets[segmentCount];
+        const int chunkSize = 64 * 1024;
+        const int chunkCount = (elementCount + chunkSize - 1) / chunkSize;
+        std::vector<details::SegmentChunk<T>> chunks(chunkCount);
+        concurrency::parallel_for(0, chunkCount, [=, &chunks](int c)
+        {
+            chunks[c] = details::ReduceSegmentChunk(pValues, pOffsets, segmentCount, c * chunkSize, (std::min)(elementCount, (c + 1) * chunkSize), pOutput, op);
+        });
+
+        T carry = op.Identity();
+        for (int c = 0; c < chunkCount; ++c)
+        {
+            if (chunks[c].headSegment >= 0)
+                pOutput[chunks[c].headSegment] = op(carry, chunks[c].head);
+            carry = chunks[c].flag ? chunks[c].tail : op(carry, chunks[c].tail);
+        }
+    }
+
+    template <typename K, typename T, typename Op>
+    inline int ReduceByKey(const K* const pKeys, const T* const pValues, int count, K* const pUniqueKeys, T* const pOutput, const Op& op)
+    {
+        std::vector<int> offsets;
+        offsets.reserve(count + 1);
+        for (int i = 0; i < count; ++i)
+        {
+            if (i == 0 || pKeys[i] != pKeys[i - 1])
+            {
+                pUniqueKeys[offsets.size()] = pKeys[i];
+                offsets.push_back(i);
+            }
+        }
+        const int segmentCount = int(offsets.size());
+        offsets.push_back(count);
+        SegmentedReduce(pValues, offsets.data(), segmentCount, pOutput, op);
+        return segmentCount;
+    }
+}
@@ -0,0 +1,195 @@
+//===============================================================================
+//
+// Microsoft Press
+// C++ AMP: Accelerated Massive Parallelism with Microsoft Visual C++
+//
+//===============================================================================
+// Copyright (c) 2012 Ade Miller & Kate Gregory.  All rights reserved.
+// This code released under the terms of the
+// Microsoft Public License (Ms-PL), http://ampbook.codeplex.com/license.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//===============================================================================
+
+#pragma once
+
+#include <windows.h>
+#include <vector>
+#include <algorithm>
+#include <string.h>
+#include <assert.h>
+
+//--------------------------------------------------------------------------------------
+//  Streaming reductions over files.
+//--------------------------------------------------------------------------------------
+//
+//  FileChunkReader reads a file in large chunks using overlapped I/O. Several reads are kept
+//  in flight so the next chunks are loading while the current one is reduced. Opened
+//  unbuffered the reads bypass the file system cache and go straight to the disk, which is
+//  what a multi-GB input that doesn't fit in memory will do anyway, buffered reads are
+//  served from the cache when the file is already resident.
+//
+//  Memory mapping was also considered, but on Windows 7 a mapped view gives no control over
+//  read-ahead and page faults are taken one at a time, so explicit reads are faster for a
+//  single sequential pass.
+//
+//  Errors from the Win32 calls are thrown as an HRESULT.
+
+namespace Extras
+{
+    const size_t kStreamChunkBytes = 8 * 1024 * 1024;
+    const int kStreamReadAhead = 3;
+
+    class FileChunkReader
+    {
+    public:
+        //  chunkBytes must be a multiple of the disk's sector size for unbuffered reads, the page
+        //  size is always safe.
+        FileChunkReader(const wchar_t* path, size_t chunkBytes, int readAhead, bool unbuffered) :
+            m_chunkBytes(chunkBytes),
+            m_nextOffset(0),
+            m_current(-1),
+            m_buffers(readAhead + 1, nullptr),
+            m_overlapped(readAhead + 1),
+            m_pending(readAhead + 1, 0)
+        {
+            assert(chunkBytes > 0 && readAhead >= 0);
+            const DWORD flags = FILE_FLAG_OVERLAPPED | FILE_FLAG_SEQUENTIAL_SCAN | (unbuffered ? FILE_FLAG_NO_BUFFERING : 0);
+            m_file = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, flags, nullptr);
+            if (m_file == INVALID_HANDLE_VALUE)
+                throw HRESULT_FROM_WIN32(GetLastError());
+
+            LARGE_INTEGER size;
+            if (!GetFileSizeEx(m_file, &size))
+            {
+                const HRESULT hr = HRESULT_FROM_WIN32(GetLastError());
+                CloseHandle(m_file);
+                throw hr;
+            }
+            m_size = static_cast<unsigned long long>(size.QuadPart);
+
+            //  VirtualAlloc returns page aligned memory, as unbuffered reads require.
+            for (size_t i = 0; i < m_buffers.size(); ++i)
+            {
+                memset(&m_overlapped[i], 0, sizeof(OVERLAPPED));
+                m_buffers[i] = VirtualAlloc(nullptr, m_chunkBytes, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+                m_overlapped[i].hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+                if (m_buffers[i] == nullptr || m_overlapped[i].hEvent == nullptr)
+                {
+                    const HRESULT hr = HRESULT_FROM_WIN32(GetLastError());
+                    Release();
+                    throw hr;
+                }
+            }
+            try
+            {
+                for (size_t i = 0; i < m_buffers.size(); ++i)
+                    Issue(int(i));
+            }
+            catch (...)
+            {
+                Release();
+                throw;
+            }
+        }
+
+        ~FileChunkReader()
+        {
+            Release();
+        }
+
+        unsigned long long Size() const { return m_size; }
+        size_t ChunkBytes() const { return m_chunkBytes; }
+
+        //  The next chunk of the file, or nullptr at the end. The returned memory is reused for
+        //  read-ahead by the following call so it is only valid until then.
+
+        const void* Next(size_t& bytes)
+        {
+            if (m_current >= 0)
+                Issue(m_current);
+            m_current = (m_current + 1) % int(m_buffers.size());
+            if (!m_pending[m_current])
+            {
+                bytes = 0;
+                return nullptr;
+            }
+
+            DWORD transferred = 0;
+            m_pending[m_current] = 0;
+            if (!GetOverlappedResult(m_file, &m_overlapped[m_current], &transferred, TRUE))
+                throw HRESULT_FROM_WIN32(GetLastError());
+            bytes = transferred;
+            return (transferred > 0) ? m_buffers[m_current] : nullptr;
+        }
+
+    private:
+        FileChunkReader(const FileChunkReader&);
+        FileChunkReader& operator=(const FileChunkReader&);
+
+        void Issue(int buffer)
+        {
+            if (m_nextOffset >= m_size)
+                return;
+
+            OVERLAPPED& overlapped = m_overlapped[buffer];
+            overlapped.Offset = DWORD(m_nextOffset & 0xFFFFFFFF);
+            overlapped.OffsetHigh = DWORD(m_nextOffset >> 32);
+            ResetEvent(overlapped.hEvent);
+            if (!ReadFile(m_file, m_buffers[buffer], DWORD(m_chunkBytes), nullptr, &overlapped) && GetLastError() != ERROR_IO_PENDING)
+                throw HRESULT_FROM_WIN32(GetLastError());
+            m_pending[buffer] = 1;
+            m_nextOffset += m_chunkBytes;
+        }
+
+        void Release()
+        {
+            //  Outstanding reads must finish before their buffers are freed.
+            for (size_t i = 0; i < m_buffers.size(); ++i)
+            {
+                DWORD transferred;
+                if (m_pending[i])
+                    GetOverlappedResult(m_file, &m_overlapped[i], &transferred, TRUE);
+                if (m_overlapped[i].hEvent != nullptr)
+                    CloseHandle(m_overlapped[i].hEvent);
+                if (m_buffers[i] != nullptr)
+                    VirtualFree(m_buffers[i], 0, MEM_RELEASE);
+            }
+            CloseHandle(m_file);
+        }
+
+        HANDLE m_file;
+        unsigned long long m_size;
+        size_t m_chunkBytes;
+        unsigned long long m_nextOffset;
+        int m_current;
+        std::vector<void*> m_buffers;
+        std::vector<OVERLAPPED> m_overlapped;
+        std::vector<int> m_pending;
+    };
+
+    //  Reduce a file of T, chunk by chunk. reduce is called as reduce(const T* pData, size_t count)
+    //  for each chunk and the chunk results are combined in file order with op, see Reduce.h for
+    //  the operators. Any trailing bytes that don't make a whole element are ignored.
+
+    template <typename T, typename ChunkReduce, typename Op>
+    inline T StreamReduce(FileChunkReader& reader, const ChunkReduce& reduce, const Op& op)
+    {
+        assert(reader.ChunkBytes() % sizeof(T) == 0);
+        T result = op.Identity();
+        size_t bytes;
+        while (const void* pChunk = reader.Next(bytes))
+            result = op(result, reduce(static_cast<const T*>(pChunk), bytes / sizeof(T)));
+        return result;
+    }
+
+    template <typename T, typename ChunkReduce, typename Op>
+    inline T StreamReduce(const wchar_t* path, const ChunkReduce& reduce, const Op& op)
+    {
+        FileChunkReader reader(path, kStreamChunkBytes, kStreamReadAhead, true);
+        return StreamReduce<T>(reader, reduce, op);
+    }
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#define NOMINMAX
+
+#include "targetver.h"
+
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <numeric>
+#include <limits>
+#include <array>
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <cstdio>
+#include <amp.h>
+#include <amp_short_vectors.h>
+#include <assert.h>
+
+#include <CppUnitTest.h>
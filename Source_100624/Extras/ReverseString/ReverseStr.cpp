@@ -16,103 +16,101 @@
 
 #include "stdafx.h"
 #include "ReverseStr.h"
+#include "..\Simd\BytePermute.h"
 
 // Problem 1: Write a method to reverse an arbitrary string provided as a null terminated char*.
 
 namespace Extras
 {
-    //  You can use this instead of std::swap(). It's ugly IMO but removes the temp
-    //  used by std::swap() but doesn't support other types.
-    //
-    //  See: http://en.wikipedia.org/wiki/XOR_swap_algorithm
+    //  Length of a null terminated string, 16 bytes per compare. The loads are aligned so they
+    //  never cross into a page that doesn't also contain part of the string. The bytes before
+    //  pStr in the first block are masked out.
 
-    inline void XorSwap(char& left, char& right)
+    size_t StrLength(const char* const pStr)
     {
-        left = left ^ right;
-        right = left ^ right;
-        left = left ^ right;
+        const size_t misalignment = reinterpret_cast<size_t>(pStr) % 16;
+        const __m128i* pBlock = reinterpret_cast<const __m128i*>(pStr - misalignment);
+        const __m128i zero = _mm_setzero_si128();
+
+        unsigned long mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128(pBlock), zero))) >> misalignment;
+        size_t offset = 0;
+        while (mask == 0)
+        {
+            ++pBlock;
+            offset = reinterpret_cast<const char*>(pBlock) - pStr;
+            mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128(pBlock), zero)));
+        }
+        unsigned long bit;
+        _BitScanForward(&bit, mask);
+        return offset + bit;
     }
 
-    inline char* FindEnd(char* const pStr)
+    //  In place SIMD reversal, see Extras\Simd\BytePermute.h. Large buffers are reversed in
+    //  parallel by swapping mirrored chunks from both ends.
+
+    void ReverseBuffer(char* const pData, size_t length)
     {
-        char* pEnd = pStr;
-        while (*pEnd != '\0') { ++pEnd; }
-        return pEnd;
+        ReverseBytes(pData, length);
     }
 
     void ReverseStr(char* const pStr)
     {
-        char* pEnd = FindEnd(pStr) - 1;
-        char* pStart = pStr;
-
-        while (pStart < pEnd)
-        {
-            XorSwap(*pStart, *pEnd);
-            //std::swap(*pStart, *pEnd);
-            --pEnd;
-            ++pStart;
-        }
+        ReverseBuffer(pStr, StrLength(pStr));
     }
 
-    //  C++ AMP version. This packs the char data into unsigned int.
+    //  C++ AMP version. This packs the char data into unsigned int and works on the caller's
+    //  buffer, the only copies are the runtime's transfers to and from the accelerator. Each
+    //  thread gathers the four chars of one output word from the input, so the result goes to
+    //  a separate array and is copied straight back over the string. The last length % 4 chars
+    //  don't fill a word, they're passed to the kernel packed into one value and the chars
+    //  that land in those positions are written on the CPU.
 
     using namespace concurrency;
 
-    typedef unsigned long PackedChars;
+    typedef unsigned int PackedChars;
 
-    struct CharBlock
+    inline unsigned CharAt(const array_view<const PackedChars, 1>& words, PackedChars tail, unsigned wordChars, unsigned pos) 
+        restrict(amp)
     {
-        unsigned A, B, C, D;
+        const PackedChars word = (pos < wordChars) ? words[pos / 4] : tail;
+        return (word >> (8 * (pos % 4))) & 0xFF;
+    }
 
-        CharBlock(const PackedChars& chrs) restrict(cpu, amp)
+    void ReverseStrAmp(char* const pStr)
+    {
+        const unsigned charLen = static_cast<unsigned>(StrLength(pStr));
+        const unsigned wordLen = charLen / sizeof(PackedChars);
+        const unsigned wordChars = wordLen * sizeof(PackedChars);
+        const unsigned tailLen = charLen - wordChars;
+        if (wordLen == 0)
         {
-            A =  chrs & 0xFF;
-            B = (chrs & 0xFF00) >> 8;
-            C = (chrs & 0xFF0000) >> 16;
-            D = (chrs & 0xFF000000) >> 24; 
+            std::reverse(pStr, pStr + charLen);
+            return;
         }
 
-        inline PackedChars ReversePack() restrict(cpu, amp)
+        PackedChars tail = 0;
+        char head[sizeof(PackedChars)];
+        for (unsigned i = 0; i < tailLen; ++i)
         {
-            return (D | (C << 8) | (B << 16) | (A << 24));
+            tail |= PackedChars(static_cast<unsigned char>(pStr[wordChars + i])) << (8 * i);
+            head[i] = pStr[i];
         }
-    };
-
-    //  This not only swaps left and right it also swaps the order of the bytes within 
-    //  left and right. So 0x01020304 swapped with 0x0a0b0c0d becomes
-    //  0x0d0c0b0a and 0x04030201.
-
-    inline void Swap(PackedChars& left, PackedChars& right) restrict(amp)
-    {
-        PackedChars tmp = right;
-        right = CharBlock(left).ReversePack();
-        left = CharBlock(tmp).ReversePack();
-    }
 
-    void ReverseStrAmp(char* const pStr)
-    {
-        const unsigned blkSize = 4 * sizeof(char);
-        const unsigned charLen = 
-            static_cast<unsigned>(std::distance(pStr, FindEnd(pStr)));
-        unsigned blkLen = charLen / blkSize;
-        blkLen += ((blkLen % blkSize) > 0) ? 1 : 0; // Pad blocks.
-        blkLen += (blkLen % 2);                     // Even out blocks count.
-        const unsigned blkChars = blkLen * blkSize;
-
-        std::vector<char> strData(blkChars);
-        std::copy(pStr, pStr + charLen, strData.begin());
-        array_view<PackedChars, 1> str(extent<1>(blkLen), 
-            reinterpret_cast<PackedChars*>(strData.data()));
-
-        const unsigned offset = blkLen - 1;
-        parallel_for_each(extent<1>(blkLen / 2), [str, offset](index<1> idx) 
+        array<PackedChars, 1> reversed(wordLen);
+        array_view<const PackedChars, 1> words(wordLen, reinterpret_cast<const PackedChars*>(pStr));
+        const unsigned last = charLen - 1;
+        parallel_for_each(reversed.extent, [words, tail, wordChars, last, &reversed](index<1> idx) 
             restrict(amp)
         {
-            Swap(str[idx], str[offset - idx]);
+            const unsigned pos = last - 4 * idx[0];
+            reversed[idx] = CharAt(words, tail, wordChars, pos) | 
+                (CharAt(words, tail, wordChars, pos - 1) << 8) | 
+                (CharAt(words, tail, wordChars, pos - 2) << 16) | 
+                (CharAt(words, tail, wordChars, pos - 3) << 24);
         });
-        str.synchronize();
 
-        copy(strData.cbegin() + blkChars - charLen, strData.cend(), 
-            stdext::make_checked_array_iterator<char*>(pStr, charLen));
+        copy(reversed, reinterpret_cast<PackedChars*>(pStr));
+        for (unsigned i = 0; i < tailLen; ++i)
+            pStr[last - i] = head[i];
     }
 }
\ No newline at end of file
@@ -22,4 +22,7 @@ namespace Extras
 {
     void ReverseStr(char* const pStr);
     void ReverseStrAmp(char* const pStr);
+
+    size_t StrLength(const char* const pStr);
+    void ReverseBuffer(char* const pData, size_t length);
 }
\ No newline at end of file
@@ -73,6 +73,42 @@ namespace ReverseStringTests
 
             Assert::AreEqual(0, expected.compare(input), Msg(expected, input).c_str());
         }
+
+        TEST_METHOD(ReverseStrTests_AllShortLengthsAndAlignments)
+        {
+            for (size_t offset = 0; offset < 16; ++offset)
+            {
+                for (size_t length = 0; length < 100; ++length)
+                {
+                    std::string buffer(offset, 'x');
+                    for (size_t i = 0; i < length; ++i)
+                        buffer.push_back(static_cast<char>('a' + i % 26));
+                    std::string expected(buffer.substr(offset));
+                    std::reverse(expected.begin(), expected.end());
+
+                    Assert::IsTrue(StrLength(buffer.c_str() + offset) == length);
+                    ReverseStr(&buffer[0] + offset);
+
+                    std::string actual(buffer.substr(offset));
+                    Assert::AreEqual(0, expected.compare(actual), Msg(expected, actual).c_str());
+                }
+            }
+        }
+
+        TEST_METHOD(ReverseStrTests_LargeBuffer)
+        {
+            std::vector<char> input(3 * 1024 * 1024 + 7);
+            for (size_t i = 0; i < input.size(); ++i)
+                input[i] = static_cast<char>(i * 31 + i / 256);
+            std::vector<char> expected(input);
+            std::rotate(expected.begin(), expected.begin() + 1, expected.end());
+
+            //  Reversing the tail and then the whole buffer rotates it left by one.
+            ReverseBuffer(input.data() + 1, input.size() - 1);
+            ReverseBuffer(input.data(), input.size());
+
+            Assert::IsTrue(expected == input);
+        }
     };
 
     TEST_CLASS(ReverseStrAmpTests)
@@ -145,5 +181,26 @@ namespace ReverseStringTests
 
             Assert::AreEqual(0, expected.compare(input), Msg(expected, input).c_str());
         }
+
+        TEST_METHOD(ReverseStrAmpTests_AllShortLengthsAndAlignments)
+        {
+            //  Every length mod 4 so the chars that don't fill a word are covered.
+            for (size_t offset = 0; offset < 4; ++offset)
+            {
+                for (size_t length = 0; length < 40; ++length)
+                {
+                    std::string buffer(offset, 'x');
+                    for (size_t i = 0; i < length; ++i)
+                        buffer.push_back(static_cast<char>('a' + i % 26));
+                    std::string expected(buffer.substr(offset));
+                    std::reverse(expected.begin(), expected.end());
+
+                    ReverseStrAmp(&buffer[0] + offset);
+
+                    std::string actual(buffer.substr(offset));
+                    Assert::AreEqual(0, expected.compare(actual), Msg(expected, actual).c_str());
+                }
+            }
+        }
     };
 }
\ No newline at end of file
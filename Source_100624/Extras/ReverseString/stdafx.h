@@ -5,7 +5,11 @@
 #include <CppUnitTest.h>
 
 #include <string>
+#include <vector>
+#include <algorithm>
 #include <utility>
 #include <iterator>
 #include <iostream>
-#include <amp.h>
\ No newline at end of file
+#include <amp.h>
+#include <intrin.h>
+#include <emmintrin.h>
@@ -0,0 +1,180 @@
+//===============================================================================
+//
+// Microsoft Press
+// C++ AMP: Accelerated Massive Parallelism with Microsoft Visual C++
+//
+//===============================================================================
+// Copyright (c) 2012 Ade Miller & Kate Gregory.  All rights reserved.
+// This code released under the terms of the 
+// Microsoft Public License (Ms-PL), http://ampbook.codeplex.com/license.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//===============================================================================
+
+#pragma once
+
+#include <ppl.h>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <iterator>
+
+namespace Extras
+{
+    // Parallel merging and sorting with any comparator, for keys RadixSort can't handle.
+    //
+    // ParallelMerge uses merge path, see Odeh, Green, Mwassi, Shmueli & Birk, "Merge Path - Parallel
+    // Merging Made Simple". The merged output is cut into equal pieces of kMergeChunkSize elements. A binary
+    // search along the diagonal through the two inputs where each cut falls finds how many elements of
+    // each input come before it, then every piece is merged independently with std::merge. Each thread
+    // does the same amount of work however the values in the two inputs interleave.
+    //
+    // ParallelMergeK merges k sorted sequences in a tree of pairwise merges and ParallelMergeSort sorts
+    // chunks with std::stable_sort and then merges them the same way. All of them are stable, equal
+    // elements keep their order and those from earlier inputs come first.
+
+    const size_t kMergeChunkSize = 64 * 1024;
+
+    namespace details
+    {
+        // The number of elements from the first input among the first diagonal elements of the merge.
+
+        template <typename It1, typename It2, typename Compare>
+        size_t MergePathSplit(It1 first1, size_t count1, It2 first2, size_t count2, size_t diagonal, const Compare& comp)
+        {
+            size_t lo = (diagonal > count2) ? diagonal - count2 : 0;
+            size_t hi = (std::min)(diagonal, count1);
+            while (lo < hi)
+            {
+                const size_t mid = lo + (hi - lo) / 2;
+                if (!comp(first2[diagonal - 1 - mid], first1[mid]))
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+            return lo;
+        }
+    }
+
+    template <typename It1, typename It2, typename OutIt, typename Compare>
+    void ParallelMerge(It1 first1, It1 last1, It2 first2, It2 last2, OutIt outFirst, const Compare& comp)
+    {
+        const size_t count1 = size_t(std::distance(first1, last1));
+        const size_t count2 = size_t(std::distance(first2, last2));
+        const size_t total = count1 + count2;
+        const size_t pieceCount = (total + kMergeChunkSize - 1) / kMergeChunkSize;
+
+        concurrency::parallel_for(size_t(0), pieceCount, [&](size_t p)
+        {
+            const size_t diagonal = p * kMergeChunkSize;
+            const size_t nextDiagonal = (std::min)(total, diagonal + kMergeChunkSize);
+            const size_t i = details::MergePathSplit(first1, count1, first2, count2, diagonal, comp);
+            const size_t nextI = details::MergePathSplit(first1, count1, first2, count2, nextDiagonal, comp);
+            std::merge(first1 + i, first1 + nextI, first2 + (diagonal - i), first2 + (nextDiagonal - nextI), outFirst + diagonal, comp);
+        });
+    }
+
+    template <typename It1, typename It2, typename OutIt>
+    void ParallelMerge(It1 first1, It1 last1, It2 first2, It2 last2, OutIt outFirst)
+    {
+        typedef typename std::iterator_traits<It1>::value_type T;
+
+        ParallelMerge(first1, last1, first2, last2, outFirst, std::less<T>());
+    }
+
+    namespace details
+    {
+        // Merges adjacent pairs of the sorted runs of source, whose boundaries are given by bounds, into
+        // target until one run remains. Returns true if the result ended up in target.
+
+        template <typename T, typename Compare>
+        bool MergeRuns(T* pSource, T* pTarget, std::vector<size_t> bounds, const Compare& comp)
+        {
+            bool inTarget = false;
+            while (bounds.size() > 2)
+            {
+                std::vector<size_t> merged;
+                merged.reserve(bounds.size() / 2 + 2);
+                size_t r = 0;
+                for (; r + 2 < bounds.size(); r += 2)
+                {
+                    merged.push_back(bounds[r]);
+                    ParallelMerge(pSource + bounds[r], pSource + bounds[r + 1], pSource + bounds[r + 1], pSource + bounds[r + 2], pTarget + bounds[r], comp);
+                }
+                if (r + 1 < bounds.size())
+                {
+                    // An odd run out is carried over to the next round unchanged.
+                    merged.push_back(bounds[r]);
+                    std::copy(pSource + bounds[r], pSource + bounds[r + 1], pTarget + bounds[r]);
+                }
+                merged.push_back(bounds.back());
+                bounds.swap(merged);
+                std::swap(pSource, pTarget);
+                inTarget = !inTarget;
+            }
+            return inTarget;
+        }
+    }
+
+    // Merges k sorted sequences into output.
+
+    template <typename T, typename Compare>
+    void ParallelMergeK(const std::vector<std::vector<T>>& inputs, std::vector<T>& output, const Compare& comp)
+    {
+        std::vector<size_t> bounds(1, 0);
+        for (size_t k = 0; k < inputs.size(); ++k)
+            bounds.push_back(bounds.back() + inputs[k].size());
+
+        std::vector<T> buffer(bounds.back());
+        output.resize(bounds.back());
+        concurrency::parallel_for(size_t(0), inputs.size(), [&](size_t k)
+        {
+            std::copy(begin(inputs[k]), end(inputs[k]), begin(buffer) + bounds[k]);
+        });
+        if (!details::MergeRuns(buffer.data(), output.data(), bounds, comp))
+            output.swap(buffer);
+    }
+
+    template <typename T>
+    void ParallelMergeK(const std::vector<std::vector<T>>& inputs, std::vector<T>& output)
+    {
+        ParallelMergeK(inputs, output, std::less<T>());
+    }
+
+    // Stable sort of count elements, in place.
+
+    template <typename T, typename Compare>
+    void ParallelMergeSort(T* const pData, size_t count, const Compare& comp)
+    {
+        const size_t chunkCount = (std::max)(size_t(1), (std::min)(size_t(concurrency::CurrentScheduler::GetNumberOfVirtualProcessors()) * 4, count / kMergeChunkSize));
+        std::vector<size_t> bounds(chunkCount + 1);
+        for (size_t c = 0; c <= chunkCount; ++c)
+            bounds[c] = count / chunkCount * c + (std::min)(c, count % chunkCount);
+
+        concurrency::parallel_for(size_t(0), chunkCount, [&](size_t c)
+        {
+            std::stable_sort(pData + bounds[c], pData + bounds[c + 1], comp);
+        });
+        if (chunkCount == 1)
+            return;
+
+        std::vector<T> buffer(count);
+        if (details::MergeRuns(pData, buffer.data(), bounds, comp))
+        {
+            concurrency::parallel_for(size_t(0), count, kMergeChunkSize, [&](size_t first)
+            {
+                const size_t last = (std::min)(count, first + kMergeChunkSize);
+                std::copy(begin(buffer) + first, begin(buffer) + last, pData + first);
+            });
+        }
+    }
+
+    template <typename T>
+    void ParallelMergeSort(T* const pData, size_t count)
+    {
+        ParallelMergeSort(pData, count, std::less<T>());
+    }
+}
@@ -0,0 +1,256 @@
+//===============================================================================
+//
+// Microsoft Press
+// C++ AMP: Accelerated Massive Parallelism with Microsoft Visual C++
+//
+//===============================================================================
+// Copyright (c) 2012 Ade Miller & Kate Gregory.  All rights reserved.
+// This code released under the terms of the 
+// Microsoft Public License (Ms-PL), http://ampbook.codeplex.com/license.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//===============================================================================
+
+#pragma once
+
+#include <ppl.h>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <string.h>
+#include <assert.h>
+
+#include "ScanSequential.h"
+
+namespace Extras
+{
+    // Parallel least significant digit radix sort for 32 and 64 bit integer and floating point keys, with
+    // or without an array of values that are moved with their keys. The sort is stable.
+    //
+    // Keys are first mapped to unsigned integers that sort in the same order, then sorted eight bits at a
+    // time. Each pass splits the keys into one chunk per thread. Every chunk counts its own digits, an
+    // exclusive scan of the counts in digit major order gives each chunk the position where its keys for
+    // each digit start, then all chunks scatter their keys in parallel. A first pass over the keys counts
+    // every digit at once, and any digit that is the same for all keys is skipped.
+
+    const size_t kRadixMinChunkSize = 64 * 1024;
+
+    namespace details
+    {
+        const int kRadixBits = 8;
+        const int kRadixBuckets = 1 << kRadixBits;
+
+        // Maps a key to an unsigned integer with the same ordering, and back.
+
+        template <typename K>
+        struct RadixKey;
+
+        template <>
+        struct RadixKey<unsigned>
+        {
+            typedef unsigned Bits;
+            static Bits ToBits(unsigned k) { return k; }
+            static unsigned FromBits(Bits b) { return b; }
+        };
+
+        template <>
+        struct RadixKey<int>
+        {
+            typedef unsigned Bits;
+            static Bits ToBits(int k) { return Bits(k) ^ 0x80000000u; }
+            static int FromBits(Bits b) { return int(b ^ 0x80000000u); }
+        };
+
+        template <>
+        struct RadixKey<unsigned long long>
+        {
+            typedef unsigned long long Bits;
+            static Bits ToBits(unsigned long long k) { return k; }
+            static unsigned long long FromBits(Bits b) { return b; }
+        };
+
+        template <>
+        struct RadixKey<long long>
+        {
+            typedef unsigned long long Bits;
+            static Bits ToBits(long long k) { return Bits(k) ^ 0x8000000000000000ull; }
+            static long long FromBits(Bits b) { return (long long)(b ^ 0x8000000000000000ull); }
+        };
+
+        // Negative floats have all their bits flipped so larger magnitudes sort first, positive floats
+        // just have the sign bit set. -0.0 sorts before +0.0 and NaNs sort to the ends.
+
+        template <>
+        struct RadixKey<float>
+        {
+            typedef unsigned Bits;
+            static Bits ToBits(float k)
+            {
+                Bits b;
+                memcpy(&b, &k, sizeof(b));
+                return (b & 0x80000000u) ? ~b : (b | 0x80000000u);
+            }
+            static float FromBits(Bits b)
+            {
+                b = (b & 0x80000000u) ? (b & 0x7FFFFFFFu) : ~b;
+                float k;
+                memcpy(&k, &b, sizeof(k));
+                return k;
+            }
+        };
+
+        template <>
+        struct RadixKey<double>
+        {
+            typedef unsigned long long Bits;
+            static Bits ToBits(double k)
+            {
+                Bits b;
+                memcpy(&b, &k, sizeof(b));
+                return (b & 0x8000000000000000ull) ? ~b : (b | 0x8000000000000000ull);
+            }
+            static double FromBits(Bits b)
+            {
+                b = (b & 0x8000000000000000ull) ? (b & 0x7FFFFFFFFFFFFFFFull) : ~b;
+                double k;
+                memcpy(&k, &b, sizeof(k));
+                return k;
+            }
+        };
+
+        struct NoValue
+        {
+        };
+
+        inline int Digit(unsigned long long bits, int pass)
+        {
+            return int(bits >> (pass * kRadixBits)) & (kRadixBuckets - 1);
+        }
+
+        // Sorts keys, and values if pValues isn't null. The result ends up in either the original or the
+        // temporary buffers, returns true if it's in the temporary ones.
+
+        template <typename Bits, typename V>
+        bool RadixSortBits(Bits* pKeys, Bits* pKeysTemp, V* pValues, V* pValuesTemp, size_t count)
+        {
+            const int passCount = int(sizeof(Bits)) * 8 / kRadixBits;
+            const size_t chunkCount = (std::max)(size_t(1), (std::min)(size_t(concurrency::CurrentScheduler::GetNumberOfVirtualProcessors()), count / kRadixMinChunkSize));
+            const size_t chunkSize = (count + chunkCount - 1) / chunkCount;
+
+            // Count every digit of every key in one pass to find the digits that are the same for all keys.
+            std::vector<size_t> totals(passCount * kRadixBuckets, 0);
+            {
+                std::vector<std::vector<size_t>> chunkTotals(chunkCount, std::vector<size_t>(passCount * kRadixBuckets, 0));
+                concurrency::parallel_for(size_t(0), chunkCount, [&](size_t c)
+                {
+                    size_t* const pCounts = chunkTotals[c].data();
+                    const size_t last = (std::min)(count, (c + 1) * chunkSize);
+                    for (size_t i = c * chunkSize; i < last; ++i)
+                    {
+                        for (int pass = 0; pass < passCount; ++pass)
+                            ++pCounts[pass * kRadixBuckets + Digit(pKeys[i], pass)];
+                    }
+                });
+                for (size_t c = 0; c < chunkCount; ++c)
+                    std::transform(totals.begin(), totals.end(), chunkTotals[c].begin(), totals.begin(), std::plus<size_t>());
+            }
+
+            bool inTemp = false;
+            std::vector<size_t> counts(kRadixBuckets * chunkCount);
+            std::vector<size_t> offsets(kRadixBuckets * chunkCount);
+            for (int pass = 0; pass < passCount; ++pass)
+            {
+                if (std::find(totals.begin() + pass * kRadixBuckets, totals.begin() + (pass + 1) * kRadixBuckets, count) != totals.begin() + (pass + 1) * kRadixBuckets)
+                    continue;
+
+                // Per chunk digit counts, stored digit major so the scan gives each chunk its starting positions.
+                concurrency::parallel_for(size_t(0), chunkCount, [&](size_t c)
+                {
+                    size_t local[kRadixBuckets] = { 0 };
+                    const size_t last = (std::min)(count, (c + 1) * chunkSize);
+                    for (size_t i = c * chunkSize; i < last; ++i)
+                        ++local[Digit(pKeys[i], pass)];
+                    for (int d = 0; d < kRadixBuckets; ++d)
+                        counts[d * chunkCount + c] = local[d];
+                });
+                Prescan(counts.begin(), counts.end(), offsets.begin());
+
+                concurrency::parallel_for(size_t(0), chunkCount, [&](size_t c)
+                {
+                    size_t next[kRadixBuckets];
+                    for (int d = 0; d < kRadixBuckets; ++d)
+                        next[d] = offsets[d * chunkCount + c];
+                    const size_t last = (std::min)(count, (c + 1) * chunkSize);
+                    if (pValues != nullptr)
+                    {
+                        for (size_t i = c * chunkSize; i < last; ++i)
+                        {
+                            const size_t j = next[Digit(pKeys[i], pass)]++;
+                            pKeysTemp[j] = pKeys[i];
+                            pValuesTemp[j] = pValues[i];
+                        }
+                    }
+                    else
+                    {
+                        for (size_t i = c * chunkSize; i < last; ++i)
+                            pKeysTemp[next[Digit(pKeys[i], pass)]++] = pKeys[i];
+                    }
+                });
+
+                std::swap(pKeys, pKeysTemp);
+                std::swap(pValues, pValuesTemp);
+                inTemp = !inTemp;
+            }
+            return inTemp;
+        }
+
+        template <typename K, typename V>
+        void RadixSort(K* const pKeys, V* const pValues, size_t count)
+        {
+            typedef typename RadixKey<K>::Bits Bits;
+            if (count < 2)
+                return;
+
+            std::vector<Bits> bits(count);
+            std::vector<Bits> bitsTemp(count);
+            std::vector<V> valuesTemp((pValues != nullptr) ? count : 0);
+            concurrency::parallel_for(size_t(0), count, kRadixMinChunkSize, [&](size_t first)
+            {
+                const size_t last = (std::min)(count, first + kRadixMinChunkSize);
+                for (size_t i = first; i < last; ++i)
+                    bits[i] = RadixKey<K>::ToBits(pKeys[i]);
+            });
+
+            const bool inTemp = RadixSortBits(bits.data(), bitsTemp.data(), pValues, valuesTemp.data(), count);
+            const Bits* const pSorted = inTemp ? bitsTemp.data() : bits.data();
+            concurrency::parallel_for(size_t(0), count, kRadixMinChunkSize, [&](size_t first)
+            {
+                const size_t last = (std::min)(count, first + kRadixMinChunkSize);
+                for (size_t i = first; i < last; ++i)
+                    pKeys[i] = RadixKey<K>::FromBits(pSorted[i]);
+                if (inTemp && pValues != nullptr)
+                    std::copy(valuesTemp.begin() + first, valuesTemp.begin() + last, pValues + first);
+            });
+        }
+    }
+
+    // Sorts count keys in place, K is int, unsigned, long long, unsigned long long, float or double.
+
+    template <typename K>
+    inline void RadixSort(K* const pKeys, size_t count)
+    {
+        details::RadixSort(pKeys, static_cast<details::NoValue*>(nullptr), count);
+    }
+
+    // Sorts count keys in place and moves pValues[i] along with pKeys[i].
+
+    template <typename K, typename V>
+    inline void RadixSort(K* const pKeys, V* const pValues, size_t count)
+    {
+        assert(pValues != nullptr);
+        details::RadixSort(pKeys, pValues, count);
+    }
+}
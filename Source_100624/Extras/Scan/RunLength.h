@@ -0,0 +1,205 @@
+//===============================================================================
+//
+// Microsoft Press
+// C++ AMP: Accelerated Massive Parallelism with Microsoft Visual C++
+//
+//===============================================================================
+// Copyright (c) 2012 Ade Miller & Kate Gregory.  All rights reserved.
+// This code released under the terms of the 
+// Microsoft Public License (Ms-PL), http://ampbook.codeplex.com/license.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//===============================================================================
+
+#pragma once
+
+#include <ppl.h>
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <string.h>
+#include <assert.h>
+
+#include "ScanSequential.h"
+
+namespace Extras
+{
+    // Parallel run-length encoding, for any trivially copyable element type such as unsigned char, int or
+    // float. Elements are compared bit for bit so float data round trips exactly, NaNs and -0.0 included.
+    //
+    // Encoding splits the input into chunks. Each chunk counts the elements that start a run, an exclusive
+    // scan of the counts gives every chunk the index of its first run, then all chunks write their runs.
+    // Both passes use the same affinity_partitioner so the second one reads each chunk from cache.
+    //
+    // Decoding scans the total lengths of chunks of runs, then splits the output, not the runs, evenly
+    // between threads. Each thread finds its first run from the chunk totals so a few very long runs can't
+    // leave one thread with most of the work.
+    //
+    // L is the run length type. A run longer than L can hold is written as several runs of the same value,
+    // decoding joins them up again.
+
+    const size_t kRunLengthChunkSize = 64 * 1024;
+
+    namespace details
+    {
+        template <typename T>
+        inline bool SameBits(const T& a, const T& b)
+        {
+            return memcmp(&a, &b, sizeof(T)) == 0;
+        }
+
+        // The number of entries a run of length elements takes when no entry may exceed maxLength. Written
+        // so it can't overflow when maxLength is SIZE_MAX, as it is for size_t lengths.
+
+        inline size_t RunEntryCount(size_t length, size_t maxLength)
+        {
+            return length == 0 ? 0 : 1 + (length - 1) / maxLength;
+        }
+
+        // Writes a run as entries of at most maxLength elements starting at k, returns the next entry.
+
+        template <typename T, typename L>
+        inline size_t WriteRun(const T& value, size_t length, size_t maxLength, T* const pValues, L* const pLengths, size_t k)
+        {
+            for (; length > maxLength; length -= maxLength, ++k)
+            {
+                pValues[k] = value;
+                pLengths[k] = L(maxLength);
+            }
+            pValues[k] = value;
+            pLengths[k] = L(length);
+            return k + 1;
+        }
+    }
+
+    template <typename T, typename L>
+    void RunLengthEncode(const T* const pInput, size_t count, std::vector<T>& values, std::vector<L>& lengths)
+    {
+        values.clear();
+        lengths.clear();
+        if (count == 0)
+            return;
+
+        const size_t maxLength = size_t((std::numeric_limits<L>::max)());
+        const size_t chunkCount = (count + kRunLengthChunkSize - 1) / kRunLengthChunkSize;
+        std::vector<size_t> headCounts(chunkCount);
+        std::vector<size_t> firstHeads(chunkCount);
+        std::vector<size_t> lastHeads(chunkCount);
+        std::vector<size_t> entryCounts(chunkCount);
+        concurrency::affinity_partitioner partitioner;
+        concurrency::parallel_for(size_t(0), chunkCount, [&](size_t c)
+        {
+            const size_t first = c * kRunLengthChunkSize;
+            const size_t last = (std::min)(count, first + kRunLengthChunkSize);
+            size_t heads = 0;
+            size_t entries = 0;
+            size_t firstHead = last;
+            size_t lastHead = last;
+            for (size_t i = first; i < last; ++i)
+            {
+                if (i == 0 || !details::SameBits(pInput[i], pInput[i - 1]))
+                {
+                    if (heads == 0)
+                        firstHead = i;
+                    else
+                        entries += details::RunEntryCount(i - lastHead, maxLength);
+                    lastHead = i;
+                    ++heads;
+                }
+            }
+            headCounts[c] = heads;
+            firstHeads[c] = firstHead;
+            lastHeads[c] = lastHead;
+            entryCounts[c] = entries;
+        }, partitioner);
+
+        // The last run of a chunk ends at the first run head of a later chunk, only then is its entry count known.
+        std::vector<size_t> nextHeads(chunkCount);
+        size_t next = count;
+        for (size_t c = chunkCount; c-- > 0;)
+        {
+            nextHeads[c] = next;
+            if (headCounts[c] > 0)
+            {
+                entryCounts[c] += details::RunEntryCount(next - lastHeads[c], maxLength);
+                next = firstHeads[c];
+            }
+        }
+
+        std::vector<size_t> positions(chunkCount);
+        Prescan(begin(entryCounts), end(entryCounts), begin(positions));
+        values.resize(positions.back() + entryCounts.back());
+        lengths.resize(values.size());
+
+        T* const pValues = values.data();
+        L* const pLengths = lengths.data();
+        concurrency::parallel_for(size_t(0), chunkCount, [&](size_t c)
+        {
+            if (headCounts[c] == 0)
+                return;
+            const size_t last = (std::min)(count, (c + 1) * kRunLengthChunkSize);
+            size_t k = positions[c];
+            size_t runStart = firstHeads[c];
+            for (size_t i = runStart + 1; i < last; ++i)
+            {
+                if (!details::SameBits(pInput[i], pInput[i - 1]))
+                {
+                    k = details::WriteRun(pInput[runStart], i - runStart, maxLength, pValues, pLengths, k);
+                    runStart = i;
+                }
+            }
+            details::WriteRun(pInput[runStart], nextHeads[c] - runStart, maxLength, pValues, pLengths, k);
+        }, partitioner);
+    }
+
+    template <typename T, typename L>
+    void RunLengthDecode(const std::vector<T>& values, const std::vector<L>& lengths, std::vector<T>& output)
+    {
+        assert(values.size() == lengths.size());
+
+        const size_t runCount = lengths.size();
+        const size_t chunkCount = (runCount + kRunLengthChunkSize - 1) / kRunLengthChunkSize;
+        std::vector<size_t> chunkLengths(chunkCount);
+        concurrency::parallel_for(size_t(0), chunkCount, [&](size_t c)
+        {
+            const size_t last = (std::min)(runCount, (c + 1) * kRunLengthChunkSize);
+            size_t sum = 0;
+            for (size_t r = c * kRunLengthChunkSize; r < last; ++r)
+                sum += size_t(lengths[r]);
+            chunkLengths[c] = sum;
+        });
+
+        std::vector<size_t> chunkOffsets(chunkCount);
+        Prescan(begin(chunkLengths), end(chunkLengths), begin(chunkOffsets));
+        const size_t total = (chunkCount > 0) ? chunkOffsets.back() + chunkLengths.back() : 0;
+        output.resize(total);
+        if (total == 0)
+            return;
+
+        T* const pOutput = output.data();
+        const size_t partCount = (total + kRunLengthChunkSize - 1) / kRunLengthChunkSize;
+        concurrency::parallel_for(size_t(0), partCount, [&](size_t p)
+        {
+            const size_t first = p * kRunLengthChunkSize;
+            const size_t last = (std::min)(total, first + kRunLengthChunkSize);
+
+            // The last chunk starting at or before first holds the run covering it.
+            const size_t c = size_t(std::upper_bound(begin(chunkOffsets), end(chunkOffsets), first) - begin(chunkOffsets)) - 1;
+            size_t r = c * kRunLengthChunkSize;
+            size_t runStart = chunkOffsets[c];
+            while (runStart + size_t(lengths[r]) <= first)
+                runStart += size_t(lengths[r++]);
+
+            for (size_t i = first; i < last; ++r)
+            {
+                const size_t runEnd = (std::min)(last, runStart + size_t(lengths[r]));
+                std::fill(pOutput + i, pOutput + runEnd, values[r]);
+                runStart += size_t(lengths[r]);
+                i = runEnd;
+            }
+        });
+    }
+}
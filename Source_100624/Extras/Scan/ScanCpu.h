@@ -0,0 +1,219 @@
+//===============================================================================
+//
+// Microsoft Press
+// C++ AMP: Accelerated Massive Parallelism with Microsoft Visual C++
+//
+//===============================================================================
+// Copyright (c) 2012 Ade Miller & Kate Gregory.  All rights reserved.
+// This code released under the terms of the 
+// Microsoft Public License (Ms-PL), http://ampbook.codeplex.com/license.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//===============================================================================
+
+#pragma once
+
+#include <ppl.h>
+#include <vector>
+#include <algorithm>
+#include <emmintrin.h>
+
+#include "..\Reduction\ReduceCpu.h"
+
+namespace Extras
+{
+    // CPU sums of int or float elements.
+    //
+    // Scan in ScanSequential.h carries the running total through memory from one element to the next.
+    // ScanSimd keeps it in a register instead and does the prefix sum of each four element vector with
+    // two shift-and-add steps, then adds the running total broadcast to all lanes. The vector prefixes
+    // don't depend on each other so four are computed per iteration.
+    //
+    // ScanParallel works through the input in steps of kScanCpuBlockSize elements per virtual processor.
+    // Each worker sums its block, the block sums are scanned, then each worker scans its block again
+    // starting from its offset. Both passes share an affinity_partitioner so PPL runs each block on the
+    // same core twice and the second pass reads it from L2, the input only comes from memory once.
+    //
+    // Float results are reassociated so they can differ from a sequential scan in the last bits. The input
+    // and output may be the same.
+
+    const size_t kScanCpuBlockSize = 32 * 1024;
+
+    namespace details
+    {
+        template <typename T>
+        struct SimdScanOps;
+
+        template <>
+        struct SimdScanOps<int>
+        {
+            typedef __m128i Register;
+
+            static Register Load(const int* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+            static void Store(int* p, Register v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+            static Register Broadcast(int v) { return _mm_set1_epi32(v); }
+            static Register BroadcastLast(Register v) { return _mm_shuffle_epi32(v, _MM_SHUFFLE(3, 3, 3, 3)); }
+            static int First(Register v) { return _mm_cvtsi128_si32(v); }
+            static Register Add(Register a, Register b) { return _mm_add_epi32(a, b); }
+            static int AddScalar(int a, int b) { return int(unsigned(a) + unsigned(b)); }
+
+            // Shifts each element up one lane, lane 0 becomes zero.
+            static Register ShiftLane(Register v) { return _mm_slli_si128(v, 4); }
+
+            static Register Prefix(Register v)
+            {
+                v = _mm_add_epi32(v, _mm_slli_si128(v, 4));
+                return _mm_add_epi32(v, _mm_slli_si128(v, 8));
+            }
+        };
+
+        template <>
+        struct SimdScanOps<float>
+        {
+            typedef __m128 Register;
+
+            static Register Load(const float* p) { return _mm_loadu_ps(p); }
+            static void Store(float* p, Register v) { _mm_storeu_ps(p, v); }
+            static Register Broadcast(float v) { return _mm_set1_ps(v); }
+            static Register BroadcastLast(Register v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3)); }
+            static float First(Register v) { return _mm_cvtss_f32(v); }
+            static Register Add(Register a, Register b) { return _mm_add_ps(a, b); }
+            static float AddScalar(float a, float b) { return a + b; }
+
+            static Register ShiftLane(Register v) { return _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(v), 4)); }
+
+            static Register Prefix(Register v)
+            {
+                v = _mm_add_ps(v, ShiftLane(v));
+                return _mm_add_ps(v, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(v), 8)));
+            }
+        };
+
+        // Scans count elements starting from carry and returns the total including carry.
+
+        template <typename T>
+        T ScanSimd(const T* const pInput, T* const pOutput, size_t count, T carry, bool exclusive)
+        {
+            typedef SimdScanOps<T> Ops;
+            typedef typename Ops::Register Register;
+
+            Register total = Ops::Broadcast(carry);
+            size_t i = 0;
+            for (; i + 16 <= count; i += 16)
+            {
+                const Register v0 = Ops::Prefix(Ops::Load(pInput + i));
+                const Register v1 = Ops::Prefix(Ops::Load(pInput + i + 4));
+                const Register v2 = Ops::Prefix(Ops::Load(pInput + i + 8));
+                const Register v3 = Ops::Prefix(Ops::Load(pInput + i + 12));
+                const Register t0 = total;
+                const Register t1 = Ops::Add(t0, Ops::BroadcastLast(v0));
+                const Register t2 = Ops::Add(t1, Ops::BroadcastLast(v1));
+                const Register t3 = Ops::Add(t2, Ops::BroadcastLast(v2));
+                total = Ops::Add(t3, Ops::BroadcastLast(v3));
+                if (exclusive)
+                {
+                    Ops::Store(pOutput + i, Ops::Add(t0, Ops::ShiftLane(v0)));
+                    Ops::Store(pOutput + i + 4, Ops::Add(t1, Ops::ShiftLane(v1)));
+                    Ops::Store(pOutput + i + 8, Ops::Add(t2, Ops::ShiftLane(v2)));
+                    Ops::Store(pOutput + i + 12, Ops::Add(t3, Ops::ShiftLane(v3)));
+                }
+                else
+                {
+                    Ops::Store(pOutput + i, Ops::Add(t0, v0));
+                    Ops::Store(pOutput + i + 4, Ops::Add(t1, v1));
+                    Ops::Store(pOutput + i + 8, Ops::Add(t2, v2));
+                    Ops::Store(pOutput + i + 12, Ops::Add(t3, v3));
+                }
+            }
+
+            T sum = Ops::First(total);
+            for (; i < count; ++i)
+            {
+                const T value = pInput[i];
+                if (exclusive)
+                    pOutput[i] = sum;
+                sum = Ops::AddScalar(sum, value);
+                if (!exclusive)
+                    pOutput[i] = sum;
+            }
+            return sum;
+        }
+
+        template <typename T>
+        void ScanParallel(const T* const pInput, T* const pOutput, size_t count, bool exclusive)
+        {
+            typedef SimdScanOps<T> Ops;
+
+            const size_t workers = (std::min)(size_t(concurrency::CurrentScheduler::GetNumberOfVirtualProcessors()), 
+                (std::max)(size_t(1), count / kScanCpuBlockSize));
+            if (workers <= 1)
+            {
+                ScanSimd(pInput, pOutput, count, T(0), exclusive);
+                return;
+            }
+
+            std::vector<PaddedPartial<T>> offsets(workers);
+            concurrency::affinity_partitioner partitioner;
+            const size_t step = workers * kScanCpuBlockSize;
+            T carry = T(0);
+            for (size_t first = 0; first < count; first += step)
+            {
+                const size_t blockSize = ((std::min)(step, count - first) + workers - 1) / workers;
+                const size_t last = (std::min)(count, first + step);
+
+                concurrency::parallel_for(size_t(0), workers, [&](size_t w)
+                {
+                    const size_t blockFirst = (std::min)(last, first + w * blockSize);
+                    const size_t blockLast = (std::min)(last, blockFirst + blockSize);
+                    offsets[w].value = SumSimd(pInput + blockFirst, blockLast - blockFirst);
+                }, partitioner);
+
+                for (size_t w = 0; w < workers; ++w)
+                {
+                    const T blockSum = offsets[w].value;
+                    offsets[w].value = carry;
+                    carry = Ops::AddScalar(carry, blockSum);
+                }
+
+                concurrency::parallel_for(size_t(0), workers, [&](size_t w)
+                {
+                    const size_t blockFirst = (std::min)(last, first + w * blockSize);
+                    const size_t blockLast = (std::min)(last, blockFirst + blockSize);
+                    ScanSimd(pInput + blockFirst, pOutput + blockFirst, blockLast - blockFirst, offsets[w].value, exclusive);
+                }, partitioner);
+            }
+        }
+    }
+
+    // Single threaded scans, output element at i contains the sum of elements [0]...[i-1] for PrescanSimd
+    // and [0]...[i] for ScanSimd.
+
+    template <typename T>
+    inline void PrescanSimd(const T* const pInput, T* const pOutput, size_t count)
+    {
+        details::ScanSimd(pInput, pOutput, count, T(0), true);
+    }
+
+    template <typename T>
+    inline void ScanSimd(const T* const pInput, T* const pOutput, size_t count)
+    {
+        details::ScanSimd(pInput, pOutput, count, T(0), false);
+    }
+
+    // Multi threaded scans.
+
+    template <typename T>
+    inline void PrescanParallel(const T* const pInput, T* const pOutput, size_t count)
+    {
+        details::ScanParallel(pInput, pOutput, count, true);
+    }
+
+    template <typename T>
+    inline void ScanParallel(const T* const pInput, T* const pOutput, size_t count)
+    {
+        details::ScanParallel(pInput, pOutput, count, false);
+    }
+}
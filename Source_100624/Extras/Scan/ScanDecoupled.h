@@ -0,0 +1,339 @@
+//===============================================================================
+//
+// Microsoft Press
+// C++ AMP: Accelerated Massive Parallelism with Microsoft Visual C++
+//
+//===============================================================================
+// Copyright (c) 2012 Ade Miller & Kate Gregory.  All rights reserved.
+// This code released under the terms of the 
+// Microsoft Public License (Ms-PL), http://ampbook.codeplex.com/license.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//===============================================================================
+
+#pragma once
+
+#include <amp.h>
+#include <iterator>
+#include <algorithm>
+#include <assert.h>
+
+#include "..\Reduction\Reduce.h"
+
+using namespace concurrency;
+
+namespace Extras
+{
+    // Single pass scan with decoupled look-back, see Merrill & Garland, "Single-pass Parallel Prefix Scan
+    // with Decoupled Look-back", NVIDIA Technical Report NVR-2016-002.
+    //
+    // ScanAmpTiled needs a pass for the tile-wise scans, a recursive scan of the tile sums and a pass to
+    // add them back in, so the output is written twice and read once more. Here each tile publishes its
+    // total as soon as it is known, then adds up the totals of the preceding tiles, stopping at the first
+    // one that has already published its inclusive prefix. Each element is read and written once.
+    //
+    // Tiles wait on their predecessors so they take their position from an atomic counter rather than
+    // their tile index. A tile only ever waits for tiles that started before it, which can't deadlock
+    // however the hardware schedules them. Only int, unsigned and float elements are supported as the
+    // published values are read and written with 32 bit atomics. Any associative operator from Reduce.h,
+    // or one like them, can be used, it's applied in order so it needn't be commutative.
+    //
+    // A single dispatch can have at most 65535 tiles. Longer inputs are scanned in sections of that many
+    // tiles, each one starting from the total of the sections before it, so any length works and the
+    // iterator versions take 64 bit lengths.
+
+    const int kScanItemsPerThread = 8;
+    const int kScanMaxTiles = 65535;
+
+    namespace details
+    {
+        template <typename T>
+        struct ScanBits;
+
+        template <>
+        struct ScanBits<int>
+        {
+            static unsigned ToBits(int v) restrict(amp) { return unsigned(v); }
+            static int FromBits(unsigned v) restrict(amp) { return int(v); }
+        };
+
+        template <>
+        struct ScanBits<unsigned>
+        {
+            static unsigned ToBits(unsigned v) restrict(amp) { return v; }
+            static unsigned FromBits(unsigned v) restrict(amp) { return v; }
+        };
+
+        template <>
+        struct ScanBits<float>
+        {
+            static unsigned ToBits(float v) restrict(amp) { return direct3d::asuint(v); }
+            static float FromBits(unsigned v) restrict(amp) { return direct3d::asfloat(v); }
+        };
+
+        // Tile status values.
+
+        const int kScanNotReady = 0;
+        const int kScanAggregate = 1;
+        const int kScanInclusive = 2;
+
+        // Scans one section of at most kScanMaxTiles tiles, the first tile starts from carry rather than
+        // the identity.
+
+        template <int TileSize, typename T, typename Op>
+        void ScanDecoupledSection(array_view<const T, 1> input, array_view<T, 1> output, const Op& op, bool exclusive, T carry)
+        {
+            static_assert(TileSize * kScanItemsPerThread * sizeof(T) <= 16 * 1024, "TileSize is too large to fit in tile_static memory.");
+            assert(input.extent[0] == output.extent[0]);
+
+            const int elementCount = input.extent[0];
+            const int tileElements = TileSize * kScanItemsPerThread;
+            const int tileCount = (elementCount + tileElements - 1) / tileElements;
+            assert(tileCount <= kScanMaxTiles);
+            const int isExclusive = exclusive ? 1 : 0;
+
+            // One status per tile, the extra element at the end is the counter that hands out tile positions.
+            array<int, 1> status(tileCount + 1);
+            array<unsigned, 1> aggregates(tileCount);
+            array<unsigned, 1> inclusives(tileCount);
+            parallel_for_each(status.extent, [&status](index<1> idx) restrict(amp)
+            {
+                status[idx] = kScanNotReady;
+            });
+
+            parallel_for_each(extent<1>(tileCount * TileSize).tile<TileSize>(), [=, &status, &aggregates, &inclusives](tiled_index<TileSize> tidx) restrict(amp)
+            {
+                const int tid = tidx.local[0];
+                tile_static T data[TileSize * kScanItemsPerThread];
+                tile_static T threadSums[TileSize];
+                tile_static int position;
+                tile_static T tilePrefix;
+
+                if (tid == 0)
+                    position = atomic_fetch_inc(&status[tileCount]);
+                tidx.barrier.wait_with_tile_static_memory_fence();
+
+                // Coalesced load, adjacent threads read adjacent elements.
+                const int first = position * tileElements;
+                for (int j = 0; j < kScanItemsPerThread; ++j)
+                {
+                    const int i = first + j * TileSize + tid;
+                    data[j * TileSize + tid] = (i < elementCount) ? input[i] : op.Identity();
+                }
+                tidx.barrier.wait_with_tile_static_memory_fence();
+
+                // Each thread scans its own run of consecutive elements, then the run totals are scanned.
+                T* const items = &data[tid * kScanItemsPerThread];
+                T sum = op.Identity();
+                for (int j = 0; j < kScanItemsPerThread; ++j)
+                {
+                    sum = op(sum, items[j]);
+                    items[j] = sum;
+                }
+                threadSums[tid] = sum;
+                tidx.barrier.wait_with_tile_static_memory_fence();
+
+                for (int offset = 1; offset < TileSize; offset *= 2)
+                {
+                    const T v = (tid >= offset) ? op(threadSums[tid - offset], threadSums[tid]) : threadSums[tid];
+                    tidx.barrier.wait_with_tile_static_memory_fence();
+                    threadSums[tid] = v;
+                    tidx.barrier.wait_with_tile_static_memory_fence();
+                }
+
+                // One thread publishes the tile's total and looks back for its prefix.
+                if (tid == 0)
+                {
+                    const T aggregate = threadSums[TileSize - 1];
+                    T prefix = carry;
+                    if (position > 0)
+                    {
+                        atomic_exchange(&aggregates[position], ScanBits<T>::ToBits(aggregate));
+                        global_memory_fence(tidx.barrier);
+                        atomic_exchange(&status[position], kScanAggregate);
+
+                        // Walking backwards, so each predecessor's value goes on the left.
+                        prefix = op.Identity();
+                        int predecessor = position - 1;
+                        while (true)
+                        {
+                            const int s = atomic_fetch_add(&status[predecessor], 0);
+                            if (s == kScanInclusive)
+                            {
+                                prefix = op(ScanBits<T>::FromBits(atomic_fetch_add(&inclusives[predecessor], 0u)), prefix);
+                                break;
+                            }
+                            if (s == kScanAggregate)
+                            {
+                                prefix = op(ScanBits<T>::FromBits(atomic_fetch_add(&aggregates[predecessor], 0u)), prefix);
+                                --predecessor;
+                            }
+                        }
+                    }
+                    atomic_exchange(&inclusives[position], ScanBits<T>::ToBits(op(prefix, aggregate)));
+                    global_memory_fence(tidx.barrier);
+                    atomic_exchange(&status[position], kScanInclusive);
+                    tilePrefix = prefix;
+                }
+                tidx.barrier.wait_with_tile_static_memory_fence();
+
+                // Add the prefixes, going backwards so an exclusive scan can read the previous inclusive value.
+                const T threadPrefix = (tid > 0) ? op(tilePrefix, threadSums[tid - 1]) : tilePrefix;
+                for (int j = kScanItemsPerThread - 1; j >= 0; --j)
+                {
+                    if (isExclusive)
+                        items[j] = (j > 0) ? op(threadPrefix, items[j - 1]) : threadPrefix;
+                    else
+                        items[j] = op(threadPrefix, items[j]);
+                }
+                tidx.barrier.wait_with_tile_static_memory_fence();
+
+                for (int j = 0; j < kScanItemsPerThread; ++j)
+                {
+                    const int i = first + j * TileSize + tid;
+                    if (i < elementCount)
+                        output[i] = data[j * TileSize + tid];
+                }
+            });
+        }
+
+        // The value carried into the section after input, given the input's last element and the output's.
+
+        template <typename T, typename Op>
+        T NextCarry(const Op& op, bool exclusive, const T& lastInput, const T& lastOutput)
+        {
+            return exclusive ? op(lastOutput, lastInput) : lastOutput;
+        }
+
+        // Scans input in sections of kScanMaxTiles tiles and returns the carry for whatever follows.
+
+        template <int TileSize, typename T, typename Op>
+        T ScanDecoupled(array_view<const T, 1> input, array_view<T, 1> output, const Op& op, bool exclusive, T carry)
+        {
+            const int sectionSize = kScanMaxTiles * TileSize * kScanItemsPerThread;
+            const int elementCount = input.extent[0];
+            for (int first = 0; first < elementCount; first += sectionSize)
+            {
+                const int count = (std::min)(sectionSize, elementCount - first);
+                const bool more = (first + count < elementCount);
+
+                // Read the last input element before it's overwritten by an in-place scan.
+                T lastInput = op.Identity();
+                if (more && exclusive)
+                    copy(input.section(first + count - 1, 1), &lastInput);
+
+                ScanDecoupledSection<TileSize>(input.section(first, count), output.section(first, count), op, exclusive, carry);
+
+                if (more)
+                {
+                    T lastOutput;
+                    copy(output.section(first + count - 1, 1), &lastOutput);
+                    carry = NextCarry(op, exclusive, lastInput, lastOutput);
+                }
+            }
+            return carry;
+        }
+
+        // Copies the input to the accelerator in sections, so the length can exceed what an array can hold.
+
+        template <int TileSize, typename InIt, typename OutIt, typename Op>
+        void ScanDecoupledRange(InIt first, InIt last, OutIt outFirst, const Op& op, bool exclusive)
+        {
+            typedef typename std::iterator_traits<InIt>::value_type T;
+
+            const int maxChunk = kScanMaxTiles * TileSize * kScanItemsPerThread;
+            size_t remaining = size_t(std::distance(first, last));
+            if (remaining == 0)
+                return;
+            concurrency::array<T, 1> in(int((std::min)(remaining, size_t(maxChunk))));
+            concurrency::array<T, 1> out(in.extent);
+
+            T carry = op.Identity();
+            while (remaining > 0)
+            {
+                const int count = int((std::min)(remaining, size_t(maxChunk)));
+                InIt chunkLast = first;
+                std::advance(chunkLast, count);
+                array_view<T, 1> inView = array_view<T, 1>(in).section(0, count);
+                array_view<T, 1> outView = array_view<T, 1>(out).section(0, count);
+                copy(first, chunkLast, inView);
+
+                ScanDecoupledSection<TileSize>(array_view<const T, 1>(inView), outView, op, exclusive, carry);
+                copy(outView, outFirst);
+
+                remaining -= count;
+                if (remaining > 0)
+                {
+                    T lastInput = op.Identity();
+                    T lastOutput;
+                    copy(inView.section(count - 1, 1), &lastInput);
+                    copy(outView.section(count - 1, 1), &lastOutput);
+                    carry = NextCarry(op, exclusive, lastInput, lastOutput);
+                    std::advance(outFirst, count);
+                }
+                first = chunkLast;
+            }
+        }
+    }
+
+    // The input and output may be the same array_view.
+
+    template <int TileSize, typename T, typename Op>
+    void PrescanAmpDecoupled(array_view<T, 1> input, array_view<T, 1> output, const Op& op)
+    {
+        details::ScanDecoupled<TileSize, T>(array_view<const T, 1>(input), output, op, true, op.Identity());
+    }
+
+    template <int TileSize, typename T>
+    void PrescanAmpDecoupled(array_view<T, 1> input, array_view<T, 1> output)
+    {
+        PrescanAmpDecoupled<TileSize>(input, output, SumOp<T>());
+    }
+
+    template <int TileSize, typename T, typename Op>
+    void ScanAmpDecoupled(array_view<T, 1> input, array_view<T, 1> output, const Op& op)
+    {
+        details::ScanDecoupled<TileSize, T>(array_view<const T, 1>(input), output, op, false, op.Identity());
+    }
+
+    template <int TileSize, typename T>
+    void ScanAmpDecoupled(array_view<T, 1> input, array_view<T, 1> output)
+    {
+        ScanAmpDecoupled<TileSize>(input, output, SumOp<T>());
+    }
+
+    // Exclusive scan, output element at i contains op applied to elements [0]...[i-1].
+
+    template <int TileSize, typename InIt, typename OutIt, typename Op>
+    inline void PrescanAmpDecoupled(InIt first, InIt last, OutIt outFirst, const Op& op)
+    {
+        details::ScanDecoupledRange<TileSize>(first, last, outFirst, op, true);
+    }
+
+    template <int TileSize, typename InIt, typename OutIt>
+    inline void PrescanAmpDecoupled(InIt first, InIt last, OutIt outFirst)
+    {
+        typedef typename std::iterator_traits<InIt>::value_type T;
+
+        details::ScanDecoupledRange<TileSize>(first, last, outFirst, SumOp<T>(), true);
+    }
+
+    // Inclusive scan, output element at i contains op applied to elements [0]...[i].
+
+    template <int TileSize, typename InIt, typename OutIt, typename Op>
+    inline void ScanAmpDecoupled(InIt first, InIt last, OutIt outFirst, const Op& op)
+    {
+        details::ScanDecoupledRange<TileSize>(first, last, outFirst, op, false);
+    }
+
+    template <int TileSize, typename InIt, typename OutIt>
+    inline void ScanAmpDecoupled(InIt first, InIt last, OutIt outFirst)
+    {
+        typedef typename std::iterator_traits<InIt>::value_type T;
+
+        details::ScanDecoupledRange<TileSize>(first, last, outFirst, SumOp<T>(), false);
+    }
+}
@@ -17,33 +17,72 @@
 #pragma once
 
 #include <amp.h>
+#include <iterator>
 #include <assert.h>
 
 using namespace concurrency;
 
 namespace Extras
 {
-    // Exclusive scan, output element at i contains the sum of elements [0]...[i-1].
+    // The scans take the same operators as Extras::Reduce, a type with an Identity() and an associative
+    // operator(), see ..\Reduction\Reduce.h. The sequential scans only need them to be callable on the
+    // CPU. Without an operator the elements are summed.
+    //
+    // The input is read one element ahead of the output so outFirst may equal first for an in-place scan.
+    // Both return the end of the output.
+
+    namespace details
+    {
+        template <typename T>
+        struct SequentialSumOp
+        {
+            T Identity() const { return T(0); }
+            T operator()(const T& a, const T& b) const { return a + b; }
+        };
+    }
+
+    // Exclusive scan, output element at i contains op applied to elements [0]...[i-1].
+
+    template <typename InIt, typename OutIt, typename Op>
+    OutIt Prescan(InIt first, InIt last, OutIt outFirst, const Op& op)
+    {
+        auto sum = op.Identity();
+        for (; first != last; ++first, ++outFirst)
+        {
+            const auto value = *first;
+            *outFirst = sum;
+            sum = op(sum, value);
+        }
+        return outFirst;
+    }
 
     template <typename InIt, typename OutIt>
-    void Prescan(InIt first, InIt last, OutIt outFirst)
+    OutIt Prescan(InIt first, InIt last, OutIt outFirst)
     {
-        typedef OutIt::value_type T;
+        typedef typename std::iterator_traits<InIt>::value_type T;
 
-        *outFirst = T(0);
-        for (int i = 1; i < std::distance(first, last); ++i)
-            outFirst[i] = first[i - 1] + outFirst[i - 1];
+        return Prescan(first, last, outFirst, details::SequentialSumOp<T>());
     }
 
-    // Inclusive scan, output element at i contains the sum of elements [0]...[i].
+    // Inclusive scan, output element at i contains op applied to elements [0]...[i].
+
+    template <typename InIt, typename OutIt, typename Op>
+    OutIt Scan(InIt first, InIt last, OutIt outFirst, const Op& op)
+    {
+        auto sum = op.Identity();
+        for (; first != last; ++first, ++outFirst)
+        {
+            sum = op(sum, *first);
+            *outFirst = sum;
+        }
+        return outFirst;
+    }
 
     template <typename InIt, typename OutIt>
-    void Scan(InIt first, InIt last, OutIt outFirst)
+    OutIt Scan(InIt first, InIt last, OutIt outFirst)
     {
-        typedef OutIt::value_type T;
+        typedef typename std::iterator_traits<InIt>::value_type T;
 
-        *outFirst = T(*first);
-        for (int i = 1; i < std::distance(first, last); ++i)
-            outFirst[i] = first[i] + outFirst[i - 1];
+        return Scan(first, last, outFirst, details::SequentialSumOp<T>());
     }
-}
\ No newline at end of file
+}
@@ -17,67 +17,136 @@
 #pragma once
 
 #include <amp.h>
+#include <iterator>
 #include <assert.h>
 
+#include "..\Reduction\Reduce.h"
+
 using namespace concurrency;
 
 namespace Extras
 {
     // http://www.csce.uark.edu/~mqhuang/courses/5013/f2011/lab/Lab-5-scan.pdf 
 
-    // Exclusive scan, output element at i contains the sum of elements [0]...[i-1].
+    namespace details
+    {
+        // Hillis and Steele scan, log2(n) passes over the whole array. The first pass reads the input and
+        // writes a temporary so the input and output may be the same array_view. An exclusive scan just
+        // shifts the input right by one as it's loaded, filling in the identity. Works for any length.
 
-    template <typename InIt, typename OutIt>
-    inline void PrescanAmpSimple(InIt first, InIt last, OutIt outFirst)
+        template <typename T, typename Op>
+        void ScanSimple(array_view<const T, 1> input, array_view<T, 1> output, const Op& op, bool exclusive)
+        {
+            assert(input.extent[0] == output.extent[0]);
+
+            const int size = input.extent[0];
+            if (size == 0)
+                return;
+            const int shift = exclusive ? 1 : 0;
+
+            array<T, 1> temp(size);
+            array_view<T, 1> in(temp);
+            array_view<T, 1> out(output);
+            bool inTemp = true;
+            in.discard_data();
+            parallel_for_each(input.extent, [=](index<1> idx) restrict (amp)
+            {
+                const int i = idx[0] - shift;
+                const T value = (i >= 0) ? input[i] : op.Identity();
+                in[idx] = (i >= 1) ? op(input[i - 1], value) : value;
+            });
+
+            for (int offset = 2; offset < size; offset *= 2)
+            {
+                out.discard_data();
+                parallel_for_each(input.extent, [=](index<1> idx) restrict (amp)
+                {
+                    if (idx[0] >= offset)
+                        out[idx] = op(in[idx - offset], in[idx]);
+                    else
+                        out[idx] = in[idx];
+                });
+                std::swap(in, out);
+                inTemp = !inTemp;
+            }
+
+            // The result is in whichever view was written last.
+            if (inTemp)
+                in.copy_to(output);
+        }
+    }
+
+    template <typename T, typename Op>
+    void PrescanAmpSimple(array_view<T, 1> input, array_view<T, 1> output, const Op& op)
     {
-        typedef InIt::value_type T;
+        details::ScanSimple(array_view<const T, 1>(input), output, op, true);
+    }
 
-        const int size = int(distance(first, last));
-        concurrency::array<T, 1> in(size);
-        concurrency::array<T, 1> out(size);
-        copy(first, last, in);
-        
-		ScanAmpSimple(array_view<T, 1>(in), array_view<T, 1>(out));
+    template <typename T>
+    void PrescanAmpSimple(array_view<T, 1> input, array_view<T, 1> output)
+    {
+        details::ScanSimple(array_view<const T, 1>(input), output, SumOp<T>(), true);
+    }
 
-		// Prescan is just an offset scan, so shift the results by one.
-        copy(out.section(0, size - 1), outFirst + 1);
-		*outFirst = T(0);
+    template <typename T, typename Op>
+    void ScanAmpSimple(array_view<T, 1> input, array_view<T, 1> output, const Op& op)
+    {
+        details::ScanSimple(array_view<const T, 1>(input), output, op, false);
     }
 
-    // Inclusive scan, output element at i contains the sum of elements [0]...[i].
+    template <typename T>
+    void ScanAmpSimple(array_view<T, 1> input, array_view<T, 1> output)
+    {
+        details::ScanSimple(array_view<const T, 1>(input), output, SumOp<T>(), false);
+    }
+
+    // Exclusive scan, output element at i contains op applied to elements [0]...[i-1].
+
+    template <typename InIt, typename OutIt, typename Op>
+    inline void PrescanAmpSimple(InIt first, InIt last, OutIt outFirst, const Op& op)
+    {
+        typedef typename std::iterator_traits<InIt>::value_type T;
+
+        const int size = int(std::distance(first, last));
+        if (size == 0)
+            return;
+        concurrency::array<T, 1> in(size, first, last);
+        concurrency::array<T, 1> out(size);
+
+        PrescanAmpSimple(array_view<T, 1>(in), array_view<T, 1>(out), op);
+        copy(out, outFirst);
+    }
 
     template <typename InIt, typename OutIt>
-    inline void ScanAmpSimple(InIt first, InIt last, OutIt outFirst)
+    inline void PrescanAmpSimple(InIt first, InIt last, OutIt outFirst)
+    {
+        typedef typename std::iterator_traits<InIt>::value_type T;
+
+        PrescanAmpSimple(first, last, outFirst, SumOp<T>());
+    }
+
+    // Inclusive scan, output element at i contains op applied to elements [0]...[i].
+
+    template <typename InIt, typename OutIt, typename Op>
+    inline void ScanAmpSimple(InIt first, InIt last, OutIt outFirst, const Op& op)
     {
-        typedef InIt::value_type T;
+        typedef typename std::iterator_traits<InIt>::value_type T;
 
-        const int size = int(distance(first, last));
-        concurrency::array<T, 1> in(size);
+        const int size = int(std::distance(first, last));
+        if (size == 0)
+            return;
+        concurrency::array<T, 1> in(size, first, last);
         concurrency::array<T, 1> out(size);
-        copy(first, last, in);
-        
-        ScanAmpSimple(array_view<T, 1>(in), array_view<T, 1>(out));
+
+        ScanAmpSimple(array_view<T, 1>(in), array_view<T, 1>(out), op);
         copy(out, outFirst);
     }
 
-    template <typename T>
-    void ScanAmpSimple(array_view<T, 1> input, array_view<T, 1> output)
+    template <typename InIt, typename OutIt>
+    inline void ScanAmpSimple(InIt first, InIt last, OutIt outFirst)
     {
-        assert(input.extent[0] == output.extent[0]);
+        typedef typename std::iterator_traits<InIt>::value_type T;
 
-        for (int offset = 1; offset < input.extent[0]; offset *= 2)
-        {
-            assert(input.extent[0] == output.extent[0]);
-            assert(input.extent[0] % 2 == 0);
-            output.discard_data();
-            parallel_for_each(input.extent, [=](index<1> idx) restrict (amp)
-            {
-                if (idx[0] >= offset)
-                    output[idx] = input[idx] + input[idx - offset];
-                else
-                    output[idx] = input[idx];
-            });
-            std::swap(input, output);
-        }
+        ScanAmpSimple(first, last, outFirst, SumOp<T>());
     }
 }
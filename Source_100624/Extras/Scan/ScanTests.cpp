@@ -19,6 +19,14 @@
 #include "ScanSimple.h"
 #include "ScanSequential.h"
 #include "ScanTiled.h"
+#include "ScanDecoupled.h"
+#include "ScanCpu.h"
+#include "SegmentedScan.h"
+#include "SummedAreaTable.h"
+#include "RunLength.h"
+#include "Merge.h"
+#include "RadixSort.h"
+#include "..\Reduction\Reduce.h"
 #include "Utilities.h"
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
@@ -33,6 +41,28 @@ namespace ScanTests
         return msg.str();
     }
 
+    // Composition of the affine maps x -> a * x + b modulo 2^16, a and b packed into the high and low
+    // halves. It's associative but not commutative so it checks the scans apply the operator in order.
+    struct AffineOp
+    {
+        unsigned Identity() const restrict(amp, cpu) { return 1u << 16; }
+        unsigned operator()(const unsigned& f, const unsigned& g) const restrict(amp, cpu)
+        {
+            const unsigned a = ((g >> 16) * (f >> 16)) & 0xFFFF;
+            const unsigned b = ((g >> 16) * (f & 0xFFFF) + (g & 0xFFFF)) & 0xFFFF;
+            return (a << 16) | b;
+        }
+    };
+
+    std::vector<unsigned> AffineInput(size_t size)
+    {
+        std::mt19937 rng(11);
+        std::vector<unsigned> input(size);
+        for (size_t i = 0; i < size; ++i)
+            input[i] = unsigned(rng());
+        return input;
+    }
+
 	TEST_CLASS(ScanTests)
 	{
 	public:
@@ -83,6 +113,22 @@ namespace ScanTests
 			std::vector<int> exp(begin(expected), end(expected));
             Assert::IsTrue(exp == result, Msg(exp, result).c_str());
 		}
+
+        TEST_METHOD(ScanTests_InPlaceMax)
+        {
+            std::vector<int> data(7);
+            data[0] = -5; data[1] = 3; data[2] = 1; data[3] = 8; data[4] = -2; data[5] = 8; data[6] = 9;
+            std::array<int, 7> expected = { -5, 3, 3, 8, 8, 8, 9 };
+
+            Scan(begin(data), end(data), begin(data), MaxOp<int>());
+
+            std::vector<int> exp(begin(expected), end(expected));
+            Assert::IsTrue(exp == data, Msg(exp, data).c_str());
+
+            Prescan(begin(data), end(data), begin(data), MaxOp<int>());
+            Assert::AreEqual(INT_MIN, data[0]);
+            Assert::AreEqual(8, data[6]);
+        }
 	};
 
 	TEST_CLASS(ScanAmpTests)
@@ -136,6 +182,27 @@ namespace ScanTests
             
             Assert::IsTrue(expected == result, Msg(expected, result).c_str());
 		}
+
+        TEST_METHOD(ScanAmpSimpleTests_AnyLength)
+        {
+            const int sizes[] = { 1, 2, 7, 1000 };
+            for (int size : sizes)
+            {
+                std::vector<int> input(size);
+                for (int i = 0; i < size; ++i)
+                    input[i] = (i * 37) % 11 - 5;
+                std::vector<int> result(input.size());
+                std::vector<int> expected(input.size());
+
+                Scan(begin(input), end(input), begin(expected));
+                ScanAmpSimple(begin(input), end(input), result.begin());
+                Assert::IsTrue(expected == result, Msg(expected, result).c_str());
+
+                Prescan(begin(input), end(input), begin(expected), MaxOp<int>());
+                PrescanAmpSimple(begin(input), end(input), result.begin(), MaxOp<int>());
+                Assert::IsTrue(expected == result, Msg(expected, result).c_str());
+            }
+        }
 	};
 
     TEST_CLASS(ScanAmpTiledTests)
@@ -189,5 +256,581 @@ namespace ScanTests
             
             Assert::IsTrue(expected == result, Msg(expected, result).c_str());
 		}
+
+        TEST_METHOD(ScanAmpTiledTests_InPlaceAnyLength)
+        {
+            // 1001 elements need three levels of 8 element tiles, none of them full.
+            std::vector<int> data(1001);
+            for (size_t i = 0; i < data.size(); ++i)
+                data[i] = int(i % 5) - 2;
+            std::vector<int> expected(data.size());
+            Prescan(begin(data), end(data), begin(expected));
+
+            array_view<int, 1> av(int(data.size()), data);
+            PrescanAmpTiled<8>(av, av);
+            av.synchronize();
+
+            Assert::IsTrue(expected == data, Msg(expected, data).c_str());
+        }
+
+        TEST_METHOD(ScanAmpTiledTests_NonCommutative)
+        {
+            const std::vector<unsigned> input = AffineInput(777);
+            std::vector<unsigned> result(input.size());
+            std::vector<unsigned> expected(input.size());
+
+            Scan(begin(input), end(input), begin(expected), AffineOp());
+            ScanAmpTiled<16>(begin(input), end(input), result.begin(), AffineOp());
+            Assert::IsTrue(expected == result);
+
+            Prescan(begin(input), end(input), begin(expected), AffineOp());
+            PrescanAmpTiled<16>(begin(input), end(input), result.begin(), AffineOp());
+            Assert::IsTrue(expected == result);
+        }
 	};
+
+    TEST_CLASS(ScanAmpDecoupledTests)
+    {
+    public:
+
+        TEST_METHOD(PrescanAmpDecoupledTests_Simple)
+        {
+            std::vector<int> input(8, 1);
+            std::vector<int> result(input.size());
+            std::vector<int> expected(input.size());
+            std::iota(begin(expected), end(expected), 0);
+
+            PrescanAmpDecoupled<4>(begin(input), end(input), result.begin());
+
+            Assert::IsTrue(expected == result, Msg(expected, result).c_str());
+        }
+
+        TEST_METHOD(ScanAmpDecoupledTests_Complex)
+        {
+            std::array<int, 8> input =    { 1, 3,  6,  2,  7,  9,  0,  5 };
+            std::vector<int> result(8);
+            std::array<int, 8> expected = { 1, 4, 10, 12, 19, 28, 28, 33 };
+
+            ScanAmpDecoupled<4>(begin(input), end(input), result.begin());
+
+            std::vector<int> exp(begin(expected), end(expected));
+            Assert::IsTrue(exp == result, Msg(exp, result).c_str());
+        }
+
+        TEST_METHOD(ScanAmpDecoupledTests_LargeManyTiles)
+        {
+            // Not a multiple of the tile's element count, so the last tile is partly empty.
+            std::vector<int> input(100003);
+            for (size_t i = 0; i < input.size(); ++i)
+                input[i] = int(i % 7) - 3;
+            std::vector<int> result(input.size());
+            std::vector<int> expected(input.size());
+            std::partial_sum(begin(input), end(input), begin(expected));
+
+            ScanAmpDecoupled<32>(begin(input), end(input), result.begin());
+            Assert::IsTrue(expected == result, Msg(expected, result).c_str());
+
+            ScanAmpDecoupled<256>(begin(input), end(input), result.begin());
+            Assert::IsTrue(expected == result, Msg(expected, result).c_str());
+        }
+
+        TEST_METHOD(ScanAmpDecoupledTests_InPlaceFloat)
+        {
+            std::vector<float> data(5000, 0.5f);
+            array_view<float, 1> av(int(data.size()), data);
+
+            PrescanAmpDecoupled<64>(av, av);
+            av.synchronize();
+
+            for (size_t i = 0; i < data.size(); ++i)
+                Assert::AreEqual(0.5f * i, data[i]);
+        }
+
+        TEST_METHOD(ScanAmpDecoupledTests_NonCommutative)
+        {
+            const std::vector<unsigned> input = AffineInput(20001);
+            std::vector<unsigned> result(input.size());
+            std::vector<unsigned> expected(input.size());
+
+            Scan(begin(input), end(input), begin(expected), AffineOp());
+            ScanAmpDecoupled<32>(begin(input), end(input), result.begin(), AffineOp());
+            Assert::IsTrue(expected == result);
+
+            Prescan(begin(input), end(input), begin(expected), AffineOp());
+            PrescanAmpDecoupled<32>(begin(input), end(input), result.begin(), AffineOp());
+            Assert::IsTrue(expected == result);
+        }
+    };
+    // Segment lengths cycling through empty, short and longer than several tiles.
+    std::vector<int> MakeSegmentOffsets(int elementCount)
+    {
+        const int lengths[] = { 3, 0, 1, 70, 0, 0, 5, 300, 2, 16 };
+        std::vector<int> offsets(1, 0);
+        for (int s = 0; offsets.back() < elementCount; ++s)
+            offsets.push_back((std::min)(elementCount, offsets.back() + lengths[s % 10]));
+        return offsets;
+    }
+
+    template <typename Op>
+    std::vector<int> ReferenceSegmentedScan(const std::vector<int>& input, const std::vector<int>& offsets, const Op& op, bool exclusive)
+    {
+        std::vector<int> result(input.size());
+        for (size_t s = 0; s + 1 < offsets.size(); ++s)
+        {
+            if (exclusive)
+                Prescan(begin(input) + offsets[s], begin(input) + offsets[s + 1], begin(result) + offsets[s], op);
+            else
+                Scan(begin(input) + offsets[s], begin(input) + offsets[s + 1], begin(result) + offsets[s], op);
+        }
+        return result;
+    }
+
+    TEST_CLASS(SegmentedScanTests)
+    {
+    public:
+
+        TEST_METHOD(SegmentedScanTests_HeadFlags)
+        {
+            std::vector<int> input(5000);
+            for (size_t i = 0; i < input.size(); ++i)
+                input[i] = int(i % 13) - 6;
+            const std::vector<int> offsets = MakeSegmentOffsets(int(input.size()));
+            std::vector<int> flags(input.size(), 0);
+            for (size_t s = 0; s + 1 < offsets.size(); ++s)
+            {
+                if (offsets[s] < int(input.size()))
+                    flags[offsets[s]] = 1;
+            }
+            std::vector<int> result(input.size());
+            array_view<int, 1> inputView(int(input.size()), input);
+            array_view<int, 1> flagsView(int(flags.size()), flags);
+            array_view<int, 1> resultView(int(result.size()), result);
+
+            std::vector<int> expected = ReferenceSegmentedScan(input, offsets, SumOp<int>(), false);
+            SegmentedScanAmp<32>(inputView, flagsView, resultView);
+            resultView.synchronize();
+            Assert::IsTrue(expected == result, Msg(expected, result).c_str());
+
+            expected = ReferenceSegmentedScan(input, offsets, SumOp<int>(), true);
+            SegmentedPrescanAmp<32>(inputView, flagsView, resultView);
+            resultView.synchronize();
+            Assert::IsTrue(expected == result, Msg(expected, result).c_str());
+        }
+
+        TEST_METHOD(SegmentedScanTests_OffsetsInPlaceMax)
+        {
+            std::vector<int> data(3001);
+            for (size_t i = 0; i < data.size(); ++i)
+                data[i] = int((i * 7919) % 101) - 50;
+            std::vector<int> offsets = MakeSegmentOffsets(int(data.size()));
+            std::vector<int> expected = ReferenceSegmentedScan(data, offsets, MaxOp<int>(), true);
+            array_view<int, 1> dataView(int(data.size()), data);
+            array_view<int, 1> offsetsView(int(offsets.size()), offsets);
+
+            SegmentedPrescanAmpOffsets<64>(dataView, offsetsView, dataView, MaxOp<int>());
+            dataView.synchronize();
+
+            Assert::IsTrue(expected == data, Msg(expected, data).c_str());
+        }
+    };
+
+    TEST_CLASS(ScanCpuTests)
+    {
+    public:
+
+        TEST_METHOD(ScanCpuTests_SimdAnyLength)
+        {
+            const size_t sizes[] = { 0, 1, 15, 16, 17, 1003 };
+            for (size_t size : sizes)
+            {
+                std::vector<int> input(size);
+                for (size_t i = 0; i < size; ++i)
+                    input[i] = int(i % 9) - 4;
+                std::vector<int> result(size);
+                std::vector<int> expected(size);
+
+                Scan(begin(input), end(input), begin(expected));
+                ScanSimd(input.data(), result.data(), size);
+                Assert::IsTrue(expected == result, Msg(expected, result).c_str());
+
+                Prescan(begin(input), end(input), begin(expected));
+                PrescanSimd(input.data(), result.data(), size);
+                Assert::IsTrue(expected == result, Msg(expected, result).c_str());
+            }
+        }
+
+        TEST_METHOD(ScanCpuTests_ParallelInPlace)
+        {
+            // Several steps of blocks, with a partial step at the end.
+            std::mt19937 rng(7);
+            std::vector<int> data(1000003);
+            for (size_t i = 0; i < data.size(); ++i)
+                data[i] = int(rng());
+            // The sums overflow, so compute the expected wrapped values without signed overflow.
+            std::vector<int> expected(data.size());
+            unsigned sum = 0;
+            for (size_t i = 0; i < data.size(); ++i)
+            {
+                expected[i] = int(sum);
+                sum += unsigned(data[i]);
+            }
+
+            PrescanParallel(data.data(), data.data(), data.size());
+
+            Assert::IsTrue(expected == data);
+        }
+
+        TEST_METHOD(ScanCpuTests_ParallelFloat)
+        {
+            // Small integers so every partial sum is exact whatever the order of the additions.
+            std::vector<float> input(300001);
+            for (size_t i = 0; i < input.size(); ++i)
+                input[i] = float(int(i % 7) - 3);
+            std::vector<float> result(input.size());
+            std::vector<float> expected(input.size());
+            Scan(begin(input), end(input), begin(expected));
+
+            ScanParallel(input.data(), result.data(), input.size());
+
+            Assert::IsTrue(expected == result);
+        }
+    };
+
+    TEST_CLASS(SummedAreaTableTests)
+    {
+    public:
+
+        TEST_METHOD(SummedAreaTableTests_RectangleSums)
+        {
+            // Wider than one strip, with padding at the end of each row.
+            const int width = 1500;
+            const int height = 37;
+            const size_t stride = 1504;
+            std::vector<unsigned char> image(stride * height);
+            for (size_t i = 0; i < image.size(); ++i)
+                image[i] = (unsigned char)((i * 7919) % 256);
+            SummedAreaTable<long long> table;
+            table.Build(image.data(), width, height, stride);
+
+            std::mt19937 rng(23);
+            for (int n = 0; n < 200; ++n)
+            {
+                int x0 = int(rng() % (width + 1)), x1 = int(rng() % (width + 1));
+                int y0 = int(rng() % (height + 1)), y1 = int(rng() % (height + 1));
+                if (x1 < x0) std::swap(x0, x1);
+                if (y1 < y0) std::swap(y0, y1);
+                long long expected = 0;
+                for (int y = y0; y < y1; ++y)
+                    for (int x = x0; x < x1; ++x)
+                        expected += image[y * stride + x];
+                Assert::AreEqual(expected, table.Sum(x0, y0, x1, y1));
+            }
+        }
+
+        TEST_METHOD(SummedAreaTableTests_BoxFilterAndStatistics)
+        {
+            const int width = 50;
+            const int height = 30;
+            const int radius = 3;
+            std::vector<float> image(width * height);
+            for (size_t i = 0; i < image.size(); ++i)
+                image[i] = float(i % 11);
+            SummedAreaTable<double> sums;
+            SummedAreaTable<double> squares;
+            sums.Build(image.data(), width, height, width);
+            squares.BuildSquares(image.data(), width, height, width);
+
+            std::vector<float> box(image.size());
+            std::vector<float> mean(image.size());
+            std::vector<float> variance(image.size());
+            BoxFilter(sums, radius, box.data(), width);
+            LocalStatistics(sums, squares, radius, mean.data(), variance.data(), width);
+
+            for (int y = 0; y < height; ++y)
+            {
+                for (int x = 0; x < width; ++x)
+                {
+                    double sum = 0.0, sumSquares = 0.0;
+                    int count = 0;
+                    for (int v = (std::max)(0, y - radius); v <= (std::min)(height - 1, y + radius); ++v)
+                    {
+                        for (int u = (std::max)(0, x - radius); u <= (std::min)(width - 1, x + radius); ++u)
+                        {
+                            sum += image[v * width + u];
+                            sumSquares += image[v * width + u] * image[v * width + u];
+                            ++count;
+                        }
+                    }
+                    const double m = sum / count;
+                    Assert::AreEqual(float(m), box[y * width + x], 1e-4f);
+                    Assert::AreEqual(float(m), mean[y * width + x], 1e-4f);
+                    Assert::AreEqual(float(sumSquares / count - m * m), variance[y * width + x], 1e-3f);
+                }
+            }
+        }
+    };
+
+    TEST_CLASS(RunLengthTests)
+    {
+    public:
+
+        TEST_METHOD(RunLengthTests_BytesRoundTrip)
+        {
+            // Runs from one element to several chunks long.
+            std::vector<unsigned char> input;
+            std::mt19937 rng(29);
+            while (input.size() < 1000000)
+            {
+                const size_t length = (rng() % 50 == 0) ? 200000 : 1 + rng() % 20;
+                input.insert(end(input), length, (unsigned char)(rng() % 3));
+            }
+            std::vector<unsigned char> expectedValues;
+            std::vector<unsigned> expectedLengths;
+            for (size_t i = 0; i < input.size(); ++i)
+            {
+                if (i == 0 || input[i] != input[i - 1])
+                {
+                    expectedValues.push_back(input[i]);
+                    expectedLengths.push_back(0);
+                }
+                ++expectedLengths.back();
+            }
+
+            std::vector<unsigned char> values;
+            std::vector<unsigned> lengths;
+            RunLengthEncode(input.data(), input.size(), values, lengths);
+            Assert::IsTrue(expectedValues == values);
+            Assert::IsTrue(expectedLengths == lengths);
+
+            std::vector<unsigned char> decoded;
+            RunLengthDecode(values, lengths, decoded);
+            Assert::IsTrue(input == decoded);
+        }
+
+        TEST_METHOD(RunLengthTests_FloatBitsAndEdgeCases)
+        {
+            std::vector<float> input(10, 1.0f);
+            input[3] = -0.0f;
+            input[4] = 0.0f;
+            input[5] = std::numeric_limits<float>::quiet_NaN();
+            input[6] = input[5];
+            std::vector<float> values;
+            std::vector<int> lengths;
+
+            RunLengthEncode(input.data(), input.size(), values, lengths);
+            Assert::AreEqual(size_t(5), values.size());
+            Assert::AreEqual(2, lengths[3]);
+
+            std::vector<float> decoded;
+            RunLengthDecode(values, lengths, decoded);
+            Assert::AreEqual(0, memcmp(input.data(), decoded.data(), input.size() * sizeof(float)));
+
+            RunLengthEncode(input.data(), 0, values, lengths);
+            RunLengthDecode(values, lengths, decoded);
+            Assert::IsTrue(values.empty() && decoded.empty());
+        }
+
+        TEST_METHOD(RunLengthTests_RunsLongerThanLengthType)
+        {
+            // A 300 element run needs two unsigned char lengths, the 255 element run exactly one.
+            std::vector<int> input(300, 7);
+            input.insert(end(input), 255, 8);
+            input.push_back(9);
+            std::vector<int> values;
+            std::vector<unsigned char> lengths;
+
+            RunLengthEncode(input.data(), input.size(), values, lengths);
+            const int expectedValues[] = { 7, 7, 8, 9 };
+            const unsigned char expectedLengths[] = { 255, 45, 255, 1 };
+            Assert::IsTrue(std::vector<int>(std::begin(expectedValues), std::end(expectedValues)) == values);
+            Assert::IsTrue(std::vector<unsigned char>(std::begin(expectedLengths), std::end(expectedLengths)) == lengths);
+
+            std::vector<int> decoded;
+            RunLengthDecode(values, lengths, decoded);
+            Assert::IsTrue(input == decoded);
+
+            // Runs crossing chunk boundaries, the encoder only learns their length from a later chunk.
+            std::vector<int> large(3 * kRunLengthChunkSize + 1000, 1);
+            large[kRunLengthChunkSize / 2] = 2;
+            RunLengthEncode(large.data(), large.size(), values, lengths);
+            size_t total = 0;
+            for (size_t r = 0; r < lengths.size(); ++r)
+                total += lengths[r];
+            Assert::AreEqual(large.size(), total);
+            RunLengthDecode(values, lengths, decoded);
+            Assert::IsTrue(large == decoded);
+        }
+
+        TEST_METHOD(RunLengthTests_SizeTLengthsRoundTrip)
+        {
+            // The max of size_t is SIZE_MAX, counting entries per run must not overflow.
+            std::vector<short> input(2 * kRunLengthChunkSize + 17, 3);
+            input.insert(end(input), 2, 4);
+            input.push_back(5);
+            std::vector<short> values;
+            std::vector<size_t> lengths;
+
+            RunLengthEncode(input.data(), input.size(), values, lengths);
+            const short expectedValues[] = { 3, 4, 5 };
+            const size_t expectedLengths[] = { 2 * kRunLengthChunkSize + 17, 2, 1 };
+            Assert::IsTrue(std::vector<short>(std::begin(expectedValues), std::end(expectedValues)) == values);
+            Assert::IsTrue(std::vector<size_t>(std::begin(expectedLengths), std::end(expectedLengths)) == lengths);
+
+            std::vector<short> decoded;
+            RunLengthDecode(values, lengths, decoded);
+            Assert::IsTrue(input == decoded);
+        }
+    };
+
+    typedef std::pair<int, int> KeyIndex;
+
+    bool KeyLess(const KeyIndex& a, const KeyIndex& b)
+    {
+        return a.first < b.first;
+    }
+
+    TEST_CLASS(MergeTests)
+    {
+    public:
+
+        TEST_METHOD(MergeTests_ParallelMergeIsStable)
+        {
+            // Few distinct keys so most comparisons are ties, the second member records the input.
+            std::mt19937 rng(31);
+            std::vector<KeyIndex> first(150000);
+            std::vector<KeyIndex> second(90001);
+            for (size_t i = 0; i < first.size(); ++i)
+                first[i] = KeyIndex(int(rng() % 100), 0);
+            for (size_t i = 0; i < second.size(); ++i)
+                second[i] = KeyIndex(int(rng() % 100), 1);
+            std::sort(begin(first), end(first), KeyLess);
+            std::sort(begin(second), end(second), KeyLess);
+            std::vector<KeyIndex> expected(first.size() + second.size());
+            std::merge(begin(first), end(first), begin(second), end(second), begin(expected), KeyLess);
+
+            std::vector<KeyIndex> result(expected.size());
+            ParallelMerge(begin(first), end(first), begin(second), end(second), begin(result), KeyLess);
+
+            Assert::IsTrue(expected == result);
+        }
+
+        TEST_METHOD(MergeTests_MergeK)
+        {
+            std::vector<std::vector<int>> inputs(7);
+            std::vector<int> expected;
+            for (size_t k = 0; k < inputs.size(); ++k)
+            {
+                // One empty input and one much longer than the others.
+                const size_t size = (k == 2) ? 0 : (k == 5) ? 200000 : 1000 * k + 3;
+                for (size_t i = 0; i < size; ++i)
+                    inputs[k].push_back(int((i * 2654435761u + k) % 100000));
+                std::sort(begin(inputs[k]), end(inputs[k]));
+                expected.insert(end(expected), begin(inputs[k]), end(inputs[k]));
+            }
+            std::sort(begin(expected), end(expected));
+
+            std::vector<int> result;
+            ParallelMergeK(inputs, result);
+
+            Assert::IsTrue(expected == result);
+        }
+
+        TEST_METHOD(MergeTests_MergeSortCustomComparator)
+        {
+            std::mt19937 rng(37);
+            std::vector<KeyIndex> data(500001);
+            for (size_t i = 0; i < data.size(); ++i)
+                data[i] = KeyIndex(int(rng() % 5000), int(i));
+            std::vector<KeyIndex> expected(data);
+            std::stable_sort(begin(expected), end(expected), KeyLess);
+
+            ParallelMergeSort(data.data(), data.size(), KeyLess);
+
+            Assert::IsTrue(expected == data);
+        }
+    };
+
+    TEST_CLASS(RadixSortTests)
+    {
+    public:
+
+        TEST_METHOD(RadixSortTests_Int)
+        {
+            std::mt19937 rng(17);
+            std::vector<int> data(300001);
+            for (size_t i = 0; i < data.size(); ++i)
+                data[i] = int(rng());
+            data[0] = INT_MIN;
+            data[1] = INT_MAX;
+            std::vector<int> expected(data);
+            std::sort(begin(expected), end(expected));
+
+            RadixSort(data.data(), data.size());
+
+            Assert::IsTrue(expected == data);
+        }
+
+        TEST_METHOD(RadixSortTests_Unsigned64)
+        {
+            std::mt19937_64 rng(5);
+            std::vector<unsigned long long> data(100000);
+            for (size_t i = 0; i < data.size(); ++i)
+                data[i] = rng();
+            std::vector<unsigned long long> expected(data);
+            std::sort(begin(expected), end(expected));
+
+            RadixSort(data.data(), data.size());
+
+            Assert::IsTrue(expected == data);
+        }
+
+        TEST_METHOD(RadixSortTests_FloatAndDouble)
+        {
+            std::mt19937 rng(3);
+            std::uniform_real_distribution<float> dist(-1000.0f, 1000.0f);
+            std::vector<float> data(200000);
+            for (size_t i = 0; i < data.size(); ++i)
+                data[i] = dist(rng);
+            data[0] = std::numeric_limits<float>::infinity();
+            data[1] = -std::numeric_limits<float>::infinity();
+            data[2] = 0.0f;
+            data[3] = std::numeric_limits<float>::denorm_min();
+            data[4] = -std::numeric_limits<float>::denorm_min();
+            std::vector<double> doubles(begin(data), end(data));
+            std::vector<float> expected(data);
+            std::sort(begin(expected), end(expected));
+            std::vector<double> expectedDoubles(begin(expected), end(expected));
+
+            RadixSort(data.data(), data.size());
+            RadixSort(doubles.data(), doubles.size());
+
+            Assert::IsTrue(expected == data);
+            Assert::IsTrue(expectedDoubles == doubles);
+        }
+
+        TEST_METHOD(RadixSortTests_KeyValueIsStable)
+        {
+            // Only the low byte varies so the upper passes are skipped.
+            std::vector<unsigned> keys(250000);
+            std::vector<int> values(keys.size());
+            for (size_t i = 0; i < keys.size(); ++i)
+            {
+                keys[i] = unsigned(i * 7919) % 13;
+                values[i] = int(i);
+            }
+            std::vector<std::pair<unsigned, int>> expected(keys.size());
+            for (size_t i = 0; i < keys.size(); ++i)
+                expected[i] = std::make_pair(keys[i], values[i]);
+            std::stable_sort(begin(expected), end(expected),
+                [](const std::pair<unsigned, int>& a, const std::pair<unsigned, int>& b) { return a.first < b.first; });
+
+            RadixSort(keys.data(), values.data(), keys.size());
+
+            for (size_t i = 0; i < keys.size(); ++i)
+            {
+                Assert::AreEqual(expected[i].first, keys[i]);
+                Assert::AreEqual(expected[i].second, values[i]);
+            }
+        }
+    };
 }
@@ -17,90 +17,34 @@
 #pragma once
 
 #include <amp.h>
+#include <iterator>
 #include <assert.h>
 
+#include "..\Reduction\Reduce.h"
+
 using namespace concurrency;
 
 namespace Extras
 {
-    // Exclusive scan, output element at i contains the sum of elements [0]...[i-1].
-
-    template <int TileSize, typename InIt, typename OutIt>
-    inline void PrescanAmpTiled(InIt first, InIt last, OutIt outFirst)
-    {
-        typedef InIt::value_type T;
-
-        const int size = int(distance(first, last));
-        concurrency::array<T, 1> in(size);
-        concurrency::array<T, 1> out(size);
-        copy(first, last, in);
-        
-		ScanAmpTiled<TileSize>(array_view<T, 1>(in), array_view<T, 1>(out));
-
-		// Prescan is just an offset scan, so shift the results by one.
-        copy(out.section(0, size - 1), outFirst + 1);
-		*outFirst = T(0);
-    }
-
-    // Inclusive scan, output element at i contains the sum of elements [0]...[i].
-
-    template <int TileSize, typename InIt, typename OutIt>
-    inline void ScanAmpTiled(InIt first, InIt last, OutIt outFirst)
-    {
-        typedef InIt::value_type T;
-
-        const int size = int(distance(first, last));
-        concurrency::array<T, 1> in(size);
-        concurrency::array<T, 1> out(size);
-        copy(first, last, in);
-        
-        ScanAmpTiled<TileSize>(array_view<T, 1>(in), array_view<T, 1>(out));
-        copy(out, outFirst);
-    }
-
-    template <int TileSize, typename T>
-    void ScanAmpTiled(array_view<T, 1> input, array_view<T, 1> output)
+    namespace details
     {
-        assert(input.extent[0] == output.extent[0]);
-
-        const int elementCount = input.extent[0];
-        const int tileCount = (elementCount + TileSize - 1) / TileSize;
-
-        // Compute tile-wise scans and reductions.
-        array<T> tileSums(tileCount);
-        details::ComputeTilewiseScan<TileSize>(array_view<const T>(input), array_view<T>(output), array_view<T>(tileSums));
-
-        // recurse if necessary
-        if (tileCount >  1)
+        void Switch(int& index1, int& index2) restrict(amp, cpu)
         {
-            array<T> tmp(tileSums.extent);
-            ScanAmpTiled<TileSize>(array_view<T>(tileSums), array_view<T>(tmp));
-            copy(tmp, tileSums);
-
-            if (elementCount > 0) 
-            {
-                parallel_for_each(extent<1>(elementCount), [=, &tileSums] (concurrency::index<1> idx) restrict (amp) 
-                {
-                    int tileIdx = idx[0] / TileSize;
-                    if (tileIdx == 0)
-                        output[idx] = output[idx];
-                    else
-                        output[idx] = tileSums[tileIdx - 1] + output[idx];
-                });
-            }
+            index1 = 1 - index1;
+            index2 = 1 - index2;
         }
-    }
 
-    namespace details
-    {
-        // For each tile calculate the exclusive scan.
+        // For each tile calculate the inclusive or exclusive scan and the tile's total. Elements past the
+        // end of the input are treated as the identity so the length needn't be a multiple of TileSize.
+        // Each tile reads all its input before writing any output so the two may be the same array_view.
 
-        template <int TileSize, typename T>
-        void ComputeTilewiseScan(array_view<const T> input, array_view<T> tilewiseOutput, array_view<T> tileSums)
+        template <int TileSize, typename T, typename Op>
+        void ComputeTilewiseScan(array_view<const T> input, array_view<T> tilewiseOutput, array_view<T> tileSums, const Op& op, bool exclusive)
         {
             const int elementCount = input.extent[0];
             const int tileCount = (elementCount + TileSize - 1) / TileSize;
             const int threadCount = tileCount * TileSize;
+            const int isExclusive = exclusive ? 1 : 0;
 
             parallel_for_each(extent<1>(threadCount).tile<TileSize>(), [=](tiled_index<TileSize> tidx) restrict(amp) 
             {
@@ -111,40 +55,139 @@ namespace Extras
                 int inIdx = 0;
                 int outIdx = 1;
                 // Do the first pass (offset = 1) while loading elements into tile_static memory.
-                if (globid < elementCount)
-                {
-                    if (tid >= 1)
-                        tile[outIdx][tid] = input[globid - 1] + input[globid];
-                    else 
-                        tile[outIdx][tid] = input[globid];
-                }
+                const T value = (globid < elementCount) ? input[globid] : op.Identity();
+                if (tid >= 1 && globid <= elementCount)
+                    tile[outIdx][tid] = op(input[globid - 1], value);
+                else 
+                    tile[outIdx][tid] = value;
                 tidx.barrier.wait();
 
                 for (int offset = 2; offset < TileSize; offset *= 2)
                 {
                     Switch(inIdx, outIdx);
 
-                    if (globid < elementCount) 
-                    {
-                        if (tid >= offset)
-                            tile[outIdx][tid] = tile[inIdx][tid - offset] + tile[inIdx][tid];
-                        else 
-                            tile[outIdx][tid] = tile[inIdx][tid];
-                    }
+                    if (tid >= offset)
+                        tile[outIdx][tid] = op(tile[inIdx][tid - offset], tile[inIdx][tid]);
+                    else 
+                        tile[outIdx][tid] = tile[inIdx][tid];
                     tidx.barrier.wait();
                 }
                 if (globid < elementCount)
-                    tilewiseOutput[globid] = tile[outIdx][tid];
+                {
+                    if (isExclusive)
+                        tilewiseOutput[globid] = (tid >= 1) ? tile[outIdx][tid - 1] : op.Identity();
+                    else
+                        tilewiseOutput[globid] = tile[outIdx][tid];
+                }
                 // Last thread in tile updates the tileSums.
                 if (tid == TileSize - 1)
                     tileSums[tidx.tile[0]] = tile[outIdx][tid];
             });
         }
 
-        void Switch(int& index1, int& index2) restrict(amp, cpu)
+        template <int TileSize, typename T, typename Op>
+        void ScanTiled(array_view<const T, 1> input, array_view<T, 1> output, const Op& op, bool exclusive)
         {
-            index1 = 1 - index1;
-            index2 = 1 - index2;
+            assert(input.extent[0] == output.extent[0]);
+
+            const int elementCount = input.extent[0];
+            if (elementCount == 0)
+                return;
+            const int tileCount = (elementCount + TileSize - 1) / TileSize;
+
+            // Compute tile-wise scans and reductions.
+            array<T> tileSums(tileCount);
+            array_view<T> sums(tileSums);
+            ComputeTilewiseScan<TileSize>(input, output, sums, op, exclusive);
+
+            // Recurse if necessary, an exclusive scan of the tile sums gives each tile's prefix.
+            if (tileCount > 1)
+            {
+                ScanTiled<TileSize>(array_view<const T, 1>(sums), sums, op, true);
+
+                parallel_for_each(extent<1>(elementCount), [=] (concurrency::index<1> idx) restrict (amp) 
+                {
+                    const int tileIdx = idx[0] / TileSize;
+                    if (tileIdx > 0)
+                        output[idx] = op(sums[tileIdx], output[idx]);
+                });
+            }
         }
     }
+
+    // The input and output may be the same array_view.
+
+    template <int TileSize, typename T, typename Op>
+    void PrescanAmpTiled(array_view<T, 1> input, array_view<T, 1> output, const Op& op)
+    {
+        details::ScanTiled<TileSize>(array_view<const T, 1>(input), output, op, true);
+    }
+
+    template <int TileSize, typename T>
+    void PrescanAmpTiled(array_view<T, 1> input, array_view<T, 1> output)
+    {
+        details::ScanTiled<TileSize>(array_view<const T, 1>(input), output, SumOp<T>(), true);
+    }
+
+    template <int TileSize, typename T, typename Op>
+    void ScanAmpTiled(array_view<T, 1> input, array_view<T, 1> output, const Op& op)
+    {
+        details::ScanTiled<TileSize>(array_view<const T, 1>(input), output, op, false);
+    }
+
+    template <int TileSize, typename T>
+    void ScanAmpTiled(array_view<T, 1> input, array_view<T, 1> output)
+    {
+        details::ScanTiled<TileSize>(array_view<const T, 1>(input), output, SumOp<T>(), false);
+    }
+
+    // Exclusive scan, output element at i contains op applied to elements [0]...[i-1].
+
+    template <int TileSize, typename InIt, typename OutIt, typename Op>
+    inline void PrescanAmpTiled(InIt first, InIt last, OutIt outFirst, const Op& op)
+    {
+        typedef typename std::iterator_traits<InIt>::value_type T;
+
+        const int size = int(std::distance(first, last));
+        if (size == 0)
+            return;
+        concurrency::array<T, 1> in(size, first, last);
+        concurrency::array<T, 1> out(size);
+
+        PrescanAmpTiled<TileSize>(array_view<T, 1>(in), array_view<T, 1>(out), op);
+        copy(out, outFirst);
+    }
+
+    template <int TileSize, typename InIt, typename OutIt>
+    inline void PrescanAmpTiled(InIt first, InIt last, OutIt outFirst)
+    {
+        typedef typename std::iterator_traits<InIt>::value_type T;
+
+        PrescanAmpTiled<TileSize>(first, last, outFirst, SumOp<T>());
+    }
+
+    // Inclusive scan, output element at i contains op applied to elements [0]...[i].
+
+    template <int TileSize, typename InIt, typename OutIt, typename Op>
+    inline void ScanAmpTiled(InIt first, InIt last, OutIt outFirst, const Op& op)
+    {
+        typedef typename std::iterator_traits<InIt>::value_type T;
+
+        const int size = int(std::distance(first, last));
+        if (size == 0)
+            return;
+        concurrency::array<T, 1> in(size, first, last);
+        concurrency::array<T, 1> out(size);
+
+        ScanAmpTiled<TileSize>(array_view<T, 1>(in), array_view<T, 1>(out), op);
+        copy(out, outFirst);
+    }
+
+    template <int TileSize, typename InIt, typename OutIt>
+    inline void ScanAmpTiled(InIt first, InIt last, OutIt outFirst)
+    {
+        typedef typename std::iterator_traits<InIt>::value_type T;
+
+        ScanAmpTiled<TileSize>(first, last, outFirst, SumOp<T>());
+    }
 }
@@ -0,0 +1,195 @@
+//===============================================================================
+//
+// Microsoft Press
+// C++ AMP: Accelerated Massive Parallelism with Microsoft Visual C++
+//
+//===============================================================================
+// Copyright (c) 2012 Ade Miller & Kate Gregory.  All rights reserved.
+// This code released under the terms of the 
+// Microsoft Public License (Ms-PL), http://ampbook.codeplex.com/license.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//===============================================================================
+
+#pragma once
+
+#include <amp.h>
+#include <assert.h>
+
+#include "..\Reduction\Reduce.h"
+#include "ScanTiled.h"
+
+using namespace concurrency;
+
+namespace Extras
+{
+    // Segmented scans, many independent scans over consecutive segments of one array, such as the rows of
+    // a CSR matrix. Segments are given either as head flags, a non-zero flag marks the first element of a
+    // segment, or as offsets, offsets[s] is the index of the first element of segment s and offsets has
+    // one more entry than there are segments, so empty segments are allowed.
+    //
+    // Each element is paired with its flag and the pairs are scanned with ScanAmpTiled using the segmented
+    // operator, (fa, a) * (fb, b) = (fa | fb, fb ? b : a * b), which is associative whenever the operator
+    // is. That's one scan over the whole array whatever the segment lengths, so the work is balanced across
+    // tiles even when a few segments hold most of the elements.
+
+    namespace details
+    {
+        template <typename T>
+        struct FlaggedValue
+        {
+            int flag;
+            T value;
+        };
+
+        template <typename T, typename Op>
+        struct SegmentedOp
+        {
+            Op op;
+
+            explicit SegmentedOp(const Op& o) : op(o) { }
+
+            FlaggedValue<T> Identity() const restrict(amp, cpu)
+            {
+                FlaggedValue<T> r;
+                r.flag = 0;
+                r.value = op.Identity();
+                return r;
+            }
+
+            FlaggedValue<T> operator()(const FlaggedValue<T>& a, const FlaggedValue<T>& b) const restrict(amp, cpu)
+            {
+                FlaggedValue<T> r;
+                r.flag = a.flag | b.flag;
+                r.value = (b.flag != 0) ? b.value : op(a.value, b.value);
+                return r;
+            }
+        };
+
+        template <int TileSize, typename T, typename Op>
+        void SegmentedScan(array_view<const T, 1> input, array_view<const int, 1> headFlags, array_view<T, 1> output, const Op& op, bool exclusive)
+        {
+            assert(input.extent[0] == output.extent[0]);
+            assert(input.extent[0] == headFlags.extent[0]);
+
+            const int elementCount = input.extent[0];
+            if (elementCount == 0)
+                return;
+            const int isExclusive = exclusive ? 1 : 0;
+
+            array<FlaggedValue<T>, 1> pairs(elementCount);
+            array_view<FlaggedValue<T>, 1> pairsView(pairs);
+            pairsView.discard_data();
+            parallel_for_each(input.extent, [=](index<1> idx) restrict(amp)
+            {
+                FlaggedValue<T> p;
+                p.flag = (headFlags[idx] != 0) ? 1 : 0;
+                p.value = input[idx];
+                pairsView[idx] = p;
+            });
+
+            ScanTiled<TileSize>(array_view<const FlaggedValue<T>, 1>(pairsView), pairsView, SegmentedOp<T, Op>(op), false);
+
+            // An exclusive scan takes the previous inclusive value unless the element starts a segment.
+            parallel_for_each(input.extent, [=](index<1> idx) restrict(amp)
+            {
+                const int i = idx[0];
+                if (!isExclusive)
+                    output[idx] = pairsView[idx].value;
+                else if (i == 0 || headFlags[idx] != 0)
+                    output[idx] = op.Identity();
+                else
+                    output[idx] = pairsView[i - 1].value;
+            });
+        }
+
+        // Head flags from offsets, several empty segments may flag the same element.
+
+        inline void HeadFlagsFromOffsets(array_view<const int, 1> offsets, array_view<int, 1> headFlags)
+        {
+            const int elementCount = headFlags.extent[0];
+            headFlags.discard_data();
+            parallel_for_each(headFlags.extent, [=](index<1> idx) restrict(amp)
+            {
+                headFlags[idx] = 0;
+            });
+            const int segmentCount = offsets.extent[0] - 1;
+            if (segmentCount == 0)
+                return;
+            parallel_for_each(extent<1>(segmentCount), [=](index<1> idx) restrict(amp)
+            {
+                const int first = offsets[idx];
+                if (first < elementCount)
+                    headFlags[first] = 1;
+            });
+        }
+
+        template <int TileSize, typename T, typename Op>
+        void SegmentedScanOffsets(array_view<const T, 1> input, array_view<const int, 1> offsets, array_view<T, 1> output, const Op& op, bool exclusive)
+        {
+            assert(offsets.extent[0] >= 1);
+
+            if (input.extent[0] == 0)
+                return;
+            array<int, 1> headFlags(input.extent);
+            HeadFlagsFromOffsets(offsets, array_view<int, 1>(headFlags));
+            SegmentedScan<TileSize>(input, array_view<const int, 1>(headFlags), output, op, exclusive);
+        }
+    }
+
+    // Inclusive scan within each segment, output element at i contains op applied to the elements from the
+    // start of i's segment up to and including i. The input and output may be the same array_view.
+
+    template <int TileSize, typename T, typename Op>
+    void SegmentedScanAmp(array_view<T, 1> input, array_view<int, 1> headFlags, array_view<T, 1> output, const Op& op)
+    {
+        details::SegmentedScan<TileSize>(array_view<const T, 1>(input), array_view<const int, 1>(headFlags), output, op, false);
+    }
+
+    template <int TileSize, typename T>
+    void SegmentedScanAmp(array_view<T, 1> input, array_view<int, 1> headFlags, array_view<T, 1> output)
+    {
+        SegmentedScanAmp<TileSize>(input, headFlags, output, SumOp<T>());
+    }
+
+    template <int TileSize, typename T, typename Op>
+    void SegmentedScanAmpOffsets(array_view<T, 1> input, array_view<int, 1> offsets, array_view<T, 1> output, const Op& op)
+    {
+        details::SegmentedScanOffsets<TileSize>(array_view<const T, 1>(input), array_view<const int, 1>(offsets), output, op, false);
+    }
+
+    template <int TileSize, typename T>
+    void SegmentedScanAmpOffsets(array_view<T, 1> input, array_view<int, 1> offsets, array_view<T, 1> output)
+    {
+        SegmentedScanAmpOffsets<TileSize>(input, offsets, output, SumOp<T>());
+    }
+
+    // Exclusive scan within each segment, the first element of each segment gets the identity.
+
+    template <int TileSize, typename T, typename Op>
+    void SegmentedPrescanAmp(array_view<T, 1> input, array_view<int, 1> headFlags, array_view<T, 1> output, const Op& op)
+    {
+        details::SegmentedScan<TileSize>(array_view<const T, 1>(input), array_view<const int, 1>(headFlags), output, op, true);
+    }
+
+    template <int TileSize, typename T>
+    void SegmentedPrescanAmp(array_view<T, 1> input, array_view<int, 1> headFlags, array_view<T, 1> output)
+    {
+        SegmentedPrescanAmp<TileSize>(input, headFlags, output, SumOp<T>());
+    }
+
+    template <int TileSize, typename T, typename Op>
+    void SegmentedPrescanAmpOffsets(array_view<T, 1> input, array_view<int, 1> offsets, array_view<T, 1> output, const Op& op)
+    {
+        details::SegmentedScanOffsets<TileSize>(array_view<const T, 1>(input), array_view<const int, 1>(offsets), output, op, true);
+    }
+
+    template <int TileSize, typename T>
+    void SegmentedPrescanAmpOffsets(array_view<T, 1> input, array_view<int, 1> offsets, array_view<T, 1> output)
+    {
+        SegmentedPrescanAmpOffsets<TileSize>(input, offsets, output, SumOp<T>());
+    }
+}
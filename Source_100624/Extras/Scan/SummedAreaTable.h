@@ -0,0 +1,170 @@
+//===============================================================================
+//
+// Microsoft Press
+// C++ AMP: Accelerated Massive Parallelism with Microsoft Visual C++
+//
+//===============================================================================
+// Copyright (c) 2012 Ade Miller & Kate Gregory.  All rights reserved.
+// This code released under the terms of the 
+// Microsoft Public License (Ms-PL), http://ampbook.codeplex.com/license.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//===============================================================================
+
+#pragma once
+
+#include <ppl.h>
+#include <vector>
+#include <algorithm>
+#include <assert.h>
+
+#include "ScanSequential.h"
+
+namespace Extras
+{
+    // Summed-area table, or integral image. Entry (x, y) holds the sum of all pixels above and to the left
+    // of it so the sum over any rectangle takes four lookups, whatever its size. Box filters and local
+    // statistics built on it cost the same per pixel for any window.
+    //
+    // The table is built in two passes, a scan of each row and then a scan down each column. Rows are
+    // split between threads, each is transformed to AccT in the table and then summed in place with
+    // Extras::Scan.
+    // The column scan adds each row to the one below it, working down strips of kSatStripWidth columns so
+    // each thread walks memory in order. A strip is a whole number of cache lines for any AccT and narrow
+    // enough that an HD image gives every core several strips.
+    //
+    // AccT is the accumulator type. Use long long for 8 bit or int images, 32 bit sums of 8 bit pixels
+    // overflow past about 8.4 million pixels, and double for float images.
+
+    const int kSatStripWidth = 64;
+
+    template <typename AccT>
+    class SummedAreaTable
+    {
+    public:
+        SummedAreaTable() : m_width(0), m_height(0) { }
+
+        // Builds the table from an image of width x height pixels, rows are stride elements apart.
+
+        template <typename T>
+        void Build(const T* const pImage, int width, int height, size_t stride)
+        {
+            Build(pImage, width, height, stride, [](T v) { return AccT(v); });
+        }
+
+        // Builds a table of squared pixel values, for local variance.
+
+        template <typename T>
+        void BuildSquares(const T* const pImage, int width, int height, size_t stride)
+        {
+            Build(pImage, width, height, stride, [](T v) { return AccT(v) * AccT(v); });
+        }
+
+        int Width() const { return m_width; }
+        int Height() const { return m_height; }
+
+        // Sum of the pixels in [x0, x1) x [y0, y1).
+
+        AccT Sum(int x0, int y0, int x1, int y1) const
+        {
+            assert(0 <= x0 && x0 <= x1 && x1 <= m_width);
+            assert(0 <= y0 && y0 <= y1 && y1 <= m_height);
+
+            const size_t stride = size_t(m_width) + 1;
+            const AccT* const pTop = &m_table[size_t(y0) * stride];
+            const AccT* const pBottom = &m_table[size_t(y1) * stride];
+            return pBottom[x1] - pBottom[x0] - pTop[x1] + pTop[x0];
+        }
+
+    private:
+        // The table has an extra row and column of zeros at the top and left so queries need no tests.
+
+        template <typename T, typename Transform>
+        void Build(const T* const pImage, int width, int height, size_t stride, const Transform& transform)
+        {
+            m_width = width;
+            m_height = height;
+            const size_t tableStride = size_t(width) + 1;
+            m_table.assign(tableStride * (size_t(height) + 1), AccT(0));
+            AccT* const pTable = m_table.data();
+
+            concurrency::parallel_for(0, height, [=](int y)
+            {
+                const T* const pRow = pImage + size_t(y) * stride;
+                AccT* const pOut = pTable + (size_t(y) + 1) * tableStride + 1;
+                std::transform(pRow, pRow + width, pOut, transform);
+                Scan(pOut, pOut + width, pOut);
+            });
+
+            const int stripCount = (width + kSatStripWidth - 1) / kSatStripWidth;
+            concurrency::parallel_for(0, stripCount, [=](int strip)
+            {
+                const int first = strip * kSatStripWidth + 1;
+                const int last = (std::min)(width + 1, first + kSatStripWidth);
+                for (int y = 2; y <= height; ++y)
+                {
+                    const AccT* const pAbove = pTable + size_t(y - 1) * tableStride;
+                    AccT* const pRow = pTable + size_t(y) * tableStride;
+                    for (int x = first; x < last; ++x)
+                        pRow[x] += pAbove[x];
+                }
+            });
+        }
+
+        int m_width;
+        int m_height;
+        std::vector<AccT> m_table;
+    };
+
+    // Mean of the (2 * radius + 1) square window around each pixel, clipped to the image, truncated for an
+    // integer AccT. The output has the table's dimensions and rows are stride elements apart.
+
+    template <typename AccT, typename T>
+    void BoxFilter(const SummedAreaTable<AccT>& table, int radius, T* const pOutput, size_t stride)
+    {
+        const int width = table.Width();
+        const int height = table.Height();
+        concurrency::parallel_for(0, height, [&](int y)
+        {
+            const int y0 = (std::max)(0, y - radius);
+            const int y1 = (std::min)(height, y + radius + 1);
+            T* const pRow = pOutput + size_t(y) * stride;
+            for (int x = 0; x < width; ++x)
+            {
+                const int x0 = (std::max)(0, x - radius);
+                const int x1 = (std::min)(width, x + radius + 1);
+                pRow[x] = T(table.Sum(x0, y0, x1, y1) / AccT((x1 - x0) * (y1 - y0)));
+            }
+        });
+    }
+
+    // Mean and variance of the window around each pixel, from tables of the pixels and their squares.
+
+    template <typename AccT>
+    void LocalStatistics(const SummedAreaTable<AccT>& sums, const SummedAreaTable<AccT>& squares, int radius, 
+        float* const pMean, float* const pVariance, size_t stride)
+    {
+        assert(sums.Width() == squares.Width() && sums.Height() == squares.Height());
+
+        const int width = sums.Width();
+        const int height = sums.Height();
+        concurrency::parallel_for(0, height, [&](int y)
+        {
+            const int y0 = (std::max)(0, y - radius);
+            const int y1 = (std::min)(height, y + radius + 1);
+            for (int x = 0; x < width; ++x)
+            {
+                const int x0 = (std::max)(0, x - radius);
+                const int x1 = (std::min)(width, x + radius + 1);
+                const double count = double((x1 - x0) * (y1 - y0));
+                const double mean = double(sums.Sum(x0, y0, x1, y1)) / count;
+                const double meanSquare = double(squares.Sum(x0, y0, x1, y1)) / count;
+                pMean[size_t(y) * stride + x] = float(mean);
+                pVariance[size_t(y) * stride + x] = float((std::max)(0.0, meanSquare - mean * mean));
+            }
+        });
+    }
+}
@@ -9,6 +9,9 @@
 #include <iterator>
 #include <numeric>
 #include <array>
+#include <random>
+#include <limits>
+#include <climits>
 #include <iostream>
 #include <amp.h>
 #include <assert.h>
@@ -19,6 +19,9 @@
 #include "..\Scan\ScanSimple.h"
 #include "..\Scan\ScanTiled.h"
 #include "..\Scan\ScanTiledOptimized.h"
+#include "..\Scan\ScanDecoupled.h"
+#include "..\Scan\ScanSequential.h"
+#include "..\Scan\ScanCpu.h"
 
 using namespace Extras;
 
@@ -64,9 +67,65 @@ public:
     }
 };
 
+template <int TileSize>
+class DecoupledScan : public IScan
+{
+public:
+    void Scan(array_view<int, 1>(in), array_view<int, 1>(out)) const
+    {
+        ScanAmpDecoupled<TileSize>(array_view<int, 1>(in), array_view<int, 1>(out));
+    }
+};
+
+//  Reads and writes every element once, the lower bound for any scan.
+
+class CopyScan : public IScan
+{
+public:
+    void Scan(array_view<int, 1>(in), array_view<int, 1>(out)) const
+    {
+        in.copy_to(out);
+    }
+};
+
 typedef std::pair<std::shared_ptr<IScan>, std::wstring> ScanDescription;
 
-inline bool ValidateSizes(unsigned tileSize, unsigned elementCount);
+//  CPU scans work on host memory so there's nothing to copy, total and calculation times are the same.
+
+class ICpuScan
+{
+public:
+    virtual void Scan(const std::vector<int>& in, std::vector<int>& out) const = 0;
+};
+
+class SequentialCpuScan : public ICpuScan
+{
+public:
+    void Scan(const std::vector<int>& in, std::vector<int>& out) const
+    {
+        Extras::Scan(begin(in), end(in), begin(out));
+    }
+};
+
+class SimdCpuScan : public ICpuScan
+{
+public:
+    void Scan(const std::vector<int>& in, std::vector<int>& out) const
+    {
+        ScanSimd(in.data(), out.data(), in.size());
+    }
+};
+
+class ParallelCpuScan : public ICpuScan
+{
+public:
+    void Scan(const std::vector<int>& in, std::vector<int>& out) const
+    {
+        ScanParallel(in.data(), out.data(), in.size());
+    }
+};
+
+typedef std::pair<std::shared_ptr<ICpuScan>, std::wstring> CpuScanDescription;
 
 int _tmain(int argc, _TCHAR* argv[])
 {
@@ -88,10 +147,6 @@ int _tmain(int argc, _TCHAR* argv[])
         << elementCount * sizeof(int) / 1024 << " KB of data ..."  << std::endl;    
     std::wcout << "Tile size:     " << tileSize << std::endl;
 
-    if (!ValidateSizes(2, elementCount))
-        std::wcout << "Tile size is not factor of element count. This will cause runtime errors." 
-        << std::endl;
-
     accelerator defaultDevice;
     std::wcout << L"Using device : " << defaultDevice.get_description() << std::endl;
     if (defaultDevice == accelerator(accelerator::direct3d_ref))
@@ -103,11 +158,13 @@ int _tmain(int argc, _TCHAR* argv[])
     std::vector<int> expected(input.size());
     std::iota(begin(expected), end(expected), 1);
 
-    std::array<ScanDescription, 4> scans = {
+    std::array<ScanDescription, 6> scans = {
         ScanDescription(std::make_shared<DummyScan>(),                      L"Overhead"),
+        ScanDescription(std::make_shared<CopyScan>(),                       L"Copy (bandwidth bound)"),
         ScanDescription(std::make_shared<SimpleScan>(),                     L"Simple"),
         ScanDescription(std::make_shared<TiledScan<tileSize>>(),            L"Tiled"),
-        ScanDescription(std::make_shared<TiledOptScan<tileSize>>(),         L"Tiled Optimized") };
+        ScanDescription(std::make_shared<TiledOptScan<tileSize>>(),         L"Tiled Optimized"),
+        ScanDescription(std::make_shared<DecoupledScan<tileSize>>(),        L"Decoupled look-back") };
 
     std::wcout << std::endl << "                                                           Total : Calc" << std::endl << std::endl;
 
@@ -133,7 +190,8 @@ int _tmain(int argc, _TCHAR* argv[])
             });
             copy(out, begin(result));
         });
-        if (!std::equal(begin(result), end(result), begin(expected)) && scanName.compare(L"Overhead") != 0)
+        if (!std::equal(begin(result), end(result), begin(expected)) && scanName.compare(L"Overhead") != 0
+            && scanName.compare(L"Copy (bandwidth bound)") != 0)
         {
             std::wcout << "FAILED: " << scanName << std::endl;
         }
@@ -144,18 +202,35 @@ int _tmain(int argc, _TCHAR* argv[])
             std::wcout << std::right << std::fixed << std::setprecision(2) << totalTime << " : " << computeTime << " (ms)" << std::endl;        
         }
     }
-    return 0;
-}
 
-//----------------------------------------------------------------------------
-//  Ensure that the reduction can repeatedly divide the elements by tile size.
-//----------------------------------------------------------------------------
+    std::array<CpuScanDescription, 3> cpuScans = {
+        CpuScanDescription(std::make_shared<SequentialCpuScan>(),           L"CPU sequential"),
+        CpuScanDescription(std::make_shared<SimdCpuScan>(),                 L"CPU SIMD"),
+        CpuScanDescription(std::make_shared<ParallelCpuScan>(),             L"CPU parallel SIMD, cache blocked") };
 
-inline bool ValidateSizes(unsigned tileSize, unsigned elementCount)
-{
-    while ((elementCount % tileSize) == 0) 
+    std::wcout << std::endl;
+    for (CpuScanDescription s : cpuScans)
     {
-        elementCount /= tileSize;
+        ICpuScan* scanImpl = s.first.get();
+        std::wstring scanName = s.second;
+
+        std::fill(begin(input), end(input), 1);
+        std::fill(begin(result), end(result), 0);
+
+        const double computeTime = JitAndTimeFunc(view, [&]()
+        {
+            scanImpl->Scan(input, result);
+        });
+        if (!std::equal(begin(result), end(result), begin(expected)))
+        {
+            std::wcout << "FAILED: " << scanName << std::endl;
+        }
+        else
+        {
+            std::wcout << "SUCCESS: " << scanName;
+            std::wcout.width(std::max(0U, 55 - scanName.length()));
+            std::wcout << std::right << std::fixed << std::setprecision(2) << computeTime << " : " << computeTime << " (ms)" << std::endl;
+        }
     }
-    return elementCount < tileSize;
+    return 0;
 }
@@ -0,0 +1,583 @@
+//===============================================================================
+//
+// Microsoft Press
+// C++ AMP: Accelerated Massive Parallelism with Microsoft Visual C++
+//
+//===============================================================================
+// Copyright (c) 2012 Ade Miller & Kate Gregory.  All rights reserved.
+// This code released under the terms of the
+// Microsoft Public License (Ms-PL), http://ampbook.codeplex.com/license.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//===============================================================================
+
+#pragma once
+
+#include <ppl.h>
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <math.h>
+#include <assert.h>
+#include <emmintrin.h>
+#include <immintrin.h>
+
+#include "CpuFeatures.h"
+
+//--------------------------------------------------------------------------------------
+//  BLAS level 1 kernels.
+//--------------------------------------------------------------------------------------
+//
+//  Single precision vector operations, each written once against a small set of register
+//  operations and instantiated for SSE2, AVX2 and AVX-512. The overloads without a level
+//  use GetSimdLevel(), the others exist so that each version can be tested and benchmarked.
+//
+//  Every kernel has a scalar head that runs until the output, or the first input of a
+//  reduction, is aligned to the register width. The main loop then uses aligned accesses
+//  for that array and unaligned ones for the others, and a scalar tail finishes the vector.
+//  Pointers only need the natural alignment of float.
+//
+//  Vectors of kBlas1ParallelThreshold elements or more are split into chunks of
+//  kBlas1ChunkSize elements that are processed in parallel. Reductions compute one partial
+//  result per chunk and combine them in chunk order in double precision, so they give the
+//  same result however the chunks are scheduled. Results can differ between levels in the
+//  last bits because the number of accumulators differs, and AVX2 and AVX-512 use fused
+//  multiply adds where SSE2 rounds the product first.
+
+namespace Extras
+{
+    namespace Blas1
+    {
+        const size_t kBlas1ChunkSize = 64 * 1024;
+        const size_t kBlas1ParallelThreshold = 4 * kBlas1ChunkSize;
+
+        namespace details
+        {
+            struct Sse2Ops
+            {
+                typedef __m128 Register;
+                static const size_t kWidth = 4;
+
+                static Register Zero() { return _mm_setzero_ps(); }
+                static Register Set1(float v) { return _mm_set1_ps(v); }
+                static Register Load(const float* p) { return _mm_load_ps(p); }
+                static Register LoadU(const float* p) { return _mm_loadu_ps(p); }
+                static void Store(float* p, Register v) { _mm_store_ps(p, v); }
+                static Register Add(Register a, Register b) { return _mm_add_ps(a, b); }
+                static Register Mul(Register a, Register b) { return _mm_mul_ps(a, b); }
+                static Register MulAdd(Register a, Register b, Register c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+                static Register Abs(Register a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+
+                //  Returns b where a is NaN so that a running maximum ignores NaNs.
+                static Register Max(Register a, Register b) { return _mm_max_ps(a, b); }
+
+                static float Sum(Register v)
+                {
+                    v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+                    v = _mm_add_ss(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1)));
+                    return _mm_cvtss_f32(v);
+                }
+
+                static float MaxLane(Register v)
+                {
+                    v = _mm_max_ps(v, _mm_movehl_ps(v, v));
+                    v = _mm_max_ss(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1)));
+                    return _mm_cvtss_f32(v);
+                }
+            };
+
+#if defined(EXTRAS_SIMD_AVX2)
+            struct Avx2Ops
+            {
+                typedef __m256 Register;
+                static const size_t kWidth = 8;
+
+                static Register Zero() { return _mm256_setzero_ps(); }
+                static Register Set1(float v) { return _mm256_set1_ps(v); }
+                static Register Load(const float* p) { return _mm256_load_ps(p); }
+                static Register LoadU(const float* p) { return _mm256_loadu_ps(p); }
+                static void Store(float* p, Register v) { _mm256_store_ps(p, v); }
+                static Register Add(Register a, Register b) { return _mm256_add_ps(a, b); }
+                static Register Mul(Register a, Register b) { return _mm256_mul_ps(a, b); }
+                static Register MulAdd(Register a, Register b, Register c) { return _mm256_fmadd_ps(a, b, c); }
+                static Register Abs(Register a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+                static Register Max(Register a, Register b) { return _mm256_max_ps(a, b); }
+
+                static float Sum(Register v)
+                {
+                    return Sse2Ops::Sum(_mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1)));
+                }
+
+                static float MaxLane(Register v)
+                {
+                    return Sse2Ops::MaxLane(_mm_max_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1)));
+                }
+            };
+#endif
+
+#if defined(EXTRAS_SIMD_AVX512)
+            struct Avx512Ops
+            {
+                typedef __m512 Register;
+                static const size_t kWidth = 16;
+
+                static Register Zero() { return _mm512_setzero_ps(); }
+                static Register Set1(float v) { return _mm512_set1_ps(v); }
+                static Register Load(const float* p) { return _mm512_load_ps(p); }
+                static Register LoadU(const float* p) { return _mm512_loadu_ps(p); }
+                static void Store(float* p, Register v) { _mm512_store_ps(p, v); }
+                static Register Add(Register a, Register b) { return _mm512_add_ps(a, b); }
+                static Register Mul(Register a, Register b) { return _mm512_mul_ps(a, b); }
+                static Register MulAdd(Register a, Register b, Register c) { return _mm512_fmadd_ps(a, b, c); }
+                static Register Abs(Register a) { return _mm512_castsi512_ps(_mm512_and_si512(_mm512_castps_si512(a), _mm512_set1_epi32(0x7FFFFFFF))); }
+                static Register Max(Register a, Register b) { return _mm512_max_ps(a, b); }
+
+                //  Split into 256 bit halves with AVX512F instructions only.
+                static __m256 High(Register v) { return _mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(v), 1)); }
+                static float Sum(Register v) { return Avx2Ops::Sum(_mm256_add_ps(_mm512_castps512_ps256(v), High(v))); }
+                static float MaxLane(Register v) { return Avx2Ops::MaxLane(_mm256_max_ps(_mm512_castps512_ps256(v), High(v))); }
+            };
+#endif
+
+            //  Number of elements before p + head is aligned to the register width, at most count.
+
+            template <typename Ops>
+            inline size_t AlignmentHead(const float* const p, size_t count)
+            {
+                const size_t bytes = Ops::kWidth * sizeof(float);
+                const size_t misalignment = reinterpret_cast<size_t>(p) % bytes;
+                assert(misalignment % sizeof(float) == 0);
+                const size_t head = (misalignment == 0) ? 0 : (bytes - misalignment) / sizeof(float);
+                return (std::min)(head, count);
+            }
+
+            //  Calls range(first, last) for the whole vector or for each chunk in parallel.
+
+            template <typename Range>
+            inline void ForEachChunk(size_t count, bool parallel, const Range& range)
+            {
+                if (!parallel || count < kBlas1ParallelThreshold)
+                {
+                    range(size_t(0), count);
+                    return;
+                }
+                const size_t chunks = (count + kBlas1ChunkSize - 1) / kBlas1ChunkSize;
+                concurrency::parallel_for(size_t(0), chunks, [&](size_t c)
+                {
+                    range(c * kBlas1ChunkSize, (std::min)(count, (c + 1) * kBlas1ChunkSize));
+                });
+            }
+
+            template <typename Range, typename Combine>
+            inline double ReduceChunks(size_t count, bool parallel, const Range& range, const Combine& combine)
+            {
+                if (!parallel || count < kBlas1ParallelThreshold)
+                    return range(size_t(0), count);
+
+                const size_t chunks = (count + kBlas1ChunkSize - 1) / kBlas1ChunkSize;
+                std::vector<float> partial(chunks);
+                concurrency::parallel_for(size_t(0), chunks, [&](size_t c)
+                {
+                    partial[c] = range(c * kBlas1ChunkSize, (std::min)(count, (c + 1) * kBlas1ChunkSize));
+                });
+                double result = partial[0];
+                for (size_t c = 1; c < chunks; ++c)
+                    result = combine(result, double(partial[c]));
+                return result;
+            }
+
+            //  Runs kernel.Run<Ops>(first, last) with the widest register operations allowed by level.
+
+            template <typename Kernel>
+            inline void RunElementwise(const Kernel& kernel, size_t count, SimdLevel level, bool parallel)
+            {
+#if defined(EXTRAS_SIMD_AVX512)
+                if (level >= SimdLevel::Avx512)
+                {
+                    ForEachChunk(count, parallel, [&](size_t first, size_t last) { kernel.template Run<Avx512Ops>(first, last); });
+                    return;
+                }
+#endif
+#if defined(EXTRAS_SIMD_AVX2)
+                if (level >= SimdLevel::Avx2)
+                {
+                    ForEachChunk(count, parallel, [&](size_t first, size_t last) { kernel.template Run<Avx2Ops>(first, last); });
+                    return;
+                }
+#endif
+                ForEachChunk(count, parallel, [&](size_t first, size_t last) { kernel.template Run<Sse2Ops>(first, last); });
+            }
+
+            template <typename Kernel>
+            inline double RunReduction(const Kernel& kernel, size_t count, SimdLevel level, bool parallel)
+            {
+#if defined(EXTRAS_SIMD_AVX512)
+                if (level >= SimdLevel::Avx512)
+                    return ReduceChunks(count, parallel, [&](size_t first, size_t last) { return kernel.template Run<Avx512Ops>(first, last); }, Kernel::Combine);
+#endif
+#if defined(EXTRAS_SIMD_AVX2)
+                if (level >= SimdLevel::Avx2)
+                    return ReduceChunks(count, parallel, [&](size_t first, size_t last) { return kernel.template Run<Avx2Ops>(first, last); }, Kernel::Combine);
+#endif
+                return ReduceChunks(count, parallel, [&](size_t first, size_t last) { return kernel.template Run<Sse2Ops>(first, last); }, Kernel::Combine);
+            }
+
+            //  z = x + y
+
+            struct AddKernel
+            {
+                const float* pX;
+                const float* pY;
+                float* pZ;
+
+                template <typename Ops>
+                void Run(size_t first, size_t last) const
+                {
+                    size_t i = first;
+                    for (const size_t head = first + AlignmentHead<Ops>(pZ + first, last - first); i < head; ++i)
+                        pZ[i] = pX[i] + pY[i];
+                    for (; i + Ops::kWidth <= last; i += Ops::kWidth)
+                        Ops::Store(pZ + i, Ops::Add(Ops::LoadU(pX + i), Ops::LoadU(pY + i)));
+                    for (; i < last; ++i)
+                        pZ[i] = pX[i] + pY[i];
+                }
+            };
+
+            //  x = alpha * x
+
+            struct ScaleKernel
+            {
+                float alpha;
+                float* pX;
+
+                template <typename Ops>
+                void Run(size_t first, size_t last) const
+                {
+                    const typename Ops::Register a = Ops::Set1(alpha);
+                    size_t i = first;
+                    for (const size_t head = first + AlignmentHead<Ops>(pX + first, last - first); i < head; ++i)
+                        pX[i] *= alpha;
+                    for (; i + Ops::kWidth <= last; i += Ops::kWidth)
+                        Ops::Store(pX + i, Ops::Mul(a, Ops::Load(pX + i)));
+                    for (; i < last; ++i)
+                        pX[i] *= alpha;
+                }
+            };
+
+            //  y = alpha * x + y
+
+            struct AxpyKernel
+            {
+                float alpha;
+                const float* pX;
+                float* pY;
+
+                template <typename Ops>
+                void Run(size_t first, size_t last) const
+                {
+                    const typename Ops::Register a = Ops::Set1(alpha);
+                    size_t i = first;
+                    for (const size_t head = first + AlignmentHead<Ops>(pY + first, last - first); i < head; ++i)
+                        pY[i] += alpha * pX[i];
+                    for (; i + Ops::kWidth <= last; i += Ops::kWidth)
+                        Ops::Store(pY + i, Ops::MulAdd(a, Ops::LoadU(pX + i), Ops::Load(pY + i)));
+                    for (; i < last; ++i)
+                        pY[i] += alpha * pX[i];
+                }
+            };
+
+            //  a = b + scalar * c, the STREAM triad.
+
+            struct TriadKernel
+            {
+                const float* pB;
+                const float* pC;
+                float scalar;
+                float* pA;
+
+                template <typename Ops>
+                void Run(size_t first, size_t last) const
+                {
+                    const typename Ops::Register s = Ops::Set1(scalar);
+                    size_t i = first;
+                    for (const size_t head = first + AlignmentHead<Ops>(pA + first, last - first); i < head; ++i)
+                        pA[i] = pB[i] + scalar * pC[i];
+                    for (; i + Ops::kWidth <= last; i += Ops::kWidth)
+                        Ops::Store(pA + i, Ops::MulAdd(s, Ops::LoadU(pC + i), Ops::LoadU(pB + i)));
+                    for (; i < last; ++i)
+                        pA[i] = pB[i] + scalar * pC[i];
+                }
+            };
+
+            //  z = x * y + z
+
+            struct FmaAccumulateKernel
+            {
+                const float* pX;
+                const float* pY;
+                float* pZ;
+
+                template <typename Ops>
+                void Run(size_t first, size_t last) const
+                {
+                    size_t i = first;
+                    for (const size_t head = first + AlignmentHead<Ops>(pZ + first, last - first); i < head; ++i)
+                        pZ[i] += pX[i] * pY[i];
+                    for (; i + Ops::kWidth <= last; i += Ops::kWidth)
+                        Ops::Store(pZ + i, Ops::MulAdd(Ops::LoadU(pX + i), Ops::LoadU(pY + i), Ops::Load(pZ + i)));
+                    for (; i < last; ++i)
+                        pZ[i] += pX[i] * pY[i];
+                }
+            };
+
+            //  Reductions keep four accumulators so that four independent adds are in flight.
+
+            struct DotKernel
+            {
+                const float* pX;
+                const float* pY;
+
+                static double Combine(double a, double b) { return a + b; }
+
+                template <typename Ops>
+                float Run(size_t first, size_t last) const
+                {
+                    const size_t w = Ops::kWidth;
+                    size_t i = first;
+                    float head = 0.0f;
+                    for (const size_t end = first + AlignmentHead<Ops>(pX + first, last - first); i < end; ++i)
+                        head += pX[i] * pY[i];
+
+                    typename Ops::Register acc0 = Ops::Zero();
+                    typename Ops::Register acc1 = Ops::Zero();
+                    typename Ops::Register acc2 = Ops::Zero();
+                    typename Ops::Register acc3 = Ops::Zero();
+                    for (; i + 4 * w <= last; i += 4 * w)
+                    {
+                        acc0 = Ops::MulAdd(Ops::Load(pX + i), Ops::LoadU(pY + i), acc0);
+                        acc1 = Ops::MulAdd(Ops::Load(pX + i + w), Ops::LoadU(pY + i + w), acc1);
+                        acc2 = Ops::MulAdd(Ops::Load(pX + i + 2 * w), Ops::LoadU(pY + i + 2 * w), acc2);
+                        acc3 = Ops::MulAdd(Ops::Load(pX + i + 3 * w), Ops::LoadU(pY + i + 3 * w), acc3);
+                    }
+                    for (; i + w <= last; i += w)
+                        acc0 = Ops::MulAdd(Ops::Load(pX + i), Ops::LoadU(pY + i), acc0);
+                    float result = Ops::Sum(Ops::Add(Ops::Add(acc0, acc1), Ops::Add(acc2, acc3)));
+
+                    for (; i < last; ++i)
+                        result += pX[i] * pY[i];
+                    return result + head;
+                }
+            };
+
+            //  Sum of (scale * x)^2, used by Nrm2.
+
+            struct SumSquaresKernel
+            {
+                const float* pX;
+                float scale;
+
+                static double Combine(double a, double b) { return a + b; }
+
+                template <typename Ops>
+                float Run(size_t first, size_t last) const
+                {
+                    const size_t w = Ops::kWidth;
+                    const typename Ops::Register s = Ops::Set1(scale);
+                    size_t i = first;
+                    float head = 0.0f;
+                    for (const size_t end = first + AlignmentHead<Ops>(pX + first, last - first); i < end; ++i)
+                        head += (scale * pX[i]) * (scale * pX[i]);
+
+                    typename Ops::Register acc0 = Ops::Zero();
+                    typename Ops::Register acc1 = Ops::Zero();
+                    typename Ops::Register acc2 = Ops::Zero();
+                    typename Ops::Register acc3 = Ops::Zero();
+                    for (; i + 4 * w <= last; i += 4 * w)
+                    {
+                        const typename Ops::Register v0 = Ops::Mul(s, Ops::Load(pX + i));
+                        const typename Ops::Register v1 = Ops::Mul(s, Ops::Load(pX + i + w));
+                        const typename Ops::Register v2 = Ops::Mul(s, Ops::Load(pX + i + 2 * w));
+                        const typename Ops::Register v3 = Ops::Mul(s, Ops::Load(pX + i + 3 * w));
+                        acc0 = Ops::MulAdd(v0, v0, acc0);
+                        acc1 = Ops::MulAdd(v1, v1, acc1);
+                        acc2 = Ops::MulAdd(v2, v2, acc2);
+                        acc3 = Ops::MulAdd(v3, v3, acc3);
+                    }
+                    for (; i + w <= last; i += w)
+                    {
+                        const typename Ops::Register v = Ops::Mul(s, Ops::Load(pX + i));
+                        acc0 = Ops::MulAdd(v, v, acc0);
+                    }
+                    float result = Ops::Sum(Ops::Add(Ops::Add(acc0, acc1), Ops::Add(acc2, acc3)));
+
+                    for (; i < last; ++i)
+                        result += (scale * pX[i]) * (scale * pX[i]);
+                    return result + head;
+                }
+            };
+
+            //  Largest |x|, NaNs are ignored.
+
+            struct AbsMaxKernel
+            {
+                const float* pX;
+
+                static double Combine(double a, double b) { return (std::max)(a, b); }
+
+                template <typename Ops>
+                float Run(size_t first, size_t last) const
+                {
+                    const size_t w = Ops::kWidth;
+                    size_t i = first;
+                    float result = 0.0f;
+                    for (const size_t end = first + AlignmentHead<Ops>(pX + first, last - first); i < end; ++i)
+                        result = (fabsf(pX[i]) > result) ? fabsf(pX[i]) : result;
+
+                    typename Ops::Register max0 = Ops::Zero();
+                    typename Ops::Register max1 = Ops::Zero();
+                    typename Ops::Register max2 = Ops::Zero();
+                    typename Ops::Register max3 = Ops::Zero();
+                    for (; i + 4 * w <= last; i += 4 * w)
+                    {
+                        max0 = Ops::Max(Ops::Abs(Ops::Load(pX + i)), max0);
+                        max1 = Ops::Max(Ops::Abs(Ops::Load(pX + i + w)), max1);
+                        max2 = Ops::Max(Ops::Abs(Ops::Load(pX + i + 2 * w)), max2);
+                        max3 = Ops::Max(Ops::Abs(Ops::Load(pX + i + 3 * w)), max3);
+                    }
+                    for (; i + w <= last; i += w)
+                        max0 = Ops::Max(Ops::Abs(Ops::Load(pX + i)), max0);
+                    const float vectorMax = Ops::MaxLane(Ops::Max(Ops::Max(max0, max1), Ops::Max(max2, max3)));
+                    result = (std::max)(result, vectorMax);
+
+                    for (; i < last; ++i)
+                        result = (fabsf(pX[i]) > result) ? fabsf(pX[i]) : result;
+                    return result;
+                }
+            };
+        }
+
+        //  pZ[i] = pX[i] + pY[i]
+
+        inline void Add(const float* const pX, const float* const pY, float* const pZ, size_t count, SimdLevel level, bool parallel)
+        {
+            const details::AddKernel kernel = { pX, pY, pZ };
+            details::RunElementwise(kernel, count, level, parallel);
+        }
+
+        inline void Add(const float* const pX, const float* const pY, float* const pZ, size_t count)
+        {
+            Add(pX, pY, pZ, count, GetSimdLevel(), true);
+        }
+
+        //  pX[i] = alpha * pX[i]
+
+        inline void Scale(float alpha, float* const pX, size_t count, SimdLevel level, bool parallel)
+        {
+            const details::ScaleKernel kernel = { alpha, pX };
+            details::RunElementwise(kernel, count, level, parallel);
+        }
+
+        inline void Scale(float alpha, float* const pX, size_t count)
+        {
+            Scale(alpha, pX, count, GetSimdLevel(), true);
+        }
+
+        //  pY[i] = alpha * pX[i] + pY[i]
+
+        inline void Axpy(float alpha, const float* const pX, float* const pY, size_t count, SimdLevel level, bool parallel)
+        {
+            const details::AxpyKernel kernel = { alpha, pX, pY };
+            details::RunElementwise(kernel, count, level, parallel);
+        }
+
+        inline void Axpy(float alpha, const float* const pX, float* const pY, size_t count)
+        {
+            Axpy(alpha, pX, pY, count, GetSimdLevel(), true);
+        }
+
+        //  pA[i] = pB[i] + scalar * pC[i]
+
+        inline void Triad(const float* const pB, const float* const pC, float scalar, float* const pA, size_t count, SimdLevel level, bool parallel)
+        {
+            const details::TriadKernel kernel = { pB, pC, scalar, pA };
+            details::RunElementwise(kernel, count, level, parallel);
+        }
+
+        inline void Triad(const float* const pB, const float* const pC, float scalar, float* const pA, size_t count)
+        {
+            Triad(pB, pC, scalar, pA, count, GetSimdLevel(), true);
+        }
+
+        //  pZ[i] = pX[i] * pY[i] + pZ[i]
+
+        inline void FmaAccumulate(const float* const pX, const float* const pY, float* const pZ, size_t count, SimdLevel level, bool parallel)
+        {
+            const details::FmaAccumulateKernel kernel = { pX, pY, pZ };
+            details::RunElementwise(kernel, count, level, parallel);
+        }
+
+        inline void FmaAccumulate(const float* const pX, const float* const pY, float* const pZ, size_t count)
+        {
+            FmaAccumulate(pX, pY, pZ, count, GetSimdLevel(), true);
+        }
+
+        inline float Dot(const float* const pX, const float* const pY, size_t count, SimdLevel level, bool parallel)
+        {
+            const details::DotKernel kernel = { pX, pY };
+            return float(details::RunReduction(kernel, count, level, parallel));
+        }
+
+        inline float Dot(const float* const pX, const float* const pY, size_t count)
+        {
+            return Dot(pX, pY, count, GetSimdLevel(), true);
+        }
+
+        //  Largest absolute value, zero for an empty vector. NaNs are ignored.
+
+        inline float AbsMax(const float* const pX, size_t count, SimdLevel level, bool parallel)
+        {
+            const details::AbsMaxKernel kernel = { pX };
+            return float(details::RunReduction(kernel, count, level, parallel));
+        }
+
+        inline float AbsMax(const float* const pX, size_t count)
+        {
+            return AbsMax(pX, count, GetSimdLevel(), true);
+        }
+
+        //  Euclidean norm. The squares are summed directly, which is a single pass over the data.
+        //  Only if that overflows, or is small enough that denormal squares could have lost
+        //  precision, is the sum repeated with every element scaled by a power of two that brings
+        //  the largest one into [0.5, 1).
+
+        inline float Nrm2(const float* const pX, size_t count, SimdLevel level, bool parallel)
+        {
+            const double kSafeMin = ldexp(1.0, -90);
+            const details::SumSquaresKernel direct = { pX, 1.0f };
+            const double sum = details::RunReduction(direct, count, level, parallel);
+            if (sum >= kSafeMin && sum <= (std::numeric_limits<float>::max)())
+                return float(sqrt(sum));
+            if (sum != sum)
+                return std::numeric_limits<float>::quiet_NaN();
+
+            const float largest = AbsMax(pX, count, level, parallel);
+            if (largest == 0.0f || largest > (std::numeric_limits<float>::max)())
+                return largest;
+            int exponent;
+            frexpf(largest, &exponent);
+
+            //  2^-exponent overflows a float when largest is subnormal, 2^126 already brings those into range.
+            const int shift = (std::min)(-exponent, 126);
+            const details::SumSquaresKernel scaled = { pX, ldexpf(1.0f, shift) };
+            return ldexpf(float(sqrt(details::RunReduction(scaled, count, level, parallel))), -shift);
+        }
+
+        inline float Nrm2(const float* const pX, size_t count)
+        {
+            return Nrm2(pX, count, GetSimdLevel(), true);
+        }
+    }
+}
@@ -0,0 +1,557 @@
+//===============================================================================
+//
+// Microsoft Press
+// C++ AMP: Accelerated Massive Parallelism with Microsoft Visual C++
+//
+//===============================================================================
+// Copyright (c) 2012 Ade Miller & Kate Gregory.  All rights reserved.
+// This code released under the terms of the
+// Microsoft Public License (Ms-PL), http://ampbook.codeplex.com/license.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//===============================================================================
+
+#pragma once
+
+#include <ppl.h>
+#include <algorithm>
+#include <assert.h>
+#include <string.h>
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#include <immintrin.h>
+
+#include "CpuFeatures.h"
+
+//--------------------------------------------------------------------------------------
+//  Byte permutations.
+//--------------------------------------------------------------------------------------
+//
+//  PermuteBytes applies a fixed byte pattern to every element of a buffer, for example an
+//  endian swap, an RGBA <-> BGRA channel swap or a 24 <-> 32 bit pixel conversion. The
+//  pattern is a BytePattern template argument listing, for each output byte, the input byte
+//  it's copied from or kPermuteZero or kPermuteOnes for a constant.
+//
+//  The pattern is expanded once into a pshufb control covering as many whole elements as
+//  fit in 16 bytes. The kernel for the level returned by GetSimdLevel() applies it to 16, 32
+//  or 64 bytes per instruction: pshufb with SSSE3 and vpshufb on two or four 128 bit lanes
+//  with AVX2 and AVX-512. Machines with only SSE2 use the scalar loop. Loads and stores are
+//  unaligned and never touch bytes outside the elements being converted, so any count works
+//  and large buffers are split across threads without padding.
+//
+//  ReverseBytes reverses a whole buffer in place using the same instruction sets. Blocks are
+//  reversed in a register and swapped with the block mirroring them at the other end.
+//
+//  LerpBytes cross fades two byte buffers, interleaving them into 16 bit lanes to weight
+//  and sum them before packing the result back to bytes.
+
+namespace Extras
+{
+    const int kPermuteZero = -1;
+    const int kPermuteOnes = -2;
+
+    //  Buffers with more output bytes than this are permuted in parallel.
+
+    const size_t kParallelPermuteThreshold = 1024 * 1024;
+
+    //  InBytes and OutBytes are the element sizes, 1 to 8 bytes. Output byte n is copied from
+    //  input byte Bn.
+
+    template <int InBytes, int OutBytes, int B0, int B1 = kPermuteZero, int B2 = kPermuteZero, int B3 = kPermuteZero,
+        int B4 = kPermuteZero, int B5 = kPermuteZero, int B6 = kPermuteZero, int B7 = kPermuteZero>
+    struct BytePattern
+    {
+        static_assert(InBytes > 0 && InBytes <= 8 && OutBytes > 0 && OutBytes <= 8, "Elements must be 1 to 8 bytes.");
+
+        static const int kInBytes = InBytes;
+        static const int kOutBytes = OutBytes;
+
+        static int Source(int i)
+        {
+            const int sources[8] = { B0, B1, B2, B3, B4, B5, B6, B7 };
+            return sources[i];
+        }
+    };
+
+    typedef BytePattern<2, 2, 1, 0> ByteSwap16;
+    typedef BytePattern<4, 4, 3, 2, 1, 0> ByteSwap32;
+    typedef BytePattern<8, 8, 7, 6, 5, 4, 3, 2, 1, 0> ByteSwap64;
+
+    //  Exchanges the first and third channels of 32 bit pixels, RGBA <-> BGRA.
+
+    typedef BytePattern<4, 4, 2, 1, 0, 3> SwapRedBlue;
+
+    //  24 bit pixels to 32 bit pixels with opaque alpha and back, the RGBTRIPLE and RGBQUAD layouts.
+
+    typedef BytePattern<3, 4, 0, 1, 2, kPermuteOnes> Expand24To32;
+    typedef BytePattern<4, 3, 0, 1, 2> Pack32To24;
+
+    namespace details
+    {
+        const size_t kPermuteChunkBytes = 256 * 1024;
+
+        //  A pshufb control for kGroup whole elements and the constant bytes to OR in afterwards.
+        //  A control byte with the top bit set makes pshufb write zero.
+
+        template <typename Pattern>
+        struct PermuteControl
+        {
+            static const int kGroup = 16 / ((Pattern::kInBytes > Pattern::kOutBytes) ? Pattern::kInBytes : Pattern::kOutBytes);
+            static const int kInStep = kGroup * Pattern::kInBytes;
+            static const int kOutStep = kGroup * Pattern::kOutBytes;
+
+            __m128i shuffle;
+            __m128i ones;
+
+            PermuteControl()
+            {
+                char shuffleBytes[16];
+                char onesBytes[16];
+                memset(shuffleBytes, 0x80, sizeof(shuffleBytes));
+                memset(onesBytes, 0, sizeof(onesBytes));
+                for (int e = 0; e < kGroup; ++e)
+                {
+                    for (int b = 0; b < Pattern::kOutBytes; ++b)
+                    {
+                        const int source = Pattern::Source(b);
+                        assert(source < Pattern::kInBytes && source >= kPermuteOnes);
+                        const int i = e * Pattern::kOutBytes + b;
+                        if (source >= 0)
+                            shuffleBytes[i] = static_cast<char>(e * Pattern::kInBytes + source);
+                        else if (source == kPermuteOnes)
+                            onesBytes[i] = static_cast<char>(0xFF);
+                    }
+                }
+                shuffle = _mm_loadu_si128(reinterpret_cast<const __m128i*>(shuffleBytes));
+                ones = _mm_loadu_si128(reinterpret_cast<const __m128i*>(onesBytes));
+            }
+
+            //  Built during static initialization, before the program starts any threads. A function
+            //  local static isn't thread safe with v110.
+
+            static const PermuteControl& Get()
+            {
+                return s_control;
+            }
+
+        private:
+            static const PermuteControl s_control;
+        };
+
+        template <typename Pattern>
+        const PermuteControl<Pattern> PermuteControl<Pattern>::s_control;
+
+        template <typename Pattern>
+        inline void PermuteScalar(const unsigned char* pSrc, unsigned char* pDest, size_t count)
+        {
+            for (size_t i = 0; i < count; ++i, pSrc += Pattern::kInBytes, pDest += Pattern::kOutBytes)
+            {
+                //  Copy the element first so that permuting in place works.
+                unsigned char element[Pattern::kInBytes];
+                memcpy(element, pSrc, Pattern::kInBytes);
+                for (int b = 0; b < Pattern::kOutBytes; ++b)
+                {
+                    const int source = Pattern::Source(b);
+                    pDest[b] = (source >= 0) ? element[source] : ((source == kPermuteOnes) ? 0xFF : 0);
+                }
+            }
+        }
+
+        //  Each kernel converts whole groups of elements for as long as its loads and stores stay
+        //  inside the count elements and returns the number of elements converted.
+
+        template <typename Pattern>
+        inline size_t PermuteSsse3(const unsigned char* const pSrc, unsigned char* const pDest, size_t count, const PermuteControl<Pattern>& control)
+        {
+            const size_t inBytes = count * Pattern::kInBytes;
+            const size_t outBytes = count * Pattern::kOutBytes;
+            size_t i = 0;
+            for (; i * Pattern::kInBytes + 16 <= inBytes && i * Pattern::kOutBytes + 16 <= outBytes; i += PermuteControl<Pattern>::kGroup)
+            {
+                const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + i * Pattern::kInBytes));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(pDest + i * Pattern::kOutBytes), _mm_or_si128(_mm_shuffle_epi8(v, control.shuffle), control.ones));
+            }
+            return i;
+        }
+
+#if defined(EXTRAS_SIMD_AVX2)
+        //  vpshufb shuffles each 128 bit lane separately so each lane holds one group. When the
+        //  groups aren't exactly 16 bytes the lanes are loaded or stored separately.
+
+        template <typename Pattern>
+        inline size_t PermuteAvx2(const unsigned char* const pSrc, unsigned char* const pDest, size_t count, const PermuteControl<Pattern>& control)
+        {
+            typedef PermuteControl<Pattern> Control;
+            const size_t inBytes = count * Pattern::kInBytes;
+            const size_t outBytes = count * Pattern::kOutBytes;
+            const __m256i shuffle = _mm256_inserti128_si256(_mm256_castsi128_si256(control.shuffle), control.shuffle, 1);
+            const __m256i ones = _mm256_inserti128_si256(_mm256_castsi128_si256(control.ones), control.ones, 1);
+            size_t i = 0;
+            for (; (i + Control::kGroup) * Pattern::kInBytes + 16 <= inBytes && (i + Control::kGroup) * Pattern::kOutBytes + 16 <= outBytes; i += 2 * Control::kGroup)
+            {
+                const unsigned char* const pIn = pSrc + i * Pattern::kInBytes;
+                unsigned char* const pOut = pDest + i * Pattern::kOutBytes;
+                __m256i v;
+                if (Control::kInStep == 16)
+                    v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pIn));
+                else
+                    v = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pIn))),
+                        _mm_loadu_si128(reinterpret_cast<const __m128i*>(pIn + Control::kInStep)), 1);
+                v = _mm256_or_si256(_mm256_shuffle_epi8(v, shuffle), ones);
+                if (Control::kOutStep == 16)
+                {
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(pOut), v);
+                }
+                else
+                {
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(pOut), _mm256_castsi256_si128(v));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(pOut + Control::kOutStep), _mm256_extracti128_si256(v, 1));
+                }
+            }
+            return i;
+        }
+#endif
+
+#if defined(EXTRAS_SIMD_AVX512)
+        template <typename Pattern>
+        inline size_t PermuteAvx512(const unsigned char* const pSrc, unsigned char* const pDest, size_t count, const PermuteControl<Pattern>& control)
+        {
+            typedef PermuteControl<Pattern> Control;
+            const size_t inBytes = count * Pattern::kInBytes;
+            const size_t outBytes = count * Pattern::kOutBytes;
+            const __m512i shuffle = _mm512_broadcast_i32x4(control.shuffle);
+            const __m512i ones = _mm512_broadcast_i32x4(control.ones);
+            size_t i = 0;
+            for (; (i + 3 * Control::kGroup) * Pattern::kInBytes + 16 <= inBytes && (i + 3 * Control::kGroup) * Pattern::kOutBytes + 16 <= outBytes; i += 4 * Control::kGroup)
+            {
+                const unsigned char* const pIn = pSrc + i * Pattern::kInBytes;
+                unsigned char* const pOut = pDest + i * Pattern::kOutBytes;
+                __m512i v;
+                if (Control::kInStep == 16)
+                {
+                    v = _mm512_loadu_si512(pIn);
+                }
+                else
+                {
+                    v = _mm512_castsi128_si512(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pIn)));
+                    v = _mm512_inserti32x4(v, _mm_loadu_si128(reinterpret_cast<const __m128i*>(pIn + Control::kInStep)), 1);
+                    v = _mm512_inserti32x4(v, _mm_loadu_si128(reinterpret_cast<const __m128i*>(pIn + 2 * Control::kInStep)), 2);
+                    v = _mm512_inserti32x4(v, _mm_loadu_si128(reinterpret_cast<const __m128i*>(pIn + 3 * Control::kInStep)), 3);
+                }
+                v = _mm512_or_si512(_mm512_shuffle_epi8(v, shuffle), ones);
+                if (Control::kOutStep == 16)
+                {
+                    _mm512_storeu_si512(pOut, v);
+                }
+                else
+                {
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(pOut), _mm512_castsi512_si128(v));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(pOut + Control::kOutStep), _mm512_extracti32x4_epi32(v, 1));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(pOut + 2 * Control::kOutStep), _mm512_extracti32x4_epi32(v, 2));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(pOut + 3 * Control::kOutStep), _mm512_extracti32x4_epi32(v, 3));
+                }
+            }
+            return i;
+        }
+#endif
+
+        //  Runs the widest kernel allowed by level and hands what's left to the narrower ones.
+
+        template <typename Pattern>
+        inline void PermuteRange(const unsigned char* const pSrc, unsigned char* const pDest, size_t count, const PermuteControl<Pattern>& control, SimdLevel level)
+        {
+            size_t done = 0;
+#if defined(EXTRAS_SIMD_AVX512)
+            if (level >= SimdLevel::Avx512)
+                done += PermuteAvx512(pSrc, pDest, count, control);
+#endif
+#if defined(EXTRAS_SIMD_AVX2)
+            if (level >= SimdLevel::Avx2)
+                done += PermuteAvx2(pSrc + done * Pattern::kInBytes, pDest + done * Pattern::kOutBytes, count - done, control);
+#endif
+            if (level >= SimdLevel::Ssse3)
+                done += PermuteSsse3(pSrc + done * Pattern::kInBytes, pDest + done * Pattern::kOutBytes, count - done, control);
+            PermuteScalar<Pattern>(pSrc + done * Pattern::kInBytes, pDest + done * Pattern::kOutBytes, count - done);
+        }
+    }
+
+    //  Applies Pattern to count elements. pSrc and pDest may be the same buffer when the input
+    //  and output elements are the same size and that size divides 16, otherwise they must not
+    //  overlap. The level overload is for testing and benchmarking each kernel.
+
+    template <typename Pattern>
+    inline void PermuteBytes(const void* const pSrc, void* const pDest, size_t count, SimdLevel level)
+    {
+        const unsigned char* const pIn = static_cast<const unsigned char*>(pSrc);
+        unsigned char* const pOut = static_cast<unsigned char*>(pDest);
+        assert(pIn != pOut || (Pattern::kInBytes == Pattern::kOutBytes && 16 % Pattern::kInBytes == 0));
+
+        const details::PermuteControl<Pattern>* const pControl = &details::PermuteControl<Pattern>::Get();
+        if (count * Pattern::kOutBytes <= kParallelPermuteThreshold)
+        {
+            details::PermuteRange(pIn, pOut, count, *pControl, level);
+            return;
+        }
+
+        const size_t chunkSize = details::kPermuteChunkBytes / Pattern::kOutBytes;
+        const size_t chunks = (count + chunkSize - 1) / chunkSize;
+        concurrency::parallel_for(size_t(0), chunks, [=](size_t c)
+        {
+            const size_t first = c * chunkSize;
+            details::PermuteRange(pIn + first * Pattern::kInBytes, pOut + first * Pattern::kOutBytes, (std::min)(chunkSize, count - first), *pControl, level);
+        });
+    }
+
+    template <typename Pattern>
+    inline void PermuteBytes(const void* const pSrc, void* const pDest, size_t count)
+    {
+        PermuteBytes<Pattern>(pSrc, pDest, count, GetSimdLevel());
+    }
+
+    //--------------------------------------------------------------------------------------
+    //  In place reversal.
+    //--------------------------------------------------------------------------------------
+
+    namespace details
+    {
+        //  Each function swaps pLow[i] with pHighEnd[-1 - i] for whole blocks while i < count and
+        //  returns the number of bytes swapped. The two ranges must not overlap.
+
+        inline size_t SwapReversedSse2(unsigned char* const pLow, unsigned char* const pHighEnd, size_t count)
+        {
+            size_t i = 0;
+            for (; i + 16 <= count; i += 16)
+            {
+                __m128i* const pLeft = reinterpret_cast<__m128i*>(pLow + i);
+                __m128i* const pRight = reinterpret_cast<__m128i*>(pHighEnd - i - 16);
+                __m128i blocks[2] = { _mm_loadu_si128(pRight), _mm_loadu_si128(pLeft) };
+                for (int b = 0; b < 2; ++b)
+                {
+                    //  Swap the bytes in each word then reverse the words.
+                    __m128i v = _mm_or_si128(_mm_slli_epi16(blocks[b], 8), _mm_srli_epi16(blocks[b], 8));
+                    v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+                    v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+                    blocks[b] = _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+                }
+                _mm_storeu_si128(pLeft, blocks[0]);
+                _mm_storeu_si128(pRight, blocks[1]);
+            }
+            return i;
+        }
+
+        inline size_t SwapReversedSsse3(unsigned char* const pLow, unsigned char* const pHighEnd, size_t count)
+        {
+            const __m128i control = _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+            size_t i = 0;
+            for (; i + 16 <= count; i += 16)
+            {
+                __m128i* const pLeft = reinterpret_cast<__m128i*>(pLow + i);
+                __m128i* const pRight = reinterpret_cast<__m128i*>(pHighEnd - i - 16);
+                const __m128i left = _mm_loadu_si128(pLeft);
+                const __m128i right = _mm_loadu_si128(pRight);
+                _mm_storeu_si128(pLeft, _mm_shuffle_epi8(right, control));
+                _mm_storeu_si128(pRight, _mm_shuffle_epi8(left, control));
+            }
+            return i;
+        }
+
+#if defined(EXTRAS_SIMD_AVX2)
+        //  Reverse the bytes within each 128 bit lane and then swap the lanes.
+
+        inline size_t SwapReversedAvx2(unsigned char* const pLow, unsigned char* const pHighEnd, size_t count)
+        {
+            const __m128i lane = _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+            const __m256i control = _mm256_inserti128_si256(_mm256_castsi128_si256(lane), lane, 1);
+            size_t i = 0;
+            for (; i + 32 <= count; i += 32)
+            {
+                __m256i* const pLeft = reinterpret_cast<__m256i*>(pLow + i);
+                __m256i* const pRight = reinterpret_cast<__m256i*>(pHighEnd - i - 32);
+                const __m256i left = _mm256_loadu_si256(pLeft);
+                const __m256i right = _mm256_loadu_si256(pRight);
+                _mm256_storeu_si256(pLeft, _mm256_permute4x64_epi64(_mm256_shuffle_epi8(right, control), _MM_SHUFFLE(1, 0, 3, 2)));
+                _mm256_storeu_si256(pRight, _mm256_permute4x64_epi64(_mm256_shuffle_epi8(left, control), _MM_SHUFFLE(1, 0, 3, 2)));
+            }
+            return i;
+        }
+#endif
+
+#if defined(EXTRAS_SIMD_AVX512)
+        inline size_t SwapReversedAvx512(unsigned char* const pLow, unsigned char* const pHighEnd, size_t count)
+        {
+            const __m512i control = _mm512_broadcast_i32x4(_mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0));
+            size_t i = 0;
+            for (; i + 64 <= count; i += 64)
+            {
+                unsigned char* const pLeft = pLow + i;
+                unsigned char* const pRight = pHighEnd - i - 64;
+                const __m512i left = _mm512_shuffle_epi8(_mm512_loadu_si512(pLeft), control);
+                const __m512i right = _mm512_shuffle_epi8(_mm512_loadu_si512(pRight), control);
+                _mm512_storeu_si512(pLeft, _mm512_shuffle_i64x2(right, right, _MM_SHUFFLE(0, 1, 2, 3)));
+                _mm512_storeu_si512(pRight, _mm512_shuffle_i64x2(left, left, _MM_SHUFFLE(0, 1, 2, 3)));
+            }
+            return i;
+        }
+#endif
+
+        inline void SwapReversed(unsigned char* const pLow, unsigned char* const pHighEnd, size_t count, SimdLevel level)
+        {
+            size_t done = 0;
+#if defined(EXTRAS_SIMD_AVX512)
+            if (level >= SimdLevel::Avx512)
+                done += SwapReversedAvx512(pLow, pHighEnd, count);
+#endif
+#if defined(EXTRAS_SIMD_AVX2)
+            if (level >= SimdLevel::Avx2)
+                done += SwapReversedAvx2(pLow + done, pHighEnd - done, count - done);
+#endif
+            if (level >= SimdLevel::Ssse3)
+                done += SwapReversedSsse3(pLow + done, pHighEnd - done, count - done);
+            else
+                done += SwapReversedSse2(pLow + done, pHighEnd - done, count - done);
+            for (; done < count; ++done)
+                std::swap(pLow[done], pHighEnd[-1 - static_cast<ptrdiff_t>(done)]);
+        }
+    }
+
+    //  Reverses length bytes in place. Large buffers are split into chunks of the lower half,
+    //  each swapped with its mirror image in the upper half on a separate thread.
+
+    inline void ReverseBytes(void* const pData, size_t length, SimdLevel level)
+    {
+        unsigned char* const p = static_cast<unsigned char*>(pData);
+        const size_t half = length / 2;
+        if (length <= kParallelPermuteThreshold)
+        {
+            details::SwapReversed(p, p + length, half, level);
+            return;
+        }
+
+        const size_t chunks = (half + details::kPermuteChunkBytes - 1) / details::kPermuteChunkBytes;
+        concurrency::parallel_for(size_t(0), chunks, [=](size_t c)
+        {
+            const size_t first = c * details::kPermuteChunkBytes;
+            details::SwapReversed(p + first, p + length - first, (std::min)(details::kPermuteChunkBytes, half - first), level);
+        });
+    }
+
+    inline void ReverseBytes(void* const pData, size_t length)
+    {
+        ReverseBytes(pData, length, GetSimdLevel());
+    }
+
+    //--------------------------------------------------------------------------------------
+    //  Byte blending.
+    //--------------------------------------------------------------------------------------
+
+    namespace details
+    {
+        //  Each function blends whole registers and returns the number of bytes done. The weights
+        //  sum to 256 so a * weightA + b * weightB fits in an unsigned 16 bit lane.
+
+        inline size_t LerpSse2(const unsigned char* const pA, const unsigned char* const pB, unsigned char* const pDest, size_t count, int weightA)
+        {
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i wa = _mm_set1_epi16(static_cast<short>(weightA));
+            const __m128i wb = _mm_set1_epi16(static_cast<short>(256 - weightA));
+            size_t i = 0;
+            for (; i + 16 <= count; i += 16)
+            {
+                const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pA + i));
+                const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pB + i));
+                const __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), wa), _mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), wb));
+                const __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), wa), _mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), wb));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(pDest + i), _mm_packus_epi16(_mm_srli_epi16(lo, 8), _mm_srli_epi16(hi, 8)));
+            }
+            return i;
+        }
+
+#if defined(EXTRAS_SIMD_AVX2)
+        //  The unpacks and the pack both work within 128 bit lanes so the byte order is preserved.
+
+        inline size_t LerpAvx2(const unsigned char* const pA, const unsigned char* const pB, unsigned char* const pDest, size_t count, int weightA)
+        {
+            const __m256i zero = _mm256_setzero_si256();
+            const __m256i wa = _mm256_set1_epi16(static_cast<short>(weightA));
+            const __m256i wb = _mm256_set1_epi16(static_cast<short>(256 - weightA));
+            size_t i = 0;
+            for (; i + 32 <= count; i += 32)
+            {
+                const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pA + i));
+                const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pB + i));
+                const __m256i lo = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(a, zero), wa), _mm256_mullo_epi16(_mm256_unpacklo_epi8(b, zero), wb));
+                const __m256i hi = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(a, zero), wa), _mm256_mullo_epi16(_mm256_unpackhi_epi8(b, zero), wb));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(pDest + i), _mm256_packus_epi16(_mm256_srli_epi16(lo, 8), _mm256_srli_epi16(hi, 8)));
+            }
+            return i;
+        }
+#endif
+
+#if defined(EXTRAS_SIMD_AVX512)
+        inline size_t LerpAvx512(const unsigned char* const pA, const unsigned char* const pB, unsigned char* const pDest, size_t count, int weightA)
+        {
+            const __m512i zero = _mm512_setzero_si512();
+            const __m512i wa = _mm512_set1_epi16(static_cast<short>(weightA));
+            const __m512i wb = _mm512_set1_epi16(static_cast<short>(256 - weightA));
+            size_t i = 0;
+            for (; i + 64 <= count; i += 64)
+            {
+                const __m512i a = _mm512_loadu_si512(pA + i);
+                const __m512i b = _mm512_loadu_si512(pB + i);
+                const __m512i lo = _mm512_add_epi16(_mm512_mullo_epi16(_mm512_unpacklo_epi8(a, zero), wa), _mm512_mullo_epi16(_mm512_unpacklo_epi8(b, zero), wb));
+                const __m512i hi = _mm512_add_epi16(_mm512_mullo_epi16(_mm512_unpackhi_epi8(a, zero), wa), _mm512_mullo_epi16(_mm512_unpackhi_epi8(b, zero), wb));
+                _mm512_storeu_si512(pDest + i, _mm512_packus_epi16(_mm512_srli_epi16(lo, 8), _mm512_srli_epi16(hi, 8)));
+            }
+            return i;
+        }
+#endif
+
+        inline void LerpRange(const unsigned char* const pA, const unsigned char* const pB, unsigned char* const pDest, size_t count, int weightA, SimdLevel level)
+        {
+            size_t done = 0;
+#if defined(EXTRAS_SIMD_AVX512)
+            if (level >= SimdLevel::Avx512)
+                done += LerpAvx512(pA, pB, pDest, count, weightA);
+#endif
+#if defined(EXTRAS_SIMD_AVX2)
+            if (level >= SimdLevel::Avx2)
+                done += LerpAvx2(pA + done, pB + done, pDest + done, count - done, weightA);
+#endif
+            done += LerpSse2(pA + done, pB + done, pDest + done, count - done, weightA);
+            for (; done < count; ++done)
+                pDest[done] = static_cast<unsigned char>((pA[done] * weightA + pB[done] * (256 - weightA)) >> 8);
+        }
+    }
+
+    //  pDest[i] = pA[i] * weightA + pB[i] * (1 - weightA) for count bytes, weightA in [0, 1]. The
+    //  weight is rounded to a multiple of 1/256 and the result is truncated, as a float to
+    //  unsigned char conversion would be, so it's within one of the float calculation.
+
+    inline void LerpBytes(const void* const pA, const void* const pB, void* const pDest, size_t count, float weightA, SimdLevel level)
+    {
+        const unsigned char* const pFirst = static_cast<const unsigned char*>(pA);
+        const unsigned char* const pSecond = static_cast<const unsigned char*>(pB);
+        unsigned char* const pOut = static_cast<unsigned char*>(pDest);
+        const int weight = (std::min)(256, (std::max)(0, static_cast<int>(weightA * 256.0f + 0.5f)));
+        if (count <= kParallelPermuteThreshold)
+        {
+            details::LerpRange(pFirst, pSecond, pOut, count, weight, level);
+            return;
+        }
+
+        const size_t chunks = (count + details::kPermuteChunkBytes - 1) / details::kPermuteChunkBytes;
+        concurrency::parallel_for(size_t(0), chunks, [=](size_t c)
+        {
+            const size_t first = c * details::kPermuteChunkBytes;
+            details::LerpRange(pFirst + first, pSecond + first, pOut + first, (std::min)(details::kPermuteChunkBytes, count - first), weight, level);
+        });
+    }
+
+    inline void LerpBytes(const void* const pA, const void* const pB, void* const pDest, size_t count, float weightA)
+    {
+        LerpBytes(pA, pB, pDest, count, weightA, GetSimdLevel());
+    }
+}
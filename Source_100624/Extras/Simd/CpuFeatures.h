@@ -0,0 +1,111 @@
+//===============================================================================
+//
+// Microsoft Press
+// C++ AMP: Accelerated Massive Parallelism with Microsoft Visual C++
+//
+//===============================================================================
+// Copyright (c) 2012 Ade Miller & Kate Gregory.  All rights reserved.
+// This code released under the terms of the
+// Microsoft Public License (Ms-PL), http://ampbook.codeplex.com/license.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//===============================================================================
+
+#pragma once
+
+#include <intrin.h>
+
+//--------------------------------------------------------------------------------------
+//  Runtime instruction set detection.
+//--------------------------------------------------------------------------------------
+//
+//  Kernels that have more than one SIMD implementation pick one at runtime with
+//  GetSimdLevel() rather than with /arch, so a single binary uses AVX2 or AVX-512 where
+//  it's available and still runs on an SSE2 only machine. A level is only reported if the
+//  operating system also saves the wider registers on a context switch. SimdLevel::Avx2 also
+//  requires FMA3, which every processor with AVX2 has.
+//
+//  Visual C++ accepts AVX2 intrinsics without /arch:AVX2 and AVX-512 intrinsics from VS2017
+//  15.3. Other compilers only accept them when the matching -m option is given. The
+//  EXTRAS_SIMD_AVX2 and EXTRAS_SIMD_AVX512 macros say which kernels can be compiled and
+//  GetSimdLevel() never reports a level that wasn't.
+
+#if defined(_MSC_VER) || (defined(__AVX2__) && defined(__FMA__))
+#define EXTRAS_SIMD_AVX2 1
+#endif
+
+#if (defined(_MSC_VER) && _MSC_VER >= 1911) || (defined(__AVX512F__) && defined(__AVX512BW__))
+#define EXTRAS_SIMD_AVX512 1
+#endif
+
+namespace Extras
+{
+    enum class SimdLevel
+    {
+        Sse2,
+        Ssse3,
+        Avx2,
+        Avx512
+    };
+
+    namespace details
+    {
+        inline SimdLevel DetectSimdLevel()
+        {
+            int info[4];
+            __cpuid(info, 0);
+            const int maxLeaf = info[0];
+
+            __cpuid(info, 1);
+            const bool ssse3 = (info[2] & (1 << 9)) != 0;
+            const bool osxsave = (info[2] & (1 << 27)) != 0;
+            const bool fma = (info[2] & (1 << 12)) != 0;
+            const bool avx = (info[2] & (1 << 28)) != 0;
+            if (!ssse3)
+                return SimdLevel::Sse2;
+            if (!osxsave || !avx || maxLeaf < 7)
+                return SimdLevel::Ssse3;
+
+            //  XCR0 bits 1 and 2 are the SSE and AVX state, bits 5 to 7 the AVX-512 state.
+            const unsigned long long xcr0 = _xgetbv(0);
+            if ((xcr0 & 0x06) != 0x06)
+                return SimdLevel::Ssse3;
+
+            __cpuidex(info, 7, 0);
+            if ((info[1] & (1 << 5)) == 0 || !fma)
+                return SimdLevel::Ssse3;
+#if defined(EXTRAS_SIMD_AVX512)
+            //  AVX512F plus AVX512BW for the byte and word instructions.
+            if ((info[1] & (1 << 16)) != 0 && (info[1] & (1 << 30)) != 0 && (xcr0 & 0xE0) == 0xE0)
+                return SimdLevel::Avx512;
+#endif
+#if defined(EXTRAS_SIMD_AVX2)
+            return SimdLevel::Avx2;
+#else
+            return SimdLevel::Ssse3;
+#endif
+        }
+
+        //  Detected during static initialization, before the program starts any threads. A
+        //  function local static isn't thread safe with v110.
+
+        template <typename Unused = void>
+        struct DetectedSimdLevel
+        {
+            static const SimdLevel value;
+        };
+
+        template <typename Unused>
+        const SimdLevel DetectedSimdLevel<Unused>::value = DetectSimdLevel();
+    }
+
+    //  The widest level supported by both the processor and the operating system.
+
+    inline SimdLevel GetSimdLevel()
+    {
+        return details::DetectedSimdLevel<>::value;
+    }
+}
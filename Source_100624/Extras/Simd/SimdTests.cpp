@@ -0,0 +1,501 @@
+//===============================================================================
+//
+// Microsoft Press
+// C++ AMP: Accelerated Massive Parallelism with Microsoft Visual C++
+//
+//===============================================================================
+// Copyright (c) 2012 Ade Miller & Kate Gregory.  All rights reserved.
+// This code released under the terms of the
+// Microsoft Public License (Ms-PL), http://ampbook.codeplex.com/license.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//===============================================================================
+
+#include "stdafx.h"
+
+#include "VectorPacket.h"
+#include "BytePermute.h"
+#include "Blas1.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Extras;
+
+namespace SimdTests
+{
+    //  Scalar helpers as written in the Morph sample.
+
+    float dot(const float_2& a, const float_2& b) { return a.x * b.x + a.y * b.y; }
+    float length_sq(const float_2& a) { return dot(a, a); }
+    float_2 flip_perpendicular(const float_2& a) { return float_2(-a.y, a.x); }
+
+    //  The same source compiles for both float_2 and Float2Packet.
+
+    template <typename Vector2, typename Scalar>
+    Scalar ProjectOntoLine(const Vector2& p, const Vector2& q, const Vector2& x, Scalar& v)
+    {
+        const Vector2 pq = q - p;
+        const Vector2 px = x - p;
+        v = dot(px, flip_perpendicular(pq));
+        return dot(px, pq) / length_sq(pq);
+    }
+
+    struct PaddedParticle
+    {
+        float_3 pos;
+        float mass;
+        float_3 vel;
+        float pad;
+    };
+
+    template <int W>
+    void CheckArithmetic()
+    {
+        float a[W], b[W], result[W];
+        for (int i = 0; i < W; ++i)
+        {
+            a[i] = float(i + 1);
+            b[i] = float(2 * i - 3);
+        }
+
+        const FloatPacket<W> pa = FloatPacket<W>::Load(a);
+        const FloatPacket<W> pb = FloatPacket<W>::Load(b);
+        ((pa + pb) * 2.0f - 1.0f / pa).Store(result);
+
+        for (int i = 0; i < W; ++i)
+            Assert::AreEqual((a[i] + b[i]) * 2.0f - 1.0f / a[i], result[i], 1e-6f);
+
+        Assert::AreEqual(std::max(a[W - 1], b[W - 1]), Max(pa, pb)[W - 1]);
+        Assert::AreEqual(-3.0f, Min(pa, pb)[0]);
+        Assert::AreEqual(-1.0f, (-pa)[0]);
+    }
+
+    template <int W>
+    void CheckRsqrt()
+    {
+        float values[W];
+        for (int i = 0; i < W; ++i)
+            values[i] = 0.01f + i * 37.5f;
+
+        const FloatPacket<W> r = Rsqrt(FloatPacket<W>::Load(values));
+        for (int i = 0; i < W; ++i)
+        {
+            const float expected = 1.0f / sqrtf(values[i]);
+            Assert::AreEqual(expected, r[i], expected * 1e-6f);
+        }
+    }
+
+    template <int W>
+    void CheckSelect()
+    {
+        float values[W];
+        for (int i = 0; i < W; ++i)
+            values[i] = float(i);
+
+        const FloatPacket<W> p = FloatPacket<W>::Load(values);
+        const MaskPacket<W> odd = (p > 0.5f) & (p < 2.5f);
+
+        Assert::AreEqual(6, odd.Bits());
+        Assert::IsTrue(odd.Any());
+        Assert::IsFalse(odd.All());
+        Assert::IsTrue((odd | !odd).All());
+
+        const Float3Packet<W> v = Select(odd, Float3Packet<W>(float_3(1.0f, 2.0f, 3.0f)), Float3Packet<W>(float_3(0.0f)));
+        Assert::AreEqual(0.0f, v[0].y);
+        Assert::AreEqual(2.0f, v[1].y);
+        Assert::AreEqual(3.0f, v[2].z);
+        Assert::AreEqual(0.0f, v[3].z);
+    }
+
+    template <int W>
+    void CheckGatherScatter()
+    {
+        std::vector<PaddedParticle> particles(W);
+        for (int i = 0; i < W; ++i)
+        {
+            particles[i].pos = float_3(float(i), float(i * 2), float(i * 3));
+            particles[i].mass = -1.0f;
+        }
+
+        Float3Packet<W> pos = Float3Packet<W>::Gather(&particles[0].pos, sizeof(PaddedParticle));
+        Assert::AreEqual(float(14 * (W - 1) * (W - 1)), SqrLength(pos - Float3Packet<W>(float_3(0.0f, 0.0f, 0.0f)))[W - 1]);
+
+        pos += Float3Packet<W>(float_3(1.0f, 1.0f, 1.0f));
+        pos.Scatter(&particles[0].pos, sizeof(PaddedParticle));
+        for (int i = 0; i < W; ++i)
+        {
+            Assert::AreEqual(float(i * 3 + 1), particles[i].pos.z);
+            Assert::AreEqual(-1.0f, particles[i].mass);
+        }
+    }
+
+    template <int W>
+    void CheckMatchesScalar()
+    {
+        const float_2 p(1.0f, 2.0f);
+        const float_2 q(4.0f, 6.0f);
+        float xs[W], ys[W];
+        for (int i = 0; i < W; ++i)
+        {
+            xs[i] = 0.5f * i - 1.0f;
+            ys[i] = 3.0f - i;
+        }
+
+        FloatPacket<W> vPacket;
+        const FloatPacket<W> uPacket = ProjectOntoLine(Float2Packet<W>(p), Float2Packet<W>(q), Float2Packet<W>::Load(xs, ys), vPacket);
+        for (int i = 0; i < W; ++i)
+        {
+            float v;
+            const float u = ProjectOntoLine(p, q, float_2(xs[i], ys[i]), v);
+            Assert::AreEqual(u, uPacket[i], 1e-6f);
+            Assert::AreEqual(v, vPacket[i], 1e-6f);
+        }
+    }
+
+    TEST_CLASS(VectorPacketTests)
+    {
+    public:
+        TEST_METHOD(VectorPacketTests_Arithmetic)
+        {
+            CheckArithmetic<4>();
+            CheckArithmetic<kNativePacketWidth>();
+        }
+
+        TEST_METHOD(VectorPacketTests_Rsqrt)
+        {
+            CheckRsqrt<4>();
+            CheckRsqrt<kNativePacketWidth>();
+        }
+
+        TEST_METHOD(VectorPacketTests_MaskAndSelect)
+        {
+            CheckSelect<4>();
+            CheckSelect<kNativePacketWidth>();
+        }
+
+        TEST_METHOD(VectorPacketTests_GatherScatter)
+        {
+            CheckGatherScatter<4>();
+            CheckGatherScatter<kNativePacketWidth>();
+        }
+
+        TEST_METHOD(VectorPacketTests_MatchesScalarHelpers)
+        {
+            CheckMatchesScalar<4>();
+            CheckMatchesScalar<kNativePacketWidth>();
+        }
+    };
+
+    //  Every level the test machine supports, so each kernel up to the widest one is checked.
+
+    std::vector<SimdLevel> SupportedLevels()
+    {
+        std::vector<SimdLevel> levels;
+        levels.push_back(SimdLevel::Sse2);
+        if (GetSimdLevel() >= SimdLevel::Ssse3)
+            levels.push_back(SimdLevel::Ssse3);
+        if (GetSimdLevel() >= SimdLevel::Avx2)
+            levels.push_back(SimdLevel::Avx2);
+        if (GetSimdLevel() >= SimdLevel::Avx512)
+            levels.push_back(SimdLevel::Avx512);
+        return levels;
+    }
+
+    std::vector<unsigned char> MakeBytes(size_t count)
+    {
+        std::vector<unsigned char> bytes(count);
+        for (size_t i = 0; i < count; ++i)
+            bytes[i] = static_cast<unsigned char>(i * 7 + i / 251);
+        return bytes;
+    }
+
+    template <typename Pattern>
+    std::vector<unsigned char> ReferencePermute(const std::vector<unsigned char>& input, size_t count)
+    {
+        std::vector<unsigned char> output(count * Pattern::kOutBytes);
+        for (size_t i = 0; i < count; ++i)
+        {
+            for (int b = 0; b < Pattern::kOutBytes; ++b)
+            {
+                const int source = Pattern::Source(b);
+                output[i * Pattern::kOutBytes + b] = (source >= 0) ? input[i * Pattern::kInBytes + source] : ((source == kPermuteOnes) ? 0xFF : 0);
+            }
+        }
+        return output;
+    }
+
+    template <typename Pattern>
+    void CheckPermute(size_t maxCount)
+    {
+        const std::vector<SimdLevel> levels = SupportedLevels();
+        for (size_t l = 0; l < levels.size(); ++l)
+        {
+            for (size_t count = 0; count <= maxCount; ++count)
+            {
+                const std::vector<unsigned char> input = MakeBytes(count * Pattern::kInBytes);
+                const std::vector<unsigned char> expected = ReferencePermute<Pattern>(input, count);
+
+                //  Guard bytes either side of the output catch any stray stores.
+                std::vector<unsigned char> output(count * Pattern::kOutBytes + 64, 0xCD);
+                PermuteBytes<Pattern>(input.data(), output.data() + 32, count, levels[l]);
+
+                Assert::IsTrue(std::equal(expected.begin(), expected.end(), output.begin() + 32));
+                Assert::IsTrue(std::count(output.begin(), output.begin() + 32, 0xCD) == 32);
+                Assert::IsTrue(std::count(output.end() - 32, output.end(), 0xCD) == 32);
+            }
+        }
+    }
+
+    TEST_CLASS(BytePermuteTests)
+    {
+    public:
+        TEST_METHOD(BytePermuteTests_ByteSwaps)
+        {
+            CheckPermute<ByteSwap16>(100);
+            CheckPermute<ByteSwap32>(100);
+            CheckPermute<ByteSwap64>(100);
+        }
+
+        TEST_METHOD(BytePermuteTests_PixelChannels)
+        {
+            CheckPermute<SwapRedBlue>(100);
+            CheckPermute<Expand24To32>(100);
+            CheckPermute<Pack32To24>(100);
+        }
+
+        TEST_METHOD(BytePermuteTests_InPlace)
+        {
+            const std::vector<SimdLevel> levels = SupportedLevels();
+            for (size_t l = 0; l < levels.size(); ++l)
+            {
+                std::vector<unsigned char> data = MakeBytes(4 * 1001);
+                const std::vector<unsigned char> expected = ReferencePermute<SwapRedBlue>(data, 1001);
+
+                PermuteBytes<SwapRedBlue>(data.data(), data.data(), 1001, levels[l]);
+
+                Assert::IsTrue(expected == data);
+            }
+        }
+
+        TEST_METHOD(BytePermuteTests_LargeBufferRoundTrip)
+        {
+            const size_t count = 2 * 1024 * 1024 + 5;
+            const std::vector<unsigned char> input = MakeBytes(count * 3);
+            std::vector<unsigned char> pixels(count * 4);
+            std::vector<unsigned char> output(count * 3);
+
+            PermuteBytes<Expand24To32>(input.data(), pixels.data(), count);
+            PermuteBytes<Pack32To24>(pixels.data(), output.data(), count);
+
+            Assert::IsTrue(ReferencePermute<Expand24To32>(input, count) == pixels);
+            Assert::IsTrue(input == output);
+        }
+
+        TEST_METHOD(BytePermuteTests_ReverseBytes)
+        {
+            const std::vector<SimdLevel> levels = SupportedLevels();
+            for (size_t l = 0; l < levels.size(); ++l)
+            {
+                for (size_t length = 0; length < 300; ++length)
+                {
+                    std::vector<unsigned char> data = MakeBytes(length);
+                    const std::vector<unsigned char> expected(data.rbegin(), data.rend());
+
+                    ReverseBytes(data.data(), data.size(), levels[l]);
+
+                    Assert::IsTrue(expected == data);
+                }
+            }
+
+            std::vector<unsigned char> large = MakeBytes(5 * 1024 * 1024 + 3);
+            const std::vector<unsigned char> expected(large.rbegin(), large.rend());
+            ReverseBytes(large.data(), large.size());
+            Assert::IsTrue(expected == large);
+        }
+
+        TEST_METHOD(BytePermuteTests_LerpBytesMatchesFloat)
+        {
+            const std::vector<SimdLevel> levels = SupportedLevels();
+            const float weights[] = { 0.0f, 0.3f, 0.5f, 0.77f, 1.0f };
+            for (size_t l = 0; l < levels.size(); ++l)
+            {
+                for (int w = 0; w < 5; ++w)
+                {
+                    for (size_t count = 0; count < 200; count += 13)
+                    {
+                        const std::vector<unsigned char> a = MakeBytes(count);
+                        const std::vector<unsigned char> b(a.rbegin(), a.rend());
+                        std::vector<unsigned char> output(count);
+
+                        LerpBytes(a.data(), b.data(), output.data(), count, weights[w], levels[l]);
+
+                        for (size_t i = 0; i < count; ++i)
+                        {
+                            const int expected = static_cast<int>(a[i] * weights[w] + b[i] * (1.0f - weights[w]));
+                            Assert::IsTrue(abs(expected - output[i]) <= 1);
+                        }
+                    }
+                }
+            }
+        }
+    };
+
+    std::vector<float> MakeFloats(size_t count, float seed)
+    {
+        std::vector<float> values(count);
+        for (size_t i = 0; i < count; ++i)
+            values[i] = float(int((i * 37 + size_t(seed * 11)) % 101) - 50) / 16.0f + seed;
+        return values;
+    }
+
+    bool AreClose(double expected, double actual, double tolerance)
+    {
+        return fabs(expected - actual) <= tolerance * (std::max)(1.0, fabs(expected));
+    }
+
+    TEST_CLASS(Blas1Tests)
+    {
+    public:
+        //  Offsets into the vectors give every alignment of the output relative to the inputs.
+
+        TEST_METHOD(Blas1Tests_ElementwiseMatchesScalar)
+        {
+            const std::vector<SimdLevel> levels = SupportedLevels();
+            for (size_t l = 0; l < levels.size(); ++l)
+            {
+                for (size_t offset = 0; offset < 4; ++offset)
+                {
+                    for (size_t count = 0; count < 150; count += 7)
+                    {
+                        const std::vector<float> x = MakeFloats(count + 4, 0.25f);
+                        const std::vector<float> y = MakeFloats(count + 4, -1.5f);
+                        const float* pX = x.data() + 3 - offset;
+                        const float* pY = y.data() + 1;
+
+                        std::vector<float> z(count + 4, -7.0f);
+                        Blas1::Add(pX, pY, z.data() + offset, count, levels[l], false);
+                        for (size_t i = 0; i < count; ++i)
+                            Assert::AreEqual(pX[i] + pY[i], z[i + offset]);
+                        Assert::AreEqual(-7.0f, z[count + offset]);
+
+                        std::vector<float> scaled(pX, pX + count);
+                        Blas1::Scale(0.5f, scaled.data(), count, levels[l], false);
+                        for (size_t i = 0; i < count; ++i)
+                            Assert::AreEqual(0.5f * pX[i], scaled[i]);
+
+                        //  Exact in both rounded and fused arithmetic, the operands are multiples of 1/64.
+                        std::vector<float> axpy(pY, pY + count);
+                        Blas1::Axpy(-2.0f, pX, axpy.data(), count, levels[l], false);
+                        for (size_t i = 0; i < count; ++i)
+                            Assert::AreEqual(pY[i] - 2.0f * pX[i], axpy[i]);
+
+                        std::vector<float> triad(count + 4);
+                        Blas1::Triad(pY, pX, 3.0f, triad.data() + offset, count, levels[l], false);
+                        for (size_t i = 0; i < count; ++i)
+                            Assert::AreEqual(pY[i] + 3.0f * pX[i], triad[i + offset]);
+
+                        std::vector<float> accumulate(count, 1.0f);
+                        Blas1::FmaAccumulate(pX, pY, accumulate.data(), count, levels[l], false);
+                        for (size_t i = 0; i < count; ++i)
+                            Assert::AreEqual(pX[i] * pY[i] + 1.0f, accumulate[i]);
+                    }
+                }
+            }
+        }
+
+        TEST_METHOD(Blas1Tests_ReductionsMatchScalar)
+        {
+            const std::vector<SimdLevel> levels = SupportedLevels();
+            for (size_t l = 0; l < levels.size(); ++l)
+            {
+                for (size_t offset = 0; offset < 4; ++offset)
+                {
+                    for (size_t count = 0; count < 300; count += 11)
+                    {
+                        const std::vector<float> x = MakeFloats(count + 4, 0.75f);
+                        const std::vector<float> y = MakeFloats(count + 4, 2.0f);
+                        const float* pX = x.data() + offset;
+                        const float* pY = y.data() + 2;
+
+                        double dot = 0.0;
+                        double squares = 0.0;
+                        float absMax = 0.0f;
+                        for (size_t i = 0; i < count; ++i)
+                        {
+                            dot += double(pX[i]) * pY[i];
+                            squares += double(pX[i]) * pX[i];
+                            absMax = (std::max)(absMax, fabsf(pX[i]));
+                        }
+
+                        Assert::IsTrue(AreClose(dot, Blas1::Dot(pX, pY, count, levels[l], false), 1e-5));
+                        Assert::IsTrue(AreClose(sqrt(squares), Blas1::Nrm2(pX, count, levels[l], false), 1e-5));
+                        Assert::AreEqual(absMax, Blas1::AbsMax(pX, count, levels[l], false));
+                    }
+                }
+            }
+        }
+
+        TEST_METHOD(Blas1Tests_LargeVectorsInParallel)
+        {
+            const size_t count = 3 * Blas1::kBlas1ParallelThreshold + 9;
+            const std::vector<float> x = MakeFloats(count, 0.5f);
+            const std::vector<float> y = MakeFloats(count, -0.25f);
+
+            std::vector<float> serial(y);
+            std::vector<float> parallel(y);
+            Blas1::Axpy(1.5f, x.data(), serial.data(), count, GetSimdLevel(), false);
+            Blas1::Axpy(1.5f, x.data(), parallel.data(), count);
+            Assert::IsTrue(serial == parallel);
+
+            double dot = 0.0;
+            for (size_t i = 0; i < count; ++i)
+                dot += double(x[i]) * y[i];
+            const float parallelDot = Blas1::Dot(x.data(), y.data(), count);
+            Assert::IsTrue(AreClose(dot, parallelDot, 1e-4));
+            Assert::AreEqual(parallelDot, Blas1::Dot(x.data(), y.data(), count));
+        }
+
+        TEST_METHOD(Blas1Tests_Nrm2AvoidsOverflowAndUnderflow)
+        {
+            const std::vector<SimdLevel> levels = SupportedLevels();
+            for (size_t l = 0; l < levels.size(); ++l)
+            {
+                std::vector<float> large(100, 3e30f);
+                large[7] = -4e30f;
+                const double expected = sqrt(99.0 * 9.0 + 16.0) * 1e30;
+                Assert::IsTrue(AreClose(expected, Blas1::Nrm2(large.data(), large.size(), levels[l], false), 1e-5));
+
+                std::vector<float> small(100, 3e-30f);
+                small[7] = -4e-30f;
+                Assert::IsTrue(AreClose(expected * 1e-60, Blas1::Nrm2(small.data(), small.size(), levels[l], false), 1e-5));
+
+                const std::vector<float> zeros(50, 0.0f);
+                Assert::AreEqual(0.0f, Blas1::Nrm2(zeros.data(), zeros.size(), levels[l], false));
+
+                const std::vector<float> subnormals(100, 1e-40f);
+                Assert::IsTrue(AreClose(10.0 * double(1e-40f), Blas1::Nrm2(subnormals.data(), subnormals.size(), levels[l], false), 1e-5));
+                const float smallest = std::numeric_limits<float>::denorm_min();
+                Assert::AreEqual(smallest, Blas1::Nrm2(&smallest, 1, levels[l], false));
+
+                large[50] = std::numeric_limits<float>::infinity();
+                Assert::IsTrue(Blas1::Nrm2(large.data(), large.size(), levels[l], false) == std::numeric_limits<float>::infinity());
+            }
+        }
+
+        TEST_METHOD(Blas1Tests_AbsMaxIgnoresNaN)
+        {
+            const std::vector<SimdLevel> levels = SupportedLevels();
+            for (size_t l = 0; l < levels.size(); ++l)
+            {
+                std::vector<float> x = MakeFloats(77, 0.0f);
+                x[40] = -100.0f;
+                x[3] = std::numeric_limits<float>::quiet_NaN();
+                x[60] = std::numeric_limits<float>::quiet_NaN();
+                Assert::AreEqual(100.0f, Blas1::AbsMax(x.data(), x.size(), levels[l], false));
+                Assert::AreEqual(0.0f, Blas1::AbsMax(x.data(), 0, levels[l], false));
+            }
+        }
+    };
+}
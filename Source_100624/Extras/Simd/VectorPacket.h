@@ -0,0 +1,465 @@
+//===============================================================================
+//
+// Microsoft Press
+// C++ AMP: Accelerated Massive Parallelism with Microsoft Visual C++
+//
+//===============================================================================
+// Copyright (c) 2012 Ade Miller & Kate Gregory.  All rights reserved.
+// This code released under the terms of the
+// Microsoft Public License (Ms-PL), http://ampbook.codeplex.com/license.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//===============================================================================
+
+#pragma once
+
+#include <math.h>
+#include <assert.h>
+#include <immintrin.h>
+#include <amp_short_vectors.h>
+
+using namespace concurrency::graphics;
+
+//--------------------------------------------------------------------------------------
+//  Short vector packets.
+//--------------------------------------------------------------------------------------
+//
+//  A packet holds W floats, one per SIMD lane. Float2Packet and Float3Packet store one
+//  packet per component (structure of arrays) so a float_3 calculation written against
+//  them computes W independent vectors with each instruction.
+//
+//  The free functions dot, length_sq, length, flip_perpendicular and SqrLength have the same
+//  names as the scalar restrict(cpu, amp) helpers used by the samples. Code written against
+//  float_2 or float_3 will compile unchanged against the packet types, argument dependent
+//  lookup finds the overloads here.
+//
+//  The native width follows the instruction set the project is compiled for: 16 lanes for
+//  /arch:AVX512, 8 for /arch:AVX or /arch:AVX2 and 4 otherwise. All widths that the compiler
+//  supports can be used explicitly, for example float3x4 in code that must run on any CPU.
+
+namespace Extras
+{
+#if defined(__AVX512F__)
+    const int kNativePacketWidth = 16;
+#elif defined(__AVX__)
+    const int kNativePacketWidth = 8;
+#else
+    const int kNativePacketWidth = 4;
+#endif
+
+    //  Register types and primitive operations for each packet width. Rsqrt uses the hardware
+    //  estimate followed by one Newton-Raphson step, giving close to full single precision.
+
+    template <int W>
+    struct PacketTraits;
+
+    template <>
+    struct PacketTraits<4>
+    {
+        typedef __m128 Register;
+        typedef __m128 Mask;
+
+        static inline Register Set1(float v) { return _mm_set1_ps(v); }
+        static inline Register Load(const float* p) { return _mm_loadu_ps(p); }
+        static inline void Store(float* p, Register v) { _mm_storeu_ps(p, v); }
+
+        static inline Register Add(Register a, Register b) { return _mm_add_ps(a, b); }
+        static inline Register Sub(Register a, Register b) { return _mm_sub_ps(a, b); }
+        static inline Register Mul(Register a, Register b) { return _mm_mul_ps(a, b); }
+        static inline Register Div(Register a, Register b) { return _mm_div_ps(a, b); }
+        static inline Register Min(Register a, Register b) { return _mm_min_ps(a, b); }
+        static inline Register Max(Register a, Register b) { return _mm_max_ps(a, b); }
+        static inline Register Sqrt(Register a) { return _mm_sqrt_ps(a); }
+        static inline Register Rsqrt(Register a)
+        {
+            const Register y = _mm_rsqrt_ps(a);
+            const Register ayy = _mm_mul_ps(_mm_mul_ps(a, y), y);
+            return _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), y), _mm_sub_ps(_mm_set1_ps(3.0f), ayy));
+        }
+
+        static inline Mask Less(Register a, Register b) { return _mm_cmplt_ps(a, b); }
+        static inline Mask LessEqual(Register a, Register b) { return _mm_cmple_ps(a, b); }
+        static inline Mask Equal(Register a, Register b) { return _mm_cmpeq_ps(a, b); }
+        static inline Mask And(Mask a, Mask b) { return _mm_and_ps(a, b); }
+        static inline Mask Or(Mask a, Mask b) { return _mm_or_ps(a, b); }
+        static inline Mask Not(Mask a) { return _mm_xor_ps(a, _mm_castsi128_ps(_mm_set1_epi32(-1))); }
+        static inline int Bits(Mask m) { return _mm_movemask_ps(m); }
+        static inline Register Select(Mask m, Register a, Register b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+    };
+
+#if defined(__AVX__)
+    template <>
+    struct PacketTraits<8>
+    {
+        typedef __m256 Register;
+        typedef __m256 Mask;
+
+        static inline Register Set1(float v) { return _mm256_set1_ps(v); }
+        static inline Register Load(const float* p) { return _mm256_loadu_ps(p); }
+        static inline void Store(float* p, Register v) { _mm256_storeu_ps(p, v); }
+
+        static inline Register Add(Register a, Register b) { return _mm256_add_ps(a, b); }
+        static inline Register Sub(Register a, Register b) { return _mm256_sub_ps(a, b); }
+        static inline Register Mul(Register a, Register b) { return _mm256_mul_ps(a, b); }
+        static inline Register Div(Register a, Register b) { return _mm256_div_ps(a, b); }
+        static inline Register Min(Register a, Register b) { return _mm256_min_ps(a, b); }
+        static inline Register Max(Register a, Register b) { return _mm256_max_ps(a, b); }
+        static inline Register Sqrt(Register a) { return _mm256_sqrt_ps(a); }
+        static inline Register Rsqrt(Register a)
+        {
+            const Register y = _mm256_rsqrt_ps(a);
+            const Register ayy = _mm256_mul_ps(_mm256_mul_ps(a, y), y);
+            return _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(0.5f), y), _mm256_sub_ps(_mm256_set1_ps(3.0f), ayy));
+        }
+
+        static inline Mask Less(Register a, Register b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+        static inline Mask LessEqual(Register a, Register b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+        static inline Mask Equal(Register a, Register b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+        static inline Mask And(Mask a, Mask b) { return _mm256_and_ps(a, b); }
+        static inline Mask Or(Mask a, Mask b) { return _mm256_or_ps(a, b); }
+        static inline Mask Not(Mask a) { return _mm256_xor_ps(a, _mm256_castsi256_ps(_mm256_set1_epi32(-1))); }
+        static inline int Bits(Mask m) { return _mm256_movemask_ps(m); }
+        static inline Register Select(Mask m, Register a, Register b) { return _mm256_blendv_ps(b, a, m); }
+    };
+#endif
+
+#if defined(__AVX512F__)
+    template <>
+    struct PacketTraits<16>
+    {
+        typedef __m512 Register;
+        typedef __mmask16 Mask;
+
+        static inline Register Set1(float v) { return _mm512_set1_ps(v); }
+        static inline Register Load(const float* p) { return _mm512_loadu_ps(p); }
+        static inline void Store(float* p, Register v) { _mm512_storeu_ps(p, v); }
+
+        static inline Register Add(Register a, Register b) { return _mm512_add_ps(a, b); }
+        static inline Register Sub(Register a, Register b) { return _mm512_sub_ps(a, b); }
+        static inline Register Mul(Register a, Register b) { return _mm512_mul_ps(a, b); }
+        static inline Register Div(Register a, Register b) { return _mm512_div_ps(a, b); }
+        static inline Register Min(Register a, Register b) { return _mm512_min_ps(a, b); }
+        static inline Register Max(Register a, Register b) { return _mm512_max_ps(a, b); }
+        static inline Register Sqrt(Register a) { return _mm512_sqrt_ps(a); }
+        static inline Register Rsqrt(Register a)
+        {
+            const Register y = _mm512_rsqrt14_ps(a);
+            const Register ayy = _mm512_mul_ps(_mm512_mul_ps(a, y), y);
+            return _mm512_mul_ps(_mm512_mul_ps(_mm512_set1_ps(0.5f), y), _mm512_sub_ps(_mm512_set1_ps(3.0f), ayy));
+        }
+
+        static inline Mask Less(Register a, Register b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+        static inline Mask LessEqual(Register a, Register b) { return _mm512_cmp_ps_mask(a, b, _CMP_LE_OQ); }
+        static inline Mask Equal(Register a, Register b) { return _mm512_cmp_ps_mask(a, b, _CMP_EQ_OQ); }
+        static inline Mask And(Mask a, Mask b) { return static_cast<Mask>(a & b); }
+        static inline Mask Or(Mask a, Mask b) { return static_cast<Mask>(a | b); }
+        static inline Mask Not(Mask a) { return static_cast<Mask>(~a); }
+        static inline int Bits(Mask m) { return m; }
+        static inline Register Select(Mask m, Register a, Register b) { return _mm512_mask_blend_ps(m, b, a); }
+    };
+#endif
+
+    //--------------------------------------------------------------------------------------
+    //  MaskPacket, one boolean per lane. Produced by comparisons and consumed by Select.
+    //--------------------------------------------------------------------------------------
+
+    template <int W>
+    class MaskPacket
+    {
+    public:
+        typedef PacketTraits<W> Traits;
+        typedef typename Traits::Mask Mask;
+
+        explicit MaskPacket(Mask m) : m_value(m) { }
+
+        Mask Value() const { return m_value; }
+
+        //  Bit i is set if lane i is true.
+        int Bits() const { return Traits::Bits(m_value); }
+        bool Any() const { return Bits() != 0; }
+        bool All() const { return Bits() == (1 << W) - 1; }
+
+        MaskPacket operator&(const MaskPacket& rhs) const { return MaskPacket(Traits::And(m_value, rhs.m_value)); }
+        MaskPacket operator|(const MaskPacket& rhs) const { return MaskPacket(Traits::Or(m_value, rhs.m_value)); }
+        MaskPacket operator!() const { return MaskPacket(Traits::Not(m_value)); }
+
+    private:
+        Mask m_value;
+    };
+
+    //--------------------------------------------------------------------------------------
+    //  FloatPacket, W floats.
+    //--------------------------------------------------------------------------------------
+
+    template <int W>
+    class FloatPacket
+    {
+    public:
+        typedef PacketTraits<W> Traits;
+        typedef typename Traits::Register Register;
+        static const int Width = W;
+
+        FloatPacket() { }
+
+        //  Broadcast a scalar to every lane. Implicit so that scalars mix with packets in expressions.
+        FloatPacket(float v) : m_value(Traits::Set1(v)) { }
+
+        explicit FloatPacket(Register v) : m_value(v) { }
+
+        static FloatPacket Load(const float* const pSrc) { return FloatPacket(Traits::Load(pSrc)); }
+
+        void Store(float* const pDest) const { Traits::Store(pDest, m_value); }
+
+        //  Load lane i from pSrc[i * stride].
+        static FloatPacket Gather(const float* const pSrc, size_t stride)
+        {
+            float lanes[W];
+            for (int i = 0; i < W; ++i)
+                lanes[i] = pSrc[i * stride];
+            return Load(lanes);
+        }
+
+        void Scatter(float* const pDest, size_t stride) const
+        {
+            float lanes[W];
+            Store(lanes);
+            for (int i = 0; i < W; ++i)
+                pDest[i * stride] = lanes[i];
+        }
+
+        float operator[](int i) const
+        {
+            assert(i >= 0 && i < W);
+            float lanes[W];
+            Store(lanes);
+            return lanes[i];
+        }
+
+        Register Value() const { return m_value; }
+
+        FloatPacket operator-() const { return FloatPacket(Traits::Sub(Traits::Set1(0.0f), m_value)); }
+
+        FloatPacket& operator+=(const FloatPacket& rhs) { m_value = Traits::Add(m_value, rhs.m_value); return *this; }
+        FloatPacket& operator-=(const FloatPacket& rhs) { m_value = Traits::Sub(m_value, rhs.m_value); return *this; }
+        FloatPacket& operator*=(const FloatPacket& rhs) { m_value = Traits::Mul(m_value, rhs.m_value); return *this; }
+        FloatPacket& operator/=(const FloatPacket& rhs) { m_value = Traits::Div(m_value, rhs.m_value); return *this; }
+
+    private:
+        Register m_value;
+    };
+
+    //  Binary operators are free functions taking the packet by value so that a float on
+    //  either side converts to a broadcast packet.
+
+    template <int W> inline FloatPacket<W> operator+(FloatPacket<W> a, const FloatPacket<W>& b) { return a += b; }
+    template <int W> inline FloatPacket<W> operator-(FloatPacket<W> a, const FloatPacket<W>& b) { return a -= b; }
+    template <int W> inline FloatPacket<W> operator*(FloatPacket<W> a, const FloatPacket<W>& b) { return a *= b; }
+    template <int W> inline FloatPacket<W> operator/(FloatPacket<W> a, const FloatPacket<W>& b) { return a /= b; }
+    template <int W> inline FloatPacket<W> operator+(FloatPacket<W> a, float b) { return a += FloatPacket<W>(b); }
+    template <int W> inline FloatPacket<W> operator-(FloatPacket<W> a, float b) { return a -= FloatPacket<W>(b); }
+    template <int W> inline FloatPacket<W> operator*(FloatPacket<W> a, float b) { return a *= FloatPacket<W>(b); }
+    template <int W> inline FloatPacket<W> operator/(FloatPacket<W> a, float b) { return a /= FloatPacket<W>(b); }
+    template <int W> inline FloatPacket<W> operator+(float a, const FloatPacket<W>& b) { return FloatPacket<W>(a) += b; }
+    template <int W> inline FloatPacket<W> operator-(float a, const FloatPacket<W>& b) { return FloatPacket<W>(a) -= b; }
+    template <int W> inline FloatPacket<W> operator*(float a, const FloatPacket<W>& b) { return FloatPacket<W>(a) *= b; }
+    template <int W> inline FloatPacket<W> operator/(float a, const FloatPacket<W>& b) { return FloatPacket<W>(a) /= b; }
+
+    template <int W> inline MaskPacket<W> operator<(const FloatPacket<W>& a, const FloatPacket<W>& b) { return MaskPacket<W>(PacketTraits<W>::Less(a.Value(), b.Value())); }
+    template <int W> inline MaskPacket<W> operator<=(const FloatPacket<W>& a, const FloatPacket<W>& b) { return MaskPacket<W>(PacketTraits<W>::LessEqual(a.Value(), b.Value())); }
+    template <int W> inline MaskPacket<W> operator>(const FloatPacket<W>& a, const FloatPacket<W>& b) { return b < a; }
+    template <int W> inline MaskPacket<W> operator>=(const FloatPacket<W>& a, const FloatPacket<W>& b) { return b <= a; }
+    template <int W> inline MaskPacket<W> operator==(const FloatPacket<W>& a, const FloatPacket<W>& b) { return MaskPacket<W>(PacketTraits<W>::Equal(a.Value(), b.Value())); }
+    template <int W> inline MaskPacket<W> operator<(const FloatPacket<W>& a, float b) { return a < FloatPacket<W>(b); }
+    template <int W> inline MaskPacket<W> operator>(const FloatPacket<W>& a, float b) { return a > FloatPacket<W>(b); }
+
+    template <int W> inline FloatPacket<W> Min(const FloatPacket<W>& a, const FloatPacket<W>& b) { return FloatPacket<W>(PacketTraits<W>::Min(a.Value(), b.Value())); }
+    template <int W> inline FloatPacket<W> Max(const FloatPacket<W>& a, const FloatPacket<W>& b) { return FloatPacket<W>(PacketTraits<W>::Max(a.Value(), b.Value())); }
+    template <int W> inline FloatPacket<W> Sqrt(const FloatPacket<W>& a) { return FloatPacket<W>(PacketTraits<W>::Sqrt(a.Value())); }
+    template <int W> inline FloatPacket<W> Rsqrt(const FloatPacket<W>& a) { return FloatPacket<W>(PacketTraits<W>::Rsqrt(a.Value())); }
+
+    //  Lanes where mask is true take a, the others take b.
+    template <int W>
+    inline FloatPacket<W> Select(const MaskPacket<W>& mask, const FloatPacket<W>& a, const FloatPacket<W>& b)
+    {
+        return FloatPacket<W>(PacketTraits<W>::Select(mask.Value(), a.Value(), b.Value()));
+    }
+
+    //--------------------------------------------------------------------------------------
+    //  Float2Packet and Float3Packet, W two or three component vectors in SoA form.
+    //--------------------------------------------------------------------------------------
+
+    template <int W>
+    struct Float2Packet
+    {
+        FloatPacket<W> x, y;
+
+        Float2Packet() { }
+        Float2Packet(const FloatPacket<W>& x, const FloatPacket<W>& y) : x(x), y(y) { }
+        Float2Packet(const float_2& v) : x(v.x), y(v.y) { }
+
+        //  Load from separate x and y arrays.
+        static Float2Packet Load(const float* const pX, const float* const pY)
+        {
+            return Float2Packet(FloatPacket<W>::Load(pX), FloatPacket<W>::Load(pY));
+        }
+
+        void Store(float* const pX, float* const pY) const
+        {
+            x.Store(pX);
+            y.Store(pY);
+        }
+
+        //  Load from W float_2 values spaced strideBytes apart, for example a member of an AoS struct.
+        static Float2Packet Gather(const float_2* const pSrc, size_t strideBytes = sizeof(float_2))
+        {
+            assert(strideBytes % sizeof(float) == 0);
+            const float* p = reinterpret_cast<const float*>(pSrc);
+            const size_t stride = strideBytes / sizeof(float);
+            return Float2Packet(FloatPacket<W>::Gather(p, stride), FloatPacket<W>::Gather(p + 1, stride));
+        }
+
+        void Scatter(float_2* const pDest, size_t strideBytes = sizeof(float_2)) const
+        {
+            assert(strideBytes % sizeof(float) == 0);
+            float* p = reinterpret_cast<float*>(pDest);
+            const size_t stride = strideBytes / sizeof(float);
+            x.Scatter(p, stride);
+            y.Scatter(p + 1, stride);
+        }
+
+        float_2 operator[](int i) const { return float_2(x[i], y[i]); }
+
+        Float2Packet operator-() const { return Float2Packet(-x, -y); }
+        Float2Packet& operator+=(const Float2Packet& rhs) { x += rhs.x; y += rhs.y; return *this; }
+        Float2Packet& operator-=(const Float2Packet& rhs) { x -= rhs.x; y -= rhs.y; return *this; }
+        Float2Packet& operator*=(const FloatPacket<W>& s) { x *= s; y *= s; return *this; }
+        Float2Packet& operator/=(const FloatPacket<W>& s) { x /= s; y /= s; return *this; }
+    };
+
+    template <int W>
+    struct Float3Packet
+    {
+        FloatPacket<W> x, y, z;
+
+        Float3Packet() { }
+        Float3Packet(const FloatPacket<W>& x, const FloatPacket<W>& y, const FloatPacket<W>& z) : x(x), y(y), z(z) { }
+        Float3Packet(const float_3& v) : x(v.x), y(v.y), z(v.z) { }
+
+        static Float3Packet Load(const float* const pX, const float* const pY, const float* const pZ)
+        {
+            return Float3Packet(FloatPacket<W>::Load(pX), FloatPacket<W>::Load(pY), FloatPacket<W>::Load(pZ));
+        }
+
+        void Store(float* const pX, float* const pY, float* const pZ) const
+        {
+            x.Store(pX);
+            y.Store(pY);
+            z.Store(pZ);
+        }
+
+        static Float3Packet Gather(const float_3* const pSrc, size_t strideBytes = sizeof(float_3))
+        {
+            assert(strideBytes % sizeof(float) == 0);
+            const float* p = reinterpret_cast<const float*>(pSrc);
+            const size_t stride = strideBytes / sizeof(float);
+            return Float3Packet(FloatPacket<W>::Gather(p, stride), FloatPacket<W>::Gather(p + 1, stride), FloatPacket<W>::Gather(p + 2, stride));
+        }
+
+        void Scatter(float_3* const pDest, size_t strideBytes = sizeof(float_3)) const
+        {
+            assert(strideBytes % sizeof(float) == 0);
+            float* p = reinterpret_cast<float*>(pDest);
+            const size_t stride = strideBytes / sizeof(float);
+            x.Scatter(p, stride);
+            y.Scatter(p + 1, stride);
+            z.Scatter(p + 2, stride);
+        }
+
+        float_3 operator[](int i) const { return float_3(x[i], y[i], z[i]); }
+
+        Float3Packet operator-() const { return Float3Packet(-x, -y, -z); }
+        Float3Packet& operator+=(const Float3Packet& rhs) { x += rhs.x; y += rhs.y; z += rhs.z; return *this; }
+        Float3Packet& operator-=(const Float3Packet& rhs) { x -= rhs.x; y -= rhs.y; z -= rhs.z; return *this; }
+        Float3Packet& operator*=(const FloatPacket<W>& s) { x *= s; y *= s; z *= s; return *this; }
+        Float3Packet& operator/=(const FloatPacket<W>& s) { x /= s; y /= s; z /= s; return *this; }
+    };
+
+    template <int W> inline Float2Packet<W> operator+(Float2Packet<W> a, const Float2Packet<W>& b) { return a += b; }
+    template <int W> inline Float2Packet<W> operator-(Float2Packet<W> a, const Float2Packet<W>& b) { return a -= b; }
+    template <int W> inline Float2Packet<W> operator*(Float2Packet<W> a, const FloatPacket<W>& s) { return a *= s; }
+    template <int W> inline Float2Packet<W> operator*(Float2Packet<W> a, float s) { return a *= FloatPacket<W>(s); }
+    template <int W> inline Float2Packet<W> operator*(const FloatPacket<W>& s, Float2Packet<W> a) { return a *= s; }
+    template <int W> inline Float2Packet<W> operator/(Float2Packet<W> a, const FloatPacket<W>& s) { return a /= s; }
+    template <int W> inline Float2Packet<W> operator/(Float2Packet<W> a, float s) { return a /= FloatPacket<W>(s); }
+
+    template <int W> inline Float3Packet<W> operator+(Float3Packet<W> a, const Float3Packet<W>& b) { return a += b; }
+    template <int W> inline Float3Packet<W> operator-(Float3Packet<W> a, const Float3Packet<W>& b) { return a -= b; }
+    template <int W> inline Float3Packet<W> operator*(Float3Packet<W> a, const FloatPacket<W>& s) { return a *= s; }
+    template <int W> inline Float3Packet<W> operator*(Float3Packet<W> a, float s) { return a *= FloatPacket<W>(s); }
+    template <int W> inline Float3Packet<W> operator*(const FloatPacket<W>& s, Float3Packet<W> a) { return a *= s; }
+    template <int W> inline Float3Packet<W> operator/(Float3Packet<W> a, const FloatPacket<W>& s) { return a /= s; }
+    template <int W> inline Float3Packet<W> operator/(Float3Packet<W> a, float s) { return a /= FloatPacket<W>(s); }
+
+    template <int W>
+    inline Float2Packet<W> Select(const MaskPacket<W>& mask, const Float2Packet<W>& a, const Float2Packet<W>& b)
+    {
+        return Float2Packet<W>(Select(mask, a.x, b.x), Select(mask, a.y, b.y));
+    }
+
+    template <int W>
+    inline Float3Packet<W> Select(const MaskPacket<W>& mask, const Float3Packet<W>& a, const Float3Packet<W>& b)
+    {
+        return Float3Packet<W>(Select(mask, a.x, b.x), Select(mask, a.y, b.y), Select(mask, a.z, b.z));
+    }
+
+    //--------------------------------------------------------------------------------------
+    //  Vector helpers, named to match the scalar helpers in the samples.
+    //--------------------------------------------------------------------------------------
+
+    template <int W>
+    inline FloatPacket<W> dot(const Float2Packet<W>& a, const Float2Packet<W>& b)
+    {
+        return a.x * b.x + a.y * b.y;
+    }
+
+    template <int W>
+    inline FloatPacket<W> dot(const Float3Packet<W>& a, const Float3Packet<W>& b)
+    {
+        return a.x * b.x + a.y * b.y + a.z * b.z;
+    }
+
+    template <int W> inline FloatPacket<W> length_sq(const Float2Packet<W>& a) { return dot(a, a); }
+    template <int W> inline FloatPacket<W> length_sq(const Float3Packet<W>& a) { return dot(a, a); }
+    template <int W> inline FloatPacket<W> length(const Float2Packet<W>& a) { return Sqrt(length_sq(a)); }
+    template <int W> inline FloatPacket<W> length(const Float3Packet<W>& a) { return Sqrt(length_sq(a)); }
+    template <int W> inline FloatPacket<W> SqrLength(const Float3Packet<W>& r) { return dot(r, r); }
+
+    template <int W>
+    inline Float2Packet<W> flip_perpendicular(const Float2Packet<W>& a)
+    {
+        return Float2Packet<W>(-a.y, a.x);
+    }
+
+    //--------------------------------------------------------------------------------------
+    //  Native and explicit width names.
+    //--------------------------------------------------------------------------------------
+
+    typedef FloatPacket<kNativePacketWidth> floatxN;
+    typedef Float2Packet<kNativePacketWidth> float2xN;
+    typedef Float3Packet<kNativePacketWidth> float3xN;
+    typedef MaskPacket<kNativePacketWidth> maskxN;
+
+    typedef Float2Packet<4> float2x4;
+    typedef Float3Packet<4> float3x4;
+#if defined(__AVX__)
+    typedef Float2Packet<8> float2x8;
+    typedef Float3Packet<8> float3x8;
+#endif
+#if defined(__AVX512F__)
+    typedef Float2Packet<16> float2x16;
+    typedef Float3Packet<16> float3x16;
+#endif
+}
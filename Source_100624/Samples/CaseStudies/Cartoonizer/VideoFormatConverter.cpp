@@ -23,6 +23,7 @@
 #include "VideoSource.h"
 #include "VideoFormatConverter.h"
 #include "VideoBufferLock.h"
+#include "..\..\..\Extras\Simd\BytePermute.h"
 
 //-------------------------------------------------------------------
 // RGB-32 to RGB-32
@@ -46,17 +47,9 @@ void TransformImage_RGB24(BYTE* pDest, LONG destStride, const BYTE* pSrc, LONG s
 {
     for (DWORD y = 0; y < heightInPixels; y++)
     {
-        RGBTRIPLE *pSrcPel = (RGBTRIPLE*)pSrc;
-        DWORD *pDestPel = (DWORD*)pDest;
+        // RGBTRIPLE is stored as B, G, R. D3DCOLOR_XRGB pixels are B, G, R, 0xFF.
 
-        for (DWORD x = 0; x < widthInPixels; x++)
-        {
-            pDestPel[x] = D3DCOLOR_XRGB(
-                pSrcPel[x].rgbtRed,
-                pSrcPel[x].rgbtGreen,
-                pSrcPel[x].rgbtBlue
-                );
-        }
+        Extras::PermuteBytes<Extras::Expand24To32>(pSrc, pDest, widthInPixels);
 
         pSrc += srcStride;
         pDest += destStride;
@@ -0,0 +1,318 @@
+//===============================================================================
+//
+// Microsoft Press
+// C++ AMP: Accelerated Massive Parallelism with Microsoft Visual C++
+//
+//===============================================================================
+// Copyright (c) 2012 Ade Miller & Kate Gregory.  All rights reserved.
+// This code released under the terms of the 
+// Microsoft Public License (Ms-PL), http://ampbook.codeplex.com/license.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//===============================================================================
+
+
+#include <math.h>
+#include <float.h>
+#include <ppl.h>
+#include <assert.h>
+#include <vector>
+#include <algorithm>
+
+#include "Common.h"
+#include "NBodyCpu.h"
+#include "NBodyBarnesHutCpu.h"
+
+using namespace concurrency;
+using namespace concurrency::graphics;
+
+namespace
+{
+    const int kMortonBits = 21;                                 // Bits per axis, all three fit in a 64 bit code.
+    const int kMaxLeafBodies = 8;                               // Cells with more bodies than this are split.
+    const int kMaxStackSize = 8 * (kMortonBits + 1);            // Each level of the walk pushes at most 8 cells.
+    const int kBodiesPerTask = 256;
+
+    //  Spread the low 21 bits of v out so that there are two zero bits between each of them.
+
+    inline unsigned long long SpreadBits(unsigned long long v)
+    {
+        v &= 0x1FFFFF;
+        v = (v | (v << 32)) & 0x001F00000000FFFFull;
+        v = (v | (v << 16)) & 0x001F0000FF0000FFull;
+        v = (v | (v << 8)) & 0x100F00F00F00F00Full;
+        v = (v | (v << 4)) & 0x10C30C30C30C30C3ull;
+        v = (v | (v << 2)) & 0x1249249249249249ull;
+        return v;
+    }
+
+    //  Quantize one coordinate to kMortonBits bits.
+
+    inline unsigned long long Quantize(float value, float minValue, float scale)
+    {
+        const float q = (value - minValue) * scale;
+        return static_cast<unsigned long long>((std::min)((std::max)(q, 0.0f), float((1 << kMortonBits) - 1)));
+    }
+
+    inline float InvDistCube(float distSqr)
+    {
+        const float invDist = 1.0f / sqrt(distSqr);
+        return invDist * invDist * invDist;
+    }
+}
+
+//--------------------------------------------------------------------------------------
+//  Barnes-Hut tree code implementation of the n-body calculation.
+//--------------------------------------------------------------------------------------
+
+void NBodyBarnesHut::Integrate(ParticleCpu* const pParticlesIn, ParticleCpu* const pParticlesOut, int numParticles) const
+{
+    if (numParticles <= 0)
+        return;
+
+    //  Find a cube that encloses all the bodies, this is the root cell of the tree.
+
+    float_3 minPos;
+    float_3 maxPos;
+    GetParticleBounds(pParticlesIn, numParticles, minPos, maxPos);
+    const float_3 extent = maxPos - minPos;
+
+    //  Enlarge the cube slightly so the bodies on its far faces quantize to the last cell rather than beyond it.
+    //  The lower limit keeps the quantization scale finite if every body is at the same position.
+    const float size = (std::max)((std::max)(extent.x, extent.y), (std::max)(extent.z, 1.0e-6f)) * 1.0001f;
+
+    SortBodies(pParticlesIn, numParticles, minPos, size);
+    BuildTree(minPos, size);
+    ComputeMultipoles(size);
+
+    //  Each task updates a run of bodies that are adjacent in Morton order.
+
+    parallel_for(0, numParticles, kBodiesPerTask, [=](int first)
+    {
+        const int last = (std::min)(first + kBodiesPerTask, numParticles);
+        for (int i = first; i < last; ++i)
+        {
+            const int index = m_order[i];
+            const float_3 acc = Acceleration(m_sortedPos[i]);
+
+            ParticleCpu& p = pParticlesOut[index];
+            p = pParticlesIn[index];
+            p.vel += acc * m_deltaTime;
+            p.vel *= m_dampingFactor;
+            p.pos += p.vel * m_deltaTime;
+        }
+    });
+}
+
+//  Sort the bodies by the Morton code of their position.
+
+void NBodyBarnesHut::SortBodies(const ParticleCpu* const pParticles, int numParticles, const float_3& minPos, float size) const
+{
+    const float scale = float(1 << kMortonBits) / size;
+
+    m_keys.resize(numParticles);
+    parallel_for(0, numParticles, kBodiesPerTask, [=](int first)
+    {
+        const int last = (std::min)(first + kBodiesPerTask, numParticles);
+        for (int i = first; i < last; ++i)
+        {
+            const float_3 p = pParticles[i].pos;
+            const unsigned long long code = SpreadBits(Quantize(p.x, minPos.x, scale)) |
+                (SpreadBits(Quantize(p.y, minPos.y, scale)) << 1) |
+                (SpreadBits(Quantize(p.z, minPos.z, scale)) << 2);
+            m_keys[i] = std::make_pair(code, i);
+        }
+    });
+
+    //  Ties are broken by index so the order, and therefore the result, is deterministic.
+    parallel_sort(m_keys.begin(), m_keys.end());
+
+    m_codes.resize(numParticles);
+    m_order.resize(numParticles);
+    m_sortedPos.resize(numParticles);
+    parallel_for(0, numParticles, kBodiesPerTask, [=](int first)
+    {
+        const int last = (std::min)(first + kBodiesPerTask, numParticles);
+        for (int i = first; i < last; ++i)
+        {
+            m_codes[i] = m_keys[i].first;
+            m_order[i] = m_keys[i].second;
+            m_sortedPos[i] = pParticles[m_keys[i].second].pos;
+        }
+    });
+}
+
+//  Build the octree one level at a time, splitting every cell at a level in parallel.
+//
+//  A cell at level L holds the bodies whose codes share their top 3 * L bits, and its
+//  children are the runs of bodies with the same next three bits. The first pass counts
+//  each cell's non-empty children so the children of every cell can be allocated
+//  contiguously, the second pass fills them in.
+
+void NBodyBarnesHut::BuildTree(const float_3& minPos, float size) const
+{
+    const int numParticles = static_cast<int>(m_codes.size());
+    const unsigned long long* const pCodes = m_codes.data();
+
+    BarnesHutCell root;
+    root.center = minPos + float_3(size * 0.5f);
+    root.firstChild = 0;
+    root.childCount = 0;
+    root.firstBody = 0;
+    root.bodyCount = numParticles;
+
+    m_cells.assign(1, root);
+    m_levelStart.assign(1, 0);
+
+    //  Index of the first body in each of a cell's eight octants, and the end of the last one.
+    auto splitCell = [=](const BarnesHutCell& cell, int level, int (&bounds)[9])
+    {
+        const int shift = 3 * (kMortonBits - 1 - level);
+        const unsigned long long prefix = (pCodes[cell.firstBody] >> (shift + 3)) << 3;
+        bounds[0] = cell.firstBody;
+        for (unsigned long long octant = 1; octant < 8; ++octant)
+            bounds[octant] = static_cast<int>(std::lower_bound(pCodes + bounds[octant - 1], pCodes + cell.firstBody + cell.bodyCount, (prefix | octant) << shift) - pCodes);
+        bounds[8] = cell.firstBody + cell.bodyCount;
+    };
+
+    std::vector<int> childOffsets;
+    for (int level = 0; level < kMortonBits; ++level)
+    {
+        const int first = m_levelStart.back();
+        const int last = static_cast<int>(m_cells.size());
+
+        childOffsets.assign(last - first + 1, 0);
+        parallel_for(first, last, [=, &childOffsets](int c)
+        {
+            const BarnesHutCell& cell = m_cells[c];
+            if (cell.bodyCount <= kMaxLeafBodies)
+                return;
+            int bounds[9];
+            splitCell(cell, level, bounds);
+            int count = 0;
+            for (int octant = 0; octant < 8; ++octant)
+                count += (bounds[octant + 1] > bounds[octant]) ? 1 : 0;
+            childOffsets[c - first + 1] = count;
+        });
+
+        for (size_t i = 1; i < childOffsets.size(); ++i)
+            childOffsets[i] += childOffsets[i - 1];
+        if (childOffsets.back() == 0)
+            break;
+
+        m_levelStart.push_back(last);
+        m_cells.resize(last + childOffsets.back());
+
+        const float quarter = ldexpf(size, -(level + 2));
+        parallel_for(first, last, [=, &childOffsets](int c)
+        {
+            BarnesHutCell& cell = m_cells[c];
+            cell.firstChild = last + childOffsets[c - first];
+            cell.childCount = childOffsets[c - first + 1] - childOffsets[c - first];
+            if (cell.childCount == 0)
+                return;
+
+            int bounds[9];
+            splitCell(cell, level, bounds);
+            BarnesHutCell* pChild = &m_cells[cell.firstChild];
+            for (int octant = 0; octant < 8; ++octant)
+            {
+                if (bounds[octant + 1] == bounds[octant])
+                    continue;
+
+                //  Bits 0, 1 and 2 of the octant come from x, y and z.
+                pChild->center = cell.center + float_3((octant & 1) ? quarter : -quarter,
+                    (octant & 2) ? quarter : -quarter, (octant & 4) ? quarter : -quarter);
+                pChild->firstChild = 0;
+                pChild->childCount = 0;
+                pChild->firstBody = bounds[octant];
+                pChild->bodyCount = bounds[octant + 1] - bounds[octant];
+                ++pChild;
+            }
+        });
+    }
+    m_levelStart.push_back(static_cast<int>(m_cells.size()));
+}
+
+//  Calculate the mass and center of mass of each cell from the bottom of the tree up.
+
+void NBodyBarnesHut::ComputeMultipoles(float size) const
+{
+    for (int level = static_cast<int>(m_levelStart.size()) - 2; level >= 0; --level)
+    {
+        const float cellSize = ldexpf(size, -level);
+        parallel_for(m_levelStart[level], m_levelStart[level + 1], [=](int c)
+        {
+            BarnesHutCell& cell = m_cells[c];
+
+            //  All bodies have the same mass so the center of mass is the mean position.
+            float_3 sum(0.0f);
+            if (cell.childCount == 0)
+            {
+                for (int b = cell.firstBody; b < cell.firstBody + cell.bodyCount; ++b)
+                    sum += m_sortedPos[b];
+            }
+            else
+            {
+                for (int child = cell.firstChild; child < cell.firstChild + cell.childCount; ++child)
+                    sum += m_cells[child].centerOfMass * float(m_cells[child].bodyCount);
+            }
+            cell.centerOfMass = sum * (1.0f / cell.bodyCount);
+            cell.mass = m_particleMass * cell.bodyCount;
+
+            if (m_theta > 0.0f)
+            {
+                const float openDist = cellSize / m_theta + sqrt(SqrLength(cell.centerOfMass - cell.center));
+                cell.openDistSqr = openDist * openDist;
+            }
+            else
+            {
+                cell.openDistSqr = FLT_MAX;
+            }
+        });
+    }
+}
+
+//  Walk the tree for a single body using an explicit stack.
+
+float_3 NBodyBarnesHut::Acceleration(const float_3& pos) const
+{
+    const BarnesHutCell* const pCells = m_cells.data();
+    const float_3* const pSortedPos = m_sortedPos.data();
+
+    int stack[kMaxStackSize];
+    int top = 0;
+    stack[top++] = 0;
+    float_3 acc(0.0f);
+
+    while (top > 0)
+    {
+        const BarnesHutCell& cell = pCells[stack[--top]];
+        const float_3 r = cell.centerOfMass - pos;
+        const float distSqr = SqrLength(r);
+
+        if (distSqr >= cell.openDistSqr)
+        {
+            //  Far enough away to treat the whole cell as a single body.
+            acc += r * (cell.mass * InvDistCube(distSqr + m_softeningSquared));
+        }
+        else if (cell.childCount == 0)
+        {
+            for (int b = cell.firstBody; b < cell.firstBody + cell.bodyCount; ++b)
+            {
+                const float_3 rb = pSortedPos[b] - pos;
+                acc += rb * (m_particleMass * InvDistCube(SqrLength(rb) + m_softeningSquared));
+            }
+        }
+        else
+        {
+            assert(top + cell.childCount <= kMaxStackSize);
+            for (int child = cell.firstChild + cell.childCount - 1; child >= cell.firstChild; --child)
+                stack[top++] = child;
+        }
+    }
+    return acc;
+}
@@ -0,0 +1,113 @@
+//===============================================================================
+//
+// Microsoft Press
+// C++ AMP: Accelerated Massive Parallelism with Microsoft Visual C++
+//
+//===============================================================================
+// Copyright (c) 2012 Ade Miller & Kate Gregory.  All rights reserved.
+// This code released under the terms of the 
+// Microsoft Public License (Ms-PL), http://ampbook.codeplex.com/license.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//===============================================================================
+
+
+#pragma once
+
+#include <amp_short_vectors.h>
+#include <vector>
+#include <memory>
+#include <utility>
+
+#include "INBodyCpu.h"
+#include "ParticleCpu.h"
+
+using namespace concurrency::graphics;
+
+//--------------------------------------------------------------------------------------
+//  Barnes-Hut tree code implementation of the n-body calculation.
+//--------------------------------------------------------------------------------------
+//
+//  All of the other integrators calculate every body-body interaction so their cost grows as
+//  O(N^2). This one groups distant bodies into the cells of an octree and treats each cell as
+//  a single body at its center of mass, so each step costs O(N log N).
+//
+//  Each step:
+//
+//  1. Computes a Morton code for each body, interleaving the bits of its quantized x, y and z
+//     coordinates, and sorts the bodies by code. Bodies in the same octree cell are then
+//     contiguous and cells at each level are ordered along a space filling curve.
+//  2. Builds the octree one level at a time. Splitting a cell into its children is a binary
+//     search on the sorted codes, all cells at a level are split in parallel, and the
+//     children of each cell are stored contiguously.
+//  3. Calculates each cell's mass and center of mass bottom up, again one level at a time.
+//  4. Walks the tree for each body in parallel. Bodies are processed in Morton order so
+//     neighboring bodies, which visit almost the same cells, run on the same thread.
+//
+//  A cell is treated as a single body if size / distance < theta, where distance is
+//  measured from the body to the cell's center of mass. This uses Barnes' modification
+//  that adds the offset of the center of mass from the center of the cell to the opening
+//  distance, so a body near the edge of a large, lopsided cell still opens it. Smaller
+//  values of theta are more accurate, zero opens every cell and gives the same result
+//  as the direct sum.
+//
+//  Like the simple integrators, this leaves the input unchanged and writes the new
+//  values to pParticlesOut.
+
+struct BarnesHutCell
+{
+    float_3 centerOfMass;
+    float mass;
+    float_3 center;                                             // Geometric center of the cell.
+    float openDistSqr;                                          // Bodies closer than this open the cell.
+    int firstChild;                                             // Index of the first child cell, the children are contiguous.
+    int childCount;                                             // Zero for a leaf.
+    int firstBody;                                              // Bodies in Morton order.
+    int bodyCount;
+};
+
+class NBodyBarnesHut : public INBodyCpu
+{
+private:
+    const float m_softeningSquared;
+    const float m_dampingFactor;
+    const float m_deltaTime;
+    const float m_particleMass;
+    float m_theta;
+
+    //  Working storage, kept between steps to avoid reallocating it.
+
+    mutable std::vector<std::pair<unsigned long long, int>> m_keys;
+    mutable std::vector<unsigned long long> m_codes;            // Morton codes in sorted order.
+    mutable std::vector<int> m_order;                           // Index into pParticlesIn of each sorted body.
+    mutable std::vector<float_3> m_sortedPos;
+    mutable std::vector<BarnesHutCell> m_cells;
+    mutable std::vector<int> m_levelStart;                      // The cells at level L are [m_levelStart[L], m_levelStart[L + 1]).
+
+public:
+    NBodyBarnesHut(float softeningSquared, float dampingFactor, float deltaTime, float particleMass, float theta) :
+        INBodyCpu(),
+        m_softeningSquared(softeningSquared),
+        m_dampingFactor(dampingFactor),
+        m_deltaTime(deltaTime),
+        m_particleMass(particleMass),
+        m_theta(theta)
+    {
+    }
+
+    void Integrate(ParticleCpu* const pParticlesIn, ParticleCpu* const pParticlesOut, int numParticles) const;
+
+    //  Opening angle. Zero gives the exact result, around 0.5 is typical and larger values are faster.
+
+    float GetTheta() const { return m_theta; }
+    void SetTheta(float theta) { m_theta = theta; }
+
+private:
+    void SortBodies(const ParticleCpu* const pParticles, int numParticles, const float_3& minPos, float size) const;
+    void BuildTree(const float_3& minPos, float size) const;
+    void ComputeMultipoles(float size) const;
+    float_3 Acceleration(const float_3& pos) const;
+};
@@ -16,6 +16,7 @@
 
 #include <string.h>
 #include <math.h>
+#include <float.h>
 #include <ppl.h>
 #include <concrtrm.h>
 #include <amprt.h>
@@ -23,6 +24,7 @@
 #include <atlbase.h>
 #include <random>
 #include <memory>
+#include <algorithm>
 
 #include "Common.h"
 #include "NBodyCpu.h"
@@ -255,6 +257,47 @@ void LoadClusterParticles(ParticleCpu* const pParticles, float_3 center, float_3
     });  
 }
 
+namespace
+{
+    struct ParticleBounds
+    {
+        float_3 minPos;
+        float_3 maxPos;
+
+        ParticleBounds() : minPos(FLT_MAX), maxPos(-FLT_MAX) {}
+
+        void Add(const float_3& p)
+        {
+            minPos = float_3((std::min)(minPos.x, p.x), (std::min)(minPos.y, p.y), (std::min)(minPos.z, p.z));
+            maxPos = float_3((std::max)(maxPos.x, p.x), (std::max)(maxPos.y, p.y), (std::max)(maxPos.z, p.z));
+        }
+
+        static ParticleBounds Combine(const ParticleBounds& a, const ParticleBounds& b)
+        {
+            ParticleBounds result(a);
+            result.Add(b.minPos);
+            result.Add(b.maxPos);
+            return result;
+        }
+    };
+}
+
+void GetParticleBounds(const ParticleCpu* const pParticles, int numParticles, float_3& minPos, float_3& maxPos)
+{
+    const int particlesPerTask = 1024;
+    combinable<ParticleBounds> localBounds;
+    parallel_for(0, numParticles, particlesPerTask, [=, &localBounds](int first)
+    {
+        ParticleBounds& bounds = localBounds.local();
+        const int last = (std::min)(first + particlesPerTask, numParticles);
+        for (int i = first; i < last; ++i)
+            bounds.Add(pParticles[i].pos);
+    });
+    const ParticleBounds bounds = localBounds.combine(ParticleBounds::Combine);
+    minPos = bounds.minPos;
+    maxPos = bounds.maxPos;
+}
+
 inline CpuSSE GetSSEType()
 {
     int CpuInfo[4] = { -1 };
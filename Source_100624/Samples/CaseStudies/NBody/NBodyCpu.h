@@ -30,7 +30,10 @@ enum ComputeType
 {
     kCpuSingle = 0,
     kCpuMulti = 1,
-    kCpuAdvanced = 2
+    kCpuAdvanced = 2,
+    kCpuBarnesHut = 3,
+    kCpuParticleMesh = 4,
+    kCpuSoA = 5
 };
 
 //  Level of SSE support available. Determined dynamically at runtime.
@@ -141,6 +144,10 @@ public:
 
 void LoadClusterParticles(ParticleCpu* const pParticles, float_3 center, float_3 velocity, float spread, int numParticles);
 
+//  Find the smallest axis aligned box that contains all the particles, in parallel.
+
+void GetParticleBounds(const ParticleCpu* const pParticles, int numParticles, float_3& minPos, float_3& maxPos);
+
 //  Get the level of SSE support available on the current hardware. 
 
 inline CpuSSE GetSSEType();
@@ -17,6 +17,7 @@
 #include <memory>
 #include <deque>
 #include <numeric>
+#include <algorithm>
 #include <d3dx11.h>
 #include <commdlg.h>
 #include <atlbase.h>
@@ -30,18 +31,17 @@
 #include "Common.h"
 #include "NbodyCpu.h"
 #include "NbodyAdvancedCpu.h"
+#include "NBodySimulationCpu.h"
 #include "resource.h"
 
 //--------------------------------------------------------------------------------------
 // Global constants.
 //--------------------------------------------------------------------------------------
 
-const float g_softeningSquared =    0.0000015625f;
-const float g_dampingFactor =       0.9995f;
-const float g_particleMass =        ((6.67300e-11f*10000.0f)*10000.0f*10000.0f);
-const float g_deltaTime =           0.1f;
+const NBodyCpuSettings g_settings;                              // Physical constants and integrator parameters
 
-const int g_maxParticles =          (15*1024);                  // Maximum number of particles in the CPU n-body simulation
+const int g_maxParticles =          (256*1024);                 // Maximum number of particles in the CPU n-body simulation
+const int g_maxDirectParticles =    (15*1024);                  // Maximum number of particles for the O(N^2) integrators
 const int g_particleNumStepSize =   256;                        // Number of particles added for each slider tick
 
 const float g_Spread =              400.0f;                     // Separation between the two clusters.
@@ -142,6 +142,8 @@ void CALLBACK OnD3D11FrameRender( ID3D11Device* pd3dDevice, ID3D11DeviceContext*
                                  float fElapsedTime, void* pUserContext );
 void InitApp();
 void RenderText();
+bool IsDirectSum(ComputeType computeType);
+int MaxParticles(ComputeType computeType);
 
 //--------------------------------------------------------------------------------------
 // Helper function to compile an hlsl shader from file, 
@@ -202,6 +204,22 @@ int WINAPI wWinMain( HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCmdL
     return DXUTGetExitCode();
 }
 
+//--------------------------------------------------------------------------------------
+// The direct sum integrators compute every particle-particle interaction so they are limited
+// to a size that still animates. Barnes-Hut and particle-mesh are O(N log N) and can use the
+// whole particle buffer.
+//--------------------------------------------------------------------------------------
+
+bool IsDirectSum(ComputeType computeType)
+{
+    return (computeType != kCpuBarnesHut) && (computeType != kCpuParticleMesh);
+}
+
+int MaxParticles(ComputeType computeType)
+{
+    return IsDirectSum(computeType) ? g_maxDirectParticles : g_maxParticles;
+}
+
 //--------------------------------------------------------------------------------------
 // Initialize the app 
 //--------------------------------------------------------------------------------------
@@ -221,7 +239,7 @@ void InitApp()
     WCHAR szTemp[256];
     swprintf_s( szTemp, L"Bodies: %d", g_numParticles );
     g_HUD.AddStatic( IDC_NBODIES_LABEL, szTemp, -20, y += 34, 125, 22 );
-    g_HUD.AddSlider( IDC_NBODIES_SLIDER, -20, y += 34, 170, 22, 1, g_maxParticles/g_particleNumStepSize );
+    g_HUD.AddSlider( IDC_NBODIES_SLIDER, -20, y += 34, 170, 22, 1, MaxParticles(g_eComputeType)/g_particleNumStepSize );
     CDXUTComboBox* pComboBox = nullptr;
     g_HUD.AddComboBox( IDC_COMPUTETYPECOMBO, -20, y += 34, 190, 26, L'G', false, &pComboBox );
 
@@ -230,15 +248,21 @@ void InitApp()
         pComboBox->AddItem( L"CPU Single Core", nullptr );
         pComboBox->AddItem( L"CPU Multi Core", nullptr );
         pComboBox->AddItem( L"CPU Advanced", nullptr );
+        pComboBox->AddItem( L"CPU Barnes-Hut", nullptr );
+        pComboBox->AddItem( L"CPU Particle-Mesh", nullptr );
+        pComboBox->AddItem( L"CPU SoA SIMD", nullptr );
     }
 
     g_HUD.GetSlider( IDC_NBODIES_SLIDER )->SetValue( (g_numParticles / g_particleNumStepSize) );
     g_HUD.GetComboBox( IDC_COMPUTETYPECOMBO )->SetSelectedByData( ( void* )g_eComputeType );
     pComboBox->SetSelectedByIndex(g_eComputeType);
-    g_particleColors.resize(3);
+    g_particleColors.resize(6);
     g_particleColors[kCpuSingle] =     D3DXCOLOR( 1.0f, 0.05f, 0.05f, 1.0f );
     g_particleColors[kCpuMulti] =      D3DXCOLOR( 0.8f, 0.0f, 0.0f, 1.0f );
     g_particleColors[kCpuAdvanced] =      D3DXCOLOR( 0.8f, 0.0f, 0.0f, 1.0f );
+    g_particleColors[kCpuBarnesHut] =     D3DXCOLOR( 0.8f, 0.4f, 0.0f, 1.0f );
+    g_particleColors[kCpuParticleMesh] =  D3DXCOLOR( 0.8f, 0.6f, 0.1f, 1.0f );
+    g_particleColors[kCpuSoA] =           D3DXCOLOR( 1.0f, 0.2f, 0.4f, 1.0f );
     g_particleColor = g_particleColors[g_eComputeType];
 
     g_sampleUI.SetCallback( OnGUIEvent );
@@ -295,36 +319,6 @@ void LoadParticles()
     }
 }
 
-//--------------------------------------------------------------------------------------
-//  Integrator class factory. 
-//--------------------------------------------------------------------------------------
-
-std::shared_ptr<INBodyCpu> NBodyFactory(ComputeType type)
-{
-    switch (type)
-    {
-    case kCpuSingle:
-        return std::make_shared<NBodySimpleSingleCore>(g_softeningSquared, g_dampingFactor, 
-            g_deltaTime, g_particleMass);
-        break;
-    case kCpuMulti:
-        return std::make_shared<NBodySimpleMultiCore>(g_softeningSquared, g_dampingFactor, 
-            g_deltaTime, g_particleMass);
-        break;
-    case kCpuAdvanced:
-        {
-            int tileSize = GetLevelOneCacheSize() / sizeof(ParticleCpu);
-            return std::make_shared<NBodyAdvanced>(g_softeningSquared, g_dampingFactor, 
-                g_deltaTime, g_particleMass, tileSize);
-        }
-        break;
-    default:
-        assert(false);
-        return nullptr;
-        break;
-    }
-}
-
 //--------------------------------------------------------------------------------------
 //  Create render buffer. 
 //--------------------------------------------------------------------------------------
@@ -421,7 +415,7 @@ void CALLBACK OnFrameMove(double fTime, float fElapsedTime, void* pUserContext)
     g_pNBody->Integrate(g_pParticlesOld, g_pParticlesNew, g_numParticles);
 
     // Advanced integrator updates particles in place, so no need to swap the buffers.
-    if (g_eComputeType != kCpuAdvanced)
+    if (!IntegratesInPlace(g_eComputeType))
         std::swap(g_pParticlesOld, g_pParticlesNew);
 
     // Update the camera's position based on user input 
@@ -486,7 +480,13 @@ void CALLBACK OnGUIEvent( UINT nEvent, int nControlID, CDXUTControl* pControl, v
             g_eComputeType = static_cast<ComputeType>(pComboBox->GetSelectedIndex());
 
             g_particleColor = g_particleColors[g_eComputeType];
-            g_pNBody = NBodyFactory(g_eComputeType);
+            g_pNBody = NBodyFactory(g_eComputeType, g_settings);
+
+            const int maxParticles = MaxParticles(g_eComputeType);
+            g_numParticles = (std::min)(g_numParticles, maxParticles);
+            CDXUTSlider* pSlider = g_HUD.GetSlider(IDC_NBODIES_SLIDER);
+            pSlider->SetRange(1, maxParticles / g_particleNumStepSize);
+            pSlider->SetValue(g_numParticles / g_particleNumStepSize);
 
             WCHAR szTemp[256];
             swprintf_s(szTemp, L"Bodies: %d", g_numParticles);    
@@ -561,7 +561,7 @@ HRESULT CALLBACK OnD3D11CreateDevice(ID3D11Device* pd3dDevice, const DXGI_SURFAC
         pBlobRenderParticlesVS->GetBufferPointer(), pBlobRenderParticlesVS->GetBufferSize(), &g_pParticleVertexLayout) );
 
     // Create NBody object
-    g_pNBody = NBodyFactory(g_eComputeType);
+    g_pNBody = NBodyFactory(g_eComputeType, g_settings);
 
     V_RETURN(CreateParticleBuffer(pd3dDevice));
     V_RETURN(CreateParticlePosVeloBuffers(pd3dDevice));
@@ -666,10 +666,14 @@ void RenderText()
 
     const float fps = accumulate(g_FpsStatistics.begin(), g_FpsStatistics.end(), 0.0f) / g_FpsStatistics.size();
 
-    // Estimate the number of FLOPs based on 20 FLOPs per particle-particle interaction.
+    // Estimate the number of FLOPs based on 20 FLOPs per particle-particle interaction. Only the
+    // direct sum integrators compute all N^2 interactions.
     g_pTxtHelper->DrawFormattedTextLine( L"FPS:    %.2f", fps );
-    const float gflops = (g_numParticles / 1000.0f) * (g_numParticles / 1000.0f) * fps * 20 / 1000.0f;
-    g_pTxtHelper->DrawFormattedTextLine( L"GFlops: %.2f ", gflops );
+    if (IsDirectSum(g_eComputeType))
+    {
+        const float gflops = (g_numParticles / 1000.0f) * (g_numParticles / 1000.0f) * fps * 20 / 1000.0f;
+        g_pTxtHelper->DrawFormattedTextLine( L"GFlops: %.2f ", gflops );
+    }
 
     g_pTxtHelper->End();
 }
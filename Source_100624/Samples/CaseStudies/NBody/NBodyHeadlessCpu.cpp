@@ -0,0 +1,314 @@
+//===============================================================================
+//
+// Microsoft Press
+// C++ AMP: Accelerated Massive Parallelism with Microsoft Visual C++
+//
+//===============================================================================
+// Copyright (c) 2012 Ade Miller & Kate Gregory.  All rights reserved.
+// This code released under the terms of the 
+// Microsoft Public License (Ms-PL), http://ampbook.codeplex.com/license.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//===============================================================================
+
+
+#include <windows.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <limits.h>
+#include <ppl.h>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Common.h"
+#include "NBodySimulationCpu.h"
+#include "..\..\..\Extras\Simd\CpuFeatures.h"
+
+//--------------------------------------------------------------------------------------
+//  Headless n-body benchmark.
+//--------------------------------------------------------------------------------------
+//
+//  Runs the CPU integrators from the command line without a window, DXUT or a Direct3D
+//  device, so they can be benchmarked and run for long simulations from a script. Each
+//  selected integrator starts from the same initial conditions, runs some untimed warm up
+//  steps, then the timed steps, and reports one line of results. Snapshots are optional.
+//  It is a Windows console program, it shares the integrators and CPU feature detection
+//  with the windowed sample and times steps with the performance counter.
+//
+//  The last column is direct sum equivalent interactions per second, N^2 interactions per
+//  step divided by the step time. For the direct sum integrators this is the work done. 
+//  Barnes-Hut and particle-mesh compute far fewer interactions, for them it is the rate a
+//  direct sum would need to match their step time, not a count of the work they did.
+
+struct IntegratorDescription
+{
+    ComputeType type;
+    const char* name;
+};
+
+const IntegratorDescription g_integrators[] =
+{
+    { kCpuSingle,       "single" },
+    { kCpuMulti,        "multi" },
+    { kCpuAdvanced,     "advanced" },
+    { kCpuBarnesHut,    "barneshut" },
+    { kCpuParticleMesh, "particlemesh" },
+    { kCpuSoA,          "soa" }
+};
+
+struct HeadlessOptions
+{
+    std::vector<IntegratorDescription> integrators;
+    int numParticles;
+    int steps;
+    int warmupSteps;
+    float spread;                           // Separation between the two clusters.
+    std::string inputPath;                  // Initial conditions, generated if empty.
+    std::string snapshotPrefix;             // No snapshots if empty.
+    int snapshotInterval;                   // Steps between snapshots, zero for the last step only.
+    NBodyCpuSettings settings;
+
+    HeadlessOptions() :
+        numParticles(15 * 1024),
+        steps(10),
+        warmupSteps(1),
+        spread(400.0f),
+        snapshotInterval(0)
+    {
+    }
+};
+
+void PrintUsage()
+{
+    std::cerr << "Usage: NBodyHeadlessCPU [options]" << std::endl
+        << "  -integrator <name>   single, multi, advanced, barneshut, particlemesh, soa or all." << std::endl
+        << "                       May be repeated, the default is advanced." << std::endl
+        << "  -particles <n>       Number of generated particles, default 15360." << std::endl
+        << "  -input <file>        Read the initial conditions from a snapshot file instead." << std::endl
+        << "  -steps <n>           Timed steps, default 10." << std::endl
+        << "  -warmup <n>          Untimed steps before the timed ones, default 1." << std::endl
+        << "  -snapshot <prefix>   Write <prefix>_<integrator>_<step>.txt snapshots." << std::endl
+        << "  -interval <n>        Steps between snapshots, default 0 for the last step only." << std::endl
+        << "  -theta <value>       Barnes-Hut opening angle, default 0.5." << std::endl
+        << "  -grid <n>            Particle-mesh grid size, a power of two, default 64." << std::endl;
+}
+
+bool ParseInt(const char* text, int minValue, int& value)
+{
+    char* end = nullptr;
+    const long result = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || result < minValue || result > INT_MAX)
+        return false;
+    value = static_cast<int>(result);
+    return true;
+}
+
+bool ParseFloat(const char* text, float& value)
+{
+    char* end = nullptr;
+    const double result = strtod(text, &end);
+    if (end == text || *end != '\0' || !(result >= 0.0))
+        return false;
+    value = static_cast<float>(result);
+    return true;
+}
+
+bool EqualsIgnoreCase(const char* a, const char* b)
+{
+    for (; *a != '\0' && *b != '\0'; ++a, ++b)
+    {
+        if (tolower(static_cast<unsigned char>(*a)) != tolower(static_cast<unsigned char>(*b)))
+            return false;
+    }
+    return *a == *b;
+}
+
+bool ParseIntegrator(const char* text, std::vector<IntegratorDescription>& integrators)
+{
+    const bool all = EqualsIgnoreCase(text, "all");
+    bool found = false;
+    for (const IntegratorDescription& d : g_integrators)
+    {
+        if (all || EqualsIgnoreCase(text, d.name))
+        {
+            integrators.push_back(d);
+            found = true;
+        }
+    }
+    return found;
+}
+
+bool ParseOptions(int argc, char* argv[], HeadlessOptions& options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string name(argv[i]);
+        if (name == "-help" || name == "-?" || i + 1 >= argc)
+            return false;
+        const char* const value = argv[++i];
+
+        bool valid;
+        if (name == "-integrator")
+            valid = ParseIntegrator(value, options.integrators);
+        else if (name == "-particles")
+            valid = ParseInt(value, 1, options.numParticles);
+        else if (name == "-steps")
+            valid = ParseInt(value, 0, options.steps);
+        else if (name == "-warmup")
+            valid = ParseInt(value, 0, options.warmupSteps);
+        else if (name == "-input")
+        {
+            options.inputPath = value;
+            valid = true;
+        }
+        else if (name == "-snapshot")
+        {
+            options.snapshotPrefix = value;
+            valid = true;
+        }
+        else if (name == "-interval")
+            valid = ParseInt(value, 0, options.snapshotInterval);
+        else if (name == "-theta")
+            valid = ParseFloat(value, options.settings.barnesHutTheta);
+        else if (name == "-grid")
+            valid = ParseInt(value, 2, options.settings.particleMeshGridSize) && 
+                (options.settings.particleMeshGridSize & (options.settings.particleMeshGridSize - 1)) == 0;
+        else
+            valid = false;
+
+        if (!valid)
+        {
+            std::cerr << "Invalid option: " << name << " " << value << std::endl;
+            return false;
+        }
+    }
+
+    if (options.integrators.empty())
+        ParseIntegrator("advanced", options.integrators);
+    return true;
+}
+
+const char* GetSimdLevelName()
+{
+    switch (Extras::GetSimdLevel())
+    {
+    case Extras::SimdLevel::Avx512:
+        return "AVX-512";
+    case Extras::SimdLevel::Avx2:
+        return "AVX2";
+    case Extras::SimdLevel::Ssse3:
+        return "SSSE3";
+    default:
+        return "SSE2";
+    }
+}
+
+inline double ElapsedTime(const LARGE_INTEGER& start, const LARGE_INTEGER& end)
+{
+    LARGE_INTEGER freq;
+    QueryPerformanceFrequency(&freq);
+    return (double(end.QuadPart) - double(start.QuadPart)) * 1000.0 / double(freq.QuadPart);
+}
+
+bool WriteSnapshot(const HeadlessOptions& options, const IntegratorDescription& integrator, const NBodySimulationCpu& simulation, int step)
+{
+    std::ostringstream path;
+    path << options.snapshotPrefix << "_" << integrator.name << "_" << std::setw(6) << std::setfill('0') << step << ".txt";
+    if (WriteParticles(path.str(), simulation.GetParticles(), simulation.GetNumParticles()))
+        return true;
+
+    std::cerr << "Unable to write snapshot " << path.str() << std::endl;
+    return false;
+}
+
+//  Run the warm up and timed steps for one integrator and report the results.
+
+bool RunIntegrator(const HeadlessOptions& options, const IntegratorDescription& integrator, const std::vector<ParticleCpu>& initial)
+{
+    NBodySimulationCpu simulation(integrator.type, options.settings, initial);
+
+    //  Warm up from the initial conditions, then restart from them so snapshots match across
+    //  integrators.
+    for (int s = 0; s < options.warmupSteps; ++s)
+        simulation.Step();
+    simulation.Reset(initial);
+
+    const bool snapshots = !options.snapshotPrefix.empty();
+    if (snapshots && options.snapshotInterval > 0 && !WriteSnapshot(options, integrator, simulation, 0))
+        return false;
+
+    double elapsedMs = 0.0;
+    for (int s = 1; s <= options.steps; ++s)
+    {
+        LARGE_INTEGER start, end;
+        QueryPerformanceCounter(&start);
+        simulation.Step();
+        QueryPerformanceCounter(&end);
+        elapsedMs += ElapsedTime(start, end);
+
+        //  Snapshots are written outside the timed region.
+        const bool snapshotStep = (options.snapshotInterval > 0) ? (s % options.snapshotInterval == 0) : (s == options.steps);
+        if (snapshots && snapshotStep && !WriteSnapshot(options, integrator, simulation, s))
+            return false;
+    }
+
+    const double seconds = elapsedMs / 1000.0;
+    const double numParticles = simulation.GetNumParticles();
+    const double stepsPerSecond = (seconds > 0.0) ? options.steps / seconds : 0.0;
+    std::cout << std::left << std::setw(14) << integrator.name << std::right
+        << std::setw(10) << simulation.GetNumParticles()
+        << std::setw(8) << options.steps
+        << std::fixed << std::setprecision(2)
+        << std::setw(14) << elapsedMs
+        << std::setw(12) << stepsPerSecond
+        << std::scientific << std::setprecision(3)
+        << std::setw(38) << numParticles * numParticles * stepsPerSecond << std::endl;
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    HeadlessOptions options;
+    if (!ParseOptions(argc, argv, options))
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    std::vector<ParticleCpu> initial;
+    if (!options.inputPath.empty())
+    {
+        if (!ReadParticles(options.inputPath, initial) || initial.empty())
+        {
+            std::cerr << "Unable to read particles from " << options.inputPath << std::endl;
+            return 1;
+        }
+    }
+    else
+    {
+        initial.resize(options.numParticles);
+        LoadCollidingClusters(initial, options.spread);
+    }
+
+    std::cout << "Processors: " << concurrency::CurrentScheduler::GetNumberOfVirtualProcessors() 
+        << ", SIMD: " << GetSimdLevelName() << std::endl;
+    std::cout << std::left << std::setw(14) << "Integrator" << std::right
+        << std::setw(10) << "Particles"
+        << std::setw(8) << "Steps"
+        << std::setw(14) << "Time (ms)"
+        << std::setw(12) << "Steps/s"
+        << std::setw(38) << "Direct-sum-equivalent interactions/s" << std::endl;
+
+    for (const IntegratorDescription& integrator : options.integrators)
+    {
+        if (!RunIntegrator(options, integrator, initial))
+            return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,361 @@
+//===============================================================================
+//
+// Microsoft Press
+// C++ AMP: Accelerated Massive Parallelism with Microsoft Visual C++
+//
+//===============================================================================
+// Copyright (c) 2012 Ade Miller & Kate Gregory.  All rights reserved.
+// This code released under the terms of the 
+// Microsoft Public License (Ms-PL), http://ampbook.codeplex.com/license.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//===============================================================================
+
+
+#include <math.h>
+#include <ppl.h>
+#include <assert.h>
+#include <vector>
+#include <algorithm>
+
+#include "Common.h"
+#include "NBodyCpu.h"
+#include "NBodyParticleMeshCpu.h"
+
+using namespace concurrency;
+using namespace concurrency::graphics;
+
+namespace
+{
+    const int kParticlesPerTask = 1024;
+
+    //  Grid cell containing p and the CIC weight of the next cell along each axis. The cell is
+    //  clamped so that both it and the next one are inside the grid.
+
+    inline void CloudInCell(const float_3& p, const float_3& minPos, float invCellSize, int gridSize, int (&cell)[3], float (&weight)[3])
+    {
+        const float u[3] = { (p.x - minPos.x) * invCellSize, (p.y - minPos.y) * invCellSize, (p.z - minPos.z) * invCellSize };
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            cell[axis] = (std::min)((std::max)(static_cast<int>(u[axis]), 0), gridSize - 2);
+            weight[axis] = (std::min)((std::max)(u[axis] - cell[axis], 0.0f), 1.0f);
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------
+//  Particle-mesh implementation of the n-body calculation.
+//--------------------------------------------------------------------------------------
+
+NBodyParticleMesh::NBodyParticleMesh(float dampingFactor, float deltaTime, float particleMass, int gridSize) :
+    INBodyCpu(),
+    m_dampingFactor(dampingFactor),
+    m_deltaTime(deltaTime),
+    m_particleMass(particleMass),
+    m_gridSize(gridSize),
+    m_paddedSize(2 * gridSize),
+    m_grid(size_t(2 * gridSize) * (2 * gridSize) * (2 * gridSize)),
+    m_acceleration(size_t(gridSize) * gridSize * gridSize)
+{
+    assert((gridSize >= 2) && ((gridSize & (gridSize - 1)) == 0));
+    const int n = m_paddedSize;
+
+    m_twiddles.resize(n / 2);
+    for (int k = 0; k < n / 2; ++k)
+    {
+        const double angle = -2.0 * 3.14159265358979323846 * k / n;
+        m_twiddles[k] = Complex(float(cos(angle)), float(sin(angle)));
+    }
+
+    int bits = 0;
+    while ((1 << bits) < n)
+        ++bits;
+    m_bitReverse.resize(n);
+    for (int i = 0; i < n; ++i)
+    {
+        int reversed = 0;
+        for (int b = 0; b < bits; ++b)
+            reversed |= ((i >> b) & 1) << (bits - 1 - b);
+        m_bitReverse[i] = reversed;
+    }
+
+    //  The Green's function in grid units. Offsets past half the padded grid wrap around to
+    //  negative offsets. Giving zero offset the same value as one cell is a deliberate softening
+    //  choice. It sets the potential a cell's own mass adds to that cell, which the central
+    //  differences at the neighbouring cells read, so it does change forces between nearby cells.
+
+    parallel_for(0, n, [=](int z)
+    {
+        const int dz = (std::min)(z, n - z);
+        for (int y = 0; y < n; ++y)
+        {
+            const int dy = (std::min)(y, n - y);
+            for (int x = 0; x < n; ++x)
+            {
+                const int dx = (std::min)(x, n - x);
+                const int rSqr = dx * dx + dy * dy + dz * dz;
+                m_grid[PaddedIndex(x, y, z)] = Complex((rSqr == 0) ? -1.0f : -1.0f / sqrt(float(rSqr)), 0.0f);
+            }
+        }
+    });
+    ForwardTransform(n);
+
+    //  It is real and even so its transform is real. Fold in the 1 / n^3 of the inverse transform.
+    const float scale = 1.0f / (float(n) * n * n);
+    m_greensFunction.resize(m_grid.size());
+    for (size_t i = 0; i < m_grid.size(); ++i)
+        m_greensFunction[i] = m_grid[i].real() * scale;
+}
+
+void NBodyParticleMesh::Integrate(ParticleCpu* const pParticlesIn, ParticleCpu* const pParticlesOut, int numParticles) const
+{
+    if (numParticles <= 0)
+        return;
+
+    //  Fit the grid around the bodies, each lies in [0, m_gridSize - 1) in grid units so all
+    //  eight of its CIC grid points are inside the grid.
+
+    float_3 minPos;
+    float_3 maxPos;
+    GetParticleBounds(pParticlesIn, numParticles, minPos, maxPos);
+    const float_3 extent = maxPos - minPos;
+    const float size = (std::max)((std::max)(extent.x, extent.y), (std::max)(extent.z, 1.0e-6f)) * 1.0001f;
+    const float cellSize = size / (m_gridSize - 1);
+    const float invCellSize = 1.0f / cellSize;
+
+    DepositMass(pParticlesIn, numParticles, minPos, invCellSize);
+    SolvePotential();
+    ComputeAcceleration(cellSize);
+
+    const int gridSize = m_gridSize;
+    const float_3* const pAcceleration = m_acceleration.data();
+    parallel_for(0, numParticles, kParticlesPerTask, [=](int first)
+    {
+        const int last = (std::min)(first + kParticlesPerTask, numParticles);
+        for (int i = first; i < last; ++i)
+        {
+            int cell[3];
+            float weight[3];
+            CloudInCell(pParticlesIn[i].pos, minPos, invCellSize, gridSize, cell, weight);
+
+            float_3 acc(0.0f);
+            for (int corner = 0; corner < 8; ++corner)
+            {
+                const int dx = corner & 1;
+                const int dy = (corner >> 1) & 1;
+                const int dz = (corner >> 2) & 1;
+                const float w = (dx ? weight[0] : 1.0f - weight[0]) * (dy ? weight[1] : 1.0f - weight[1]) * (dz ? weight[2] : 1.0f - weight[2]);
+                acc += pAcceleration[(cell[0] + dx) + gridSize * ((cell[1] + dy) + gridSize * (cell[2] + dz))] * w;
+            }
+
+            ParticleCpu& p = pParticlesOut[i];
+            p = pParticlesIn[i];
+            p.vel += acc * m_deltaTime;
+            p.vel *= m_dampingFactor;
+            p.pos += p.vel * m_deltaTime;
+        }
+    });
+}
+
+//  Deposit the mass of each body onto the grid with CIC weights.
+//
+//  Bodies that are close together write to the same grid points, so each task deposits
+//  into its own grid and the grids are then summed in a fixed order. This avoids locks or
+//  atomics and gives the same result whichever threads run the tasks.
+
+void NBodyParticleMesh::DepositMass(const ParticleCpu* const pParticles, int numParticles, const float_3& minPos, float invCellSize) const
+{
+    const int gridSize = m_gridSize;
+    const int gridPoints = gridSize * gridSize * gridSize;
+    const int tasks = (std::max)(1, (std::min)(static_cast<int>(CurrentScheduler::GetNumberOfVirtualProcessors()), numParticles / kParticlesPerTask));
+    m_partialMass.resize(tasks);
+
+    parallel_for(0, tasks, [=](int t)
+    {
+        std::vector<float>& mass = m_partialMass[t];
+        mass.assign(gridPoints, 0.0f);
+        const int first = static_cast<int>((static_cast<long long>(numParticles) * t) / tasks);
+        const int last = static_cast<int>((static_cast<long long>(numParticles) * (t + 1)) / tasks);
+        for (int i = first; i < last; ++i)
+        {
+            int cell[3];
+            float weight[3];
+            CloudInCell(pParticles[i].pos, minPos, invCellSize, gridSize, cell, weight);
+
+            for (int corner = 0; corner < 8; ++corner)
+            {
+                const int dx = corner & 1;
+                const int dy = (corner >> 1) & 1;
+                const int dz = (corner >> 2) & 1;
+                const float w = (dx ? weight[0] : 1.0f - weight[0]) * (dy ? weight[1] : 1.0f - weight[1]) * (dz ? weight[2] : 1.0f - weight[2]);
+                mass[(cell[0] + dx) + gridSize * ((cell[1] + dy) + gridSize * (cell[2] + dz))] += w * m_particleMass;
+            }
+        }
+    });
+
+    //  Sum the partial grids into the first octant of the padded grid and zero the rest.
+
+    const int n = m_paddedSize;
+    parallel_for(0, n, [=](int z)
+    {
+        for (int y = 0; y < n; ++y)
+        {
+            Complex* const pLine = &m_grid[PaddedIndex(0, y, z)];
+            if (z >= gridSize || y >= gridSize)
+            {
+                std::fill(pLine, pLine + n, Complex(0.0f, 0.0f));
+                continue;
+            }
+            for (int x = 0; x < gridSize; ++x)
+            {
+                const int i = x + gridSize * (y + gridSize * z);
+                float sum = 0.0f;
+                for (int t = 0; t < tasks; ++t)
+                    sum += m_partialMass[t][i];
+                pLine[x] = Complex(sum, 0.0f);
+            }
+            std::fill(pLine + gridSize, pLine + n, Complex(0.0f, 0.0f));
+        }
+    });
+}
+
+//  Convolve the mass with the Green's function. This leaves the potential, in grid units, at the
+//  points of m_grid that ComputeAcceleration reads.
+
+void NBodyParticleMesh::SolvePotential() const
+{
+    ForwardTransform(m_gridSize);
+
+    const int planeSize = m_paddedSize * m_paddedSize;
+    parallel_for(0, m_paddedSize, [=](int z)
+    {
+        for (int i = z * planeSize; i < (z + 1) * planeSize; ++i)
+            m_grid[i] *= m_greensFunction[i];
+    });
+
+    InverseTransform();
+}
+
+//  Acceleration at each grid point from central differences of the potential.
+//
+//  The points either side of the grid, at -1 and m_gridSize, are inside the padding where
+//  the convolution is still exact. -1 wraps around to the end of the padded grid.
+
+void NBodyParticleMesh::ComputeAcceleration(float cellSize) const
+{
+    const int gridSize = m_gridSize;
+    const int n = m_paddedSize;
+    const float scale = -1.0f / (2.0f * cellSize * cellSize);
+
+    parallel_for(0, gridSize, [=](int z)
+    {
+        const int zm = (z + n - 1) % n;
+        for (int y = 0; y < gridSize; ++y)
+        {
+            const int ym = (y + n - 1) % n;
+            for (int x = 0; x < gridSize; ++x)
+            {
+                const int xm = (x + n - 1) % n;
+                const float ax = m_grid[PaddedIndex(x + 1, y, z)].real() - m_grid[PaddedIndex(xm, y, z)].real();
+                const float ay = m_grid[PaddedIndex(x, y + 1, z)].real() - m_grid[PaddedIndex(x, ym, z)].real();
+                const float az = m_grid[PaddedIndex(x, y, z + 1)].real() - m_grid[PaddedIndex(x, y, zm)].real();
+                m_acceleration[x + gridSize * (y + gridSize * z)] = float_3(ax, ay, az) * scale;
+            }
+        }
+    });
+}
+
+//  In place radix 2 FFTs of width interleaved sequences. Element j of sequence x is at
+//  pFirst[j * stride + x], so width 1 transforms a single line and larger widths transform
+//  whole rows of the grid at once, with contiguous memory accesses. The inverse is not scaled.
+
+void NBodyParticleMesh::Transform(Complex* const pFirst, int stride, int width, bool inverse) const
+{
+    const int n = m_paddedSize;
+    for (int i = 0; i < n; ++i)
+    {
+        if (i < m_bitReverse[i])
+            std::swap_ranges(pFirst + i * stride, pFirst + i * stride + width, pFirst + m_bitReverse[i] * stride);
+    }
+
+    for (int half = 1; half < n; half *= 2)
+    {
+        const int twiddleStep = n / (2 * half);
+        for (int start = 0; start < n; start += 2 * half)
+        {
+            for (int k = 0; k < half; ++k)
+            {
+                const Complex w = m_twiddles[k * twiddleStep];
+                const float wr = w.real();
+                const float wi = inverse ? -w.imag() : w.imag();
+                Complex* const pA = pFirst + (start + k) * stride;
+                Complex* const pB = pA + half * stride;
+                for (int x = 0; x < width; ++x)
+                {
+                    //  Multiply written out in full, some libraries' operator* also handles infinities and NaNs.
+                    const Complex t(wr * pB[x].real() - wi * pB[x].imag(), wr * pB[x].imag() + wi * pB[x].real());
+                    pB[x] = pA[x] - t;
+                    pA[x] += t;
+                }
+            }
+        }
+    }
+}
+
+//  Forward 3D FFT of m_grid, one axis at a time. Only the first activeSize points along each
+//  axis are non zero, so lines that are entirely zero are skipped until an earlier pass has
+//  filled them in.
+
+void NBodyParticleMesh::ForwardTransform(int activeSize) const
+{
+    const int n = m_paddedSize;
+
+    //  Along x, one line at a time.
+    parallel_for(0, activeSize, [=](int z)
+    {
+        for (int y = 0; y < activeSize; ++y)
+            Transform(&m_grid[PaddedIndex(0, y, z)], 1, 1, false);
+    });
+
+    //  Along y, all the rows of an xy plane together.
+    parallel_for(0, activeSize, [=](int z)
+    {
+        Transform(&m_grid[PaddedIndex(0, 0, z)], n, n, false);
+    });
+
+    //  Along z, all the rows of an xz plane together.
+    parallel_for(0, n, [=](int y)
+    {
+        Transform(&m_grid[PaddedIndex(0, y, 0)], n * n, n, false);
+    });
+}
+
+//  Inverse 3D FFT of m_grid. The axes are taken in the opposite order so that the later passes
+//  only compute the lines ComputeAcceleration reads, those at -1 ... m_gridSize along each axis.
+
+void NBodyParticleMesh::InverseTransform() const
+{
+    const int n = m_paddedSize;
+    const int gridSize = m_gridSize;
+    const int needed = gridSize + 2;
+    auto neededIndex = [=](int i) { return (i <= gridSize) ? i : n - 1; };
+
+    parallel_for(0, n, [=](int y)
+    {
+        Transform(&m_grid[PaddedIndex(0, y, 0)], n * n, n, true);
+    });
+
+    parallel_for(0, needed, [=](int z)
+    {
+        Transform(&m_grid[PaddedIndex(0, 0, neededIndex(z))], n, n, true);
+    });
+
+    parallel_for(0, needed, [=](int z)
+    {
+        for (int y = 0; y < needed; ++y)
+            Transform(&m_grid[PaddedIndex(0, neededIndex(y), neededIndex(z))], 1, 1, true);
+    });
+}
@@ -0,0 +1,94 @@
+//===============================================================================
+//
+// Microsoft Press
+// C++ AMP: Accelerated Massive Parallelism with Microsoft Visual C++
+//
+//===============================================================================
+// Copyright (c) 2012 Ade Miller & Kate Gregory.  All rights reserved.
+// This code released under the terms of the 
+// Microsoft Public License (Ms-PL), http://ampbook.codeplex.com/license.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//===============================================================================
+
+
+#pragma once
+
+#include <amp_short_vectors.h>
+#include <complex>
+#include <vector>
+
+#include "INBodyCpu.h"
+#include "ParticleCpu.h"
+
+using namespace concurrency::graphics;
+
+//--------------------------------------------------------------------------------------
+//  Particle-mesh implementation of the n-body calculation.
+//--------------------------------------------------------------------------------------
+//
+//  Rather than summing forces between bodies this calculates the gravitational potential
+//  on a regular grid and interpolates the force at each body from it. Each step:
+//
+//  1. Fits a cube of gridSize^3 cells around the bodies and deposits each body's mass onto
+//     the eight nearest grid points with cloud-in-cell (CIC) weights.
+//  2. Convolves the mass with the Green's function of gravity, -1 / r, using FFTs. The
+//     mass grid is zero padded to twice its size in each dimension, so the convolution
+//     gives the potential of an isolated system rather than of a periodic one.
+//  3. Takes central differences of the potential to get the acceleration at each grid
+//     point, and interpolates it back to each body with the same CIC weights.
+//
+//  Each step costs O(N + G log G) for G grid points. The grid smooths the force over about
+//  a cell, which replaces the softening used by the other integrators. The force between
+//  bodies in the same or neighboring cells is underestimated, so this suits large, smooth
+//  distributions better than close encounters.
+//
+//  The FFT is a radix 2 transform applied along each axis in turn. The passes along y and z
+//  transform whole rows of the grid at once so that they access memory contiguously, and
+//  the planes of each pass are transformed in parallel. gridSize must be a power of two.
+//
+//  Like the simple integrators, this leaves the input unchanged and writes the new
+//  values to pParticlesOut.
+
+class NBodyParticleMesh : public INBodyCpu
+{
+private:
+    typedef std::complex<float> Complex;
+
+    const float m_dampingFactor;
+    const float m_deltaTime;
+    const float m_particleMass;
+    const int m_gridSize;                                       // Cells along each side of the grid holding the bodies.
+    const int m_paddedSize;                                     // Twice m_gridSize, the size of the FFT in each dimension.
+
+    std::vector<Complex> m_twiddles;                            // exp(-2 pi i k / m_paddedSize)
+    std::vector<int> m_bitReverse;
+    std::vector<float> m_greensFunction;                        // Transform of -1 / r in grid units, already scaled for the inverse FFT.
+
+    //  Working storage, kept between steps to avoid reallocating it.
+
+    mutable std::vector<std::vector<float>> m_partialMass;      // Mass deposited by each task.
+    mutable std::vector<Complex> m_grid;                        // Mass, then its transform, then the potential.
+    mutable std::vector<float_3> m_acceleration;
+
+public:
+    NBodyParticleMesh(float dampingFactor, float deltaTime, float particleMass, int gridSize);
+
+    void Integrate(ParticleCpu* const pParticlesIn, ParticleCpu* const pParticlesOut, int numParticles) const;
+
+private:
+    void DepositMass(const ParticleCpu* const pParticles, int numParticles, const float_3& minPos, float invCellSize) const;
+    void SolvePotential() const;
+    void ComputeAcceleration(float cellSize) const;
+    void Transform(Complex* const pFirst, int stride, int width, bool inverse) const;
+    void ForwardTransform(int activeSize) const;
+    void InverseTransform() const;
+
+    inline int PaddedIndex(int x, int y, int z) const
+    {
+        return x + m_paddedSize * (y + m_paddedSize * z);
+    }
+};
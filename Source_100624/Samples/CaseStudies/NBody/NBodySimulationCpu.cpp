@@ -0,0 +1,127 @@
+//===============================================================================
+//
+// Microsoft Press
+// C++ AMP: Accelerated Massive Parallelism with Microsoft Visual C++
+//
+//===============================================================================
+// Copyright (c) 2012 Ade Miller & Kate Gregory.  All rights reserved.
+// This code released under the terms of the 
+// Microsoft Public License (Ms-PL), http://ampbook.codeplex.com/license.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//===============================================================================
+
+
+#include <assert.h>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+
+#include "Common.h"
+#include "NBodySimulationCpu.h"
+#include "NBodyAdvancedCpu.h"
+#include "NBodyBarnesHutCpu.h"
+#include "NBodyParticleMeshCpu.h"
+#include "NBodySoACpu.h"
+
+//--------------------------------------------------------------------------------------
+//  Integrator class factory.
+//--------------------------------------------------------------------------------------
+
+std::shared_ptr<INBodyCpu> NBodyFactory(ComputeType type, const NBodyCpuSettings& settings)
+{
+    switch (type)
+    {
+    case kCpuSingle:
+        return std::make_shared<NBodySimpleSingleCore>(settings.softeningSquared, settings.dampingFactor, 
+            settings.deltaTime, settings.particleMass);
+        break;
+    case kCpuMulti:
+        return std::make_shared<NBodySimpleMultiCore>(settings.softeningSquared, settings.dampingFactor, 
+            settings.deltaTime, settings.particleMass);
+        break;
+    case kCpuAdvanced:
+        {
+            int tileSize = GetLevelOneCacheSize() / sizeof(ParticleCpu);
+            return std::make_shared<NBodyAdvanced>(settings.softeningSquared, settings.dampingFactor, 
+                settings.deltaTime, settings.particleMass, tileSize);
+        }
+        break;
+    case kCpuBarnesHut:
+        return std::make_shared<NBodyBarnesHut>(settings.softeningSquared, settings.dampingFactor, 
+            settings.deltaTime, settings.particleMass, settings.barnesHutTheta);
+        break;
+    case kCpuParticleMesh:
+        return std::make_shared<NBodyParticleMesh>(settings.dampingFactor, settings.deltaTime, 
+            settings.particleMass, settings.particleMeshGridSize);
+        break;
+    case kCpuSoA:
+        return std::make_shared<NBodySoA>(settings.softeningSquared, settings.dampingFactor, 
+            settings.deltaTime, settings.particleMass);
+        break;
+    default:
+        assert(false);
+        return nullptr;
+        break;
+    }
+}
+
+//--------------------------------------------------------------------------------------
+//  Initial conditions and snapshots.
+//--------------------------------------------------------------------------------------
+
+void LoadCollidingClusters(std::vector<ParticleCpu>& particles, float spread)
+{
+    const float centerSpread = spread * 0.50f;
+    const int numParticles = static_cast<int>(particles.size());
+    if (numParticles == 0)
+        return;
+
+    LoadClusterParticles(&particles[0],
+        float_3(centerSpread, 0.0f, 0.0f), 
+        float_3( 0, 0, -20),
+        spread, 
+        numParticles / 2);
+    LoadClusterParticles(&particles[numParticles / 2],
+        float_3(-centerSpread, 0.0f, 0.0f), 
+        float_3( 0, 0, 20),
+        spread, 
+        (numParticles + 1) / 2);
+}
+
+bool ReadParticles(const std::string& path, std::vector<ParticleCpu>& particles)
+{
+    std::ifstream file(path.c_str());
+    int numParticles = 0;
+    if (!(file >> numParticles) || numParticles < 0)
+        return false;
+
+    std::vector<ParticleCpu> result(numParticles);
+    for (ParticleCpu& p : result)
+    {
+        if (!(file >> p.pos.x >> p.pos.y >> p.pos.z >> p.vel.x >> p.vel.y >> p.vel.z))
+            return false;
+        p.acc = 0.0f;
+    }
+    particles.swap(result);
+    return true;
+}
+
+bool WriteParticles(const std::string& path, const ParticleCpu* const pParticles, int numParticles)
+{
+    std::ofstream file(path.c_str());
+    if (!file)
+        return false;
+
+    file << std::setprecision(std::numeric_limits<float>::max_digits10) << numParticles << "\n";
+    for (int i = 0; i < numParticles; ++i)
+    {
+        const ParticleCpu& p = pParticles[i];
+        file << p.pos.x << " " << p.pos.y << " " << p.pos.z << " " 
+            << p.vel.x << " " << p.vel.y << " " << p.vel.z << "\n";
+    }
+    return !file.fail();
+}
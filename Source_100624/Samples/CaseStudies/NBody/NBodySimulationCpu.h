@@ -0,0 +1,130 @@
+//===============================================================================
+//
+// Microsoft Press
+// C++ AMP: Accelerated Massive Parallelism with Microsoft Visual C++
+//
+//===============================================================================
+// Copyright (c) 2012 Ade Miller & Kate Gregory.  All rights reserved.
+// This code released under the terms of the 
+// Microsoft Public License (Ms-PL), http://ampbook.codeplex.com/license.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//===============================================================================
+
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "INBodyCpu.h"
+#include "ParticleCpu.h"
+#include "NBodyCpu.h"
+
+//--------------------------------------------------------------------------------------
+//  Integrator settings.
+//--------------------------------------------------------------------------------------
+//
+//  The physical constants and per integrator parameters. The defaults are the values used
+//  by the windowed sample.
+
+struct NBodyCpuSettings
+{
+    float softeningSquared;
+    float dampingFactor;
+    float particleMass;
+    float deltaTime;
+    float barnesHutTheta;                   // Opening angle for the Barnes-Hut integrator
+    int particleMeshGridSize;               // Grid cells along each side for the particle-mesh integrator, a power of two
+
+    NBodyCpuSettings() :
+        softeningSquared(0.0000015625f),
+        dampingFactor(0.9995f),
+        particleMass((6.67300e-11f*10000.0f)*10000.0f*10000.0f),
+        deltaTime(0.1f),
+        barnesHutTheta(0.5f),
+        particleMeshGridSize(64)
+    {
+    }
+};
+
+//  Integrator class factory.
+
+std::shared_ptr<INBodyCpu> NBodyFactory(ComputeType type, const NBodyCpuSettings& settings);
+
+//  The advanced integrator updates pParticlesIn in place, all the others write the new values
+//  to pParticlesOut so the caller swaps the buffers after each step.
+
+inline bool IntegratesInPlace(ComputeType type)
+{
+    return type == kCpuAdvanced;
+}
+
+//--------------------------------------------------------------------------------------
+//  A simulation without any rendering.
+//--------------------------------------------------------------------------------------
+//
+//  Owns the particle buffers for one integrator and steps it, swapping the buffers as
+//  OnFrameMove does in the windowed sample. Used by the headless benchmark, which has no
+//  window or Direct3D device.
+
+class NBodySimulationCpu
+{
+private:
+    ComputeType m_type;
+    std::shared_ptr<INBodyCpu> m_pNBody;
+    std::vector<ParticleCpu> m_particlesOld;
+    std::vector<ParticleCpu> m_particlesNew;
+    ParticleCpu* m_pParticlesOld;
+    ParticleCpu* m_pParticlesNew;
+
+public:
+    NBodySimulationCpu(ComputeType type, const NBodyCpuSettings& settings, const std::vector<ParticleCpu>& particles) :
+        m_type(type),
+        m_pNBody(NBodyFactory(type, settings))
+    {
+        Reset(particles);
+    }
+
+    //  Restart from new initial conditions. The integrator keeps any scratch memory it has
+    //  already allocated.
+
+    void Reset(const std::vector<ParticleCpu>& particles)
+    {
+        m_particlesOld = particles;
+        m_particlesNew = particles;
+        m_pParticlesOld = m_particlesOld.data();
+        m_pParticlesNew = m_particlesNew.data();
+    }
+
+    void Step()
+    {
+        m_pNBody->Integrate(m_pParticlesOld, m_pParticlesNew, GetNumParticles());
+        if (!IntegratesInPlace(m_type))
+            std::swap(m_pParticlesOld, m_pParticlesNew);
+    }
+
+    const ParticleCpu* GetParticles() const { return m_pParticlesOld; }
+
+    int GetNumParticles() const { return static_cast<int>(m_particlesOld.size()); }
+};
+
+//--------------------------------------------------------------------------------------
+//  Initial conditions and snapshots.
+//--------------------------------------------------------------------------------------
+
+//  Two clusters set to collide, the same initial conditions as the windowed sample.
+
+void LoadCollidingClusters(std::vector<ParticleCpu>& particles, float spread);
+
+//  Snapshots are text files with the number of particles on the first line followed by one
+//  line per particle with its position and velocity, "px py pz vx vy vz". Floats are written
+//  with enough digits to be read back exactly. Both return false if the file can't be opened
+//  or read.
+
+bool ReadParticles(const std::string& path, std::vector<ParticleCpu>& particles);
+bool WriteParticles(const std::string& path, const ParticleCpu* const pParticles, int numParticles);
@@ -0,0 +1,302 @@
+//===============================================================================
+//
+// Microsoft Press
+// C++ AMP: Accelerated Massive Parallelism with Microsoft Visual C++
+//
+//===============================================================================
+// Copyright (c) 2012 Ade Miller & Kate Gregory.  All rights reserved.
+// This code released under the terms of the 
+// Microsoft Public License (Ms-PL), http://ampbook.codeplex.com/license.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//===============================================================================
+
+
+#include <math.h>
+#include <ppl.h>
+#include <assert.h>
+#include <vector>
+#include <algorithm>
+#include <immintrin.h>
+
+#include "Common.h"
+#include "NBodySoACpu.h"
+#include "..\..\..\Extras\Simd\CpuFeatures.h"
+
+using namespace concurrency;
+using namespace concurrency::graphics;
+
+//--------------------------------------------------------------------------------------
+//  Structure of arrays particle positions.
+//--------------------------------------------------------------------------------------
+
+void PositionsSoA::Load(const ParticleCpu* const pParticles, int numParticles)
+{
+    const int paddedSize = (numParticles + kSoAPacketWidth - 1) / kSoAPacketWidth * kSoAPacketWidth;
+    std::vector<float>* const components[] = { &x, &y, &z };
+    for (std::vector<float>* pComponent : components)
+    {
+        pComponent->resize(paddedSize);
+        std::fill(pComponent->begin() + numParticles, pComponent->end(), 0.0f);
+    }
+
+    const int particlesPerTask = 1024;
+    parallel_for(0, numParticles, particlesPerTask, [=](int first)
+    {
+        const int last = (std::min)(first + particlesPerTask, numParticles);
+        for (int i = first; i < last; ++i)
+        {
+            x[i] = pParticles[i].pos.x;
+            y[i] = pParticles[i].pos.y;
+            z[i] = pParticles[i].pos.z;
+        }
+    });
+}
+
+//--------------------------------------------------------------------------------------
+//  The interaction engine for structure of arrays positions.
+//--------------------------------------------------------------------------------------
+
+//  Select the widest implementation the processor and the build support.
+
+void NBodySoAInteractionEngine::SelectCpuImplementation()
+{
+    const Extras::SimdLevel level = Extras::GetSimdLevel();
+#if defined(EXTRAS_SIMD_AVX512)
+    if (level >= Extras::SimdLevel::Avx512)
+    {
+        m_funcptr = &NBodySoAInteractionEngine::BodyBodyInteractionAVX512;
+        return;
+    }
+#endif
+#if defined(EXTRAS_SIMD_AVX2)
+    if (level >= Extras::SimdLevel::Avx2)
+    {
+        m_funcptr = &NBodySoAInteractionEngine::BodyBodyInteractionAVX2;
+        return;
+    }
+#endif
+    m_funcptr = &NBodySoAInteractionEngine::BodyBodyInteractionSSE;
+}
+
+void NBodySoAInteractionEngine::Integrate(const ParticleCpu& particleIn, ParticleCpu& particleOut, const float_3& acc) const
+{
+    float_3 vel(particleIn.vel);
+    vel += acc * m_deltaTime;
+    vel *= m_dampingFactor;
+
+    particleOut.pos = particleIn.pos + vel * m_deltaTime;
+    particleOut.vel = vel;
+    particleOut.acc = 0.0f;
+}
+
+//  Integrates the targets [iBegin, iEnd) of a register from the accelerations in its lanes. The
+//  callers clip iEnd to numParticles so results for the padding are dropped.
+
+void NBodySoAInteractionEngine::IntegrateTargets(const ParticleCpu* const pParticlesIn, ParticleCpu* const pParticlesOut, int iBegin, 
+    int iEnd, const float* const pAccX, const float* const pAccY, const float* const pAccZ) const
+{
+    for (int i = iBegin; i < iEnd; ++i)
+        Integrate(pParticlesIn[i], pParticlesOut[i], float_3(pAccX[i - iBegin], pAccY[i - iBegin], pAccZ[i - iBegin]));
+}
+
+void NBodySoAInteractionEngine::BodyBodyInteractionSSE(const PositionsSoA& positions, const ParticleCpu* const pParticlesIn,
+    ParticleCpu* const pParticlesOut, int iBegin, int iEnd, int numParticles) const
+{
+    const float* const pPosX = positions.x.data();
+    const float* const pPosY = positions.y.data();
+    const float* const pPosZ = positions.z.data();
+    const __m128 softeningSquared = _mm_set1_ps(m_softeningSquared);
+    const __m128 particleMass = _mm_set1_ps(m_particleMass);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 three = _mm_set1_ps(3.0f);
+
+    assert((iEnd - iBegin) % 4 == 0);
+    for (int i = iBegin; i < iEnd; i += 4)
+    {
+        const __m128 posX = _mm_loadu_ps(pPosX + i);
+        const __m128 posY = _mm_loadu_ps(pPosY + i);
+        const __m128 posZ = _mm_loadu_ps(pPosZ + i);
+        __m128 accX = _mm_setzero_ps();
+        __m128 accY = _mm_setzero_ps();
+        __m128 accZ = _mm_setzero_ps();
+
+        for (int j = 0; j < numParticles; ++j)
+        {
+            //const float_3 r = pParticles[j].pos - pos;
+            const __m128 rx = _mm_sub_ps(_mm_set1_ps(pPosX[j]), posX);
+            const __m128 ry = _mm_sub_ps(_mm_set1_ps(pPosY[j]), posY);
+            const __m128 rz = _mm_sub_ps(_mm_set1_ps(pPosZ[j]), posZ);
+
+            //float distSqr = SqrLength(r) + m_softeningSquared;
+            __m128 distSqr = _mm_add_ps(_mm_mul_ps(rx, rx), softeningSquared);
+            distSqr = _mm_add_ps(_mm_mul_ps(ry, ry), distSqr);
+            distSqr = _mm_add_ps(_mm_mul_ps(rz, rz), distSqr);
+
+            //float invDist = 1.0f / sqrt(distSqr);
+            //  Refine the 12 bit estimate with one Newton-Raphson step, y' = 0.5 * y * (3 - x * y * y).
+            __m128 invDist = _mm_rsqrt_ps(distSqr);
+            invDist = _mm_mul_ps(_mm_mul_ps(half, invDist), _mm_sub_ps(three, _mm_mul_ps(_mm_mul_ps(distSqr, invDist), invDist)));
+
+            //float invDistCube =  invDist * invDist * invDist;
+            //float s = m_particleMass * invDistCube;
+            const __m128 invDistCube = _mm_mul_ps(_mm_mul_ps(invDist, invDist), invDist);
+            const __m128 s = _mm_mul_ps(particleMass, invDistCube);
+
+            //acc += r * s;
+            accX = _mm_add_ps(_mm_mul_ps(rx, s), accX);
+            accY = _mm_add_ps(_mm_mul_ps(ry, s), accY);
+            accZ = _mm_add_ps(_mm_mul_ps(rz, s), accZ);
+        }
+
+        float acc[3][4];
+        _mm_storeu_ps(acc[0], accX);
+        _mm_storeu_ps(acc[1], accY);
+        _mm_storeu_ps(acc[2], accZ);
+        IntegrateTargets(pParticlesIn, pParticlesOut, i, (std::min)(i + 4, numParticles), acc[0], acc[1], acc[2]);
+    }
+}
+
+#if defined(EXTRAS_SIMD_AVX2)
+
+void NBodySoAInteractionEngine::BodyBodyInteractionAVX2(const PositionsSoA& positions, const ParticleCpu* const pParticlesIn,
+    ParticleCpu* const pParticlesOut, int iBegin, int iEnd, int numParticles) const
+{
+    const float* const pPosX = positions.x.data();
+    const float* const pPosY = positions.y.data();
+    const float* const pPosZ = positions.z.data();
+    const __m256 softeningSquared = _mm256_set1_ps(m_softeningSquared);
+    const __m256 particleMass = _mm256_set1_ps(m_particleMass);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 three = _mm256_set1_ps(3.0f);
+
+    assert((iEnd - iBegin) % 8 == 0);
+    for (int i = iBegin; i < iEnd; i += 8)
+    {
+        const __m256 posX = _mm256_loadu_ps(pPosX + i);
+        const __m256 posY = _mm256_loadu_ps(pPosY + i);
+        const __m256 posZ = _mm256_loadu_ps(pPosZ + i);
+        __m256 accX = _mm256_setzero_ps();
+        __m256 accY = _mm256_setzero_ps();
+        __m256 accZ = _mm256_setzero_ps();
+
+        for (int j = 0; j < numParticles; ++j)
+        {
+            //const float_3 r = pParticles[j].pos - pos;
+            const __m256 rx = _mm256_sub_ps(_mm256_broadcast_ss(pPosX + j), posX);
+            const __m256 ry = _mm256_sub_ps(_mm256_broadcast_ss(pPosY + j), posY);
+            const __m256 rz = _mm256_sub_ps(_mm256_broadcast_ss(pPosZ + j), posZ);
+
+            //float distSqr = SqrLength(r) + m_softeningSquared;
+            __m256 distSqr = _mm256_fmadd_ps(rx, rx, softeningSquared);
+            distSqr = _mm256_fmadd_ps(ry, ry, distSqr);
+            distSqr = _mm256_fmadd_ps(rz, rz, distSqr);
+
+            //float invDist = 1.0f / sqrt(distSqr);
+            //  Refine the 12 bit estimate with one Newton-Raphson step, y' = 0.5 * y * (3 - x * y * y).
+            __m256 invDist = _mm256_rsqrt_ps(distSqr);
+            invDist = _mm256_mul_ps(_mm256_mul_ps(half, invDist), _mm256_fnmadd_ps(_mm256_mul_ps(distSqr, invDist), invDist, three));
+
+            //float invDistCube =  invDist * invDist * invDist;
+            //float s = m_particleMass * invDistCube;
+            const __m256 invDistCube = _mm256_mul_ps(_mm256_mul_ps(invDist, invDist), invDist);
+            const __m256 s = _mm256_mul_ps(particleMass, invDistCube);
+
+            //acc += r * s;
+            accX = _mm256_fmadd_ps(rx, s, accX);
+            accY = _mm256_fmadd_ps(ry, s, accY);
+            accZ = _mm256_fmadd_ps(rz, s, accZ);
+        }
+
+        float acc[3][8];
+        _mm256_storeu_ps(acc[0], accX);
+        _mm256_storeu_ps(acc[1], accY);
+        _mm256_storeu_ps(acc[2], accZ);
+        IntegrateTargets(pParticlesIn, pParticlesOut, i, (std::min)(i + 8, numParticles), acc[0], acc[1], acc[2]);
+    }
+}
+
+#endif
+
+#if defined(EXTRAS_SIMD_AVX512)
+
+void NBodySoAInteractionEngine::BodyBodyInteractionAVX512(const PositionsSoA& positions, const ParticleCpu* const pParticlesIn,
+    ParticleCpu* const pParticlesOut, int iBegin, int iEnd, int numParticles) const
+{
+    const float* const pPosX = positions.x.data();
+    const float* const pPosY = positions.y.data();
+    const float* const pPosZ = positions.z.data();
+    const __m512 softeningSquared = _mm512_set1_ps(m_softeningSquared);
+    const __m512 particleMass = _mm512_set1_ps(m_particleMass);
+    const __m512 half = _mm512_set1_ps(0.5f);
+    const __m512 three = _mm512_set1_ps(3.0f);
+
+    assert((iEnd - iBegin) % 16 == 0);
+    for (int i = iBegin; i < iEnd; i += 16)
+    {
+        const __m512 posX = _mm512_loadu_ps(pPosX + i);
+        const __m512 posY = _mm512_loadu_ps(pPosY + i);
+        const __m512 posZ = _mm512_loadu_ps(pPosZ + i);
+        __m512 accX = _mm512_setzero_ps();
+        __m512 accY = _mm512_setzero_ps();
+        __m512 accZ = _mm512_setzero_ps();
+
+        for (int j = 0; j < numParticles; ++j)
+        {
+            //const float_3 r = pParticles[j].pos - pos;
+            const __m512 rx = _mm512_sub_ps(_mm512_set1_ps(pPosX[j]), posX);
+            const __m512 ry = _mm512_sub_ps(_mm512_set1_ps(pPosY[j]), posY);
+            const __m512 rz = _mm512_sub_ps(_mm512_set1_ps(pPosZ[j]), posZ);
+
+            //float distSqr = SqrLength(r) + m_softeningSquared;
+            __m512 distSqr = _mm512_fmadd_ps(rx, rx, softeningSquared);
+            distSqr = _mm512_fmadd_ps(ry, ry, distSqr);
+            distSqr = _mm512_fmadd_ps(rz, rz, distSqr);
+
+            //float invDist = 1.0f / sqrt(distSqr);
+            //  The AVX-512 estimate is good to 14 bits so one Newton-Raphson step gives full precision.
+            __m512 invDist = _mm512_rsqrt14_ps(distSqr);
+            invDist = _mm512_mul_ps(_mm512_mul_ps(half, invDist), _mm512_fnmadd_ps(_mm512_mul_ps(distSqr, invDist), invDist, three));
+
+            //float invDistCube =  invDist * invDist * invDist;
+            //float s = m_particleMass * invDistCube;
+            const __m512 invDistCube = _mm512_mul_ps(_mm512_mul_ps(invDist, invDist), invDist);
+            const __m512 s = _mm512_mul_ps(particleMass, invDistCube);
+
+            //acc += r * s;
+            accX = _mm512_fmadd_ps(rx, s, accX);
+            accY = _mm512_fmadd_ps(ry, s, accY);
+            accZ = _mm512_fmadd_ps(rz, s, accZ);
+        }
+
+        float acc[3][16];
+        _mm512_storeu_ps(acc[0], accX);
+        _mm512_storeu_ps(acc[1], accY);
+        _mm512_storeu_ps(acc[2], accZ);
+        IntegrateTargets(pParticlesIn, pParticlesOut, i, (std::min)(i + 16, numParticles), acc[0], acc[1], acc[2]);
+    }
+}
+
+#endif
+
+//--------------------------------------------------------------------------------------
+//  Parallel structure of arrays implementation of the n-body calculation.
+//--------------------------------------------------------------------------------------
+
+void NBodySoA::Integrate(ParticleCpu* const pParticlesIn, ParticleCpu* const pParticlesOut, int numParticles) const
+{
+    m_positions.Load(pParticlesIn, numParticles);
+
+    //  Each task updates a block of targets against every source. The padding particles at
+    //  the end of the arrays are targets but never sources.
+    const int targetsPerTask = 64;
+    const int paddedSize = m_positions.PaddedSize();
+    parallel_for(0, paddedSize, targetsPerTask, [=](int first)
+    {
+        m_engine->InvokeBodyBodyInteraction(m_positions, pParticlesIn, pParticlesOut, first, (std::min)(first + targetsPerTask, paddedSize), 
+            numParticles);
+    });
+}
@@ -0,0 +1,141 @@
+//===============================================================================
+//
+// Microsoft Press
+// C++ AMP: Accelerated Massive Parallelism with Microsoft Visual C++
+//
+//===============================================================================
+// Copyright (c) 2012 Ade Miller & Kate Gregory.  All rights reserved.
+// This code released under the terms of the 
+// Microsoft Public License (Ms-PL), http://ampbook.codeplex.com/license.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//===============================================================================
+
+
+#pragma once
+
+#include <amp_short_vectors.h>
+#include <vector>
+#include <memory>
+
+#include "INBodyCpu.h"
+#include "ParticleCpu.h"
+
+using namespace concurrency::graphics;
+
+//--------------------------------------------------------------------------------------
+//  Structure of arrays particle positions.
+//--------------------------------------------------------------------------------------
+//
+//  ParticleCpu stores each particle as padded float_3 values in a 64 byte record, so the
+//  SSE integrators hold one particle per __m128 with a quarter of each register unused and
+//  shuffle to calculate the dot product. The interaction loop only reads positions, so
+//  each step copies them into one array per component and a register holds the same
+//  component of 4, 8 or 16 particles. This scratch copy takes 12 bytes per particle,
+//  velocities are read from and results written to the ParticleCpu arrays directly.
+//
+//  The arrays are padded with particles at the origin to a multiple of kSoAPacketWidth, so
+//  the kernels always process whole registers of target particles. The padding is never
+//  used as a source and its results are discarded.
+
+const int kSoAPacketWidth = 16;
+
+struct PositionsSoA
+{
+    std::vector<float> x, y, z;
+
+    int PaddedSize() const { return static_cast<int>(x.size()); }
+
+    void Load(const ParticleCpu* const pParticles, int numParticles);
+};
+
+//--------------------------------------------------------------------------------------
+//  An integration engine for structure of arrays positions.
+//--------------------------------------------------------------------------------------
+//
+//  Each interaction function calculates the acceleration of the target particles
+//  [iBegin, iEnd) due to all numParticles source particles and integrates the targets from
+//  pParticlesIn to pParticlesOut. They broadcast one source to every lane and update a
+//  register of targets at a time: 4 with SSE, 8 with AVX2 and 16 with AVX-512. AVX2 and
+//  AVX-512 use fused multiply adds. All of them refine the hardware reciprocal square root
+//  estimate with a Newton-Raphson step, which is close to full single precision where the
+//  SSE integrators use the estimate alone.
+
+class NBodySoAInteractionEngine;
+
+typedef void (NBodySoAInteractionEngine::* NBodySoAFunc)(const PositionsSoA& positions, const ParticleCpu* const pParticlesIn,
+    ParticleCpu* const pParticlesOut, int iBegin, int iEnd, int numParticles) const;
+
+class NBodySoAInteractionEngine
+{
+private:
+    const float m_softeningSquared;
+    const float m_dampingFactor;
+    const float m_deltaTime;
+    const float m_particleMass;
+    NBodySoAFunc m_funcptr;
+
+public:
+    NBodySoAInteractionEngine(float softeningSquared, float dampingFactor, float deltaTime, float particleMass) :
+        m_softeningSquared(softeningSquared),
+        m_dampingFactor(dampingFactor),
+        m_deltaTime(deltaTime),
+        m_particleMass(particleMass),
+        m_funcptr(nullptr)
+    {
+        SelectCpuImplementation();
+    }
+
+    inline void InvokeBodyBodyInteraction(const PositionsSoA& positions, const ParticleCpu* const pParticlesIn,
+        ParticleCpu* const pParticlesOut, int iBegin, int iEnd, int numParticles) const
+    {
+        (this->*m_funcptr)(positions, pParticlesIn, pParticlesOut, iBegin, iEnd, numParticles);
+    };
+
+private:
+    void SelectCpuImplementation();
+
+    void Integrate(const ParticleCpu& particleIn, ParticleCpu& particleOut, const float_3& acc) const;
+    void IntegrateTargets(const ParticleCpu* const pParticlesIn, ParticleCpu* const pParticlesOut, int iBegin, int iEnd,
+        const float* const pAccX, const float* const pAccY, const float* const pAccZ) const;
+
+    // Different implementations of the body-body interaction.
+
+    void BodyBodyInteractionSSE(const PositionsSoA& positions, const ParticleCpu* const pParticlesIn,
+        ParticleCpu* const pParticlesOut, int iBegin, int iEnd, int numParticles) const;
+    void BodyBodyInteractionAVX2(const PositionsSoA& positions, const ParticleCpu* const pParticlesIn,
+        ParticleCpu* const pParticlesOut, int iBegin, int iEnd, int numParticles) const;
+    void BodyBodyInteractionAVX512(const PositionsSoA& positions, const ParticleCpu* const pParticlesIn,
+        ParticleCpu* const pParticlesOut, int iBegin, int iEnd, int numParticles) const;
+};
+
+//--------------------------------------------------------------------------------------
+//  Parallel structure of arrays implementation of the n-body calculation.
+//--------------------------------------------------------------------------------------
+//
+//  Calculates every interaction, like NBodySimpleMultiCore, reading source positions from
+//  the structure of arrays copy. The copy costs O(N) against the O(N^2) interactions.
+//  ParticleCpu itself is unchanged because its layout is shared with the HLSL renderer.
+//
+//  Like the simple integrators, this leaves the input unchanged and writes the new
+//  values to pParticlesOut. The output acceleration is zero, the advanced integrator
+//  accumulates into it and expects that at the start of a step.
+
+class NBodySoA : public INBodyCpu
+{
+private:
+    std::shared_ptr<NBodySoAInteractionEngine> m_engine;
+    mutable PositionsSoA m_positions;
+
+public:
+    NBodySoA(float softeningSquared, float dampingFactor, float deltaTime, float particleMass) :
+        INBodyCpu(),
+        m_engine(std::make_shared<NBodySoAInteractionEngine>(softeningSquared, dampingFactor, deltaTime, particleMass))
+    {
+    }
+
+    void Integrate(ParticleCpu* const pParticlesIn, ParticleCpu* const pParticlesOut, int numParticles) const;
+};
@@ -17,7 +17,13 @@
 #pragma once
 
 #include <amp_graphics.h>
+
+//  The headless benchmark defines NBODY_HEADLESS so the integrators build without the
+//  DirectX SDK.
+
+#ifndef NBODY_HEADLESS
 #include <d3dx9math.h>
+#endif
 
 using namespace concurrency::graphics;
 
@@ -36,6 +42,8 @@ inline float_3 PolarToCartesian(T r, T theta, T phi)
     return float_3(r * sin(theta) * cos(phi), r * sin(theta) * sin(phi), r * cos(theta));
 }
 
+#ifndef NBODY_HEADLESS
+
 //--------------------------------------------------------------------------------------
 //  D3D related data structures used by the GUI.
 //--------------------------------------------------------------------------------------
@@ -51,3 +59,5 @@ struct ResourceData
     D3DXMATRIX inverseView;
     D3DXCOLOR color;            // color value for changing particles color
 };
+
+#endif
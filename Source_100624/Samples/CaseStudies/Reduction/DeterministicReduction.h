@@ -0,0 +1,135 @@
+//===============================================================================
+//
+// Microsoft Press
+// C++ AMP: Accelerated Massive Parallelism with Microsoft Visual C++
+//
+//===============================================================================
+// Copyright (c) 2012 Ade Miller & Kate Gregory.  All rights reserved.
+// This code released under the terms of the 
+// Microsoft Public License (Ms-PL), http://ampbook.codeplex.com/license.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//===============================================================================
+
+//----------------------------------------------------------------------------
+// Floating point reductions that give the same bits on any number of cores,
+// see Extras\Reduction\DeterministicReduce.h. Each is paired with the fastest
+// non-deterministic float reduction on the same processor so the benchmark
+// shows what reproducibility costs. The integer source data is converted to
+// float before timing starts.
+//----------------------------------------------------------------------------
+
+#pragma once
+
+#include "IReduce.h"
+#include "Timer.h"
+#include <vector>
+#include <amp.h>
+#include <ppl.h>
+#include "..\..\..\Extras\Reduction\Reduce.h"
+#include "..\..\..\Extras\Reduction\DeterministicReduce.h"
+
+using namespace concurrency;
+
+//  The sample's total is above 2^24 so the non-deterministic float sums round and, unlike 
+//  the deterministic ones, don't reproduce the integer total exactly. How far they are off 
+//  depends on how the work was split. A single thread summing all 16M values in order comes 
+//  out about 6% low, so this is a loose bound that still catches a wrong sum.
+
+const double kFloatSumTolerance = 0.1;
+
+inline std::vector<float> ToFloat(const std::vector<int>& source)
+{
+    return std::vector<float>(source.cbegin(), source.cend());
+}
+
+class ParallelFloatReduction : public IReduce
+{
+public:
+    int Reduce(accelerator_view& view, const std::vector<int>& source, double& computeTime) const
+    {
+        const std::vector<float> data = ToFloat(source);
+        float total;
+        computeTime = TimeFunc(view, [&]()
+        {
+            total = parallel_reduce(data.cbegin(), data.cend(), 0.0f, std::plus<float>());
+        });
+        return int(total);
+    }
+
+    double RelativeTolerance() const { return kFloatSumTolerance; }
+};
+
+class FixedTreeCpuReduction : public IReduce
+{
+public:
+    int Reduce(accelerator_view& view, const std::vector<int>& source, double& computeTime) const
+    {
+        const std::vector<float> data = ToFloat(source);
+        float total;
+        computeTime = TimeFunc(view, [&]()
+        {
+            total = Extras::FixedTreeSumCpu(data.data(), data.size());
+        });
+        return int(total);
+    }
+};
+
+class ExactCpuReduction : public IReduce
+{
+public:
+    int Reduce(accelerator_view& view, const std::vector<int>& source, double& computeTime) const
+    {
+        const std::vector<float> data = ToFloat(source);
+        float total;
+        computeTime = TimeFunc(view, [&]()
+        {
+            total = Extras::ExactSum(data.data(), data.size());
+        });
+        return int(total);
+    }
+};
+
+template <int TileSize, int TileCount>
+class AmpFloatReduction : public IReduce
+{
+public:
+    int Reduce(accelerator_view& view, const std::vector<int>& source, double& computeTime) const
+    {
+        if (accelerator(accelerator::default_accelerator).is_emulated)
+            return -1;
+
+        const std::vector<float> data = ToFloat(source);
+        array<float, 1> a(int(data.size()), data.cbegin(), data.cend(), view);
+        float total;
+        computeTime = TimeFunc(view, [&]()
+        {
+            total = Extras::Reduce<TileSize, TileCount>(view, array_view<const float, 1>(a), Extras::SumOp<float>());
+        });
+        return int(total);
+    }
+
+    double RelativeTolerance() const { return kFloatSumTolerance; }
+};
+
+class FixedTreeAmpReduction : public IReduce
+{
+public:
+    int Reduce(accelerator_view& view, const std::vector<int>& source, double& computeTime) const
+    {
+        if (accelerator(accelerator::default_accelerator).is_emulated)
+            return -1;
+
+        const std::vector<float> data = ToFloat(source);
+        array<float, 1> a(int(data.size()), data.cbegin(), data.cend(), view);
+        float total;
+        computeTime = TimeFunc(view, [&]()
+        {
+            total = Extras::FixedTreeSum(view, array_view<const float, 1>(a));
+        });
+        return int(total);
+    }
+};
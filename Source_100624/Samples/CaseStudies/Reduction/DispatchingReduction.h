@@ -0,0 +1,204 @@
+//===============================================================================
+//
+// Microsoft Press
+// C++ AMP: Accelerated Massive Parallelism with Microsoft Visual C++
+//
+//===============================================================================
+// Copyright (c) 2012 Ade Miller & Kate Gregory.  All rights reserved.
+// This code released under the terms of the 
+// Microsoft Public License (Ms-PL), http://ampbook.codeplex.com/license.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//===============================================================================
+
+//----------------------------------------------------------------------------
+// A reducer that chooses one of the other implementations, and its tile
+// size and count, from the number of elements. Small inputs are fastest on
+// the CPU while large ones pay for the copy to the GPU.
+//
+// The crossover points depend on the machine, so they are measured by a
+// calibration run the first time it is used. The results are saved to a
+// profile file along with the accelerator and processor count they were
+// measured on. The profile is reused until either changes. Delete the file
+// to recalibrate.
+//
+// Only implementations that accept any number of elements are candidates.
+//----------------------------------------------------------------------------
+
+#pragma once
+
+#include "IReduce.h"
+#include "Timer.h"
+#include <vector>
+#include <memory>
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <iostream>
+#include <float.h>
+#include <ppl.h>
+#include "SequentialReduction.h"
+#include "ParallelReduction.h"
+#include "SimdReduction.h"
+#include "GenericReduction.h"
+
+using namespace concurrency;
+
+class DispatchingReduction : public IReduce
+{
+public:
+    DispatchingReduction(const std::wstring& profilePath) : m_profilePath(profilePath)
+    {
+        AddCandidate(std::make_shared<SequentialReduction>(),           L"CPU sequential");
+        AddCandidate(std::make_shared<ParallelReduction>(),             L"CPU parallel");
+        AddCandidate(std::make_shared<SimdSequentialReduction>(),       L"CPU sequential SIMD");
+        AddCandidate(std::make_shared<SimdParallelReduction>(),         L"CPU parallel SIMD");
+        AddCandidate(std::make_shared<GenericReduction<128, 32>>(),     L"C++ AMP generic reduction 128 x 32");
+        AddCandidate(std::make_shared<GenericReduction<256, 64>>(),     L"C++ AMP generic reduction 256 x 64");
+        AddCandidate(std::make_shared<GenericReduction<512, 128>>(),    L"C++ AMP generic reduction 512 x 128");
+        AddCandidate(std::make_shared<GenericReduction<1024, 128>>(),   L"C++ AMP generic reduction 1024 x 128");
+    }
+
+    int Reduce(accelerator_view& view, const std::vector<int>& source, double& computeTime) const
+    {
+        EnsureProfile(view);
+        return m_candidates[Select(source.size())].reducer->Reduce(view, source, computeTime);
+    }
+
+    //  The name of the implementation used for elementCount elements.
+    std::wstring Selected(accelerator_view& view, size_t elementCount) const
+    {
+        EnsureProfile(view);
+        return m_candidates[Select(elementCount)].name;
+    }
+
+private:
+    struct Candidate
+    {
+        std::shared_ptr<IReduce> reducer;
+        std::wstring name;
+    };
+
+    //  Use candidate from minimumSize elements up to the next threshold.
+    struct Threshold
+    {
+        size_t minimumSize;
+        size_t candidate;
+    };
+
+    void AddCandidate(const std::shared_ptr<IReduce>& reducer, const std::wstring& name)
+    {
+        Candidate c = { reducer, name };
+        m_candidates.push_back(c);
+    }
+
+    void EnsureProfile(accelerator_view& view) const
+    {
+        if (!m_thresholds.empty() || LoadProfile(view))
+            return;
+
+        std::wcout << "Calibrating the dispatching reduction, saving results to " << m_profilePath << std::endl;
+        Calibrate(view);
+        SaveProfile(view);
+    }
+
+    size_t Select(size_t elementCount) const
+    {
+        size_t selected = m_thresholds[0].candidate;
+        for (size_t i = 1; i < m_thresholds.size() && m_thresholds[i].minimumSize <= elementCount; ++i)
+            selected = m_thresholds[i].candidate;
+        return selected;
+    }
+
+    static std::wstring MachineKey(accelerator_view& view)
+    {
+        std::wostringstream key;
+        key << view.get_accelerator().get_description() << L" (" << view.get_accelerator().get_device_path() << L") "
+            << CurrentScheduler::GetNumberOfVirtualProcessors() << L" processors";
+        return key.str();
+    }
+
+    //  Time each candidate at sizes from 1K to 16M elements, keeping the fastest correct one.
+    void Calibrate(accelerator_view& view) const
+    {
+        m_thresholds.clear();
+        for (size_t elementCount = 1024; elementCount <= 16 * 1024 * 1024; elementCount *= 4)
+        {
+            std::vector<int> source(elementCount);
+            int i = 0;
+            std::generate(source.begin(), source.end(), [&i]() { return (i++ & 0xf); });
+            const int expectedResult = int((elementCount / 16) * ((15 * 16) / 2));
+
+            size_t best = 0;
+            double bestTime = DBL_MAX;
+            for (size_t c = 0; c < m_candidates.size(); ++c)
+            {
+                const IReduce* reducer = m_candidates[c].reducer.get();
+                double computeTime;
+                int result = 0;
+                double time = JitAndTimeFunc(view, [&]() { result = reducer->Reduce(view, source, computeTime); });
+                if (result != expectedResult)
+                    continue;
+                for (int repeat = 0; repeat < 2; ++repeat)
+                    time = (std::min)(time, TimeFunc(view, [&]() { reducer->Reduce(view, source, computeTime); }));
+                if (time < bestTime)
+                {
+                    bestTime = time;
+                    best = c;
+                }
+            }
+
+            if (m_thresholds.empty() || m_thresholds.back().candidate != best)
+            {
+                Threshold t = { m_thresholds.empty() ? 0 : elementCount, best };
+                m_thresholds.push_back(t);
+            }
+        }
+    }
+
+    //  The profile is the machine key followed by one "minimumSize<tab>name" line per threshold.
+    bool LoadProfile(accelerator_view& view) const
+    {
+        std::wifstream file(m_profilePath);
+        std::wstring key;
+        if (!std::getline(file, key) || key != MachineKey(view))
+            return false;
+
+        std::vector<Threshold> thresholds;
+        std::wstring line;
+        while (std::getline(file, line))
+        {
+            const size_t tab = line.find(L'\t');
+            const std::wstring name = (tab == std::wstring::npos) ? std::wstring() : line.substr(tab + 1);
+            size_t c = 0;
+            while (c < m_candidates.size() && m_candidates[c].name != name)
+                ++c;
+
+            //  A profile written with different candidates is recalibrated.
+            if (c == m_candidates.size())
+                return false;
+            Threshold t = { size_t(_wtoi64(line.substr(0, tab).c_str())), c };
+            thresholds.push_back(t);
+        }
+        if (thresholds.empty() || thresholds[0].minimumSize != 0)
+            return false;
+
+        m_thresholds.swap(thresholds);
+        return true;
+    }
+
+    void SaveProfile(accelerator_view& view) const
+    {
+        std::wofstream file(m_profilePath);
+        file << MachineKey(view) << std::endl;
+        for (size_t i = 0; i < m_thresholds.size(); ++i)
+            file << m_thresholds[i].minimumSize << L'\t' << m_candidates[m_thresholds[i].candidate].name << std::endl;
+    }
+
+    std::wstring m_profilePath;
+    std::vector<Candidate> m_candidates;
+    mutable std::vector<Threshold> m_thresholds;
+};
@@ -0,0 +1,72 @@
+//===============================================================================
+//
+// Microsoft Press
+// C++ AMP: Accelerated Massive Parallelism with Microsoft Visual C++
+//
+//===============================================================================
+// Copyright (c) 2012 Ade Miller & Kate Gregory.  All rights reserved.
+// This code released under the terms of the 
+// Microsoft Public License (Ms-PL), http://ampbook.codeplex.com/license.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//===============================================================================
+
+//----------------------------------------------------------------------------
+// The cascading reduction written once as a template over element type and
+// operator, see Extras\Reduction\Reduce.h. The second version computes sum,
+// sum of squares, count, minimum and maximum in the same single pass, which
+// shows what the extra outputs cost compared to reading the data again.
+//----------------------------------------------------------------------------
+
+#pragma once
+
+#include "IReduce.h"
+#include "Timer.h"
+#include <vector>
+#include <amp.h>
+#include "..\..\..\Extras\Reduction\Reduce.h"
+
+using namespace concurrency;
+
+template <int TileSize, int TileCount>
+class GenericReduction : public IReduce
+{
+public:
+    int Reduce(accelerator_view& view, const std::vector<int>& source, double& computeTime) const
+    {
+        if (accelerator(accelerator::default_accelerator).is_emulated)
+            return -1;
+
+        array<int, 1> a(int(source.size()), source.cbegin(), source.cend(), view);
+
+        int result;
+        computeTime = TimeFunc(view, [&]()
+        {
+            result = Extras::Reduce<TileSize, TileCount>(view, array_view<const int, 1>(a), Extras::SumOp<int>());
+        });
+        return result;
+    }
+};
+
+class GenericStatisticsReduction : public IReduce
+{
+public:
+    int Reduce(accelerator_view& view, const std::vector<int>& source, double& computeTime) const
+    {
+        if (accelerator(accelerator::default_accelerator).is_emulated)
+            return -1;
+
+        array<int, 1> a(int(source.size()), source.cbegin(), source.cend(), view);
+
+        //  The benchmark data is small and non-negative so 32 bit unsigned sums of squares can't overflow.
+        Extras::Statistics<int, unsigned> stats;
+        computeTime = TimeFunc(view, [&]()
+        {
+            stats = Extras::ComputeStatistics<unsigned>(view, array_view<const int, 1>(a));
+        });
+        return (stats.count == int(source.size())) ? int(stats.sum) : 0;
+    }
+};
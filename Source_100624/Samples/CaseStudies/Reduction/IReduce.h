@@ -25,4 +25,8 @@ class IReduce
 public:
     virtual int Reduce(accelerator_view& view, 
         const std::vector<int>& source, double& computeTime) const = 0;
+
+    //  Float reductions whose partial sums pass 2^24 round, so their result is checked 
+    //  against the expected total with this relative tolerance. Exact reductions use zero.
+    virtual double RelativeTolerance() const { return 0.0; }
 };
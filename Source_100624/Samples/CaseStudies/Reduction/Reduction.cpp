@@ -24,6 +24,7 @@
 #include <numeric> 
 #include <algorithm>
 #include <assert.h>
+#include <cmath>
 
 #include "Timer.h"
 #include "IReduce.h"
@@ -41,6 +42,11 @@
 #include "TiledMinimizedDivergenceConflictsAndStallingUnrolledReduction.h"
 #include "CascadingReduction.h"
 #include "CascadingUnrolledReduction.h"
+#include "GenericReduction.h"
+#include "DeterministicReduction.h"
+#include "SimdReduction.h"
+#include "StreamingReduction.h"
+#include "DispatchingReduction.h"
 
 #ifdef MARKERS
 #include <cvmarkersobj.h>
@@ -57,8 +63,15 @@ typedef std::pair<std::shared_ptr<IReduce>, std::wstring> ReducerDescription;
 
 inline bool validateSizes(unsigned tileSize, unsigned elementCount);
 
-void main()
+void wmain(int argc, wchar_t* argv[])
 {
+    //  Pass the path of a binary file of ints to stream it from disk instead.
+    if (argc > 1)
+    {
+        RunStreamingReduction(argv[1]);
+        return;
+    }
+
     //  Uncomment this to use the WARP accelerator even if a GPU is present.
     //accelerator::set_default(accelerator::direct3d_warp);
 
@@ -100,10 +113,12 @@ void main()
     const int expectedResult = int((elementCount / 16) * ((15 * 16) / 2));
 
     std::vector<ReducerDescription> reducers;
-    reducers.reserve(14);
+    reducers.reserve(24);
     reducers.push_back(ReducerDescription(std::make_shared<DummyReduction>(),                                                           L"Overhead"));
     reducers.push_back(ReducerDescription(std::make_shared<SequentialReduction>(),                                                      L"CPU sequential"));
     reducers.push_back(ReducerDescription(std::make_shared<ParallelReduction>(),                                                        L"CPU parallel"));
+    reducers.push_back(ReducerDescription(std::make_shared<SimdSequentialReduction>(),                                                  L"CPU sequential SIMD"));
+    reducers.push_back(ReducerDescription(std::make_shared<SimdParallelReduction>(),                                                    L"CPU parallel SIMD"));
     reducers.push_back(ReducerDescription(std::make_shared<SimpleReduction>(),                                                          L"C++ AMP simple model"));
     reducers.push_back(ReducerDescription(std::make_shared<SimpleArrayViewReduction>(),                                                 L"C++ AMP simple model using array_view"));
     reducers.push_back(ReducerDescription(std::make_shared<SimpleOptimizedReduction>(),                                                 L"C++ AMP simple model optimized"));
@@ -115,6 +130,14 @@ void main()
     reducers.push_back(ReducerDescription(std::make_shared<TiledMinimizedDivergenceConflictsAndStallingUnrolledReduction<tileSize>>(),  L"C++ AMP tiled model & unrolling"));
     reducers.push_back(ReducerDescription(std::make_shared<CascadingReduction<tileSize, tileCount>>(),                                  L"C++ AMP cascading reduction"));
     reducers.push_back(ReducerDescription(std::make_shared<CascadingUnrolledReduction<tileSize, tileCount>>(),                          L"C++ AMP cascading reduction & unrolling"));
+    reducers.push_back(ReducerDescription(std::make_shared<GenericReduction<tileSize, tileCount>>(),                                    L"C++ AMP generic reduction"));
+    reducers.push_back(ReducerDescription(std::make_shared<GenericStatisticsReduction>(),                                               L"C++ AMP generic single pass statistics"));
+    reducers.push_back(ReducerDescription(std::make_shared<ParallelFloatReduction>(),                                                   L"CPU parallel float"));
+    reducers.push_back(ReducerDescription(std::make_shared<FixedTreeCpuReduction>(),                                                    L"CPU float fixed tree (deterministic)"));
+    reducers.push_back(ReducerDescription(std::make_shared<ExactCpuReduction>(),                                                        L"CPU float exact sum (deterministic)"));
+    reducers.push_back(ReducerDescription(std::make_shared<AmpFloatReduction<tileSize, tileCount>>(),                                   L"C++ AMP float cascading"));
+    reducers.push_back(ReducerDescription(std::make_shared<FixedTreeAmpReduction>(),                                                    L"C++ AMP float fixed tree (deterministic)"));
+    reducers.push_back(ReducerDescription(std::make_shared<DispatchingReduction>(L"ReductionProfile.txt"),                              L"Dispatching reduction (calibrated)"));
 
     std::wcout << std::endl << "                                                           Total : Calc" << std::endl << std::endl;
 
@@ -139,14 +162,18 @@ void main()
             std::wcout << "SKIPPED: " << reducerName << " - Accelerator not supported." << std::endl;
             continue;
         }
-        if (expectedResult != result)
+        //  Always report the time, a failed result still shows what the reducer costs.
+        const double error = std::abs(double(result) - double(expectedResult));
+        if (error > reducerImpl->RelativeTolerance() * double(expectedResult))
         {
             std::wcout << "FAILED:  " << reducerName << " expected " << expectedResult << std::endl 
                 << "         but found " << result << std::endl;
-            continue;
+            std::wcout << "         " << reducerName;
+        }
+        else
+        {
+            std::wcout << "SUCCESS: " << reducerName;
         }
-        
-        std::wcout << "SUCCESS: " << reducerName;
         std::wcout.width(max(0, 55 - reducerName.length()));
         std::wcout << std::right << std::fixed << std::setprecision(2) << totalTime << " : " << computeTime << " (ms)" << std::endl;        
     }
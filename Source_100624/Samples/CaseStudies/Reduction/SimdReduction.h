@@ -0,0 +1,58 @@
+//===============================================================================
+//
+// Microsoft Press
+// C++ AMP: Accelerated Massive Parallelism with Microsoft Visual C++
+//
+//===============================================================================
+// Copyright (c) 2012 Ade Miller & Kate Gregory.  All rights reserved.
+// This code released under the terms of the 
+// Microsoft Public License (Ms-PL), http://ampbook.codeplex.com/license.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//===============================================================================
+
+//----------------------------------------------------------------------------
+// CPU implementations using several SSE2 accumulators per thread, see
+// Extras\Reduction\ReduceCpu.h. Compare with the sequential and parallel
+// CPU implementations above.
+//----------------------------------------------------------------------------
+
+#pragma once
+
+#include "IReduce.h"
+#include "Timer.h"
+#include <vector>
+#include "..\..\..\Extras\Reduction\ReduceCpu.h"
+
+using namespace concurrency;
+
+class SimdSequentialReduction : public IReduce
+{
+public:
+    int Reduce(accelerator_view& view, const std::vector<int>& source, double& computeTime) const
+    {
+        int total;
+        computeTime = TimeFunc(view, [&]()
+        {
+            total = Extras::SumSimd(source.data(), source.size());
+        });
+        return total;
+    }
+};
+
+class SimdParallelReduction : public IReduce
+{
+public:
+    int Reduce(accelerator_view& view, const std::vector<int>& source, double& computeTime) const
+    {
+        int total;
+        computeTime = TimeFunc(view, [&]()
+        {
+            total = Extras::SumParallel(source.data(), source.size());
+        });
+        return total;
+    }
+};
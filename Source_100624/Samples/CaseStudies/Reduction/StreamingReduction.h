@@ -0,0 +1,83 @@
+//===============================================================================
+//
+// Microsoft Press
+// C++ AMP: Accelerated Massive Parallelism with Microsoft Visual C++
+//
+//===============================================================================
+// Copyright (c) 2012 Ade Miller & Kate Gregory.  All rights reserved.
+// This code released under the terms of the 
+// Microsoft Public License (Ms-PL), http://ampbook.codeplex.com/license.
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//===============================================================================
+
+//----------------------------------------------------------------------------
+// Streaming reduction of a file of ints too large to load, see
+// Extras\Reduction\StreamReduce.h. Each chunk is summed with the CPU SIMD
+// reduction while the following chunks are read. Copying each chunk to the
+// GPU would cost more than summing it on the CPU.
+//
+// The file is read first without any computation to measure the raw read
+// bandwidth, then reduced, both through the file system cache and directly
+// from the disk.
+//----------------------------------------------------------------------------
+
+#pragma once
+
+#include "Timer.h"
+#include <iostream>
+#include <iomanip>
+#include "..\..\..\Extras\Reduction\Reduce.h"
+#include "..\..\..\Extras\Reduction\ReduceCpu.h"
+#include "..\..\..\Extras\Reduction\StreamReduce.h"
+
+inline double StreamGBps(unsigned long long bytes, double ms)
+{
+    return (ms > 0.0) ? double(bytes) / (ms * 1.0e6) : 0.0;
+}
+
+inline void RunStreamingReduction(const wchar_t* path)
+{
+    std::wcout << "Streaming reduction of " << path << std::endl << std::endl;
+
+    const wchar_t* modes[] = { L"File cache", L"Unbuffered" };
+    for (int unbuffered = 0; unbuffered < 2; ++unbuffered)
+    {
+        try
+        {
+            LARGE_INTEGER start, end;
+            unsigned long long bytes;
+
+            QueryPerformanceCounter(&start);
+            {
+                Extras::FileChunkReader reader(path, Extras::kStreamChunkBytes, Extras::kStreamReadAhead, unbuffered != 0);
+                bytes = reader.Size();
+                Extras::StreamReduce<int>(reader, [](const int*, size_t) { return 0; }, Extras::SumOp<int>());
+            }
+            QueryPerformanceCounter(&end);
+            const double readTime = ElapsedTime(start, end);
+
+            int total;
+            QueryPerformanceCounter(&start);
+            {
+                Extras::FileChunkReader reader(path, Extras::kStreamChunkBytes, Extras::kStreamReadAhead, unbuffered != 0);
+                total = Extras::StreamReduce<int>(reader, [](const int* pData, size_t count) { return Extras::SumParallel(pData, count); }, Extras::SumOp<int>());
+            }
+            QueryPerformanceCounter(&end);
+            const double reduceTime = ElapsedTime(start, end);
+
+            std::wcout << modes[unbuffered] << ": " << bytes / (1024 * 1024) << " MB, total " << total << std::endl;
+            std::wcout << std::fixed << std::setprecision(2)
+                << "    Read only  " << std::setw(10) << readTime << " (ms) " << StreamGBps(bytes, readTime) << " GB/s" << std::endl
+                << "    Reduce     " << std::setw(10) << reduceTime << " (ms) " << StreamGBps(bytes, reduceTime) << " GB/s" << std::endl;
+        }
+        catch (HRESULT hr)
+        {
+            std::wcout << modes[unbuffered] << ": FAILED to read file, HRESULT 0x" << std::hex << hr << std::dec << std::endl;
+        }
+    }
+    std::wcout << std::endl;
+}
@@ -25,6 +25,7 @@
 #include <d3d11.h>
 
 #include "Timer.h"
+#include "..\..\Extras\Scan\RadixSort.h"
 
 using namespace concurrency;
 using namespace concurrency::precise_math;
@@ -431,7 +432,23 @@ void DivergentDataExample()
     });
     std::wcout << "   Random data time:  " << elapsedTime << " (ms)" << std::endl;
 
-    std::sort(data.begin(), data.end(), std::greater<float>());
+    //  Any order that groups the positive values works, descending keeps them at the front as before.
+    //  Time std::sort on a copy of the same data to show what the radix sort saves.
+    std::vector<float> stdSorted(data);
+    LARGE_INTEGER start, end;
+    QueryPerformanceCounter(&start);
+    std::sort(stdSorted.begin(), stdSorted.end(), std::greater<float>());
+    QueryPerformanceCounter(&end);
+    const double stdSortTime = ElapsedTime(start, end);
+
+    QueryPerformanceCounter(&start);
+    Extras::RadixSort(data.data(), data.size());
+    std::reverse(data.begin(), data.end());
+    QueryPerformanceCounter(&end);
+    const double radixSortTime = ElapsedTime(start, end);
+    std::wcout << "   std::sort time:    " << stdSortTime << " (ms)" << std::endl;
+    std::wcout << "   RadixSort time:    " << radixSortTime << " (ms), "
+        << stdSortTime / radixSortTime << "x faster" << std::endl;
 
     gpuData = array<float, 1>(int(data.size()), data.begin(), data.end());
     elapsedTime = TimeFunc(view, [&]() 